@@ -0,0 +1,671 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/Mixer.h"
+#include "Audio/Sinks/NullSink.h"
+#include "Audio/Sinks/WavFileSink.h"
+#include "Audio/ToneSets/AdpcmClip.h"
+#include "Audio/ToneSets/ClickSynth.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+	const uint32_t ChannelCount = 2;
+
+	// A decaying sine, roughly the shape of a wood block click, or of a bell when given a long, slow decay
+	std::vector<float> MakeClick(float frequency, int lengthFrames, float decayPerSecond = 60.0f)
+	{
+		std::vector<float> click(lengthFrames);
+		for (int i = 0; i < lengthFrames; i++) {
+			const float t = (float)i / (float)SampleRate;
+			click[i] = 0.5f * sinf(6.2831853f * frequency * t) * expf(-t * decayPerSecond);
+		}
+		return click;
+	}
+
+	// Owns a pair of clicks for an engine to play
+	struct ClickPair {
+		std::vector<float> accent;
+		std::vector<float> normal;
+
+		audio::ToneSetView View() const {
+			return { { accent.data(), (uint32_t)accent.size() }, { normal.data(), (uint32_t)normal.size() } };
+		}
+	};
+
+	// One patch of each synthesised shape, decaying like MakeClick's bell so they ring for about a second
+	const std::pair<const char*, audio::ClickPatch> SynthesisedBells[] = {
+		{ "noise_burst", audio::ClickPatch::NoiseBurst(1500.0f, 400.0f, 0.145f, 0.5f) },
+		{ "filtered_sine", audio::ClickPatch::FilteredSine(1500.0f, 0.5f, 0.145f, 0.5f) },
+		{ "fm_bell", audio::ClickPatch::FmBell(1500.0f, 1.4f, 3.0f, 0.145f, 0.5f) }
+	};
+
+	// Single-sample clicks, so that every onset can be located exactly in the rendered output
+	const ClickPair& ImpulseClicks()
+	{
+		static const ClickPair impulses = { { 1.0f }, { 1.0f } };
+		return impulses;
+	}
+
+	// Sections of 2 to 9 bars in assorted time signatures and tempos, with the first step of every bar accented
+	// so that bar lines can be found from the onsets
+	std::unique_ptr<audio::SongTimeline> MakeTimerSong(std::mt19937& random)
+	{
+		audio::Song song;
+		for (int i = 0; i < 6; i++) {
+			audio::SongSection section = { "Section", 2 + (int)(random() % 6), 4, 1 + (int)(random() % 3), 2 + (int)(random() % 8), 70.0 + (double)(random() % 1300) / 10.0, {} };
+			for (int step = 0; step < section.GetStepsPerBar(); step++) {
+				section.pattern.push_back(step == 0 ? audio::PatternNote::ACCENT : step % 2 == 0 ? audio::PatternNote::NORMAL : audio::PatternNote::GHOST);
+			}
+			song.sections.push_back(section);
+		}
+		return audio::SongTimeline::Compile(song, SampleRate);
+	}
+
+	// Reference for a tempo change that keeps the beat's phase: from the start sample, the rate in beats per sample
+	// changes linearly from the old beat's to the new tempo's over the glide, then holds. Beats are found by
+	// bisection on the integral of the rate, independently of the engine's closed form.
+	struct TempoGlide {
+		double startSample;
+		double startPhase;
+		double startRate;
+		double endRate;
+		double glideFrames;
+
+		double BeatsAfter(double samples) const {
+			const double t = min(samples, glideFrames);
+			const double beats = startRate * t + (endRate - startRate) * t * t / (2.0 * glideFrames);
+			return beats + endRate * max(0.0, samples - glideFrames);
+		}
+
+		// The beat'th beat after the last one before the change
+		double BeatSample(uint64_t beat) const {
+			const double target = (double)beat - startPhase;
+			double low = 0.0;
+			double high = glideFrames + target / min(startRate, endRate) + 1.0;
+			for (int i = 0; i < 100; i++) {
+				const double middle = 0.5 * (low + high);
+				(BeatsAfter(middle) < target ? low : high) = middle;
+			}
+			return startSample + 0.5 * (low + high);
+		}
+	};
+
+	// Fills a voice pool with the click at staggered positions and pans, then times mixing it a block at a time,
+	// restarting each voice as it nears the end
+	void MixFullPool(bench::State& state, const audio::SampleView& click, uint32_t blockFrames)
+	{
+		audio::VoicePool voices;
+		for (int i = 0; i < audio::VoicePool::Capacity; i++) {
+			const float pan = -1.0f + 2.0f * (float)i / (float)(audio::VoicePool::Capacity - 1);
+			voices.Start(click, (uint32_t)(i * 601) % SampleRate / 2 % click.length, 0.05f, pan);
+		}
+		std::vector<float> output(blockFrames * ChannelCount);
+
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			std::fill(output.begin(), output.end(), 0.0f);
+			for (int v = 0; v < voices.GetActiveCount(); v++) {
+				audio::Voice& voice = voices.Get(v);
+				audio::MixVoice(voice, output.data(), ChannelCount, 0, blockFrames);
+				if (voice.position + blockFrames > voice.length) {
+					voice.position = 0;
+				}
+			}
+		}
+		const double elapsedMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		bench::DoNotOptimise(output[0]);
+
+		const double audioMilliseconds = (double)state.iterations * blockFrames * 1000.0 / SampleRate;
+		state.SetItemsProcessed((double)blockFrames * audio::VoicePool::Capacity);
+		state.counters["voices_per_ms_48k"] = audio::VoicePool::Capacity * audioMilliseconds / max(elapsedMilliseconds, 1e-9);
+	}
+
+	// New onsets in the engine's latest snapshot, from number 'next' on
+	void CollectOnsets(const audio::AudioEngine& engine, uint64_t& next, std::vector<audio::OnsetRecord>& onsets)
+	{
+		const audio::PlaybackSnapshot snapshot = engine.GetPlaybackSnapshot();
+		for (; next < snapshot.onsetCount; next++) {
+			onsets.push_back(snapshot.GetOnset(next));
+		}
+	}
+}
+
+void bench::RegisterAudioBenchmarks(Registry& registry)
+{
+	// Wood blocks at 240 BPM sound for 40% of each beat; bells ringing for a second overlap four deep
+	for (bool isRinging : { false, true }) {
+		for (uint32_t blockFrames : { 64u, 128u, 256u, 512u, 1024u }) {
+			for (bool useBarCache : { false, true }) {
+				const std::string mode = useBarCache ? "bar_cache" : "live";
+				const std::string clicks = isRinging ? "bell" : "wood_block";
+				registry.Add("AudioEngine/Render/" + clicks + "/" + mode + "/block:" + std::to_string(blockFrames), [blockFrames, useBarCache, isRinging](State& state) {
+					const int clickFrames = isRinging ? 48000 : 4800;
+					const float decayPerSecond = isRinging ? 5.0f : 60.0f;
+					const ClickPair toneSet = { MakeClick(2000.0f, clickFrames, decayPerSecond), MakeClick(1000.0f, clickFrames, decayPerSecond) };
+					audio::AudioEngine engine(SampleRate, ChannelCount);
+					engine.SetBarCacheEnabled(useBarCache);
+					engine.SetToneSet(toneSet.View());
+					engine.SetTempo(240.0);
+					engine.Play();
+					audio::NullSink sink(SampleRate, ChannelCount, blockFrames);
+					sink.Start(&engine);
+					for (uint64_t i = 0; i < state.iterations; i++) {
+						sink.Pump(blockFrames);
+					}
+					sink.Stop();
+					DoNotOptimise(sink.GetLastBlock()[0]);
+					state.SetItemsProcessed((double)blockFrames);
+					state.counters["bar_cache_bytes"] = (double)engine.GetBarCacheStatistics().memoryBytes;
+				});
+			}
+		}
+	}
+
+	// Mixes a full pool of overlapping, panned voices into stereo blocks. voices_per_ms_48k is how many voice-
+	// milliseconds of 48kHz audio are mixed per millisecond of CPU time, i.e. the polyphony one core sustains.
+	for (uint32_t blockFrames : { 64u, 128u, 256u, 512u, 1024u }) {
+		registry.Add("Mixer/voices:" + std::to_string(audio::VoicePool::Capacity) + "/block:" + std::to_string(blockFrames), [blockFrames](State& state) {
+			const std::vector<float> click = MakeClick(1500.0f, SampleRate, 5.0f);
+			MixFullPool(state, { click.data(), (uint32_t)click.size() }, blockFrames);
+		});
+	}
+
+	// The same pool of voices rendering synthesised clicks or decoding compressed ones as they mix, to set
+	// against the sampled ones above
+	for (const auto& bell : SynthesisedBells) {
+		const audio::ClickPatch patch = bell.second;
+		registry.Add("Mixer/voices:" + std::to_string(audio::VoicePool::Capacity) + "/synthesised/" + bell.first + "/block:256", [patch](State& state) {
+			const audio::ClickSynth synth(patch, SampleRate);
+			MixFullPool(state, audio::SampleView::Synthesised(synth), 256);
+		});
+	}
+	registry.Add("Mixer/voices:" + std::to_string(audio::VoicePool::Capacity) + "/compressed/block:256", [](State& state) {
+		const std::vector<float> click = MakeClick(1500.0f, SampleRate, 5.0f);
+		const audio::AdpcmClip clip(click.data(), (uint32_t)click.size());
+		MixFullPool(state, audio::SampleView::Compressed(clip), 256);
+	});
+
+	// Starts clicks faster than they finish, so that the pool is always full and every start steals a voice
+	registry.Add("Mixer/VoicePool/start_with_stealing", [](State& state) {
+		const std::vector<float> click = MakeClick(1500.0f, SampleRate);
+		audio::VoicePool voices;
+		voices.SetPolyphonyLimit(16);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			voices.Start(click.data(), nullptr, (uint32_t)click.size(), 0, 1.0f, 0.0f);
+		}
+		DoNotOptimise(voices.GetActiveCount());
+		state.SetItemsProcessed(1.0);
+		state.counters["stolen_fraction"] = (double)voices.GetStolenCount() / (double)state.iterations;
+	});
+
+	// Plays the same ten minutes of tempo changes, time signature changes and pauses with and without the bar
+	// cache, and reports how far apart the two outputs ever get along with how the cache was used. Synthesised
+	// and compressed clicks are rendered whole into the cache but a block at a time when live, so must match
+	// across splits. The host clock counts frames, so each tempo change has long settled before the next. Fails
+	// the run if the outputs differ at all.
+	for (const char* clicks : { "", "/synthesised", "/compressed" }) {
+		const std::string kind = clicks;
+		registry.Add("AudioEngine/BarCache/equivalence" + kind, [kind](State& state) {
+			const uint32_t blockFrames = 441;
+			const double tempos[] = { 120.0, 97.3, 180.0, 61.7, 133.3, 208.9, 75.0 };
+			const int beatsPerBars[] = { 4, 3, 7, 5 };
+			float maxDifference = 0.0f;
+			audio::BarCacheStatistics statistics = {};
+			const ClickPair bells = { MakeClick(2000.0f, 36000, 8.0f), MakeClick(1000.0f, 24000, 8.0f) };
+			// As long as the sampled bells, so that clicks overlap no more deeply
+			const audio::ClickSynth accentSynth(audio::ClickPatch::FmBell(2000.0f, 1.4f, 3.0f, 0.108f, 0.5f), SampleRate);
+			const audio::ClickSynth normalSynth(audio::ClickPatch::NoiseBurst(1000.0f, 300.0f, 0.072f, 0.5f), SampleRate);
+			const audio::AdpcmClip accentClip(bells.accent.data(), (uint32_t)bells.accent.size());
+			const audio::AdpcmClip normalClip(bells.normal.data(), (uint32_t)bells.normal.size());
+			audio::ToneSetView toneSet = bells.View();
+			if (kind == "/synthesised") {
+				toneSet = { audio::SampleView::Synthesised(accentSynth), audio::SampleView::Synthesised(normalSynth) };
+			} else if (kind == "/compressed") {
+				toneSet = { audio::SampleView::Compressed(accentClip), audio::SampleView::Compressed(normalClip) };
+			}
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				audio::AudioEngine engines[2] = { { SampleRate, 1 }, { SampleRate, 1 } };
+				audio::NullSink sinks[2] = { { SampleRate, 1, blockFrames }, { SampleRate, 1, blockFrames } };
+				DX::FakeClock clock(SampleRate);
+				for (int e = 0; e < 2; e++) {
+					engines[e].SetHostClock(&clock);
+					engines[e].SetBarCacheEnabled(e == 1);
+					engines[e].SetToneSet(toneSet);
+					engines[e].Play();
+					sinks[e].Start(&engines[e]);
+				}
+				for (uint64_t block = 0; block * blockFrames < 600 * SampleRate; block++) {
+					const uint64_t blockStart = block * blockFrames;
+					for (int e = 0; e < 2; e++) {
+						if (block % 800 == 0) {
+							engines[e].SetTempo(tempos[(block / 800) % 7]);
+						}
+						if (block % 1900 == 0) {
+							engines[e].SetBeatsPerBar(beatsPerBars[(block / 1900) % 4]);
+						}
+						if (blockStart % (53 * SampleRate) < blockFrames) {
+							engines[e].Pause();
+						} else if (blockStart % (53 * SampleRate) < 50 * blockFrames) {
+							engines[e].Play();
+						}
+						sinks[e].Pump(blockFrames);
+						engines[e].UpdateBarCache();
+					}
+					clock.Advance(blockFrames);
+					const std::vector<float>& live = sinks[0].GetLastBlock();
+					const std::vector<float>& cached = sinks[1].GetLastBlock();
+					for (uint32_t frame = 0; frame < blockFrames; frame++) {
+						maxDifference = max(maxDifference, fabsf(live[frame] - cached[frame]));
+					}
+				}
+				statistics = engines[1].GetBarCacheStatistics();
+			}
+			if (maxDifference != 0.0f) {
+				throw std::runtime_error("Cached bars differed from live playback by up to " + std::to_string(maxDifference));
+			}
+			state.counters["max_abs_difference"] = maxDifference;
+			state.counters["cached_bars"] = (double)statistics.cachedBars;
+			state.counters["live_bars"] = (double)statistics.liveBars;
+			state.counters["invalidations"] = (double)statistics.invalidations;
+			state.counters["bar_cache_builds"] = (double)statistics.builds;
+			state.counters["bar_cache_bytes"] = (double)statistics.memoryBytes;
+		});
+	}
+
+	// Pumps ten minutes of audio through block by block while changing tempo every 7 seconds, then measures
+	// how far each onset lands from where the tempo says it should be. Each change keeps the beat's phase and
+	// glides to the new tempo, so every interval between onsets lies between the old and new tempos' beats.
+	// Rounding alone allows at most a sample, as the new tempo's grid starts from a beat rounded to a sample.
+	// Fails the run on any interval outside that.
+	registry.Add("AudioEngine/OnsetAccuracy/tempo_changes", [](State& state) {
+		const uint32_t blockFrames = 480;
+		const double tempos[] = { 120.0, 97.3, 180.0, 61.7, 133.3, 208.9, 75.0 };
+		const double glideFrames = (double)llround(audio::AudioEngine::SmoothingSeconds * SampleRate);
+		double maxErrorSamples = 0.0;
+		uint64_t onsetCount = 0;
+		uint64_t intervalsOutsideTempos = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::AudioEngine engine(SampleRate, 1);
+			engine.SetToneSet(ImpulseClicks().View());
+			audio::NullSink sink(SampleRate, 1, blockFrames);
+			sink.Start(&engine);
+
+			TempoGlide glide = { 0.0, 1.0, 1.0, 1.0, glideFrames };
+			uint64_t beatsInSegment = 0;
+			double previousSamplesPerBeat = 0.0;
+			double samplesPerBeat = 0.0;
+			uint64_t lastOnset = 0;
+			bool hasOnset = false;
+			int tempoIndex = 0;
+			for (uint64_t block = 0; block * blockFrames < 600 * SampleRate; block++) {
+				const uint64_t blockStart = block * blockFrames;
+				if (blockStart % (7 * SampleRate) == 0) {
+					const double bpm = tempos[tempoIndex++ % 7];
+					engine.SetTempo(bpm);
+					if (block == 0) {
+						engine.Play();
+					}
+					previousSamplesPerBeat = block == 0 ? 60.0 * SampleRate / bpm : samplesPerBeat;
+					samplesPerBeat = 60.0 * SampleRate / bpm;
+					const double endRate = 1.0 / samplesPerBeat;
+					if (block == 0) {
+						glide = { 0.0, 1.0, endRate, endRate, glideFrames };
+					} else {
+						// The phase is that of the clicks as played, rounded to whole samples: between the last one
+						// and the one the engine has lined up next
+						const double nextOnset = (double)engine.GetPlaybackSnapshot().nextOnset.sample;
+						const double startRate = 1.0 / (nextOnset - (double)lastOnset);
+						glide = { (double)blockStart, (double)(blockStart - lastOnset) * startRate, startRate, endRate, glideFrames };
+					}
+					beatsInSegment = 0;
+				}
+				sink.Pump(blockFrames);
+				const std::vector<float>& output = sink.GetLastBlock();
+				for (uint32_t frame = 0; frame < blockFrames; frame++) {
+					if (output[frame] == 0.0f) {
+						continue;
+					}
+					const uint64_t onset = blockStart + frame;
+					beatsInSegment++;
+					maxErrorSamples = max(maxErrorSamples, fabs((double)onset - glide.BeatSample(beatsInSegment)));
+					if (hasOnset) {
+						const double interval = (double)(onset - lastOnset);
+						if (interval < min(previousSamplesPerBeat, samplesPerBeat) - 1.0 || interval > max(previousSamplesPerBeat, samplesPerBeat) + 1.0) {
+							intervalsOutsideTempos++;
+						}
+					}
+					lastOnset = onset;
+					hasOnset = true;
+					onsetCount++;
+				}
+			}
+			sink.Stop();
+		}
+		if (intervalsOutsideTempos > 0) {
+			throw std::runtime_error(std::to_string(intervalsOutsideTempos) + " beat intervals fell outside the tempos glided between");
+		}
+		state.counters["max_onset_error_samples"] = maxErrorSamples;
+		state.counters["intervals_outside_tempos"] = (double)intervalsOutsideTempos;
+		state.counters["onsets"] = (double)onsetCount / (double)state.iterations;
+	});
+
+	// A minute of dragging the tempo and volume sliders, with a change of each every millisecond between blocks,
+	// against a second engine that only follows the tempo, then a second holding still. Clicks last two seconds
+	// at a constant level, so that from the first beat on the ratio of the two outputs is the gain the volume
+	// smoothing applied to each sample. With the bar cache, the UI updates it every 60 Hz frame on a clock
+	// counting frames, and the caches built from the start of the drag are counted; one as it starts and one
+	// once it has settled. Fails the run if a block applies more than one tempo change or any interval falls
+	// outside the tempos dragged through.
+	for (bool useBarCache : { false, true }) {
+		for (uint32_t blockFrames : { 64u, 256u, 1024u }) {
+			const std::string mode = useBarCache ? "bar_cache/" : "";
+			registry.Add("AudioEngine/SliderDrag/" + mode + "block:" + std::to_string(blockFrames), [blockFrames, useBarCache](State& state) {
+				const ClickPair constant = { std::vector<float>(2 * SampleRate, 0.125f), std::vector<float>(2 * SampleRate, 0.125f) };
+				const uint32_t eventFrames = SampleRate / 1000;
+				const uint32_t uiFrameFrames = SampleRate / 60;
+				const uint64_t glideFrames = (uint64_t)llround(audio::AudioEngine::SmoothingSeconds * SampleRate);
+				std::mt19937 random(43);
+				std::uniform_real_distribution<double> step(-1.0, 1.0);
+				uint64_t events = 0;
+				uint64_t rejected = 0;
+				uint64_t maxAppliedPerBlock = 0;
+				uint64_t intervalsOutsideTempos = 0;
+				double maxGainStep = 0.0;
+				uint64_t builds = 0;
+				uint64_t cachedBars = 0;
+				audio::ParameterChangeStatistics tempo = {};
+				audio::ParameterChangeStatistics volume = {};
+				for (uint64_t i = 0; i < state.iterations; i++) {
+					audio::AudioEngine engine(SampleRate, 1);
+					audio::AudioEngine reference(SampleRate, 1);
+					DX::FakeClock clock(SampleRate);
+					engine.SetHostClock(&clock);
+					for (audio::AudioEngine* e : { &engine, &reference }) {
+						e->SetBarCacheEnabled(e == &engine && useBarCache);
+						e->SetToneSet(constant.View());
+						e->Play();
+					}
+					const uint64_t buildsBefore = engine.GetBarCacheStatistics().builds;
+					std::vector<float> output(blockFrames);
+					std::vector<float> expected(blockFrames);
+					double beatsPerMinute = 120.0;
+					double gain = 1.0;
+					double minBeatsPerMinute = beatsPerMinute;
+					double maxBeatsPerMinute = beatsPerMinute;
+					double lastGain = 1.0;
+					uint64_t nextOnset = 0;
+					uint64_t lastOnset = 0;
+					uint64_t blockStart = 0;
+					uint64_t untilEvent = eventFrames;
+					std::vector<std::pair<uint64_t, double>> recentTempos = { { 0, beatsPerMinute } };
+					while (blockStart < 61 * SampleRate) {
+						for (; blockStart < 60 * SampleRate && untilEvent <= blockFrames; untilEvent += eventFrames) {
+							beatsPerMinute = min(240.0, max(60.0, beatsPerMinute + 2.0 * step(random)));
+							gain = min(1.0, max(0.2, gain + 0.02 * step(random)));
+							rejected += engine.SetTempo(beatsPerMinute) && engine.SetVolume(gain) && reference.SetTempo(beatsPerMinute) ? 0 : 1;
+							events++;
+							recentTempos.push_back({ blockStart, beatsPerMinute });
+						}
+						while (recentTempos.size() > 1 && recentTempos[1].first + glideFrames < blockStart) {
+							recentTempos.erase(recentTempos.begin());
+						}
+						untilEvent -= min(untilEvent, (uint64_t)blockFrames);
+
+						const uint64_t appliedBefore = engine.GetTempoChangeStatistics().applied;
+						engine.Render(output.data(), blockFrames);
+						reference.Render(expected.data(), blockFrames);
+						maxAppliedPerBlock = max(maxAppliedPerBlock, engine.GetTempoChangeStatistics().applied - appliedBefore);
+						clock.Advance(blockFrames);
+						if ((blockStart + blockFrames) / uiFrameFrames != blockStart / uiFrameFrames) {
+							engine.UpdateBarCache();
+						}
+
+						// The tempo heard across each interval was somewhere in the range dragged through since the
+						// last onset, or among the tempos set over the glide before it, which it may still be gliding
+						// from
+						minBeatsPerMinute = min(minBeatsPerMinute, beatsPerMinute);
+						maxBeatsPerMinute = max(maxBeatsPerMinute, beatsPerMinute);
+						const audio::PlaybackSnapshot snapshot = engine.GetPlaybackSnapshot();
+						for (; nextOnset < snapshot.onsetCount; nextOnset++) {
+							const uint64_t onset = snapshot.GetOnset(nextOnset).sample;
+							if (nextOnset > 0) {
+								const double interval = (double)(onset - lastOnset);
+								if (interval < 60.0 * SampleRate / maxBeatsPerMinute - 1.0 || interval > 60.0 * SampleRate / minBeatsPerMinute + 1.0) {
+									intervalsOutsideTempos++;
+								}
+							}
+							lastOnset = onset;
+							minBeatsPerMinute = beatsPerMinute;
+							maxBeatsPerMinute = beatsPerMinute;
+							for (const std::pair<uint64_t, double>& recent : recentTempos) {
+								minBeatsPerMinute = min(minBeatsPerMinute, recent.second);
+								maxBeatsPerMinute = max(maxBeatsPerMinute, recent.second);
+							}
+						}
+						for (uint32_t frame = 0; frame < blockFrames; frame++) {
+							if (expected[frame] > 0.0f) {
+								const double frameGain = (double)output[frame] / (double)expected[frame];
+								maxGainStep = max(maxGainStep, fabs(frameGain - lastGain));
+								lastGain = frameGain;
+							}
+						}
+						blockStart += blockFrames;
+					}
+					tempo = engine.GetTempoChangeStatistics();
+					volume = engine.GetVolumeChangeStatistics();
+					const audio::BarCacheStatistics barCache = engine.GetBarCacheStatistics();
+					builds += barCache.builds - buildsBefore;
+					cachedBars += barCache.cachedBars;
+				}
+				if (maxAppliedPerBlock > 1 || intervalsOutsideTempos > 0) {
+					throw std::runtime_error("Slider drag applied up to " + std::to_string(maxAppliedPerBlock) + " tempo changes a block, with "
+						+ std::to_string(intervalsOutsideTempos) + " beat intervals outside the tempos dragged through");
+				}
+				const double blocks = (double)(60 * SampleRate / blockFrames);
+				state.counters["drag_events"] = (double)events / (double)state.iterations;
+				state.counters["rejected_events"] = (double)rejected;
+				state.counters["tempo_coalesced"] = (double)tempo.coalesced;
+				state.counters["tempo_applied"] = (double)tempo.applied;
+				state.counters["volume_coalesced"] = (double)volume.coalesced;
+				state.counters["volume_applied"] = (double)volume.applied;
+				state.counters["applied_per_block"] = (double)tempo.applied / blocks;
+				state.counters["max_applied_per_block"] = (double)maxAppliedPerBlock;
+				state.counters["intervals_outside_tempos"] = (double)intervalsOutsideTempos;
+				state.counters["max_gain_step"] = maxGainStep;
+				if (useBarCache) {
+					state.counters["bar_cache_builds"] = (double)builds / (double)state.iterations;
+					state.counters["cached_bars"] = (double)cachedBars / (double)state.iterations;
+				}
+			});
+		}
+	}
+
+	// Twenty-four hours of the metronome at each of four tempos with no whole number of samples per beat,
+	// checking every beat against the exact position worked out in 128-bit integers: beat k at
+	// 60 * sampleRate * k / tempo, rounded to the nearest sample with halves up. For comparison, counts the beats
+	// that the same position in double precision would round differently. Fails the run on any engine beat off
+	// its exact position.
+	registry.Add("AudioEngine/Drift/metronome/24h/tempos:4", [](State& state) {
+		const uint32_t blockFrames = 8192;
+		const uint64_t tempos[] = { 173417, 61703, 208911, 97301 };
+		const uint64_t lengthSamples = 24ull * 3600 * SampleRate;
+		uint64_t beats = 0;
+		uint64_t mismatchedBeats = 0;
+		uint64_t floatMismatches = 0;
+		std::vector<float> output(blockFrames);
+		for (uint64_t i = 0; i < state.iterations * 4; i++) {
+			const uint64_t milliBeatsPerMinute = tempos[i % 4];
+			audio::AudioEngine engine(SampleRate, 1);
+			engine.SetBarCacheEnabled(false);
+			engine.SetToneSet(ImpulseClicks().View());
+			engine.SetTempo((double)milliBeatsPerMinute / 1000.0);
+			engine.Play();
+			const double samplesPerBeat = 60.0 * SampleRate / ((double)milliBeatsPerMinute / 1000.0);
+			uint64_t nextOnset = 0;
+			for (uint64_t blockStart = 0; blockStart < lengthSamples; blockStart += blockFrames) {
+				engine.Render(output.data(), blockFrames);
+				const audio::PlaybackSnapshot snapshot = engine.GetPlaybackSnapshot();
+				for (; nextOnset < snapshot.onsetCount; nextOnset++) {
+					const unsigned __int128 numerator = (unsigned __int128)nextOnset * 60000 * SampleRate;
+					const uint64_t expected = (uint64_t)((2 * numerator + milliBeatsPerMinute) / (2 * milliBeatsPerMinute));
+					mismatchedBeats += snapshot.GetOnset(nextOnset).sample != expected ? 1 : 0;
+					floatMismatches += (uint64_t)llround((double)nextOnset * samplesPerBeat) != expected ? 1 : 0;
+				}
+			}
+			beats += nextOnset;
+		}
+		if (mismatchedBeats > 0) {
+			throw std::runtime_error(std::to_string(mismatchedBeats) + " metronome beats drifted from their exact positions");
+		}
+		state.counters["beats"] = (double)beats / (double)state.iterations;
+		state.counters["mismatched_beats"] = (double)mismatchedBeats;
+		state.counters["double_precision_mismatches"] = (double)floatMismatches / (double)state.iterations;
+	});
+
+	// Stop timers of random lengths, plain and at bar lines, on the metronome and on songs, rendered in blocks of
+	// random sizes against a fake host clock counting one per frame. A second engine plays the same without a
+	// timer, to show where each stop should land and what must come before it. Fails the run if any stop misses
+	// its frame or leaves an onset or sound behind it.
+	registry.Add("AudioEngine/StopTimer/accuracy", [](State& state) {
+		const ClickPair woodBlocks = { MakeClick(2000.0f, 4800), MakeClick(1000.0f, 4800) };
+		const uint32_t fadeFrames = (uint32_t)llround(audio::AudioEngine::StopFadeSeconds * SampleRate);
+		std::mt19937 random(21);
+		uint64_t timers = 0;
+		uint64_t maxStopErrorFrames = 0;
+		uint64_t hostCounterErrors = 0;
+		uint64_t mismatchedBeforeStop = 0;
+		uint64_t onsetsAfterStop = 0;
+		uint64_t soundAfterFade = 0;
+		double maxFadeGain = 0.0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			for (int trial = 0; trial < 50; trial++) {
+				const bool isSong = random() % 2 == 0;
+				const bool isAtBarLine = random() % 2 == 0;
+				const double seconds = 0.25 + (double)(random() % 8000) / 1000.0;
+				const std::unique_ptr<audio::SongTimeline> timeline = MakeTimerSong(random);
+				const double beatsPerMinute = 60.0 + (double)(random() % 180);
+				const int beatsPerBar = 2 + (int)(random() % 6);
+
+				DX::FakeClock clock(SampleRate);
+				audio::AudioEngine engine(SampleRate, ChannelCount);
+				audio::AudioEngine reference(SampleRate, ChannelCount);
+				engine.SetHostClock(&clock);
+				for (audio::AudioEngine* e : { &engine, &reference }) {
+					e->SetToneSet(woodBlocks.View());
+					e->SetTempo(beatsPerMinute);
+					e->SetBeatsPerBar(beatsPerBar);
+					e->SetSongTimeline(isSong ? timeline.get() : nullptr);
+					e->Play();
+				}
+				engine.SetStopTimer(seconds, isAtBarLine);
+
+				// Render until the timer has fired and the fade has had time to finish
+				const uint64_t timerFrames = (uint64_t)llround(seconds * SampleRate);
+				std::vector<float> output;
+				std::vector<float> expected;
+				std::vector<audio::OnsetRecord> onsets;
+				std::vector<audio::OnsetRecord> referenceOnsets;
+				uint64_t nextOnset = 0;
+				uint64_t nextReferenceOnset = 0;
+				bool hasFired = false;
+				audio::StopTimerEvent event = {};
+				uint64_t firedBlockStart = 0;
+				while (!hasFired || output.size() < (event.streamFrame + fadeFrames + 2048) * ChannelCount) {
+					const uint32_t blockFrames = 1 + random() % 1024;
+					const uint64_t blockStart = output.size() / ChannelCount;
+					output.resize(output.size() + (size_t)blockFrames * ChannelCount);
+					expected.resize(output.size());
+					engine.Render(output.data() + blockStart * ChannelCount, blockFrames);
+					reference.Render(expected.data() + blockStart * ChannelCount, blockFrames);
+					clock.Advance(blockFrames);
+					CollectOnsets(engine, nextOnset, onsets);
+					CollectOnsets(reference, nextReferenceOnset, referenceOnsets);
+					if (!hasFired && engine.TryGetStopTimerEvent(event)) {
+						hasFired = true;
+						firedBlockStart = blockStart;
+					}
+					if (!hasFired && blockStart > timerFrames + 30 * SampleRate) {
+						break;
+					}
+				}
+				timers++;
+
+				// Where it should stop: after the time given, or on the first bar line at or after that, which is
+				// the first accent; songs end on a bar line too
+				uint64_t stopFrame = timerFrames;
+				if (isAtBarLine) {
+					stopFrame = isSong ? timeline->GetLengthSamples() : UINT64_MAX;
+					for (const audio::OnsetRecord& onset : referenceOnsets) {
+						if (onset.voice == audio::ToneVoice::ACCENT && onset.sample >= timerFrames) {
+							stopFrame = min(stopFrame, onset.sample);
+						}
+					}
+				}
+				if (!hasFired) {
+					maxStopErrorFrames = UINT64_MAX;
+					continue;
+				}
+				const uint64_t error = event.streamFrame > stopFrame ? event.streamFrame - stopFrame : stopFrame - event.streamFrame;
+				maxStopErrorFrames = max(maxStopErrorFrames, error);
+				hostCounterErrors += event.hostCounter != firedBlockStart || event.playheadSample != event.streamFrame ? 1 : 0;
+
+				const size_t stopSample = (size_t)min(event.streamFrame, stopFrame) * ChannelCount;
+				mismatchedBeforeStop += memcmp(output.data(), expected.data(), stopSample * sizeof(float)) != 0 ? 1 : 0;
+				for (const audio::OnsetRecord& onset : onsets) {
+					onsetsAfterStop += onset.sample >= event.streamFrame ? 1 : 0;
+				}
+				const size_t fadeEnd = (size_t)(event.streamFrame + fadeFrames) * ChannelCount;
+				for (size_t sample = fadeEnd; sample < output.size(); sample++) {
+					soundAfterFade += output[sample] != 0.0f ? 1 : 0;
+				}
+
+				// Up to the first onset the timer cut off, the fade is the reference scaled down
+				uint64_t fadeCheckEnd = event.streamFrame + fadeFrames;
+				for (const audio::OnsetRecord& onset : referenceOnsets) {
+					if (onset.sample >= event.streamFrame) {
+						fadeCheckEnd = min(fadeCheckEnd, onset.sample);
+					}
+				}
+				for (size_t sample = stopSample; sample < fadeCheckEnd * ChannelCount; sample++) {
+					if (fabs(expected[sample]) > 1e-3f) {
+						maxFadeGain = max(maxFadeGain, (double)(output[sample] / expected[sample]));
+					}
+				}
+			}
+		}
+		if (maxStopErrorFrames > 0 || hostCounterErrors > 0 || mismatchedBeforeStop > 0 || onsetsAfterStop > 0 || soundAfterFade > 0) {
+			throw std::runtime_error("Stop timers were up to " + std::to_string(maxStopErrorFrames) + " frames out, with "
+				+ std::to_string(hostCounterErrors) + " host counter errors, " + std::to_string(mismatchedBeforeStop) + " mismatches before the stop, "
+				+ std::to_string(onsetsAfterStop) + " onsets after it and " + std::to_string(soundAfterFade) + " samples after the fade");
+		}
+		state.counters["timers"] = (double)timers / (double)state.iterations;
+		state.counters["max_stop_error_frames"] = (double)maxStopErrorFrames;
+		state.counters["host_counter_errors"] = (double)hostCounterErrors;
+		state.counters["mismatched_before_stop"] = (double)mismatchedBeforeStop;
+		state.counters["onsets_after_stop"] = (double)onsetsAfterStop;
+		state.counters["samples_after_fade"] = (double)soundAfterFade;
+		state.counters["max_fade_gain"] = maxFadeGain;
+	});
+
+	registry.Add("AudioEngine/WavFileSink/60s", [](State& state) {
+		const std::string path = "audio_engine_benchmark.wav";
+		const ClickPair woodBlocks = { MakeClick(2000.0f, 4800), MakeClick(1000.0f, 4800) };
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::AudioEngine engine(SampleRate, ChannelCount);
+			engine.SetToneSet(woodBlocks.View());
+			engine.Play();
+			audio::WavFileSink sink(path, SampleRate, ChannelCount, 512);
+			sink.Start(&engine);
+			sink.Pump(60 * SampleRate);
+			sink.Stop();
+		}
+		std::remove(path.c_str());
+		state.SetItemsProcessed(60.0 * SampleRate);
+	});
+}
@@ -0,0 +1,369 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/Analysis/BeatGridAnalyser.h"
+#include "Audio/Analysis/OnsetDetector.h"
+#include "Audio/Export/FlacFileWriter.h"
+#include "Audio/Export/WavFileWriter.h"
+#include "Audio/Songs/SongTimeline.h"
+#include "Audio/ToneSets/MappedFile.h"
+
+#include <chrono>
+#include <random>
+
+namespace {
+
+	const uint32_t SampleRate = 44100;
+	const uint32_t ChannelCount = 2;
+
+	// A found beat this close to a played one is that beat
+	const double ToleranceSeconds = 0.07;
+
+	// Least an analysis may score on beats and downbeats, and furthest its sections' tempos may be off
+	const double MinFMeasure = 0.95;
+	const double MaxTempoErrorBpm = 0.5;
+
+	// Silence before the first bar and after the last, as a recording would have
+	const double LeadInSeconds = 2.3;
+	const double TailSeconds = 1.0;
+
+	struct TrackSection {
+		double beatsPerMinute;
+		int beatsPerBar;
+		int barCount;
+	};
+
+	// A drum track and the beats it was played to
+	struct Track {
+		std::vector<float> samples;
+		std::vector<TrackSection> sections;
+		std::vector<double> beatSamples;
+		std::vector<double> downbeatSamples;
+	};
+
+	enum class Style {
+		STEADY,
+		SECTIONS,
+		HUMANISED
+	};
+
+	// Kick on the first beat of each half bar, snare on the others, closed hats on every eighth and a crash on
+	// each downbeat. The humanised track plays each hit up to 15 ms off the beat at uneven levels, over hiss.
+	Track PlayTrack(Style style)
+	{
+		Track track;
+		switch (style) {
+		case Style::STEADY: track.sections = { { 123.4, 4, 30 } }; break;
+		case Style::SECTIONS: track.sections = { { 96.0, 4, 12 }, { 144.0, 3, 16 }, { 128.0, 4, 16 } }; break;
+		case Style::HUMANISED: track.sections = { { 100.0, 4, 20 } }; break;
+		}
+		const bool isHumanised = style == Style::HUMANISED;
+		std::mt19937 random(45);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		std::normal_distribution<double> timing(0.0, 0.006);
+
+		double start = LeadInSeconds * SampleRate;
+		for (const TrackSection& section : track.sections) {
+			const double beatSamples = 60.0 * SampleRate / section.beatsPerMinute;
+			for (int beat = 0; beat < section.barCount * section.beatsPerBar; beat++) {
+				track.beatSamples.push_back(start + beat * beatSamples);
+				if (beat % section.beatsPerBar == 0) {
+					track.downbeatSamples.push_back(start + beat * beatSamples);
+				}
+			}
+			start += section.barCount * section.beatsPerBar * beatSamples;
+		}
+		const size_t frameCount = (size_t)(start + TailSeconds * SampleRate);
+		std::vector<float> mono(frameCount, 0.0f);
+
+		auto addHit = [&](double at, float gain, bool isKick, bool isSnare, bool isCrash) {
+			if (isHumanised) {
+				at += std::clamp(timing(random), -0.015, 0.015) * SampleRate;
+				gain *= 0.75f + 0.25f * uniform(random);
+			}
+			const size_t first = (size_t)ceil(at);
+			const size_t length = (size_t)((isCrash ? 0.6 : 0.25) * SampleRate);
+			float previousNoise = 0.0f;
+			for (size_t i = 0; i < length && first + i < frameCount; i++) {
+				const float t = (float)((double)(first + i) - at) / (float)SampleRate;
+				const float noise = uniform(random);
+				float sample;
+				if (isKick) {
+					sample = 0.9f * sinf(6.2831853f * (50.0f * t + 100.0f * 0.03f * (1.0f - expf(-t / 0.03f)))) * expf(-t / 0.12f);
+				} else if (isSnare) {
+					sample = (0.5f * noise + 0.3f * sinf(6.2831853f * 190.0f * t)) * expf(-t / 0.06f);
+				} else {
+					// Differencing the noise leaves its highs, for the hats and the crash
+					sample = (noise - previousNoise) * (isCrash ? 0.35f * expf(-t / 0.25f) : 0.15f * expf(-t / 0.02f));
+				}
+				previousNoise = noise;
+				mono[first + i] += gain * sample;
+			}
+		};
+
+		size_t beatIndex = 0;
+		for (const TrackSection& section : track.sections) {
+			const double beatSamples = 60.0 * SampleRate / section.beatsPerMinute;
+			const int halfBar = section.beatsPerBar == 3 ? 3 : 2;
+			for (int beat = 0; beat < section.barCount * section.beatsPerBar; beat++, beatIndex++) {
+				const double at = track.beatSamples[beatIndex];
+				const int inBar = beat % section.beatsPerBar;
+				addHit(at, inBar == 0 ? 1.0f : 0.8f, inBar % halfBar == 0, inBar % halfBar != 0, false);
+				if (inBar == 0) {
+					addHit(at, 1.0f, false, false, true);
+				}
+				addHit(at, 1.0f, false, false, false);
+				addHit(at + 0.5 * beatSamples, 0.7f, false, false, false);
+			}
+		}
+
+		track.samples.resize(frameCount * ChannelCount);
+		for (size_t i = 0; i < frameCount; i++) {
+			const float hiss = isHumanised ? 0.01f * uniform(random) : 0.0f;
+			for (uint32_t channel = 0; channel < ChannelCount; channel++) {
+				track.samples[i * ChannelCount + channel] = 0.5f * mono[i] + hiss;
+			}
+		}
+		return track;
+	}
+
+	void WriteTrack(const Track& track, const std::string& path, bool isFlac)
+	{
+		const uint64_t frameCount = track.samples.size() / ChannelCount;
+		if (isFlac) {
+			audio::FlacFileWriter writer(path, SampleRate, ChannelCount, 16);
+			writer.Write(track.samples.data(), frameCount);
+			writer.Finish();
+		} else {
+			audio::WavFileWriter writer(path, SampleRate, ChannelCount);
+			writer.Write(track.samples.data(), frameCount);
+			writer.Finish();
+		}
+	}
+
+	void OpenTrack(audio::MappedFile& file, const std::string& path)
+	{
+		if (!file.Open(path)) {
+			throw std::runtime_error("Could not map " + path);
+		}
+	}
+
+	struct Score {
+		uint64_t runs;
+		uint64_t sectionErrors;
+		uint64_t metreErrors;
+		double maxTempoError;
+		uint64_t beats;
+		uint64_t foundBeats;
+		uint64_t matchedBeats;
+		uint64_t downbeats;
+		uint64_t foundDownbeats;
+		uint64_t matchedDownbeats;
+		double maxDriftSeconds;
+		uint64_t clicksOutside;
+	};
+
+	// How many found times lie within the tolerance of a distinct played one, both in order
+	uint64_t CountMatches(const std::vector<double>& played, const std::vector<double>& found)
+	{
+		const double tolerance = ToleranceSeconds * SampleRate;
+		uint64_t matches = 0;
+		size_t next = 0;
+		for (double time : found) {
+			while (next < played.size() && played[next] < time - tolerance) {
+				next++;
+			}
+			if (next < played.size() && fabs(played[next] - time) <= tolerance) {
+				matches++;
+				next++;
+			}
+		}
+		return matches;
+	}
+
+	double Distance(const std::vector<double>& played, double time)
+	{
+		const auto next = std::lower_bound(played.begin(), played.end(), time);
+		double distance = INFINITY;
+		if (next != played.end()) {
+			distance = *next - time;
+		}
+		if (next != played.begin()) {
+			distance = min(distance, time - *(next - 1));
+		}
+		return distance;
+	}
+
+	// Compares the grid with the track, and the clicks of the song made from it, started with the recording at
+	// the first section, with the beats played
+	void ScoreGrid(const Track& track, const audio::BeatGrid& grid, Score& score)
+	{
+		score.runs++;
+		score.sectionErrors += (uint64_t)llabs((int64_t)grid.sections.size() - (int64_t)track.sections.size());
+		if (grid.sections.size() == track.sections.size()) {
+			for (size_t i = 0; i < grid.sections.size(); i++) {
+				score.metreErrors += grid.sections[i].beatsPerBar != track.sections[i].beatsPerBar ? 1 : 0;
+				score.maxTempoError = max(score.maxTempoError, fabs(grid.sections[i].beatsPerMinute - track.sections[i].beatsPerMinute));
+			}
+		}
+
+		std::vector<double> downbeats;
+		for (const audio::BeatGridSection& section : grid.sections) {
+			const double beatSamples = 60.0 * SampleRate / section.beatsPerMinute;
+			for (int bar = 0; bar < section.barCount; bar++) {
+				downbeats.push_back(section.startSample + bar * section.beatsPerBar * beatSamples);
+			}
+		}
+		score.beats += track.beatSamples.size();
+		score.foundBeats += grid.beatSamples.size();
+		score.matchedBeats += CountMatches(track.beatSamples, grid.beatSamples);
+		score.downbeats += track.downbeatSamples.size();
+		score.foundDownbeats += downbeats.size();
+		score.matchedDownbeats += CountMatches(track.downbeatSamples, downbeats);
+
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(grid.ToSong("Imported"), SampleRate);
+		const double start = grid.sections.empty() ? 0.0 : grid.sections[0].startSample;
+		for (size_t event = 0; event < timeline->GetEventCount(); event++) {
+			const double distance = Distance(track.beatSamples, start + (double)timeline->GetEventSample(event)) / SampleRate;
+			score.maxDriftSeconds = max(score.maxDriftSeconds, distance);
+			score.clicksOutside += distance > ToleranceSeconds ? 1 : 0;
+		}
+	}
+
+	double FMeasure(uint64_t played, uint64_t found, uint64_t matched)
+	{
+		return played + found > 0 ? 2.0 * (double)matched / (double)(played + found) : 0.0;
+	}
+
+	// The envelope of a whole file in one pass on the calling thread, as the chunked one must match
+	audio::OnsetEnvelope ComputeSinglePassEnvelope(const byte* data, size_t size)
+	{
+		const audio::DecodedAudio decoded = audio::DecodeAudioFile(std::vector<byte>(data, data + size));
+		std::vector<float> mono = decoded.MixToMono();
+		audio::OnsetDetector detector(decoded.sampleRate);
+		const uint32_t hopSize = detector.GetHopSize();
+		mono.resize((mono.size() + hopSize - 1) / hopSize * hopSize, 0.0f);
+		audio::OnsetEnvelope envelope = { decoded.sampleRate, hopSize, detector.GetFrameSize(), decoded.GetFrameCount(), {}, {} };
+		for (size_t hop = 0; hop < mono.size() / hopSize; hop++) {
+			envelope.flux.push_back(detector.TakeHop(mono.data() + hop * hopSize));
+			envelope.lowBandFlux.push_back(detector.GetLowBandFlux());
+		}
+		return envelope;
+	}
+
+	uint64_t CountMismatches(const std::vector<float>& expected, const std::vector<float>& actual)
+	{
+		uint64_t mismatches = (uint64_t)llabs((int64_t)expected.size() - (int64_t)actual.size());
+		for (size_t i = 0; i < min(expected.size(), actual.size()); i++) {
+			mismatches += expected[i] != actual[i] ? 1 : 0;
+		}
+		return mismatches;
+	}
+
+	const char* GetStyleName(Style style)
+	{
+		switch (style) {
+		case Style::STEADY: return "steady";
+		case Style::SECTIONS: return "sections";
+		case Style::HUMANISED: return "humanised";
+		}
+		return "unknown";
+	}
+}
+
+void bench::RegisterBeatGridBenchmarks(Registry& registry)
+{
+	// Tracks written to WAV and FLAC and analysed through a mapping of each: how close the sections' tempos and
+	// metres are, how many of the beats and downbeats played are found, and how far the clicks of the song made
+	// from the grid ever stray from them. The run fails if the sections or metres are wrong, a click strays
+	// outside the tolerance, or the tempo or either F-measure misses its bound.
+	for (Style style : { Style::STEADY, Style::SECTIONS, Style::HUMANISED }) {
+		registry.Add(std::string("BeatGridAnalyser/Accuracy/") + GetStyleName(style), [style](State& state) {
+			const Track track = PlayTrack(style);
+			const std::string wavPath = std::string("beat_grid_") + GetStyleName(style) + ".wav";
+			const std::string flacPath = std::string("beat_grid_") + GetStyleName(style) + ".flac";
+			WriteTrack(track, wavPath, false);
+			WriteTrack(track, flacPath, true);
+			audio::MappedFile files[2];
+			OpenTrack(files[0], wavPath);
+			OpenTrack(files[1], flacPath);
+			audio::BeatGridAnalyser analyser;
+			Score score = { 0, 0, 0, 0.0, 0, 0, 0, 0, 0, 0, 0.0, 0 };
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				for (const audio::MappedFile& file : files) {
+					const audio::BeatGrid grid = analyser.Analyse(file.GetData(), file.GetSize());
+					state.PauseTiming();
+					ScoreGrid(track, grid, score);
+					state.ResumeTiming();
+				}
+			}
+			for (audio::MappedFile& file : files) {
+				file.Close();
+			}
+			std::remove(wavPath.c_str());
+			std::remove(flacPath.c_str());
+			state.SetItemsProcessed(2.0 * (double)(track.samples.size() / ChannelCount));
+			state.counters["tempo_error_max_bpm"] = score.maxTempoError;
+			state.counters["section_errors"] = (double)score.sectionErrors;
+			state.counters["metre_errors"] = (double)score.metreErrors;
+			const double beatFMeasure = FMeasure(score.beats, score.foundBeats, score.matchedBeats);
+			const double downbeatFMeasure = FMeasure(score.downbeats, score.foundDownbeats, score.matchedDownbeats);
+			state.counters["beat_f_measure"] = beatFMeasure;
+			state.counters["downbeat_f_measure"] = downbeatFMeasure;
+			state.counters["drift_max_ms"] = 1000.0 * score.maxDriftSeconds;
+			state.counters["clicks_outside"] = (double)score.clicksOutside;
+			if (score.sectionErrors > 0 || score.metreErrors > 0 || score.clicksOutside > 0) {
+				throw std::runtime_error(std::to_string(score.sectionErrors) + " section errors, " + std::to_string(score.metreErrors) + " metre errors and "
+					+ std::to_string(score.clicksOutside) + " clicks outside the tolerance");
+			}
+			if (score.maxTempoError > MaxTempoErrorBpm || beatFMeasure < MinFMeasure || downbeatFMeasure < MinFMeasure) {
+				throw std::runtime_error("Tempo error " + std::to_string(score.maxTempoError) + " BPM, beat F-measure " + std::to_string(beatFMeasure)
+					+ " and downbeat F-measure " + std::to_string(downbeatFMeasure) + " miss their bounds");
+			}
+		});
+	}
+
+	// The sectioned track as FLAC, analysed with different numbers of workers: seconds of audio per second
+	// taken, the most audio held at once, and whether the chunked envelope matches a single pass, failing if not
+	for (int threadCount : { 1, 2, 4 }) {
+		registry.Add("BeatGridAnalyser/Throughput/threads:" + std::to_string(threadCount), [threadCount](State& state) {
+			const Track track = PlayTrack(Style::SECTIONS);
+			const std::string path = "beat_grid_throughput_" + std::to_string(threadCount) + ".flac";
+			WriteTrack(track, path, true);
+			audio::MappedFile file;
+			OpenTrack(file, path);
+			const audio::OnsetEnvelope expected = ComputeSinglePassEnvelope(file.GetData(), file.GetSize());
+			audio::BeatGridAnalyser analyser;
+			analyser.SetThreadCount(threadCount);
+			uint64_t mismatches = 0;
+			uint64_t peakBufferedFrames = 0;
+			double envelopeSeconds = 0.0;
+			const auto start = std::chrono::steady_clock::now();
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				const auto envelopeStart = std::chrono::steady_clock::now();
+				audio::StreamingDecoder decoder(file.GetData(), file.GetSize());
+				const audio::OnsetEnvelope envelope = analyser.ComputeEnvelope(decoder);
+				envelopeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - envelopeStart).count();
+				const audio::BeatGrid grid = analyser.FindBeats(envelope);
+				DoNotOptimise(grid.sections.size());
+				state.PauseTiming();
+				mismatches += CountMismatches(expected.flux, envelope.flux) + CountMismatches(expected.lowBandFlux, envelope.lowBandFlux);
+				peakBufferedFrames = max(peakBufferedFrames, analyser.GetPeakBufferedFrames());
+				state.ResumeTiming();
+			}
+			const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - state.GetPausedSeconds();
+			file.Close();
+			std::remove(path.c_str());
+			const double trackSeconds = (double)(track.samples.size() / ChannelCount) / SampleRate;
+			state.SetItemsProcessed((double)(track.samples.size() / ChannelCount));
+			state.counters["realtime_factor"] = trackSeconds * (double)state.iterations / max(elapsedSeconds, 1e-9);
+			state.counters["envelope_share"] = envelopeSeconds / max(elapsedSeconds, 1e-9);
+			state.counters["max_buffered_seconds"] = (double)peakBufferedFrames / SampleRate;
+			state.counters["track_seconds"] = trackSeconds;
+			state.counters["envelope_mismatches"] = (double)mismatches;
+			if (mismatches > 0) {
+				throw std::runtime_error(std::to_string(mismatches) + " envelope values differ from a single pass");
+			}
+		});
+	}
+}
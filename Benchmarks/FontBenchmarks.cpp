@@ -0,0 +1,67 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Common/Font.h"
+#include "Content/HelpTexts.h"
+
+namespace {
+
+	// Lays out the "Navigating the App" heading and cards the same way SettingsNavigatingTextsVertexBuffer does
+	int PrintHelpLabels(font::Font& font, std::vector<std::string>& labels, std::vector<structures::VertexTexCoord>& vboData, winrt::Windows::Foundation::Size size, float dpi)
+	{
+		const float marginLogicalInches = 0.25f;
+		const float marginUnitsW = 2.0f * (marginLogicalInches * dpi) / size.Width;
+		const float marginUnitsH = 2.0f * (marginLogicalInches * dpi) / size.Height;
+		const float w1 = -1.0f + marginUnitsW;
+		const float w2 = w1 + marginUnitsW;
+		const float w4 = 1.0f - marginUnitsW;
+		const float w3 = w4 - marginUnitsW;
+		const float h1 = -1.0f + 2.0f * marginUnitsH;
+		const float h2 = -0.125f - marginUnitsH;
+		const float h4 = 1.0f - marginUnitsH;
+		const float h3 = h4 - 2.0f * marginUnitsH;
+		const float headingTextHeightPixels = 1.2f * marginLogicalInches * dpi;
+		const float bodyTextHeightPixels = 0.9f * marginLogicalInches * dpi;
+
+		int bufferIndex = 0;
+		font.PrintTextIntoVbo(vboData, bufferIndex, labels[0], w1, h4, w4 - w1, h4 - h3, headingTextHeightPixels, size, font::Gravity::START, font::Gravity::CENTER);
+		bufferIndex += 6 * (int)labels[0].length();
+		for (size_t i = 1; i < labels.size(); i++) {
+			font.PrintTextIntoVbo(vboData, bufferIndex, labels[i], w2, h2, w3 - w2, h2 - h1, bodyTextHeightPixels, size, font::Gravity::START, font::Gravity::START);
+			bufferIndex += 6 * (int)labels[i].length();
+		}
+		return bufferIndex;
+	}
+}
+
+void bench::RegisterFontBenchmarks(Registry& registry)
+{
+	auto fileData = std::make_shared<std::vector<byte>>(ReadAssetFile("Definitions/Orkney.fnt"));
+	std::shared_ptr<font::Font> orkney(font::Font::MakeFromFileContents(*fileData));
+
+	registry.Add("Font/MakeFromFileContents", [fileData](State& state) {
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			std::unique_ptr<font::Font> font(font::Font::MakeFromFileContents(*fileData));
+			DoNotOptimise(font->m_glyphs.data());
+		}
+		state.counters["file_bytes"] = (double)fileData->size();
+	});
+
+	for (float dpi : Dpis()) {
+		std::string name = "Font/PrintHelpLabels/dpi:" + std::to_string((int)dpi) + "/window_sizes:" + std::to_string(WindowSizes().size());
+		registry.Add(name, [orkney, dpi](State& state) {
+			std::vector<std::string> labels = strings::GetNavigatingTheAppTexts();
+			size_t characterCount = 0;
+			for (auto& label : labels) {
+				characterCount += label.length();
+			}
+			std::vector<structures::VertexTexCoord> vboData(6 * characterCount);
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				for (auto& size : WindowSizes()) {
+					DoNotOptimise(PrintHelpLabels(*orkney, labels, vboData, size, dpi));
+				}
+			}
+			state.SetItemsProcessed((double)(characterCount * WindowSizes().size()));
+		});
+	}
+}
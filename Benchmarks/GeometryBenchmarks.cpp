@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Content/Components/Geometry.h"
+
+#include <random>
+
+void bench::RegisterGeometryBenchmarks(Registry& registry)
+{
+	registry.Add("Geometry/PutSquare/quads:1024", [](State& state) {
+		const int quadCount = 1024;
+		std::vector<structures::VertexTexCoord> buffer(6 * quadCount);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			for (int quad = 0; quad < quadCount; quad++) {
+				const float x = -1.0f + 2.0f * (float)quad / (float)quadCount;
+				geometry::PutSquare(buffer.data(), 6 * quad, x, -0.5f, x + 0.01f, 0.5f, 0.0f, 1.0f, 1.0f, 0.0f);
+			}
+			DoNotOptimise(buffer.data());
+		}
+		state.SetItemsProcessed(quadCount);
+	});
+
+	registry.Add("Geometry/PutSquareCentredInside/window_sizes:" + std::to_string(WindowSizes().size()), [](State& state) {
+		// The six icons of the main screen, laid out at every window size
+		std::vector<structures::VertexTexCoord> buffer(36);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			for (auto& size : WindowSizes()) {
+				geometry::PutSquareCentredInside(buffer.data(), 0, -1.0f, 0.7f, -0.5f, 1.0f, 0.0f, 0.5f, 0.25f, 0.0f, size);
+				geometry::PutSquareCentredInside(buffer.data(), 6, -0.5f, 0.7f, 0.0f, 1.0f, 0.25f, 0.5f, 0.5f, 0.0f, size);
+				geometry::PutSquareCentredInside(buffer.data(), 12, 0.0f, 0.7f, 0.5f, 1.0f, 0.5f, 0.5f, 0.75f, 0.0f, size);
+				geometry::PutSquareCentredInside(buffer.data(), 18, 0.5f, 0.7f, 1.0f, 1.0f, 0.75f, 0.5f, 1.0f, 0.0f, size);
+				geometry::PutSquareCentredInside(buffer.data(), 24, -0.9f, -0.7f, -0.4f, -0.9f, 0.0f, 1.0f, 0.25f, 0.5f, size);
+				geometry::PutSquareCentredInside(buffer.data(), 30, 0.4f, -0.7f, 0.9f, -0.9f, 0.25f, 1.0f, 0.5f, 0.5f, size);
+				DoNotOptimise(buffer.data());
+			}
+		}
+		state.SetItemsProcessed(6.0 * (double)WindowSizes().size());
+	});
+
+	registry.Add("Geometry/RegionOfInterestAt/regions:6", [](State& state) {
+		// Regions matching the main screen icons, queried at uniformly random points
+		const std::vector<winrt::Windows::Foundation::Rect> regions = {
+			{ -1.0f, 0.5f, 0.5f, 0.5f }, { -0.5f, 0.5f, 0.5f, 0.5f }, { 0.0f, 0.5f, 0.5f, 0.5f },
+			{ 0.5f, 0.5f, 0.5f, 0.5f }, { -0.9f, -0.9f, 0.5f, 0.2f }, { 0.4f, -0.9f, 0.5f, 0.2f }
+		};
+		const int pointCount = 1024;
+		std::mt19937 generator(1234);
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		std::vector<std::pair<float, float>> points(pointCount);
+		for (auto& point : points) {
+			point = { distribution(generator), distribution(generator) };
+		}
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			int hits = 0;
+			for (auto& point : points) {
+				hits += geometry::RegionOfInterestAt(regions, point.first, point.second) >= 0 ? 1 : 0;
+			}
+			DoNotOptimise(hits);
+		}
+		state.SetItemsProcessed(pointCount);
+	});
+}
@@ -0,0 +1,182 @@
+#include "Harness.h"
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifndef ASSETS_DIR
+#define ASSETS_DIR "Assets"
+#endif
+
+namespace {
+
+	struct Result {
+		std::string name;
+		uint64_t iterations;
+		double nanosecondsPerIteration;
+		std::map<std::string, double> counters;
+	};
+
+	double RunOnce(const bench::BenchmarkFunction& function, bench::State& state) {
+		auto start = std::chrono::steady_clock::now();
+		function(state);
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double>(end - start).count() - state.GetPausedSeconds();
+	}
+
+	std::string EscapeJson(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	void WriteJson(std::ostream& out, const std::vector<Result>& results) {
+		char dateBuffer[64];
+		std::time_t now = std::time(nullptr);
+		std::strftime(dateBuffer, sizeof(dateBuffer), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+		out << std::setprecision(12);
+		out << "{\n";
+		out << "  \"context\": {\n";
+		out << "    \"date\": \"" << dateBuffer << "\",\n";
+		out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+		out << "    \"library_build_type\": \"release\"\n";
+#else
+		out << "    \"library_build_type\": \"debug\"\n";
+#endif
+		out << "  },\n";
+		out << "  \"benchmarks\": [\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			const Result& result = results[i];
+			out << "    {\n";
+			out << "      \"name\": \"" << EscapeJson(result.name) << "\",\n";
+			out << "      \"iterations\": " << result.iterations << ",\n";
+			out << "      \"real_time\": " << result.nanosecondsPerIteration << ",\n";
+			for (auto& counter : result.counters) {
+				out << "      \"" << EscapeJson(counter.first) << "\": " << counter.second << ",\n";
+			}
+			out << "      \"time_unit\": \"ns\"\n";
+			out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n";
+		out << "}\n";
+	}
+}
+
+bench::State::State(uint64_t iterationCount) : iterations(iterationCount), counters(), m_pausedSeconds(0.0), m_pauseStart()
+{
+}
+
+void bench::State::SetItemsProcessed(double itemsPerIteration)
+{
+	counters["items_per_iteration"] = itemsPerIteration;
+}
+
+void bench::State::PauseTiming()
+{
+	m_pauseStart = std::chrono::steady_clock::now();
+}
+
+void bench::State::ResumeTiming()
+{
+	m_pausedSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_pauseStart).count();
+}
+
+bench::Options::Options() : filter(), jsonPath(), minTimeSeconds(0.25)
+{
+}
+
+bench::Options bench::Options::FromArgs(int argc, char* argv[])
+{
+	Options options;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.rfind("--filter=", 0) == 0) {
+			options.filter = arg.substr(9);
+		} else if (arg.rfind("--json=", 0) == 0) {
+			options.jsonPath = arg.substr(7);
+		} else if (arg.rfind("--min-time=", 0) == 0) {
+			options.minTimeSeconds = std::stod(arg.substr(11));
+		} else {
+			throw std::invalid_argument("Unknown argument: " + arg);
+		}
+	}
+	return options;
+}
+
+void bench::Registry::Add(const std::string& name, BenchmarkFunction function)
+{
+	m_entries.push_back({ name, function });
+}
+
+int bench::Registry::RunAll(const Options& options)
+{
+	std::vector<Result> results;
+	std::printf("%-64s %14s %12s\n", "Benchmark", "Time (ns)", "Iterations");
+	for (auto& entry : m_entries) {
+		if (!options.filter.empty() && entry.name.find(options.filter) == std::string::npos) {
+			continue;
+		}
+
+		// Grow the iteration count until a run lasts long enough to give a stable per-iteration time
+		uint64_t iterations = 1;
+		State state(iterations);
+		double elapsedSeconds = RunOnce(entry.function, state);
+		while (elapsedSeconds < options.minTimeSeconds && iterations < (1ULL << 40)) {
+			const double scale = elapsedSeconds > 0.0 ? 1.4 * options.minTimeSeconds / elapsedSeconds : 10.0;
+			iterations = (uint64_t)((double)iterations * std::min(10.0, std::max(2.0, scale)));
+			state = State(iterations);
+			elapsedSeconds = RunOnce(entry.function, state);
+		}
+
+		Result result;
+		result.name = entry.name;
+		result.iterations = iterations;
+		result.nanosecondsPerIteration = 1.0e9 * elapsedSeconds / (double)iterations;
+		result.counters = state.counters;
+		auto itemsCounter = state.counters.find("items_per_iteration");
+		if (itemsCounter != state.counters.end()) {
+			result.counters.erase("items_per_iteration");
+			result.counters["items_per_second"] = itemsCounter->second * (double)iterations / elapsedSeconds;
+		}
+		results.push_back(result);
+		std::printf("%-64s %14.1f %12llu\n", result.name.c_str(), result.nanosecondsPerIteration, (unsigned long long)iterations);
+	}
+
+	if (!options.jsonPath.empty()) {
+		if (options.jsonPath == "-") {
+			WriteJson(std::cout, results);
+		} else {
+			std::ofstream file(options.jsonPath);
+			if (!file) {
+				std::fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+				return 1;
+			}
+			WriteJson(file, results);
+		}
+	}
+	return 0;
+}
+
+std::vector<unsigned char> bench::ReadAssetFile(const std::string& relativePath)
+{
+	std::string path = std::string(ASSETS_DIR) + "/" + relativePath;
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Cannot open asset " + path);
+	}
+	return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
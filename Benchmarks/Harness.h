@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+	// Per-run state handed to each benchmark function. The function runs its workload 'iterations' times
+	// and may publish extra named counters, which are reported per iteration unless marked as totals.
+	class State {
+	public:
+		uint64_t iterations;
+		std::map<std::string, double> counters;
+
+		explicit State(uint64_t iterationCount);
+		void SetItemsProcessed(double itemsPerIteration);
+
+		// Setup done between these is left out of the measured time
+		void PauseTiming();
+		void ResumeTiming();
+		inline double GetPausedSeconds() const { return m_pausedSeconds; }
+
+	private:
+		double m_pausedSeconds;
+		std::chrono::steady_clock::time_point m_pauseStart;
+	};
+
+	typedef std::function<void(State&)> BenchmarkFunction;
+
+	struct Options {
+		std::string filter;
+		std::string jsonPath;
+		double minTimeSeconds;
+
+		Options();
+		static Options FromArgs(int argc, char* argv[]);
+	};
+
+	class Registry {
+	private:
+		struct Entry {
+			std::string name;
+			BenchmarkFunction function;
+		};
+		std::vector<Entry> m_entries;
+
+	public:
+		void Add(const std::string& name, BenchmarkFunction function);
+		int RunAll(const Options& options);
+	};
+
+	// Prevents the compiler from discarding a value computed by a benchmark
+	template<typename T>
+	inline void DoNotOptimise(T const& value) {
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+	// Reads a file from the app's Assets folder
+	std::vector<unsigned char> ReadAssetFile(const std::string& relativePath);
+}
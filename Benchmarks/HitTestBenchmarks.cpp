@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Content/Components/Geometry.h"
+#include "Content/Components/HitTestIndex.h"
+
+#include <random>
+
+namespace {
+
+	// Tappable cells laid out edge to edge in a square grid, with a small gap around each, like a note grid
+	std::vector<winrt::Windows::Foundation::Rect> MakeGridRegions(int count)
+	{
+		const int columns = (int)ceil(sqrt((double)count));
+		const int rows = (count + columns - 1) / columns;
+		const float cellWidth = 2.0f / (float)columns;
+		const float cellHeight = 2.0f / (float)rows;
+		std::vector<winrt::Windows::Foundation::Rect> regions;
+		for (int i = 0; i < count; i++) {
+			const float x = -1.0f + (float)(i % columns) * cellWidth;
+			const float y = -1.0f + (float)(i / columns) * cellHeight;
+			regions.push_back({ x + 0.1f * cellWidth, y + 0.1f * cellHeight, 0.8f * cellWidth, 0.8f * cellHeight });
+		}
+		return regions;
+	}
+
+	std::vector<std::pair<float, float>> MakeQueryPoints(int count)
+	{
+		std::mt19937 generator(1234);
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		std::vector<std::pair<float, float>> points(count);
+		for (auto& point : points) {
+			point = { distribution(generator), distribution(generator) };
+		}
+		return points;
+	}
+}
+
+void bench::RegisterHitTestBenchmarks(Registry& registry)
+{
+	const int queryCount = 1024;
+	for (int regionCount : { 10, 1000, 10000 }) {
+		const std::string suffix = "/regions:" + std::to_string(regionCount);
+
+		registry.Add("HitTest/LinearScan" + suffix, [regionCount, queryCount](State& state) {
+			auto regions = MakeGridRegions(regionCount);
+			auto points = MakeQueryPoints(queryCount);
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				int hits = 0;
+				for (auto& point : points) {
+					hits += geometry::RegionOfInterestAt(regions, point.first, point.second) >= 0 ? 1 : 0;
+				}
+				DoNotOptimise(hits);
+			}
+			state.SetItemsProcessed(queryCount);
+		});
+
+		// Every point must find the region the linear scan does, or the run fails
+		registry.Add("HitTest/IndexQuery" + suffix, [regionCount, queryCount](State& state) {
+			auto regions = MakeGridRegions(regionCount);
+			geometry::HitTestIndex index;
+			index.SetLayer(0, regions);
+			auto points = MakeQueryPoints(queryCount);
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				int hits = 0;
+				for (auto& point : points) {
+					hits += index.WidgetAt(point.first, point.second).IsValid() ? 1 : 0;
+				}
+				DoNotOptimise(hits);
+			}
+			state.SetItemsProcessed(queryCount);
+
+			int mismatches = 0;
+			for (auto& point : points) {
+				const int region = geometry::RegionOfInterestAt(regions, point.first, point.second);
+				const geometry::WidgetId expected = region >= 0 ? geometry::WidgetId(0, region) : geometry::WidgetId();
+				mismatches += index.WidgetAt(point.first, point.second) != expected ? 1 : 0;
+			}
+			state.counters["mismatches"] = (double)mismatches;
+			if (mismatches > 0) {
+				throw std::runtime_error(std::to_string(mismatches) + " points found a different region from the linear scan");
+			}
+		});
+
+		registry.Add("HitTest/IndexBuild" + suffix, [regionCount](State& state) {
+			auto regions = MakeGridRegions(regionCount);
+			geometry::HitTestIndex index;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				index.Clear();
+				index.SetLayer(0, regions);
+				DoNotOptimise(index.RegionCount());
+			}
+			state.SetItemsProcessed(regionCount);
+		});
+
+		registry.Add("HitTest/IndexUpdateOneRegion" + suffix, [regionCount](State& state) {
+			auto regions = MakeGridRegions(regionCount);
+			geometry::HitTestIndex index;
+			index.SetLayer(0, regions);
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				regions[regionCount / 2].X += (i & 1) ? -0.001f : 0.001f;
+				index.SetLayer(0, regions);
+				DoNotOptimise(index.RegionCount());
+			}
+			state.SetItemsProcessed(1.0);
+		});
+	}
+}
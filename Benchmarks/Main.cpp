@@ -0,0 +1,35 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include <cstdio>
+
+int main(int argc, char* argv[])
+{
+	try {
+		bench::Options options = bench::Options::FromArgs(argc, argv);
+		bench::Registry registry;
+		bench::RegisterAudioBenchmarks(registry);
+		bench::RegisterBeatGridBenchmarks(registry);
+		bench::RegisterFontBenchmarks(registry);
+		bench::RegisterGeometryBenchmarks(registry);
+		bench::RegisterHitTestBenchmarks(registry);
+		bench::RegisterMidiBenchmarks(registry);
+		bench::RegisterNotationBenchmarks(registry);
+		bench::RegisterOnsetBenchmarks(registry);
+		bench::RegisterPlaybackStateBenchmarks(registry);
+		bench::RegisterRealtimeBenchmarks(registry);
+		bench::RegisterSessionBenchmarks(registry);
+		bench::RegisterSongBenchmarks(registry);
+		bench::RegisterTapTempoBenchmarks(registry);
+		bench::RegisterTempoRampBenchmarks(registry);
+		bench::RegisterTextureBenchmarks(registry);
+		bench::RegisterTimerBenchmarks(registry);
+		bench::RegisterToneSetBenchmarks(registry);
+		bench::RegisterVisualSyncBenchmarks(registry);
+		return registry.RunAll(options);
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+}
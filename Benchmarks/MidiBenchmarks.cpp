@@ -0,0 +1,233 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/Midi/LoopbackMidiPort.h"
+#include "Audio/Midi/MidiOutput.h"
+#include "Audio/Sinks/SimulatedDeviceSink.h"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+	const uint32_t ChannelCount = 2;
+	const double BeatsPerMinute = 180.0;
+	const size_t PortCapacity = 8192;
+
+	// Long enough after stopping for the stop message to have gone out
+	const double SettleSeconds = 0.05;
+
+	// Sections of two beats getting faster, with a ghost note between beats so that clicks are not all on beats
+	audio::Song MakeSong()
+	{
+		audio::Song song;
+		song.name = "MIDI clock";
+		for (int i = 0; i < 4; i++) {
+			audio::SongSection section = { "Section", 2, 4, 2, 1, 200.0 + 40.0 * i, {} };
+			for (int step = 0; step < section.GetStepsPerBar(); step++) {
+				section.pattern.push_back(step == 0 ? audio::PatternNote::ACCENT : step % 2 == 0 ? audio::PatternNote::NORMAL : audio::PatternNote::GHOST);
+			}
+			song.sections.push_back(section);
+		}
+		return song;
+	}
+
+	double Percentile(std::vector<double> values, double percentile)
+	{
+		if (values.empty()) {
+			return 0.0;
+		}
+		const size_t rank = min(values.size() - 1, (size_t)(percentile / 100.0 * (double)values.size()));
+		std::nth_element(values.begin(), values.begin() + rank, values.end());
+		return values[rank];
+	}
+
+	// What the loopback port received: the host time of every clock pulse, how many beats had a full-velocity
+	// note, and how many of the gaps between those did not hold exactly 24 pulses. The stream must open with a
+	// start and close with a stop. A song plays to its end, so the pulses after its last beat are checked too.
+	struct ReceivedClock {
+		std::vector<double> pulseSeconds;
+		uint64_t beats;
+		uint64_t wrong;
+	};
+
+	ReceivedClock ReadClock(const audio::LoopbackMidiPort& port, bool isWholeSong)
+	{
+		ReceivedClock clock = { {}, 0, 0 };
+		const audio::ReceivedMidiMessage* messages = port.GetMessages();
+		const size_t count = port.GetMessageCount();
+		if (count == 0 || messages[0].bytes[0] != (uint8_t)audio::MidiStatus::START || messages[count - 1].bytes[0] != (uint8_t)audio::MidiStatus::STOP) {
+			clock.wrong++;
+		}
+		uint32_t pulsesSinceBeat = 0;
+		for (size_t i = 0; i < count; i++) {
+			const audio::ReceivedMidiMessage& message = messages[i];
+			if (message.bytes[0] == (uint8_t)audio::MidiStatus::TIMING_CLOCK) {
+				clock.pulseSeconds.push_back((double)message.counter / port.GetFrequency());
+				pulsesSinceBeat++;
+			} else if ((message.bytes[0] & 0xf0) == (uint8_t)audio::MidiStatus::NOTE_ON && message.bytes[2] == 127) {
+				// A beat's first pulse comes just before its note, so it counts towards the gap before
+				if (clock.beats > 0 && pulsesSinceBeat != audio::MidiOutput::PulsesPerBeat) {
+					clock.wrong++;
+				}
+				clock.beats++;
+				pulsesSinceBeat = 0;
+			}
+		}
+		if (isWholeSong && pulsesSinceBeat != audio::MidiOutput::PulsesPerBeat - 1) {
+			clock.wrong++;
+		}
+		return clock;
+	}
+
+	// How far each pulse arrived from an even grid at the tempo, lined up on the pulses' mean offset so that the
+	// output latency drops out
+	std::vector<double> GetJitter(const std::vector<double>& pulseSeconds, double beatsPerMinute)
+	{
+		const double period = 60.0 / (beatsPerMinute * audio::MidiOutput::PulsesPerBeat);
+		double meanOffset = 0.0;
+		for (size_t k = 0; k < pulseSeconds.size(); k++) {
+			meanOffset += (pulseSeconds[k] - (double)k * period) / (double)pulseSeconds.size();
+		}
+		std::vector<double> jitter(pulseSeconds.size());
+		for (size_t k = 0; k < pulseSeconds.size(); k++) {
+			jitter[k] = fabs(pulseSeconds[k] - (double)k * period - meanOffset);
+		}
+		return jitter;
+	}
+
+	struct MidiRun {
+		ReceivedClock clock;
+		audio::SyncOffsetStatistics::Summary lateness;
+		uint64_t dropped;
+		uint64_t lateBlocks;
+	};
+
+	// Plays the engine on a simulated device for the given time, or to the end of the song, with MIDI clock and
+	// notes going out through a loopback port
+	MidiRun Play(uint32_t blockFrames, const audio::SongTimeline* timeline, double seconds)
+	{
+		audio::LoopbackMidiPort port(PortCapacity);
+		audio::MidiOutput output(port, SampleRate);
+		audio::AudioEngine engine(SampleRate, ChannelCount);
+		audio::SimulatedDeviceSink sink(SampleRate, ChannelCount, blockFrames);
+		output.SetOutputLatencyFrames(sink.GetOutputLatencyFrames());
+		output.SetClickNotes(true, 9, 76, 77);
+		output.Start();
+		engine.SetMidiOutput(&output);
+		engine.SetTempo(BeatsPerMinute);
+		if (timeline != nullptr) {
+			engine.SetSongTimeline(timeline);
+		}
+		engine.Play();
+		sink.Start(&engine);
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		engine.Stop();
+		std::this_thread::sleep_for(std::chrono::duration<double>((double)sink.GetOutputLatencyFrames() / SampleRate + SettleSeconds));
+		sink.Stop();
+		output.Stop();
+		return { ReadClock(port, timeline != nullptr), output.GetLatenessStatistics().GetSummary(),
+			output.GetDroppedMessageCount() + port.GetOverflowCount(), sink.GetLateBlockCount() };
+	}
+}
+
+void bench::RegisterMidiBenchmarks(Registry& registry)
+{
+	// A second of the metronome per iteration: how late the sender thread sent each message after it was due,
+	// and how far the pulses as received strayed from an even 24 to the beat. Any wrong or dropped message fails
+	// the run.
+	for (uint32_t blockFrames : { 64u, 256u, 1024u }) {
+		registry.Add("Midi/Clock/metronome/block:" + std::to_string(blockFrames), [blockFrames](State& state) {
+			std::vector<double> jitter;
+			double latenessP50 = 0.0;
+			double latenessP95 = 0.0;
+			double latenessMax = 0.0;
+			uint64_t pulses = 0;
+			uint64_t beats = 0;
+			uint64_t wrong = 0;
+			uint64_t dropped = 0;
+			uint64_t lateBlocks = 0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				const MidiRun run = Play(blockFrames, nullptr, 1.0);
+				const std::vector<double> runJitter = GetJitter(run.clock.pulseSeconds, BeatsPerMinute);
+				jitter.insert(jitter.end(), runJitter.begin(), runJitter.end());
+				latenessP50 = max(latenessP50, run.lateness.p50Magnitude);
+				latenessP95 = max(latenessP95, run.lateness.p95Magnitude);
+				latenessMax = max(latenessMax, run.lateness.maximum);
+				pulses += run.clock.pulseSeconds.size();
+				beats += run.clock.beats;
+				wrong += run.clock.wrong;
+				dropped += run.dropped;
+				lateBlocks += run.lateBlocks;
+			}
+			state.counters["beats"] = (double)beats / (double)state.iterations;
+			state.counters["pulses"] = (double)pulses / (double)state.iterations;
+			state.counters["lateness_p50_us"] = 1.0e6 * latenessP50;
+			state.counters["lateness_p95_us"] = 1.0e6 * latenessP95;
+			state.counters["lateness_max_us"] = 1.0e6 * latenessMax;
+			state.counters["jitter_p50_us"] = 1.0e6 * Percentile(jitter, 50.0);
+			state.counters["jitter_p95_us"] = 1.0e6 * Percentile(jitter, 95.0);
+			state.counters["jitter_max_us"] = 1.0e6 * Percentile(jitter, 100.0);
+			state.counters["late_blocks"] = (double)lateBlocks;
+			state.counters["wrong"] = (double)wrong;
+			state.counters["dropped"] = (double)dropped;
+			if (wrong > 0 || dropped > 0) {
+				throw std::runtime_error(std::to_string(wrong) + " wrong beats and " + std::to_string(dropped) + " dropped messages");
+			}
+		});
+	}
+
+	// A song played to its end, with the tempo changing every two beats and ghost notes between them: every beat
+	// still gets exactly 24 pulses, and the song ending stops the followers, or the run fails
+	registry.Add("Midi/Clock/song/block:256", [](State& state) {
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(), SampleRate);
+		const double songSeconds = (double)timeline->GetLengthSamples() / SampleRate;
+		double latenessMax = 0.0;
+		uint64_t beats = 0;
+		uint64_t wrong = 0;
+		uint64_t dropped = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			const MidiRun run = Play(256, timeline.get(), songSeconds + 0.1);
+			latenessMax = max(latenessMax, run.lateness.maximum);
+			beats += run.clock.beats;
+			wrong += run.clock.wrong + (run.clock.pulseSeconds.size() != 8 * audio::MidiOutput::PulsesPerBeat ? 1 : 0);
+			dropped += run.dropped;
+		}
+		state.counters["beats"] = (double)beats / (double)state.iterations;
+		state.counters["lateness_max_us"] = 1.0e6 * latenessMax;
+		state.counters["wrong"] = (double)wrong;
+		state.counters["dropped"] = (double)dropped;
+		if (wrong > 0 || dropped > 0) {
+			throw std::runtime_error(std::to_string(wrong) + " wrong beats and " + std::to_string(dropped) + " dropped messages");
+		}
+	});
+
+	// Twice the queue's worth of pulses scheduled while the sender is stalled: the audio thread never blocks on
+	// the full queue, exactly the pulses it has no room for are dropped, and none reach the port
+	registry.Add("Midi/Queue/overflow", [](State& state) {
+		const uint64_t burst = 2 * audio::MidiOutput::QueueCapacity;
+		uint64_t wrongDrops = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			state.PauseTiming();
+			audio::LoopbackMidiPort port(PortCapacity);
+			audio::MidiOutput output(port, SampleRate);
+			output.BeginBlock(0, 0, 256);
+			state.ResumeTiming();
+			for (uint64_t pulse = 0; pulse < burst; pulse++) {
+				output.SendClock(pulse * 100);
+			}
+			state.PauseTiming();
+			if (output.GetDroppedMessageCount() != burst - audio::MidiOutput::QueueCapacity || port.GetMessageCount() != 0) {
+				wrongDrops++;
+			}
+			state.ResumeTiming();
+		}
+		state.SetItemsProcessed((double)burst);
+		state.counters["wrong_drops"] = (double)wrongDrops;
+		if (wrongDrops > 0) {
+			throw std::runtime_error(std::to_string(wrongDrops) + " bursts did not drop exactly the overflow");
+		}
+	});
+}
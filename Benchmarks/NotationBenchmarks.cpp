@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Common/Font.h"
+#include "Content/Components/NotationLayout.h"
+
+#include <random>
+
+namespace {
+
+	const int EditCount = 1000;
+	const uint32_t Seed = 50;
+
+	// Metres and subdivisions between them covering beams, stems only, hollow heads and tuplets
+	std::vector<audio::SongSection> MakeSections()
+	{
+		const int shapes[][3] = {
+			{ 4, 4, 2 }, { 4, 4, 4 }, { 3, 4, 3 }, { 5, 4, 5 }, { 7, 8, 1 }, { 6, 8, 2 }, { 2, 2, 1 }, { 12, 8, 3 }
+		};
+		std::mt19937 random(Seed);
+		std::vector<audio::SongSection> sections;
+		for (auto& shape : shapes) {
+			audio::SongSection section = { "Section", shape[0], shape[1], shape[2], 1, 120.0, {} };
+			for (int step = 0; step < section.GetStepsPerBar(); step++) {
+				section.pattern.push_back((audio::PatternNote)(random() % 4));
+			}
+			sections.push_back(section);
+		}
+		return sections;
+	}
+
+	// Box of the main screen's notation panel at 100% scaling
+	void LayOut(notation::NotationLayout& layout, font::Font* font, const audio::SongSection& section, winrt::Windows::Foundation::Size size)
+	{
+		layout.Layout(font, section, -0.9f, -0.1f, 1.8f, 0.3f, size);
+	}
+
+	struct Edit {
+		int section;
+		int step;
+		audio::PatternNote note;
+	};
+
+	// Every vertex of a step's run is tagged with it, and nothing outside the step runs is tagged with any step
+	uint64_t CountWrongTags(const notation::NotationLayout& layout)
+	{
+		const audio::SongSection& section = layout.GetSection();
+		const std::vector<structures::VertexTexCoord>& vertices = layout.GetVertices();
+		std::vector<float> expected(vertices.size(), notation::NotationLayout::NoStep);
+		for (int beat = 0; beat < section.beatsPerBar; beat++) {
+			const int first = layout.GetBeatRange(beat).firstVertex;
+			for (int i = 0; i < section.stepsPerBeat * notation::NotationLayout::VerticesPerStep; i++) {
+				expected[first + i] = (float)(beat * section.stepsPerBeat + i / notation::NotationLayout::VerticesPerStep);
+			}
+		}
+		uint64_t wrong = 0;
+		for (size_t i = 0; i < vertices.size(); i++) {
+			wrong += vertices[i].tex.z != expected[i] ? 1 : 0;
+		}
+		return wrong;
+	}
+
+	uint64_t CountDifferences(const std::vector<structures::VertexTexCoord>& a, const std::vector<structures::VertexTexCoord>& b, int first, int end)
+	{
+		uint64_t differences = 0;
+		for (int i = first; i < end; i++) {
+			differences += memcmp(&a[i], &b[i], sizeof(structures::VertexTexCoord)) != 0 ? 1 : 0;
+		}
+		return differences;
+	}
+}
+
+void bench::RegisterNotationBenchmarks(Registry& registry)
+{
+	auto fileData = ReadAssetFile("Definitions/Orkney.fnt");
+	std::shared_ptr<font::Font> orkney(font::Font::MakeFromFileContents(fileData));
+	auto sections = std::make_shared<std::vector<audio::SongSection>>(MakeSections());
+
+	std::string name = "Notation/Layout/sections:" + std::to_string(sections->size()) + "/window_sizes:" + std::to_string(WindowSizes().size());
+	registry.Add(name, [orkney, sections](State& state) {
+		notation::NotationLayout layout;
+		size_t stepCount = 0;
+		for (auto& section : *sections) {
+			stepCount += section.pattern.size();
+		}
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			for (auto& size : WindowSizes()) {
+				for (auto& section : *sections) {
+					LayOut(layout, orkney.get(), section, size);
+					DoNotOptimise(layout.GetVertices().data());
+				}
+			}
+		}
+		state.SetItemsProcessed((double)(stepCount * WindowSizes().size()));
+		state.counters["steps"] = (double)stepCount;
+	});
+
+	// Each edit must leave the layout exactly as laying out the edited bar afresh would, having changed nothing
+	// outside the range it returned, and that range must lie within the edited step's beat; any edit that does
+	// not fails the run
+	registry.Add("Notation/SetNote/edits:" + std::to_string(EditCount), [orkney, sections](State& state) {
+		state.PauseTiming();
+		const winrt::Windows::Foundation::Size size = { 1920.0f, 1080.0f };
+		std::mt19937 random(Seed);
+		std::vector<Edit> edits;
+		for (int i = 0; i < EditCount; i++) {
+			const int section = (int)(random() % sections->size());
+			const int step = (int)(random() % (*sections)[section].pattern.size());
+			edits.push_back({ section, step, (audio::PatternNote)(random() % 4) });
+		}
+
+		std::vector<notation::NotationLayout> layouts(sections->size());
+		for (size_t i = 0; i < sections->size(); i++) {
+			LayOut(layouts[i], orkney.get(), (*sections)[i], size);
+		}
+		notation::NotationLayout reference;
+		uint64_t mismatches = 0;
+		uint64_t outside = 0;
+		uint64_t wrong = 0;
+		double editBytes = 0.0;
+		double bufferBytes = 0.0;
+		for (const Edit& edit : edits) {
+			notation::NotationLayout& layout = layouts[edit.section];
+			const std::vector<structures::VertexTexCoord> before = layout.GetVertices();
+			const notation::VertexRange range = layout.SetNote(edit.step, edit.note);
+			const std::vector<structures::VertexTexCoord>& after = layout.GetVertices();
+			const int end = range.firstVertex + range.vertexCount;
+			outside += CountDifferences(before, after, 0, range.firstVertex) + CountDifferences(before, after, end, (int)after.size());
+			const notation::VertexRange beat = layout.GetBeatRange(edit.step / layout.GetSection().stepsPerBeat);
+			if (!range.IsEmpty() && (range.firstVertex < beat.firstVertex || end > beat.firstVertex + beat.vertexCount)) {
+				outside++;
+			}
+
+			LayOut(reference, orkney.get(), layout.GetSection(), size);
+			mismatches += CountDifferences(reference.GetVertices(), after, 0, (int)after.size());
+			wrong += CountWrongTags(layout);
+			editBytes += (double)range.GetByteLength();
+			bufferBytes += (double)(after.size() * sizeof(structures::VertexTexCoord));
+		}
+		if (mismatches > 0 || outside > 0 || wrong > 0) {
+			throw std::runtime_error("Note edits left " + std::to_string(mismatches) + " vertices unlike a fresh layout, " + std::to_string(outside)
+				+ " changes outside their range and " + std::to_string(wrong) + " wrong step tags");
+		}
+		state.ResumeTiming();
+
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			for (const Edit& edit : edits) {
+				DoNotOptimise(layouts[edit.section].SetNote(edit.step, edit.note));
+			}
+		}
+		state.SetItemsProcessed((double)edits.size());
+		state.counters["mismatches"] = (double)mismatches;
+		state.counters["outside"] = (double)outside;
+		state.counters["wrong"] = (double)wrong;
+		state.counters["mean_edit_bytes"] = editBytes / (double)edits.size();
+		state.counters["mean_buffer_bytes"] = bufferBytes / (double)edits.size();
+	});
+}
@@ -0,0 +1,387 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/Analysis/LiveOnsetDetector.h"
+#include "Audio/Analysis/PlayAlongMatcher.h"
+#include "Audio/Analysis/RealFft.h"
+#include "Audio/Export/WavFileWriter.h"
+#include "Audio/ToneSets/AudioDecoder.h"
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+	const uint32_t ChannelCount = 2;
+	const uint32_t InputBlockFrames = 480;
+
+	// Round trip from the song being played to the player's hits being captured
+	const uint32_t RoundTripFrames = 960;
+
+	// A detected onset this close to a hit is that hit
+	const double ToleranceSeconds = 0.025;
+
+	// Every take must find at least this share of its hits, and this share of its detections must be hits
+	const double MinPrecision = 0.95;
+	const double MinRecall = 0.95;
+
+	// Grooves at different tempos and subdivisions, down to sixteenths at 96 BPM, with some steps left out
+	audio::Song MakeSong()
+	{
+		audio::Song song;
+		song.name = "Play-along check";
+		song.sections = {
+			{ "Eighths", 4, 4, 2, 6, 100.0, {} },
+			{ "Waltz", 3, 4, 1, 6, 140.0, {} },
+			{ "Sixteenths", 4, 4, 4, 4, 96.0, {} },
+			{ "Triplets", 4, 4, 3, 4, 120.0, {} }
+		};
+		for (audio::SongSection& section : song.sections) {
+			for (int step = 0; step < section.GetStepsPerBar(); step++) {
+				section.pattern.push_back(step == 0 ? audio::PatternNote::ACCENT : step % 5 == 3 ? audio::PatternNote::REST : audio::PatternNote::NORMAL);
+			}
+		}
+		return song;
+	}
+
+	enum class Condition {
+		CLEAN,
+		NOISY,
+		SOFT
+	};
+
+	// A take of the player hitting every click of the song, captured as a stereo input would hear it
+	struct Take {
+		std::vector<float> samples;
+
+		// Where each hit starts in the input, and the click it was played for
+		std::vector<double> hitSamples;
+		std::vector<size_t> hitEvents;
+	};
+
+	// Hits are a burst of noise over a low thump, each a little early or late, at random levels; the noisy take
+	// adds hiss and mains hum, and the soft one plays near the noise floor
+	Take RecordTake(const audio::SongTimeline& timeline, Condition condition)
+	{
+		std::mt19937 random(44);
+		std::normal_distribution<double> timing(0.005, 0.01);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		const float minimumGain = condition == Condition::SOFT ? 0.03f : 0.3f;
+		const float maximumGain = condition == Condition::SOFT ? 0.1f : 0.9f;
+		const float noiseLevel = condition == Condition::NOISY ? 0.01f : condition == Condition::SOFT ? 0.002f : 0.0f;
+		const float humLevel = condition == Condition::NOISY ? 0.02f : 0.0f;
+		const uint32_t hitFrames = SampleRate / 4;
+
+		const size_t frameCount = (size_t)timeline.GetLengthSamples() + RoundTripFrames + SampleRate;
+		std::vector<float> mono(frameCount);
+		Take take;
+		for (size_t event = 0; event < timeline.GetEventCount(); event++) {
+			if (timeline.GetEventAccents()[event] == audio::PatternNote::REST) {
+				continue;
+			}
+			const double offsetSeconds = std::clamp(timing(random), -0.035, 0.035);
+			const double start = (double)timeline.GetEventSample(event) + RoundTripFrames + offsetSeconds * SampleRate;
+			take.hitSamples.push_back(start);
+			take.hitEvents.push_back(event);
+			const float gain = minimumGain + (maximumGain - minimumGain) * 0.5f * (1.0f + uniform(random));
+			const size_t first = (size_t)ceil(start);
+			for (uint32_t i = 0; i < hitFrames && first + i < frameCount; i++) {
+				const float t = (float)((double)(first + i) - start) / (float)SampleRate;
+				const float attack = min(t / 0.001f, 1.0f);
+				const float noise = uniform(random) * expf(-t / 0.02f);
+				const float thump = 0.6f * sinf(6.2831853f * 180.0f * t) * expf(-t / 0.08f);
+				mono[first + i] += gain * attack * (noise + thump);
+			}
+		}
+		take.samples.resize(frameCount * ChannelCount);
+		for (size_t i = 0; i < frameCount; i++) {
+			const float hum = humLevel * sinf(6.2831853f * 50.0f * (float)i / (float)SampleRate);
+			for (uint32_t channel = 0; channel < ChannelCount; channel++) {
+				take.samples[i * ChannelCount + channel] = mono[i] + hum + noiseLevel * uniform(random);
+			}
+		}
+		return take;
+	}
+
+	// Through a float WAV file and back, as takes recorded elsewhere would come in
+	audio::DecodedAudio RoundTripWav(const Take& take, const std::string& path)
+	{
+		{
+			audio::WavFileWriter writer(path, SampleRate, ChannelCount);
+			writer.Write(take.samples.data(), take.samples.size() / ChannelCount);
+			writer.Finish();
+		}
+		std::ifstream file(path, std::ios::binary);
+		const std::vector<byte> fileData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+		std::remove(path.c_str());
+		return audio::DecodeAudioFile(fileData);
+	}
+
+	// Feeds the input to the worker in device-sized blocks as fast as it keeps up, taking onsets as the UI would
+	std::vector<audio::DetectedOnset> DetectLive(audio::LiveOnsetDetector& detector, const audio::DecodedAudio& input, uint64_t& droppedFrames, uint64_t& lostOnsets)
+	{
+		std::vector<audio::DetectedOnset> onsets;
+		audio::DetectedOnset onset;
+		const size_t frameCount = input.GetFrameCount();
+		detector.Start();
+		for (size_t frame = 0; frame < frameCount; frame += InputBlockFrames) {
+			while (frame - detector.GetProcessedFrameCount() > SampleRate / 4) {
+				std::this_thread::yield();
+			}
+			const uint32_t frames = (uint32_t)min((size_t)InputBlockFrames, frameCount - frame);
+			detector.WriteInput(input.samples.data() + frame * input.channelCount, frames, input.channelCount);
+			while (detector.TryGetOnset(onset)) {
+				onsets.push_back(onset);
+			}
+		}
+		while (frameCount - detector.GetProcessedFrameCount() >= InputBlockFrames) {
+			std::this_thread::yield();
+		}
+		detector.Stop();
+		while (detector.TryGetOnset(onset)) {
+			onsets.push_back(onset);
+		}
+		droppedFrames += detector.GetDroppedFrameCount();
+		lostOnsets += detector.GetLostOnsetCount();
+		return onsets;
+	}
+
+	struct Score {
+		uint64_t hits;
+		uint64_t detected;
+		uint64_t truePositives;
+		uint64_t wrongEvents;
+		uint64_t repeats;
+		std::vector<double> errorsSeconds;
+		double maxLatencySeconds;
+	};
+
+	// Pairs each detection with the nearest hit not yet taken, and checks the matcher put it on that hit's click
+	void ScoreTake(const Take& take, const std::vector<audio::DetectedOnset>& onsets, const audio::SongTimeline& timeline, Score& score)
+	{
+		audio::PlayAlongMatcher matcher(timeline);
+		matcher.SetInputOffset(-(double)RoundTripFrames);
+		std::vector<bool> isTaken(take.hitSamples.size(), false);
+		score.hits += take.hitSamples.size();
+		score.detected += onsets.size();
+		for (const audio::DetectedOnset& onset : onsets) {
+			score.maxLatencySeconds = max(score.maxLatencySeconds, ((double)onset.detectedAtSample - onset.sample) / SampleRate);
+			audio::PlayAlongHit hit;
+			if (!matcher.Match(onset, hit)) {
+				continue;
+			}
+			const auto next = std::lower_bound(take.hitSamples.begin(), take.hitSamples.end(), onset.sample);
+			size_t nearest = (size_t)(next - take.hitSamples.begin());
+			if (nearest == take.hitSamples.size() || (nearest > 0 && onset.sample - take.hitSamples[nearest - 1] < take.hitSamples[nearest] - onset.sample)) {
+				nearest--;
+			}
+			const double errorSeconds = (onset.sample - take.hitSamples[nearest]) / SampleRate;
+			if (fabs(errorSeconds) > ToleranceSeconds || isTaken[nearest]) {
+				continue;
+			}
+			isTaken[nearest] = true;
+			score.truePositives++;
+			score.errorsSeconds.push_back(errorSeconds);
+			score.wrongEvents += hit.event != take.hitEvents[nearest] ? 1 : 0;
+		}
+		score.repeats += matcher.GetRepeatCount();
+	}
+
+	double Percentile(std::vector<double> values, double percentile)
+	{
+		if (values.empty()) {
+			return 0.0;
+		}
+		const size_t rank = min(values.size() - 1, (size_t)(percentile / 100.0 * (double)values.size()));
+		std::nth_element(values.begin(), values.begin() + rank, values.end());
+		return values[rank];
+	}
+
+	void ReportScore(bench::State& state, const Score& score)
+	{
+		std::vector<double> magnitudes;
+		double sum = 0.0;
+		for (double error : score.errorsSeconds) {
+			magnitudes.push_back(fabs(error));
+			sum += error;
+		}
+		const double iterations = (double)state.iterations;
+		const double precision = score.detected > 0 ? (double)score.truePositives / (double)score.detected : 0.0;
+		const double recall = score.hits > 0 ? (double)score.truePositives / (double)score.hits : 0.0;
+		state.counters["hits"] = (double)score.hits / iterations;
+		state.counters["missed"] = (double)(score.hits - score.truePositives) / iterations;
+		state.counters["false_positives"] = (double)(score.detected - score.truePositives) / iterations;
+		state.counters["f_measure"] = precision + recall > 0.0 ? 2.0 * precision * recall / (precision + recall) : 0.0;
+		state.counters["wrong_clicks"] = (double)score.wrongEvents;
+		state.counters["repeat_matches"] = (double)score.repeats / iterations;
+		state.counters["mean_error_ms"] = magnitudes.empty() ? 0.0 : 1000.0 * sum / (double)magnitudes.size();
+		state.counters["abs_error_p50_ms"] = 1000.0 * Percentile(magnitudes, 50.0);
+		state.counters["abs_error_p95_ms"] = 1000.0 * Percentile(magnitudes, 95.0);
+		state.counters["abs_error_max_ms"] = 1000.0 * Percentile(magnitudes, 100.0);
+		state.counters["detection_latency_max_ms"] = 1000.0 * score.maxLatencySeconds;
+		if (precision < MinPrecision || recall < MinRecall) {
+			throw std::runtime_error("Precision " + std::to_string(precision) + " and recall " + std::to_string(recall) + " fall below the bound");
+		}
+	}
+
+	const char* GetConditionName(Condition condition)
+	{
+		switch (condition) {
+		case Condition::CLEAN: return "clean";
+		case Condition::NOISY: return "noisy";
+		case Condition::SOFT: return "soft";
+		}
+		return "unknown";
+	}
+}
+
+void bench::RegisterOnsetBenchmarks(Registry& registry)
+{
+	// Largest difference from a direct DFT over a frame of noise, relative to the largest bin
+	registry.Add("RealFft/Transform/size:1024", [](State& state) {
+		const uint32_t size = 1024;
+		audio::RealFft fft(size);
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+		std::vector<float> input(size);
+		for (float& sample : input) {
+			sample = uniform(random);
+		}
+		std::vector<float> real(fft.GetBinCount());
+		std::vector<float> imaginary(fft.GetBinCount());
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			fft.Transform(input.data(), real.data(), imaginary.data());
+			DoNotOptimise(real[i % real.size()]);
+		}
+
+		state.PauseTiming();
+		double maxError = 0.0;
+		double maxMagnitude = 0.0;
+		for (uint32_t bin = 0; bin < fft.GetBinCount(); bin++) {
+			double expectedReal = 0.0;
+			double expectedImaginary = 0.0;
+			for (uint32_t n = 0; n < size; n++) {
+				const double angle = -2.0 * 3.14159265358979323846 * (double)((uint64_t)bin * n % size) / size;
+				expectedReal += input[n] * cos(angle);
+				expectedImaginary += input[n] * sin(angle);
+			}
+			maxError = max(maxError, hypot(real[bin] - expectedReal, imaginary[bin] - expectedImaginary));
+			maxMagnitude = max(maxMagnitude, hypot(expectedReal, expectedImaginary));
+		}
+		state.ResumeTiming();
+		state.SetItemsProcessed((double)size);
+		state.counters["max_relative_error"] = maxError / maxMagnitude;
+	});
+
+	// Takes written to WAV and read back, run through the worker and matched to the song: how many hits are
+	// found, how close, whether each lands on the click it was played for, and how long after it the detector knew.
+	// Precision or recall below its bound fails the run, as does an onset lost between the worker and the reader.
+	for (Condition condition : { Condition::CLEAN, Condition::NOISY, Condition::SOFT }) {
+		registry.Add(std::string("OnsetDetector/PlayAlong/") + GetConditionName(condition), [condition](State& state) {
+			const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(), SampleRate);
+			const Take take = RecordTake(*timeline, condition);
+			const audio::DecodedAudio input = RoundTripWav(take, "onset_benchmark.wav");
+			audio::LiveOnsetDetector detector(SampleRate);
+			Score score = { 0, 0, 0, 0, 0, {}, 0.0 };
+			uint64_t droppedFrames = 0;
+			uint64_t lostOnsets = 0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				const std::vector<audio::DetectedOnset> onsets = DetectLive(detector, input, droppedFrames, lostOnsets);
+				state.PauseTiming();
+				ScoreTake(take, onsets, *timeline, score);
+				state.ResumeTiming();
+			}
+			state.SetItemsProcessed((double)input.GetFrameCount());
+			ReportScore(state, score);
+			state.counters["dropped_frames"] = (double)droppedFrames;
+			state.counters["lost_onsets"] = (double)lostOnsets;
+			if (lostOnsets > 0) {
+				throw std::runtime_error(std::to_string(lostOnsets) + " onsets lost");
+			}
+		});
+	}
+
+	// The detector alone over the noisy take: seconds of input analysed per second taken, and the share of one
+	// core that analysing live input would take
+	registry.Add("OnsetDetector/ProcessHop", [](State& state) {
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(), SampleRate);
+		const Take take = RecordTake(*timeline, Condition::NOISY);
+		audio::DecodedAudio input = { SampleRate, ChannelCount, take.samples };
+		const std::vector<float> mono = input.MixToMono();
+		audio::OnsetDetector detector(SampleRate);
+		const uint32_t hopSize = detector.GetHopSize();
+		const size_t hopCount = mono.size() / hopSize;
+		uint64_t onsetCount = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			detector.Reset();
+			for (size_t hop = 0; hop < hopCount; hop++) {
+				audio::DetectedOnset onset;
+				onsetCount += detector.ProcessHop(mono.data() + hop * hopSize, onset) ? 1 : 0;
+			}
+		}
+		const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - state.GetPausedSeconds();
+		const double realtimeFactor = (double)(hopCount * hopSize) / SampleRate * (double)state.iterations / max(elapsedSeconds, 1e-9);
+		state.SetItemsProcessed((double)(hopCount * hopSize));
+		state.counters["onsets"] = (double)onsetCount / (double)state.iterations;
+		state.counters["hop_us"] = 1.0e6 * elapsedSeconds / (double)(hopCount * state.iterations);
+		state.counters["realtime_factor"] = realtimeFactor;
+		state.counters["core_percent"] = 100.0 / realtimeFactor;
+	});
+
+	// Two seconds of the take fed in real time, a block per period as an input device would, while the calling
+	// thread polls for onsets every millisecond as a UI would every frame: how long after each hit was captured
+	// the UI had it, and how busy the worker was. Losing any onset fails the run.
+	registry.Add("LiveOnsetDetector/Latency", [](State& state) {
+		typedef std::chrono::steady_clock Clock;
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(), SampleRate);
+		const Take take = RecordTake(*timeline, Condition::NOISY);
+		const size_t frameCount = 2 * SampleRate;
+		audio::LiveOnsetDetector detector(SampleRate);
+		std::vector<double> latencies;
+		uint64_t droppedFrames = 0;
+		uint64_t lostOnsets = 0;
+		double busySeconds = 0.0;
+		double wallSeconds = 0.0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			std::atomic<bool> isDone(false);
+			detector.Start();
+			const Clock::time_point start = Clock::now();
+			std::thread input([&take, &detector, &isDone, start, frameCount]() {
+				const std::chrono::duration<double> period((double)InputBlockFrames / SampleRate);
+				for (size_t frame = 0; frame < frameCount; frame += InputBlockFrames) {
+					std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(period * (double)(frame / InputBlockFrames + 1)));
+					detector.WriteInput(take.samples.data() + frame * ChannelCount, InputBlockFrames, ChannelCount);
+				}
+				isDone.store(true, std::memory_order_release);
+			});
+			while (!isDone.load(std::memory_order_acquire)) {
+				audio::DetectedOnset onset;
+				while (detector.TryGetOnset(onset)) {
+					const double capturedSeconds = onset.sample / SampleRate;
+					latencies.push_back(std::chrono::duration<double>(Clock::now() - start).count() - capturedSeconds);
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			input.join();
+			wallSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+			detector.Stop();
+			busySeconds += detector.GetBusySeconds();
+			droppedFrames += detector.GetDroppedFrameCount();
+			lostOnsets += detector.GetLostOnsetCount();
+		}
+		state.counters["onsets"] = (double)latencies.size() / (double)state.iterations;
+		state.counters["latency_p50_ms"] = 1000.0 * Percentile(latencies, 50.0);
+		state.counters["latency_max_ms"] = 1000.0 * Percentile(latencies, 100.0);
+		state.counters["worker_core_percent"] = 100.0 * busySeconds / max(wallSeconds, 1e-9);
+		state.counters["dropped_frames"] = (double)droppedFrames;
+		state.counters["lost_onsets"] = (double)lostOnsets;
+		if (lostOnsets > 0) {
+			throw std::runtime_error(std::to_string(lostOnsets) + " onsets lost");
+		}
+	});
+}
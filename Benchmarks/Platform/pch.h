@@ -0,0 +1,51 @@
+#pragma once
+
+// Stand-in for the app's precompiled header, used when building the portable core outside of Windows.
+// Only the handful of Windows, DirectXMath and C++/WinRT types that the portable sources touch are declared.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stack>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <winrt/Windows.Foundation.h>
+
+typedef unsigned char byte;
+
+using std::min;
+using std::max;
+
+namespace DirectX
+{
+	struct XMFLOAT3
+	{
+		float x;
+		float y;
+		float z;
+
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct alignas(16) XMMATRIX
+	{
+		float m[4][4];
+	};
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdexcept>
+
+// Plain-data equivalents of the C++/WinRT Foundation types used by the portable core
+namespace winrt
+{
+	struct hresult_error : public std::runtime_error
+	{
+		hresult_error() : std::runtime_error("hresult_error") {}
+	};
+
+	namespace Windows::Foundation
+	{
+		struct Size
+		{
+			float Width;
+			float Height;
+		};
+
+		struct Rect
+		{
+			float X;
+			float Y;
+			float Width;
+			float Height;
+		};
+	}
+}
@@ -0,0 +1,279 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/SeqLock.h"
+#include "Audio/TripleBuffer.h"
+#include "Audio/Diagnostics/RealtimeGuard.h"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+	const uint32_t ChannelCount = 2;
+	const uint32_t BlockFrames = 64;
+	const uint64_t StoreCount = 200000;
+
+	// Every word holds the number of the store that wrote it, so a read mixing two stores shows up at once
+	struct Payload {
+		static const int WordCount = 16;
+		uint64_t words[WordCount];
+	};
+
+	struct StressResult {
+		uint64_t reads;
+		uint64_t distinctValues;
+		uint64_t tornReads;
+		uint64_t outOfOrderReads;
+		double readNanoseconds;
+	};
+
+	// Once the calling thread has started reading, a writer thread stores StoreCount payloads while the reader
+	// reads until it has seen the last. Each yields now and then, as the audio thread waits for its next period
+	// and the UI thread for its next frame, which also lets the two interleave on a single core.
+	template<typename TStore, typename TRead>
+	StressResult RunStress(TStore store, TRead read)
+	{
+		StressResult result = { 0, 0, 0, 0, 0.0 };
+		std::atomic<bool> isReading(false);
+		std::thread writer([&store, &isReading]() {
+			while (!isReading.load(std::memory_order_acquire)) {
+			}
+			Payload payload;
+			for (uint64_t i = 1; i <= StoreCount; i++) {
+				std::fill(payload.words, payload.words + Payload::WordCount, i);
+				store(payload);
+				if (i % 4 == 0) {
+					std::this_thread::yield();
+				}
+			}
+		});
+		uint64_t last = 0;
+		const auto start = std::chrono::steady_clock::now();
+		isReading.store(true, std::memory_order_release);
+		while (last < StoreCount) {
+			const Payload payload = read();
+			if (++result.reads % 16 == 0) {
+				std::this_thread::yield();
+			}
+			bool isTorn = false;
+			for (int i = 1; i < Payload::WordCount; i++) {
+				isTorn |= payload.words[i] != payload.words[0];
+			}
+			result.tornReads += isTorn ? 1 : 0;
+			if (payload.words[0] < last) {
+				result.outOfOrderReads++;
+			} else if (payload.words[0] > last) {
+				result.distinctValues++;
+				last = payload.words[0];
+			}
+		}
+		result.readNanoseconds = 1.0e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / (double)result.reads;
+		writer.join();
+		return result;
+	}
+
+	// Fails the run on any torn or out of order read, after reporting
+	void ReportStress(bench::State& state, const StressResult& total)
+	{
+		state.counters["reads"] = (double)total.reads / (double)state.iterations;
+		state.counters["distinct_values"] = (double)total.distinctValues / (double)state.iterations;
+		state.counters["torn_reads"] = (double)total.tornReads;
+		state.counters["out_of_order_reads"] = (double)total.outOfOrderReads;
+		state.counters["read_ns"] = total.readNanoseconds / (double)state.iterations;
+		if (total.tornReads > 0 || total.outOfOrderReads > 0) {
+			throw std::runtime_error("Reader saw " + std::to_string(total.tornReads) + " torn and " + std::to_string(total.outOfOrderReads) + " out of order reads");
+		}
+	}
+
+	void AddStress(StressResult& total, const StressResult& result)
+	{
+		total.reads += result.reads;
+		total.distinctValues += result.distinctValues;
+		total.tornReads += result.tornReads;
+		total.outOfOrderReads += result.outOfOrderReads;
+		total.readNanoseconds += result.readNanoseconds;
+	}
+
+	std::vector<float> MakeClick(float frequency, int lengthFrames)
+	{
+		std::vector<float> click(lengthFrames);
+		for (int i = 0; i < lengthFrames; i++) {
+			const float t = (float)i / (float)SampleRate;
+			click[i] = 0.5f * sinf(6.2831853f * frequency * t) * expf(-t * 60.0f);
+		}
+		return click;
+	}
+
+	// Sections in different metres, subdivisions and tempos, long enough that no run reaches the end
+	audio::Song MakeSong()
+	{
+		audio::Song song;
+		song.name = "Position check";
+		for (int i = 0; i < 6; i++) {
+			audio::SongSection section = { "Section", 2 + i, 4, 1 + i % 3, 16, 75.0 + 17.5 * i, {} };
+			for (int step = 0; step < section.GetStepsPerBar(); step++) {
+				section.pattern.push_back(step == 0 ? audio::PatternNote::ACCENT : audio::PatternNote::NORMAL);
+			}
+			song.sections.push_back(section);
+		}
+		return song;
+	}
+
+	struct PositionResult {
+		uint64_t reads;
+		uint64_t blocks;
+		uint64_t incoherentReads;
+		uint64_t backwardReads;
+		uint64_t violations;
+	};
+
+	// Renders blocks back to back on an audio thread while the calling thread reads the published position, as
+	// Scene::Update would but without waiting for frames. Each position read is checked against the block it
+	// claims to be from: playing from the start without seeking, its playhead is its stream frame, and its
+	// section, bar and beat follow from its playhead.
+	template<typename TCheck>
+	PositionResult RunPositionStress(audio::AudioEngine& engine, uint64_t blockCount, TCheck isCoherent)
+	{
+		PositionResult result = { 0, 0, 0, 0, 0 };
+		std::atomic<bool> isDone(false);
+		audio::ClearRealtimeViolations();
+		std::thread audioThread([&engine, &isDone, blockCount]() {
+			std::vector<float> output((size_t)BlockFrames * ChannelCount);
+			audio::RealtimeScope scope;
+			for (uint64_t block = 0; block < blockCount; block++) {
+				engine.Render(output.data(), BlockFrames);
+			}
+			isDone.store(true, std::memory_order_release);
+		});
+		audio::PlaybackPosition last = {};
+		bool isLastPass = false;
+		while (!isLastPass) {
+			isLastPass = isDone.load(std::memory_order_acquire);
+			const audio::PlaybackPosition& position = engine.ReadPlaybackPosition();
+			result.reads++;
+			if (position.streamFrame == 0) {
+				continue;
+			}
+			if (!position.isPlaying || position.playheadSample != position.streamFrame || !isCoherent(position)) {
+				result.incoherentReads++;
+			}
+			if (position.streamFrame < last.streamFrame || position.section < last.section ||
+				(position.section == last.section && (position.bar < last.bar || (position.bar == last.bar && position.beat < last.beat)))) {
+				result.backwardReads++;
+			}
+			last = position;
+		}
+		audioThread.join();
+		result.blocks = last.streamFrame / BlockFrames;
+		result.violations = audio::GetRealtimeViolationCount();
+		if (result.violations > 0) {
+			audio::LogRealtimeViolations();
+			audio::ClearRealtimeViolations();
+		}
+		return result;
+	}
+
+	// Fails the run on any incoherent or backward read, or real-time violation, after reporting
+	void ReportPositionStress(bench::State& state, const PositionResult& total)
+	{
+		state.counters["reads"] = (double)total.reads / (double)state.iterations;
+		state.counters["blocks_seen_to"] = (double)total.blocks / (double)state.iterations;
+		state.counters["incoherent_reads"] = (double)total.incoherentReads;
+		state.counters["backward_reads"] = (double)total.backwardReads;
+		state.counters["realtime_violations"] = (double)total.violations;
+		if (total.incoherentReads > 0 || total.backwardReads > 0 || total.violations > 0) {
+			throw std::runtime_error("Playback position had " + std::to_string(total.incoherentReads) + " incoherent and " + std::to_string(total.backwardReads)
+				+ " backward reads, and " + std::to_string(total.violations) + " real-time violations");
+		}
+	}
+}
+
+void bench::RegisterPlaybackStateBenchmarks(Registry& registry)
+{
+	// One writer publishing as fast as it can against one reader reading as fast as it can, which is far more
+	// contention than one block a few milliseconds against one frame a refresh; run under ThreadSanitizer with
+	// -DTHREAD_SANITIZER=ON to check the memory ordering as well
+	registry.Add("TripleBuffer/Stress", [](State& state) {
+		StressResult total = { 0, 0, 0, 0, 0.0 };
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::TripleBuffer<Payload> buffer;
+			AddStress(total, RunStress([&buffer](const Payload& payload) { buffer.Store(payload); }, [&buffer]() { return buffer.Read(); }));
+		}
+		ReportStress(state, total);
+	});
+
+	// The same against the SeqLock the PlaybackSnapshot is published through, whose reads can retry
+	registry.Add("SeqLock/Stress", [](State& state) {
+		StressResult total = { 0, 0, 0, 0, 0.0 };
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			std::unique_ptr<audio::SeqLock<Payload>> lock(new audio::SeqLock<Payload>());
+			AddStress(total, RunStress([&lock](const Payload& payload) { lock->Store(payload); }, [&lock]() { return lock->Load(); }));
+		}
+		ReportStress(state, total);
+	});
+
+	// The metronome at 120 BPM, where beats fall every 24000 samples
+	registry.Add("AudioEngine/PlaybackPosition/metronome", [](State& state) {
+		const std::vector<float> clicks[] = { MakeClick(2000.0f, 4800), MakeClick(1000.0f, 4800) };
+		PositionResult total = { 0, 0, 0, 0, 0 };
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::AudioEngine engine(SampleRate, ChannelCount);
+			engine.SetToneSet({ { clicks[0].data(), (uint32_t)clicks[0].size() }, { clicks[1].data(), (uint32_t)clicks[1].size() } });
+			engine.SetTempo(120.0);
+			engine.SetBeatsPerBar(3);
+			engine.Play();
+			const PositionResult result = RunPositionStress(engine, 20000, [](const audio::PlaybackPosition& position) {
+				const uint64_t beat = (position.playheadSample - 1) / 24000;
+				return !position.isSong && position.beatsPerBar == 3 && position.beatsPerMinute == 120.0 &&
+					position.bar == beat / 3 && position.beat == beat % 3;
+			});
+			total.reads += result.reads;
+			total.blocks += result.blocks;
+			total.incoherentReads += result.incoherentReads;
+			total.backwardReads += result.backwardReads;
+			total.violations += result.violations;
+		}
+		ReportPositionStress(state, total);
+	});
+
+	// A song through sections of different metres and tempos
+	registry.Add("AudioEngine/PlaybackPosition/song", [](State& state) {
+		const std::vector<float> clicks[] = { MakeClick(2000.0f, 4800), MakeClick(1000.0f, 4800) };
+		const audio::Song song = MakeSong();
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(song, SampleRate);
+		const std::vector<uint64_t>& starts = timeline->GetSectionStartSamples();
+		PositionResult total = { 0, 0, 0, 0, 0 };
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::AudioEngine engine(SampleRate, ChannelCount);
+			engine.SetToneSet({ { clicks[0].data(), (uint32_t)clicks[0].size() }, { clicks[1].data(), (uint32_t)clicks[1].size() } });
+			engine.SetSongTimeline(timeline.get());
+			engine.Play();
+			const uint64_t blockCount = timeline->GetLengthSamples() / BlockFrames;
+			const PositionResult result = RunPositionStress(engine, blockCount, [&song, &starts](const audio::PlaybackPosition& position) {
+				if (!position.isSong || position.section >= song.sections.size()) {
+					return false;
+				}
+				const audio::SongSection& section = song.sections[position.section];
+				const uint64_t offset = position.playheadSample - 1 - starts[position.section];
+				const uint64_t stepSamples = 60000ull * SampleRate;
+				const uint64_t stepTicks = (uint64_t)section.stepsPerBeat * (uint64_t)llround(section.beatsPerMinute * 1000.0);
+				auto stepStart = [stepSamples, stepTicks](uint64_t step) { return (step * stepSamples + stepTicks / 2) / stepTicks; };
+				uint64_t step = offset * stepTicks / stepSamples;
+				step += stepStart(step + 1) <= offset ? 1 : 0;
+				step -= step > 0 && stepStart(step) > offset ? 1 : 0;
+				return position.playheadSample > starts[position.section] && position.playheadSample <= starts[position.section + 1] &&
+					position.beatsPerBar == (uint32_t)section.beatsPerBar && position.beatsPerMinute == section.beatsPerMinute &&
+					position.bar == step / section.GetStepsPerBar() && position.beat == step % section.GetStepsPerBar() / section.stepsPerBeat;
+			});
+			total.reads += result.reads;
+			total.blocks += result.blocks;
+			total.incoherentReads += result.incoherentReads;
+			total.backwardReads += result.backwardReads;
+			total.violations += result.violations;
+		}
+		ReportPositionStress(state, total);
+	});
+}
@@ -0,0 +1,156 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/Diagnostics/RealtimeGuard.h"
+#include "Audio/Diagnostics/RenderMonitor.h"
+#include "Audio/Sinks/SimulatedDeviceSink.h"
+
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+	const uint32_t ChannelCount = 2;
+
+	std::vector<float> MakeClick(float frequency, int lengthFrames)
+	{
+		std::vector<float> click(lengthFrames);
+		for (int i = 0; i < lengthFrames; i++) {
+			const float t = (float)i / (float)SampleRate;
+			click[i] = 0.5f * sinf(6.2831853f * frequency * t) * expf(-t * 60.0f);
+		}
+		return click;
+	}
+
+	audio::Song MakeSong()
+	{
+		audio::Song song;
+		song.name = "Real-time check";
+		for (int i = 0; i < 4; i++) {
+			audio::SongSection section = { "Section", 3 + i, 4, 1 + i, 4, 90.0 + 30.0 * i, {} };
+			for (int step = 0; step < section.GetStepsPerBar(); step++) {
+				section.pattern.push_back(step == 0 ? audio::PatternNote::ACCENT : step % section.stepsPerBeat == 0 ? audio::PatternNote::NORMAL : audio::PatternNote::GHOST);
+			}
+			song.sections.push_back(section);
+		}
+		return song;
+	}
+
+	// Sends the engine one of every kind of command, chosen at random every couple of milliseconds, takes any
+	// stop timer events it sends back, and updates the bar cache as a UI frame would
+	void SendCommands(audio::AudioEngine& engine, const std::vector<audio::ToneSetView>& toneSets, const audio::SongTimeline& timeline, double seconds)
+	{
+		std::mt19937 random(11);
+		const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+		while (std::chrono::steady_clock::now() < end) {
+			audio::StopTimerEvent event;
+			while (engine.TryGetStopTimerEvent(event)) {
+			}
+			engine.UpdateBarCache();
+			switch (random() % 11) {
+			case 0: engine.SetTempo(60.0 + (double)(random() % 180)); break;
+			case 1: engine.SetBeatsPerBar(2 + (int)(random() % 6)); break;
+			case 2: engine.SetTempoRamp(audio::TempoRamp::Linear(80.0, 80.0 + (double)(random() % 100), 16.0)); break;
+			case 3: engine.SetToneSet(toneSets[random() % toneSets.size()]); break;
+			case 4: engine.SetSongTimeline(random() % 2 == 0 ? &timeline : nullptr); break;
+			case 5: engine.Seek(random() % timeline.GetLengthSamples()); break;
+			case 6: engine.Pause(); break;
+			case 7: engine.SetStopTimer((double)(random() % 2000) / 1000.0, random() % 2 == 0); break;
+			case 8: engine.CancelStopTimer(); break;
+			case 9: engine.SetVolume((double)(random() % 100) / 100.0); break;
+			default: engine.Play(); break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+}
+
+void bench::RegisterRealtimeBenchmarks(Registry& registry)
+{
+	// Checks the hooks catch what they should, and what catching it costs: each iteration allocates, locks and
+	// yields once on a real-time thread
+	registry.Add("RealtimeGuard/SelfTest", [](State& state) {
+		std::mutex mutex;
+		uint64_t allocations = 0;
+		uint64_t locks = 0;
+		uint64_t systemCalls = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::RealtimeScope scope;
+			uint64_t before = audio::GetRealtimeViolationCount();
+			std::unique_ptr<int> value(new int((int)i));
+			allocations += audio::GetRealtimeViolationCount() - before;
+			DoNotOptimise(value);
+			before = audio::GetRealtimeViolationCount();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+			}
+			locks += audio::GetRealtimeViolationCount() - before;
+			before = audio::GetRealtimeViolationCount();
+			std::this_thread::yield();
+			systemCalls += audio::GetRealtimeViolationCount() - before;
+		}
+		audio::ClearRealtimeViolations();
+		state.counters["checks_enabled"] = audio::AreRealtimeChecksEnabled() ? 1.0 : 0.0;
+		state.counters["caught_allocations"] = (double)allocations / (double)state.iterations;
+		state.counters["caught_locks"] = (double)locks / (double)state.iterations;
+		state.counters["caught_system_calls"] = (double)systemCalls / (double)state.iterations;
+	});
+
+	// Runs the engine on a simulated device thread for half a second per iteration while the UI thread sends it
+	// commands, with allocations, locks and system calls on the audio thread logged and counted. Any of those,
+	// or any xrun, fails the run.
+	for (uint32_t blockFrames : { 32u, 64u, 128u, 256u, 512u, 1024u }) {
+		registry.Add("RealtimeSafety/Engine/block:" + std::to_string(blockFrames), [blockFrames](State& state) {
+			const std::vector<float> clicks[] = { MakeClick(2000.0f, 4800), MakeClick(1000.0f, 4800), MakeClick(1500.0f, 9600) };
+			const std::vector<audio::ToneSetView> toneSets = {
+				{ { clicks[0].data(), (uint32_t)clicks[0].size() }, { clicks[1].data(), (uint32_t)clicks[1].size() } },
+				{ { clicks[2].data(), (uint32_t)clicks[2].size() }, { clicks[0].data(), (uint32_t)clicks[0].size() } }
+			};
+			const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(), SampleRate);
+
+			audio::ClearRealtimeViolations();
+			uint64_t callbacks = 0;
+			uint64_t xruns = 0;
+			uint64_t lateBlocks = 0;
+			double p50 = 0.0;
+			double p99 = 0.0;
+			double maxRenderSeconds = 0.0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				audio::AudioEngine engine(SampleRate, ChannelCount);
+				engine.SetToneSet(toneSets[0]);
+				engine.Play();
+				audio::RenderMonitor monitor(&engine, SampleRate);
+				audio::SimulatedDeviceSink sink(SampleRate, ChannelCount, blockFrames);
+				sink.Start(&monitor);
+				SendCommands(engine, toneSets, *timeline, 0.5);
+				sink.Stop();
+
+				callbacks += monitor.GetCallbackCount();
+				xruns += monitor.GetXrunCount();
+				lateBlocks += sink.GetLateBlockCount();
+				p50 = max(p50, monitor.GetLoadHistogram().GetPercentile(50.0));
+				p99 = max(p99, monitor.GetLoadHistogram().GetPercentile(99.0));
+				maxRenderSeconds = max(maxRenderSeconds, monitor.GetMaxRenderSeconds());
+			}
+			const uint64_t violations = audio::GetRealtimeViolationCount();
+			if (violations > 0) {
+				audio::LogRealtimeViolations();
+				audio::ClearRealtimeViolations();
+			}
+			if (violations > 0 || xruns > 0) {
+				throw std::runtime_error("Audio thread had " + std::to_string(violations) + " real-time violations and " + std::to_string(xruns) + " xruns");
+			}
+			state.counters["callbacks"] = (double)callbacks / (double)state.iterations;
+			state.counters["realtime_violations"] = (double)violations;
+			state.counters["xruns"] = (double)xruns;
+			state.counters["late_blocks"] = (double)lateBlocks;
+			state.counters["load_p50_percent"] = p50;
+			state.counters["load_p99_percent"] = p99;
+			state.counters["max_render_us"] = 1.0e6 * maxRenderSeconds;
+		});
+	}
+}
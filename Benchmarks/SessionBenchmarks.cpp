@@ -0,0 +1,287 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/Session/DelayedSyncTransport.h"
+#include "Audio/Session/SessionSync.h"
+#include "Audio/Session/UdpSyncTransport.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+	const uint32_t ChannelCount = 2;
+
+	// A congested LAN: each datagram arrives 2 to 7 ms after it was sent, in any order, and one in fifty never does
+	const double LatencySeconds = 0.002;
+	const double JitterSeconds = 0.005;
+	const double LossFraction = 0.02;
+
+	// Longer than any step should take, and how often the peers are looked at meanwhile
+	const double TimeoutSeconds = 3.0;
+	const double PollSeconds = 0.005;
+
+	// Peers in step have every beat within this of each other
+	const double AgreedSpreadSeconds = 0.002;
+
+	// A host clock running a fixed offset ahead of the machine's, standing in for another device's
+	class OffsetClock {
+	public:
+		explicit OffsetClock(double offsetSeconds) : m_clock(), m_offsetCounts(0) {
+			m_offsetCounts = (uint64_t)(offsetSeconds * m_clock.GetFrequency());
+		}
+
+		uint64_t GetFrequency() const { return m_clock.GetFrequency(); }
+		uint64_t GetCounter() const { return m_clock.GetCounter() + m_offsetCounts; }
+		uint64_t GetCounterAt(uint64_t machineCounter) const { return machineCounter + m_offsetCounts; }
+
+	private:
+		DX::DefaultClock m_clock;
+		uint64_t m_offsetCounts;
+	};
+
+	// One device in the session, on a loopback port of its own behind a simulated network
+	struct Peer {
+		OffsetClock clock;
+		audio::UdpSyncTransport socket;
+		audio::DelayedSyncTransport network;
+		audio::SessionSync session;
+
+		Peer(uint64_t id, double offsetSeconds, double beatsPerMinute, uint32_t seed) :
+			clock(offsetSeconds),
+			socket(audio::SyncEndpoint::Loopback(0).address, 0),
+			network(socket, LatencySeconds, JitterSeconds, LossFraction, seed),
+			session(network, id, beatsPerMinute)
+		{
+			session.SetHostClock(&clock);
+		}
+	};
+
+	// Every peer sends to every other, as they would through the multicast group
+	void Connect(std::vector<std::unique_ptr<Peer>>& peers, Peer& peer)
+	{
+		for (const std::unique_ptr<Peer>& other : peers) {
+			if (other.get() != &peer) {
+				other->socket.AddDestination(audio::SyncEndpoint::Loopback(peer.socket.GetPort()));
+				peer.socket.AddDestination(audio::SyncEndpoint::Loopback(other->socket.GetPort()));
+			}
+		}
+	}
+
+	// How far apart the peers' beats are at one instant, in seconds at the first peer's tempo
+	double GetPhaseSpread(const std::vector<std::unique_ptr<Peer>>& peers)
+	{
+		const uint64_t now = DX::DefaultClock().GetCounter();
+		double lowest = INFINITY;
+		double highest = -INFINITY;
+		double beatsPerMinute = 0.0;
+		for (const std::unique_ptr<Peer>& peer : peers) {
+			const audio::SessionState state = peer->session.GetState();
+			const double micros = (double)audio::CountsToMicros(peer->clock.GetCounterAt(now), state.frequency);
+			const double beat = state.timeline.GetBeatAt(micros);
+			lowest = min(lowest, beat);
+			highest = max(highest, beat);
+			if (beatsPerMinute == 0.0) {
+				beatsPerMinute = state.timeline.GetTempoAt(beat);
+			}
+		}
+		return (highest - lowest) * 60.0 / beatsPerMinute;
+	}
+
+	// Whether every peer hears all the others and plays the same version of the timeline, at least the given one,
+	// in step
+	bool IsAgreed(const std::vector<std::unique_ptr<Peer>>& peers, uint64_t minVersion)
+	{
+		const audio::SessionState first = peers[0]->session.GetState();
+		for (const std::unique_ptr<Peer>& peer : peers) {
+			const audio::SessionState state = peer->session.GetState();
+			if (state.peerCount != peers.size() - 1 || state.timeline.version < minVersion || state.timeline.version != first.timeline.version ||
+				state.timeline.originatorId != first.timeline.originatorId || state.timeline.changeBeat != first.timeline.changeBeat) {
+				return false;
+			}
+		}
+		return GetPhaseSpread(peers) < AgreedSpreadSeconds;
+	}
+
+	// Seconds until the peers agree, or a negative time if they never do
+	double WaitForAgreement(const std::vector<std::unique_ptr<Peer>>& peers, uint64_t minVersion)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		while (!IsAgreed(peers, minVersion)) {
+			const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (elapsed > TimeoutSeconds) {
+				return -1.0;
+			}
+			std::this_thread::sleep_for(std::chrono::duration<double>(PollSeconds));
+		}
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void SamplePhaseSpread(const std::vector<std::unique_ptr<Peer>>& peers, double seconds, std::vector<double>& spreads)
+	{
+		for (double elapsed = 0.0; elapsed < seconds; elapsed += PollSeconds) {
+			spreads.push_back(GetPhaseSpread(peers));
+			std::this_thread::sleep_for(std::chrono::duration<double>(PollSeconds));
+		}
+	}
+
+	double Percentile(std::vector<double> values, double percentile)
+	{
+		if (values.empty()) {
+			return 0.0;
+		}
+		const size_t rank = min(values.size() - 1, (size_t)(percentile / 100.0 * (double)values.size()));
+		std::nth_element(values.begin(), values.begin() + rank, values.end());
+		return values[rank];
+	}
+
+	// Counts from frames rendered, so that every block is heard exactly when its frames say
+	class SteppedClock {
+	public:
+		SteppedClock() : m_counter(SampleRate) {}
+
+		uint64_t GetFrequency() const { return SampleRate; }
+		uint64_t GetCounter() const { return m_counter.load(std::memory_order_acquire); }
+		void Advance(uint64_t frames) { m_counter.fetch_add(frames, std::memory_order_release); }
+
+	private:
+		std::atomic<uint64_t> m_counter;
+	};
+}
+
+void bench::RegisterSessionBenchmarks(Registry& registry)
+{
+	// Four peers with clocks up to half a minute apart, each starting a session at its own tempo, over a network
+	// with latency, jitter and loss. Per iteration: how long they take to agree on one session, how far apart
+	// their beats then are, how long a tempo change takes to reach them all, and a fifth peer joining without
+	// moving the others. A peer that never agrees, or a session that changes hands on the join, is wrong, and
+	// fails the run.
+	registry.Add("Session/Sync/peers:4", [](State& state) {
+		std::vector<double> convergeSeconds;
+		std::vector<double> changeSeconds;
+		std::vector<double> joinSeconds;
+		std::vector<double> spreads;
+		uint64_t wrong = 0;
+		uint64_t injectedLosses = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			const uint64_t ids[] = { 40, 10, 30, 20 };
+			const double offsets[] = { 0.0, 0.25, 7.5, 31.0 };
+			const double tempos[] = { 120.0, 100.0, 90.0, 140.0 };
+			std::vector<std::unique_ptr<Peer>> peers;
+			for (size_t p = 0; p < 4; p++) {
+				peers.push_back(std::make_unique<Peer>(ids[p], offsets[p], tempos[p], (uint32_t)(100 * i + p)));
+				Connect(peers, *peers.back());
+			}
+			for (const std::unique_ptr<Peer>& peer : peers) {
+				peer->session.Start();
+			}
+			const double converged = WaitForAgreement(peers, 1);
+			convergeSeconds.push_back(converged);
+			wrong += converged < 0.0 ? 1 : 0;
+			SamplePhaseSpread(peers, 0.25, spreads);
+
+			// A change lands on the same beat everywhere, and the beats stay together across it
+			const uint64_t changeVersion = peers[2]->session.GetState().timeline.version + 1;
+			peers[2]->session.SetTempo(150.0);
+			const double changed = WaitForAgreement(peers, changeVersion);
+			changeSeconds.push_back(changed);
+			const audio::SessionState afterChange = peers[0]->session.GetState();
+			wrong += changed < 0.0 || afterChange.timeline.GetTempoAt(afterChange.timeline.changeBeat) != 150.0 ? 1 : 0;
+			SamplePhaseSpread(peers, 1.0, spreads);
+
+			// The newcomer's id is lowest, but the shared session is older than its own
+			const audio::SessionTimeline before = peers[0]->session.GetState().timeline;
+			peers.push_back(std::make_unique<Peer>(5, 3.0, 60.0, (uint32_t)(100 * i + 4)));
+			Connect(peers, *peers.back());
+			peers.back()->session.Start();
+			const double joined = WaitForAgreement(peers, before.version);
+			joinSeconds.push_back(joined);
+			const audio::SessionTimeline after = peers[0]->session.GetState().timeline;
+			wrong += joined < 0.0 || after.version != before.version || after.originatorId != before.originatorId ? 1 : 0;
+			SamplePhaseSpread(peers, 0.25, spreads);
+
+			for (const std::unique_ptr<Peer>& peer : peers) {
+				peer->session.Stop();
+				injectedLosses += peer->network.GetLostDatagramCount();
+			}
+		}
+		if (wrong > 0) {
+			throw std::runtime_error(std::to_string(wrong) + " session checks failed: peers did not agree, or the session changed hands");
+		}
+		state.counters["converge_ms"] = 1.0e3 * Percentile(convergeSeconds, 100.0);
+		state.counters["tempo_change_ms"] = 1.0e3 * Percentile(changeSeconds, 100.0);
+		state.counters["join_ms"] = 1.0e3 * Percentile(joinSeconds, 100.0);
+		state.counters["phase_spread_p50_us"] = 1.0e6 * Percentile(spreads, 50.0);
+		state.counters["phase_spread_p95_us"] = 1.0e6 * Percentile(spreads, 95.0);
+		state.counters["phase_spread_max_us"] = 1.0e6 * Percentile(spreads, 100.0);
+		state.counters["injected_losses"] = (double)injectedLosses;
+		state.counters["wrong"] = (double)wrong;
+	});
+
+	// An engine following a session on its own through two tempo changes, rendered block by block against a
+	// clock stepped with the frames: every click must be heard on a whole session beat, to within a sample
+	// either way for rounding, accented on the bar, and no beat may be skipped or played twice; any click that
+	// is not fails the run
+	registry.Add("Session/Engine/block:256", [](State& state) {
+		const uint32_t blockFrames = 256;
+		const double toleranceSeconds = 2.0 / SampleRate;
+		uint64_t beats = 0;
+		uint64_t mismatches = 0;
+		uint64_t wrong = 0;
+		double maxErrorSeconds = 0.0;
+		std::vector<float> output((size_t)blockFrames * ChannelCount);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			SteppedClock clock;
+			audio::UdpSyncTransport socket(audio::SyncEndpoint::Loopback(0).address, 0);
+			audio::SessionSync session(socket, 1, 120.0);
+			session.SetHostClock(&clock);
+			session.Start();
+			audio::AudioEngine engine(SampleRate, ChannelCount);
+			engine.SetHostClock(&clock);
+			engine.SetSession(&session, 0, 0.0);
+			engine.SetBeatsPerBar(3);
+			engine.Play();
+
+			uint64_t checkedOnsets = 0;
+			uint64_t previousBeat = 0;
+			const uint64_t blockCount = 20 * SampleRate / blockFrames;
+			for (uint64_t block = 0; block < blockCount; block++) {
+				if (block == blockCount / 4 || block == 3 * blockCount / 5) {
+					session.SetTempo(block == blockCount / 4 ? 150.0 : 97.3);
+					std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				}
+				const audio::SessionState sessionState = session.GetState();
+				engine.Render(output.data(), blockFrames);
+				clock.Advance(blockFrames);
+				const audio::PlaybackSnapshot snapshot = engine.GetPlaybackSnapshot();
+				for (; checkedOnsets < snapshot.onsetCount; checkedOnsets++) {
+					const audio::OnsetRecord& onset = snapshot.GetOnset(checkedOnsets);
+					const double micros = (double)audio::CountsToMicros(SampleRate + onset.sample, SampleRate);
+					const double beat = sessionState.timeline.GetBeatAt(micros);
+					const double nearestBeat = round(beat);
+					const double errorSeconds = fabs(beat - nearestBeat) * 60.0 / sessionState.timeline.GetTempoAt(beat);
+					maxErrorSeconds = max(maxErrorSeconds, errorSeconds);
+					mismatches += errorSeconds > toleranceSeconds ? 1 : 0;
+					const uint64_t beatIndex = (uint64_t)max(0.0, nearestBeat);
+					const bool isAccent = beatIndex % 3 == 0;
+					wrong += (checkedOnsets > 0 && beatIndex != previousBeat + 1) || isAccent != (onset.voice == audio::ToneVoice::ACCENT) ? 1 : 0;
+					previousBeat = beatIndex;
+				}
+			}
+			session.Stop();
+			beats += checkedOnsets;
+		}
+		if (mismatches > 0 || wrong > 0) {
+			throw std::runtime_error("Engine following the session played " + std::to_string(mismatches) + " clicks off the session's beats and "
+				+ std::to_string(wrong) + " skipped, repeated or wrongly accented beats");
+		}
+		state.SetItemsProcessed((double)(20 * SampleRate));
+		state.counters["beats"] = (double)beats / (double)state.iterations;
+		state.counters["max_error_us"] = 1.0e6 * maxErrorSeconds;
+		state.counters["mismatches"] = (double)mismatches;
+		state.counters["wrong"] = (double)wrong;
+	});
+}
@@ -0,0 +1,579 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/Export/FlacFileWriter.h"
+#include "Audio/Export/SongExporter.h"
+#include "Audio/Export/WavFileWriter.h"
+#include "Audio/Sinks/NullSink.h"
+#include "Audio/Songs/SongJson.h"
+#include "Audio/Songs/SongLibrary.h"
+#include "Audio/Songs/SongTimeline.h"
+#include "Audio/ToneSets/AudioDecoder.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+
+	// Sections of 8 to 32 bars in assorted time signatures, subdivisions and tempos, accenting the first beat of
+	// each bar and ghosting some of the subdivisions
+	audio::Song MakeSong(int sectionCount, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		audio::Song song;
+		song.name = "Benchmark song";
+		for (int i = 0; i < sectionCount; i++) {
+			audio::SongSection section;
+			section.name = "Section " + std::to_string(i + 1);
+			section.beatsPerBar = 2 + (int)(random() % 6);
+			section.beatUnit = random() % 3 == 0 ? 8 : 4;
+			section.stepsPerBeat = 1 + (int)(random() % 4);
+			section.barCount = 8 + (int)(random() % 25);
+			section.beatsPerMinute = 60.0 + (double)(random() % 1400) / 10.0;
+			for (int step = 0; step < section.GetStepsPerBar(); step++) {
+				if (step == 0) {
+					section.pattern.push_back(audio::PatternNote::ACCENT);
+				} else if (step % section.stepsPerBeat == 0) {
+					section.pattern.push_back(audio::PatternNote::NORMAL);
+				} else {
+					section.pattern.push_back(random() % 3 == 0 ? audio::PatternNote::REST : audio::PatternNote::GHOST);
+				}
+			}
+			song.sections.push_back(section);
+		}
+		return song;
+	}
+
+	bool IsSameTimeline(const audio::SongTimeline& a, const audio::SongTimeline& b)
+	{
+		return a.GetSectionStartSamples() == b.GetSectionStartSamples() && a.GetSectionFirstEvents() == b.GetSectionFirstEvents() &&
+			a.GetEventOffsets() == b.GetEventOffsets() && a.GetEventVoices() == b.GetEventVoices() && a.GetEventAccents() == b.GetEventAccents();
+	}
+
+	bool IsSameSong(const audio::Song& a, const audio::Song& b)
+	{
+		if (a.name != b.name || a.sections.size() != b.sections.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < a.sections.size(); i++) {
+			const audio::SongSection& x = a.sections[i];
+			const audio::SongSection& y = b.sections[i];
+			if (x.name != y.name || x.beatsPerBar != y.beatsPerBar || x.beatUnit != y.beatUnit || x.stepsPerBeat != y.stepsPerBeat ||
+				x.barCount != y.barCount || x.beatsPerMinute != y.beatsPerMinute || x.pattern != y.pattern) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// A folder of 1000 songs of 4 to 40 sections, each saved as a song file and as JSON. Written on first use
+	// and deleted when the benchmarks exit.
+	class SongLibraryFolder {
+	public:
+		static const int SongCount = 1000;
+
+		static const SongLibraryFolder& Get() {
+			static const SongLibraryFolder folder;
+			return folder;
+		}
+
+		std::string path;
+		std::vector<std::string> jsonPaths;
+		uint64_t binaryBytes;
+		uint64_t jsonBytes;
+
+	private:
+		SongLibraryFolder() : path("song_library_benchmark"), jsonPaths(), binaryBytes(0), jsonBytes(0) {
+			std::filesystem::remove_all(path);
+			std::filesystem::create_directory(path);
+			audio::SongLibrary library(path);
+			std::mt19937 random(5);
+			for (int i = 0; i < SongCount; i++) {
+				audio::Song song = MakeSong(4 + (int)(random() % 37), (uint32_t)i);
+				song.name = "Song " + std::to_string(i);
+				const std::string fileName = "song" + std::to_string(i);
+				library.SaveSong(song, fileName);
+				binaryBytes += std::filesystem::file_size(path + "/" + fileName + audio::SongLibrary::FileExtension);
+
+				const std::string json = audio::ExportSongJson(song);
+				jsonPaths.push_back(path + "/" + fileName + ".json");
+				std::ofstream(jsonPaths.back(), std::ios::binary) << json;
+				jsonBytes += json.size();
+			}
+		}
+
+		~SongLibraryFolder() {
+			std::error_code error;
+			std::filesystem::remove_all(path, error);
+		}
+	};
+
+	// Sample position of every event in the timeline
+	std::vector<uint64_t> EventSamples(const audio::SongTimeline& timeline)
+	{
+		std::vector<uint64_t> samples;
+		for (size_t section = 0; section < timeline.GetSectionCount(); section++) {
+			for (uint32_t event = timeline.GetSectionFirstEvents()[section]; event < timeline.GetSectionFirstEvents()[section + 1]; event++) {
+				samples.push_back(timeline.GetSectionStartSamples()[section] + timeline.GetEventOffsets()[event]);
+			}
+		}
+		return samples;
+	}
+
+	// Decaying sine clicks, long enough that fast subdivisions overlap three or four deep
+	struct ExportClicks {
+		std::vector<float> accent;
+		std::vector<float> normal;
+
+		ExportClicks() : accent(9600), normal(7200) {
+			for (size_t i = 0; i < accent.size(); i++) {
+				accent[i] = 0.6f * sinf(6.2831853f * 2000.0f * (float)i / SampleRate) * expf(-25.0f * (float)i / SampleRate);
+			}
+			for (size_t i = 0; i < normal.size(); i++) {
+				normal[i] = 0.4f * sinf(6.2831853f * 1100.0f * (float)i / SampleRate) * expf(-30.0f * (float)i / SampleRate);
+			}
+		}
+
+		audio::ToneSetView View() const {
+			return { { accent.data(), (uint32_t)accent.size() }, { normal.data(), (uint32_t)normal.size() } };
+		}
+	};
+
+	class MemoryWriter : public audio::AudioWriter {
+	public:
+		std::vector<float> samples;
+		uint32_t channelCount;
+
+		explicit MemoryWriter(uint32_t channels) : samples(), channelCount(channels) {}
+
+		virtual void Write(const float* block, uint64_t frameCount) override {
+			samples.insert(samples.end(), block, block + frameCount * channelCount);
+		}
+	};
+
+	// The song played through from the start on one engine, as the audio device would hear it
+	std::vector<float> RenderRealtime(const audio::SongTimeline& timeline, const audio::ToneSetView& toneSet, uint32_t channelCount, uint32_t blockFrames, uint64_t frameCount)
+	{
+		audio::AudioEngine engine(SampleRate, channelCount);
+		engine.SetToneSet(toneSet);
+		engine.SetSongTimeline(&timeline);
+		engine.Play();
+		std::vector<float> output((size_t)frameCount * channelCount);
+		for (uint64_t frame = 0; frame < frameCount; frame += blockFrames) {
+			engine.Render(output.data() + (size_t)frame * channelCount, (uint32_t)min((uint64_t)blockFrames, frameCount - frame));
+		}
+		return output;
+	}
+
+	// Six four-hour sections of triplets, quintuplets, sevens, sixes, nines and elevens to the beat, at tempos
+	// with no whole number of samples per step, every step sounding
+	const int TupletSectionCount = 6;
+	const int Tuplets[TupletSectionCount] = { 3, 5, 7, 6, 9, 11 };
+	const uint64_t TupletMilliBeatsPerMinute[TupletSectionCount] = { 97301, 133333, 61703, 173417, 120001, 88888 };
+
+	audio::Song MakeTupletSong()
+	{
+		audio::Song song;
+		song.name = "Tuplets";
+		for (int i = 0; i < TupletSectionCount; i++) {
+			audio::SongSection section;
+			section.name = "Section " + std::to_string(i + 1);
+			section.beatsPerBar = 3 + i % 5;
+			section.beatUnit = 4;
+			section.stepsPerBeat = Tuplets[i];
+			section.beatsPerMinute = (double)TupletMilliBeatsPerMinute[i] / 1000.0;
+			section.barCount = (int)(4 * 60 * section.beatsPerMinute / section.beatsPerBar);
+			for (int step = 0; step < section.GetStepsPerBar(); step++) {
+				section.pattern.push_back(step == 0 ? audio::PatternNote::ACCENT : step % section.stepsPerBeat == 0 ? audio::PatternNote::NORMAL : audio::PatternNote::GHOST);
+			}
+			song.sections.push_back(section);
+		}
+		return song;
+	}
+
+	// Exact position of a step in a tuplet section, in 128-bit integers: 60 * sampleRate * step over the steps
+	// per minute, rounded to the nearest sample with halves up
+	uint64_t ExactStepSample(int section, uint64_t step)
+	{
+		const unsigned __int128 numerator = (unsigned __int128)step * 60000 * SampleRate;
+		const unsigned __int128 denominator = (unsigned __int128)TupletMilliBeatsPerMinute[section] * Tuplets[section];
+		return (uint64_t)((2 * numerator + denominator) / (2 * denominator));
+	}
+
+	uint64_t CountMismatches(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		if (a.size() != b.size()) {
+			return max(a.size(), b.size());
+		}
+		uint64_t mismatches = 0;
+		for (size_t i = 0; i < a.size(); i++) {
+			mismatches += memcmp(&a[i], &b[i], sizeof(float)) != 0 ? 1 : 0;
+		}
+		return mismatches;
+	}
+}
+
+void bench::RegisterSongBenchmarks(Registry& registry)
+{
+	for (int sectionCount : { 10, 100, 1000 }) {
+		const std::string suffix = "/sections:" + std::to_string(sectionCount);
+
+		registry.Add("SongTimeline/Compile" + suffix, [sectionCount](State& state) {
+			const audio::Song song = MakeSong(sectionCount, 1);
+			size_t eventCount = 0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(song, SampleRate);
+				eventCount = timeline->GetEventCount();
+				DoNotOptimise(timeline);
+			}
+			state.SetItemsProcessed((double)eventCount);
+		});
+
+		// Changes the tempo and pattern of the middle section and recompiles only that, checking once that the
+		// result is the same as compiling the whole edited song
+		registry.Add("SongTimeline/RecompileSection" + suffix, [sectionCount](State& state) {
+			audio::Song song = MakeSong(sectionCount, 1);
+			std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(song, SampleRate);
+			audio::SongSection& edited = song.sections[sectionCount / 2];
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				edited.beatsPerMinute = i % 2 == 0 ? 97.0 : 143.0;
+				edited.pattern.back() = i % 2 == 0 ? audio::PatternNote::REST : audio::PatternNote::GHOST;
+				timeline->RecompileSection(song, sectionCount / 2);
+			}
+			if (!IsSameTimeline(*timeline, *audio::SongTimeline::Compile(song, SampleRate))) {
+				throw std::runtime_error("Recompiled section differs from a full compile");
+			}
+			state.SetItemsProcessed(1.0);
+		});
+
+		// Jumps to random positions, as fast-forward and rewind do
+		registry.Add("SongTimeline/Seek" + suffix, [sectionCount](State& state) {
+			const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(sectionCount, 1), SampleRate);
+			std::mt19937_64 random(2);
+			std::vector<uint64_t> targets(1024);
+			for (uint64_t& target : targets) {
+				target = random() % timeline->GetLengthSamples();
+			}
+			audio::SongCursor cursor;
+			uint64_t total = 0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				for (uint64_t target : targets) {
+					cursor.Seek(timeline.get(), target);
+					total += cursor.GetNextEventSample();
+				}
+			}
+			DoNotOptimise(total);
+			state.SetItemsProcessed((double)targets.size());
+		});
+	}
+
+	// Song file and JSON round trips, checked against the original song
+	registry.Add("SongFile/EncodeDecode/sections:100", [](State& state) {
+		const audio::Song song = MakeSong(100, 6);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			const std::vector<byte> file = audio::EncodeSongFile(song);
+			audio::SongFileView view;
+			if (!view.Open(file.data(), file.size()) || !IsSameSong(view.ToSong(), song)) {
+				throw std::runtime_error("Song file round trip changed the song");
+			}
+		}
+		state.counters["file_bytes"] = (double)audio::EncodeSongFile(song).size();
+		state.SetItemsProcessed(1.0);
+	});
+
+	registry.Add("SongJson/ExportImport/sections:100", [](State& state) {
+		const audio::Song song = MakeSong(100, 6);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			if (!IsSameSong(audio::ImportSongJson(audio::ExportSongJson(song)), song)) {
+				throw std::runtime_error("Song JSON round trip changed the song");
+			}
+		}
+		state.counters["json_bytes"] = (double)audio::ExportSongJson(song).size();
+		state.SetItemsProcessed(1.0);
+	});
+
+	// Listing a library reads only the header of each song file
+	registry.Add("SongLibrary/Scan/songs:1000", [](State& state) {
+		state.PauseTiming();
+		const SongLibraryFolder& folder = SongLibraryFolder::Get();
+		state.ResumeTiming();
+		size_t songCount = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::SongLibrary library(folder.path);
+			library.Scan();
+			songCount = library.GetSongs().size();
+		}
+		if (songCount != SongLibraryFolder::SongCount) {
+			throw std::runtime_error("Song library scan found " + std::to_string(songCount) + " songs");
+		}
+		state.SetItemsProcessed((double)songCount);
+	});
+
+	// Opening every song in full, from song files and from JSON, for comparison
+	registry.Add("SongLibrary/LoadAll/songs:1000/song_file", [](State& state) {
+		state.PauseTiming();
+		const SongLibraryFolder& folder = SongLibraryFolder::Get();
+		audio::SongLibrary library(folder.path);
+		library.Scan();
+		state.ResumeTiming();
+		size_t sectionCount = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			for (size_t song = 0; song < library.GetSongs().size(); song++) {
+				sectionCount += library.LoadSong(song).sections.size();
+			}
+		}
+		DoNotOptimise(sectionCount);
+		state.counters["bytes_per_song"] = (double)folder.binaryBytes / SongLibraryFolder::SongCount;
+		state.SetItemsProcessed((double)SongLibraryFolder::SongCount);
+	});
+
+	registry.Add("SongLibrary/LoadAll/songs:1000/json", [](State& state) {
+		state.PauseTiming();
+		const SongLibraryFolder& folder = SongLibraryFolder::Get();
+		state.ResumeTiming();
+		size_t sectionCount = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			for (const std::string& jsonPath : folder.jsonPaths) {
+				std::ifstream file(jsonPath, std::ios::binary);
+				const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+				sectionCount += audio::ImportSongJson(json).sections.size();
+			}
+		}
+		DoNotOptimise(sectionCount);
+		state.counters["bytes_per_song"] = (double)folder.jsonBytes / SongLibraryFolder::SongCount;
+		state.SetItemsProcessed((double)SongLibraryFolder::SongCount);
+	});
+
+	// Plays a song of single-sample clicks through the engine, jumping forward 10 seconds and back 7 every
+	// 3 seconds, and checks every onset lands on a timeline event at or after the last seek. Fails the run on
+	// any onset that does not.
+	registry.Add("AudioEngine/Song/seek_while_playing", [](State& state) {
+		const uint32_t blockFrames = 256;
+		const float impulse[] = { 1.0f };
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(100, 3), SampleRate);
+		const std::vector<uint64_t> eventSamples = EventSamples(*timeline);
+		uint64_t onsetCount = 0;
+		uint64_t mismatchCount = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::AudioEngine engine(SampleRate, 1);
+			engine.SetToneSet({ { impulse, 1 }, { impulse, 1 } });
+			engine.SetSongTimeline(timeline.get());
+			engine.Play();
+			audio::NullSink sink(SampleRate, 1, blockFrames);
+			sink.Start(&engine);
+			uint64_t block = 0;
+			uint64_t position = 0;
+			size_t expectedEvent = 0;
+			while (engine.IsPlaying() || block == 0) {
+				if (block > 0 && block % (3 * SampleRate / blockFrames) == 0) {
+					const int64_t jump = (block / (3 * SampleRate / blockFrames)) % 2 == 1 ? 10 * (int64_t)SampleRate : -7 * (int64_t)SampleRate;
+					position = min((uint64_t)max((int64_t)0, (int64_t)position + jump), timeline->GetLengthSamples());
+					engine.Seek(position);
+					expectedEvent = std::lower_bound(eventSamples.begin(), eventSamples.end(), position) - eventSamples.begin();
+				}
+				sink.Pump(blockFrames);
+				const std::vector<float>& output = sink.GetLastBlock();
+				for (uint32_t frame = 0; frame < blockFrames; frame++) {
+					if (output[frame] == 0.0f) {
+						continue;
+					}
+					if (expectedEvent >= eventSamples.size() || position + frame != eventSamples[expectedEvent]) {
+						mismatchCount++;
+					}
+					expectedEvent++;
+					onsetCount++;
+				}
+				position += blockFrames;
+				block++;
+			}
+			if (expectedEvent != eventSamples.size()) {
+				mismatchCount++;
+			}
+			sink.Stop();
+		}
+		if (mismatchCount > 0) {
+			throw std::runtime_error(std::to_string(mismatchCount) + " onsets missed their timeline events after seeking");
+		}
+		state.counters["onsets"] = (double)onsetCount / (double)state.iterations;
+		state.counters["mismatched_onsets"] = (double)mismatchCount;
+	});
+
+	// Plays the tuplet song through, twenty-four hours of it, checking every click against its exact position.
+	// Sections start where the one before ends, its length rounded to the nearest sample once. Then checks bar
+	// lines found from random positions against the exact ones. Fails the run on any mismatch.
+	registry.Add("AudioEngine/Drift/song/tuplets/24h", [](State& state) {
+		const uint32_t blockFrames = 4096;
+		const float impulse[] = { 1.0f };
+		const audio::Song song = MakeTupletSong();
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(song, SampleRate);
+		std::vector<uint64_t> sectionStarts = { 0 };
+		for (int section = 0; section < TupletSectionCount; section++) {
+			sectionStarts.push_back(sectionStarts.back() + ExactStepSample(section, (uint64_t)song.sections[section].GetStepsPerBar() * song.sections[section].barCount));
+		}
+		std::vector<float> output(blockFrames);
+		uint64_t onsetCount = 0;
+		uint64_t mismatchCount = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::AudioEngine engine(SampleRate, 1);
+			engine.SetToneSet({ { impulse, 1 }, { impulse, 1 } });
+			engine.SetSongTimeline(timeline.get());
+			engine.Play();
+			int section = 0;
+			uint64_t step = 0;
+			uint64_t nextOnset = 0;
+			for (uint64_t block = 0; engine.IsPlaying() || block == 0; block++) {
+				engine.Render(output.data(), blockFrames);
+				const audio::PlaybackSnapshot snapshot = engine.GetPlaybackSnapshot();
+				for (; nextOnset < snapshot.onsetCount; nextOnset++) {
+					if (section < TupletSectionCount && step == (uint64_t)song.sections[section].GetStepsPerBar() * song.sections[section].barCount) {
+						section++;
+						step = 0;
+					}
+					const uint64_t expected = section < TupletSectionCount ? sectionStarts[section] + ExactStepSample(section, step++) : UINT64_MAX;
+					mismatchCount += snapshot.GetOnset(nextOnset).sample != expected ? 1 : 0;
+				}
+			}
+			onsetCount += nextOnset;
+			mismatchCount += section != TupletSectionCount - 1 || step != (uint64_t)song.sections.back().GetStepsPerBar() * song.sections.back().barCount ? 1 : 0;
+		}
+
+		std::mt19937 random(37);
+		uint64_t barLineMismatches = 0;
+		for (int trial = 0; trial < 10000; trial++) {
+			const uint64_t sample = ((uint64_t)random() << 32 | random()) % timeline->GetLengthSamples();
+			const int section = (int)timeline->FindSection(sample);
+			const uint64_t stepsPerBar = (uint64_t)song.sections[section].GetStepsPerBar();
+			uint64_t bar = 0;
+			while (sectionStarts[section] + ExactStepSample(section, (bar + 1024) * stepsPerBar) < sample) {
+				bar += 1024;
+			}
+			while (sectionStarts[section] + ExactStepSample(section, bar * stepsPerBar) < sample) {
+				bar++;
+			}
+			const uint64_t expected = min(sectionStarts[section + 1], sectionStarts[section] + ExactStepSample(section, bar * stepsPerBar));
+			barLineMismatches += timeline->FindNextBarLine(sample) != expected ? 1 : 0;
+		}
+		if (mismatchCount > 0 || barLineMismatches > 0) {
+			throw std::runtime_error("Tuplet song drifted: " + std::to_string(mismatchCount) + " mismatched onsets and "
+				+ std::to_string(barLineMismatches) + " mismatched bar lines");
+		}
+		state.counters["hours"] = (double)timeline->GetLengthSamples() / (3600.0 * SampleRate);
+		state.counters["onsets"] = (double)onsetCount / (double)state.iterations;
+		state.counters["mismatched_onsets"] = (double)mismatchCount;
+		state.counters["mismatched_bar_lines"] = (double)barLineMismatches;
+	});
+
+	registry.Add("AudioEngine/Render/song/block:256", [](State& state) {
+		const uint32_t blockFrames = 256;
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(100, 4), SampleRate);
+		std::vector<float> click(2400);
+		for (size_t i = 0; i < click.size(); i++) {
+			click[i] = 0.5f * sinf(6.2831853f * 1500.0f * (float)i / SampleRate) * expf(-60.0f * (float)i / SampleRate);
+		}
+		audio::AudioEngine engine(SampleRate, 2);
+		engine.SetToneSet({ { click.data(), (uint32_t)click.size() }, { click.data(), (uint32_t)click.size() } });
+		engine.SetSongTimeline(timeline.get());
+		engine.Play();
+		std::vector<float> output(blockFrames * 2);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			if (!engine.IsPlaying()) {
+				engine.Play();
+			}
+			engine.Render(output.data(), blockFrames);
+		}
+		DoNotOptimise(output);
+		state.SetItemsProcessed((double)blockFrames);
+	});
+
+	// Exports a song in parallel and plays it through in real time at two block sizes, counting the samples
+	// that differ in any bit. The song is cut into chunks at section boundaries. Fails the run on any difference.
+	registry.Add("SongExporter/Equivalence/sections:20", [](State& state) {
+		const ExportClicks clicks;
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(20, 9), SampleRate);
+		uint64_t mismatches = 0;
+		size_t chunkCount = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::SongExporter exporter(*timeline, clicks.View(), 2);
+			exporter.SetThreadCount(4);
+			MemoryWriter writer(2);
+			exporter.Export(writer);
+			chunkCount = exporter.GetChunks().size();
+			for (uint32_t blockFrames : { 256u, 441u }) {
+				mismatches += CountMismatches(writer.samples, RenderRealtime(*timeline, clicks.View(), 2, blockFrames, exporter.GetFrameCount()));
+			}
+		}
+		if (mismatches > 0) {
+			throw std::runtime_error("Exported song differed from the real-time render in " + std::to_string(mismatches) + " samples");
+		}
+		state.counters["chunks"] = (double)chunkCount;
+		state.counters["mismatched_samples"] = (double)mismatches;
+	});
+
+	// Real-time factor of exporting a song of about four minutes to float WAV, i.e. seconds of audio written per
+	// second taken, by how many threads render it
+	for (int threadCount : { 1, 2, 4, 8 }) {
+		registry.Add("SongExporter/WAV/threads:" + std::to_string(threadCount), [threadCount](State& state) {
+			const std::string path = "song_export_benchmark.wav";
+			const ExportClicks clicks;
+			const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(12, 4), SampleRate);
+			audio::SongExporter exporter(*timeline, clicks.View(), 2);
+			exporter.SetThreadCount(threadCount);
+			const auto start = std::chrono::steady_clock::now();
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				audio::WavFileWriter writer(path, SampleRate, 2);
+				exporter.Export(writer);
+				writer.Finish();
+			}
+			const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::remove(path.c_str());
+
+			const double audioSeconds = (double)exporter.GetFrameCount() / SampleRate;
+			state.SetItemsProcessed((double)exporter.GetFrameCount());
+			state.counters["audio_seconds"] = audioSeconds;
+			state.counters["chunks"] = (double)exporter.GetChunks().size();
+			state.counters["realtime_factor"] = audioSeconds * (double)state.iterations / max(elapsedSeconds, 1e-9);
+		});
+	}
+
+	// The same song to 24-bit FLAC, decoded again to check every sample is within half a step of the export
+	registry.Add("SongExporter/FLAC/threads:4", [](State& state) {
+		const std::string path = "song_export_benchmark.flac";
+		const ExportClicks clicks;
+		const std::unique_ptr<audio::SongTimeline> timeline = audio::SongTimeline::Compile(MakeSong(12, 4), SampleRate);
+		audio::SongExporter exporter(*timeline, clicks.View(), 2);
+		exporter.SetThreadCount(4);
+		uint64_t fileBytes = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::FlacFileWriter writer(path, SampleRate, 2, 24);
+			exporter.Export(writer);
+			writer.Finish();
+			fileBytes = writer.GetBytesWritten();
+		}
+		const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		state.PauseTiming();
+		MemoryWriter expected(2);
+		exporter.Export(expected);
+		std::ifstream file(path, std::ios::binary);
+		const std::vector<byte> fileData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const audio::DecodedAudio decoded = audio::DecodeFlac(fileData.data(), fileData.size());
+		double maxErrorSteps = decoded.samples.size() == expected.samples.size() ? 0.0 : INFINITY;
+		for (size_t i = 0; i < decoded.samples.size() && i < expected.samples.size(); i++) {
+			maxErrorSteps = max(maxErrorSteps, fabs((double)decoded.samples[i] - (double)expected.samples[i]) * (double)(1 << 23));
+		}
+		std::remove(path.c_str());
+		state.ResumeTiming();
+
+		const double audioSeconds = (double)exporter.GetFrameCount() / SampleRate;
+		state.SetItemsProcessed((double)exporter.GetFrameCount());
+		state.counters["compression_ratio"] = (double)exporter.GetFrameCount() * 2 * 3 / (double)fileBytes;
+		state.counters["max_error_steps"] = maxErrorSteps;
+		state.counters["realtime_factor"] = audioSeconds * (double)state.iterations / max(elapsedSeconds, 1e-9);
+	});
+}
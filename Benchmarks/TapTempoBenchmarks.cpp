@@ -0,0 +1,178 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/TapTempo.h"
+
+#include <random>
+
+namespace {
+
+	// Hand jitter added to each tap, and the tempos tapped at
+	const double TempoRange[] = { 40.0, 240.0 };
+	const int Trials = 2000;
+
+	// Least share of trials within 2% by the fourth tap for each spread of jitter in milliseconds. Three intervals
+	// pin the tempo down less well the wider the spread, most of all at fast tempos.
+	const std::pair<int, double> ConvergenceFloors[] = { { 0, 0.99 }, { 10, 0.85 }, { 20, 0.6 }, { 30, 0.45 } };
+
+	enum class Fault {
+		NONE,
+		BOUNCE,
+		STRAY,
+		MISSED,
+		LATE
+	};
+
+	// Tap times for beats at the given tempo, each with its beat number, starting a little after zero. A fault is
+	// put in after the third tap.
+	std::vector<std::pair<double, int>> MakeTaps(std::mt19937& random, double beatsPerMinute, int beatCount, double jitterSeconds, Fault fault)
+	{
+		std::normal_distribution<double> jitter(0.0, jitterSeconds);
+		const double secondsPerBeat = 60.0 / beatsPerMinute;
+		std::vector<std::pair<double, int>> taps;
+		for (int beat = 0; beat < beatCount; beat++) {
+			double seconds = 1.0 + (double)beat * secondsPerBeat + (jitterSeconds > 0.0 ? jitter(random) : 0.0);
+			if (beat == 3) {
+				if (fault == Fault::MISSED) {
+					continue;
+				}
+				if (fault == Fault::LATE) {
+					seconds += 0.35 * secondsPerBeat;
+				}
+			}
+			taps.push_back({ seconds, beat });
+			if (beat == 3 && fault == Fault::BOUNCE) {
+				taps.push_back({ seconds + 0.03, -1 });
+			}
+			if (beat == 3 && fault == Fault::STRAY) {
+				taps.push_back({ seconds + 0.5 * secondsPerBeat, -1 });
+			}
+		}
+		return taps;
+	}
+
+	double RelativeError(const audio::TapTempoEstimator& estimator, double beatsPerMinute)
+	{
+		return estimator.HasEstimate() ? fabs(estimator.GetBeatsPerMinute() - beatsPerMinute) / beatsPerMinute : 1.0;
+	}
+
+	double Percentile(std::vector<double> values, double percentile)
+	{
+		const size_t rank = (size_t)ceil(percentile / 100.0 * (double)values.size());
+		std::nth_element(values.begin(), values.begin() + (rank > 0 ? rank - 1 : 0), values.end());
+		return values[rank > 0 ? rank - 1 : 0];
+	}
+}
+
+void bench::RegisterTapTempoBenchmarks(Registry& registry)
+{
+	registry.Add("TapTempo/AddTap", [](State& state) {
+		std::mt19937 random(3);
+		const std::vector<std::pair<double, int>> taps = MakeTaps(random, 120.0, 1000, 0.02, Fault::NONE);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::TapTempoEstimator estimator;
+			for (const std::pair<double, int>& tap : taps) {
+				estimator.AddTap(tap.first);
+			}
+			DoNotOptimise(estimator.GetBeatsPerMinute());
+		}
+		state.SetItemsProcessed((double)taps.size());
+	});
+
+	// Error in the estimate after the third, fourth and eighth taps, at random tempos with the hand's jitter
+	// injected as Gaussian noise of the given spread. Tapping is usually within 10 to 30 ms. Fewer trials within 2%
+	// by the fourth tap than the spread's floor fails the run.
+	for (const std::pair<int, double>& convergenceFloor : ConvergenceFloors) {
+		const int jitterMilliseconds = convergenceFloor.first;
+		const double minConverged = convergenceFloor.second;
+		registry.Add("TapTempo/Jitter/sd_ms:" + std::to_string(jitterMilliseconds), [jitterMilliseconds, minConverged](State& state) {
+			std::mt19937 random(17);
+			std::uniform_real_distribution<double> tempos(TempoRange[0], TempoRange[1]);
+			std::vector<double> errors[3];
+			uint64_t convergedByFourTaps = 0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				for (int trial = 0; trial < Trials; trial++) {
+					const double beatsPerMinute = tempos(random);
+					const std::vector<std::pair<double, int>> taps = MakeTaps(random, beatsPerMinute, 8, 0.001 * jitterMilliseconds, Fault::NONE);
+					audio::TapTempoEstimator estimator;
+					for (size_t tap = 0; tap < taps.size(); tap++) {
+						estimator.AddTap(taps[tap].first);
+						if (tap == 2 || tap == 3 || tap == 7) {
+							errors[tap == 2 ? 0 : tap == 3 ? 1 : 2].push_back(100.0 * RelativeError(estimator, beatsPerMinute));
+						}
+						if (tap == 3 && RelativeError(estimator, beatsPerMinute) <= 0.02) {
+							convergedByFourTaps++;
+						}
+					}
+				}
+			}
+			state.counters["error_p95_percent_3_taps"] = Percentile(errors[0], 95.0);
+			state.counters["error_p95_percent_4_taps"] = Percentile(errors[1], 95.0);
+			state.counters["error_p95_percent_8_taps"] = Percentile(errors[2], 95.0);
+			const double converged = (double)convergedByFourTaps / (double)(Trials * state.iterations);
+			state.counters["within_2_percent_by_4_taps"] = converged;
+			if (converged < minConverged) {
+				throw std::runtime_error("Only " + std::to_string(converged) + " of trials within 2% by the fourth tap");
+			}
+		});
+	}
+
+	// A bounced tap, a stray tap between beats, a missed beat and a late tap, each put in after the third tap with
+	// 20 ms of jitter. Compared with no fault, the error after eight beats should barely move.
+	const std::pair<std::string, Fault> faults[] = {
+		{ "none", Fault::NONE }, { "bounce", Fault::BOUNCE }, { "stray", Fault::STRAY }, { "missed", Fault::MISSED }, { "late", Fault::LATE }
+	};
+	for (const std::pair<std::string, Fault>& fault : faults) {
+		registry.Add("TapTempo/Outlier/" + fault.first, [fault](State& state) {
+			std::mt19937 random(29);
+			std::uniform_real_distribution<double> tempos(TempoRange[0], TempoRange[1]);
+			std::vector<double> errors;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				for (int trial = 0; trial < Trials; trial++) {
+					const double beatsPerMinute = tempos(random);
+					audio::TapTempoEstimator estimator;
+					for (const std::pair<double, int>& tap : MakeTaps(random, beatsPerMinute, 8, 0.02, fault.second)) {
+						estimator.AddTap(tap.first);
+					}
+					errors.push_back(100.0 * RelativeError(estimator, beatsPerMinute));
+				}
+			}
+			state.counters["error_p50_percent"] = Percentile(errors, 50.0);
+			state.counters["error_p95_percent"] = Percentile(errors, 95.0);
+		});
+	}
+
+	// Taps at one tempo, then straight on at another 10 to 40% faster or slower; counts the taps at the new
+	// tempo until the estimate is within 2% of it and stays there
+	registry.Add("TapTempo/TempoChange", [](State& state) {
+		std::mt19937 random(31);
+		std::uniform_real_distribution<double> tempos(60.0, 180.0);
+		std::uniform_real_distribution<double> changes(0.1, 0.4);
+		std::vector<double> tapsToSettle;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			for (int trial = 0; trial < Trials; trial++) {
+				const double firstTempo = tempos(random);
+				const double secondTempo = firstTempo * (random() % 2 == 0 ? 1.0 + changes(random) : 1.0 - changes(random));
+				const std::vector<std::pair<double, int>> before = MakeTaps(random, firstTempo, 8, 0.02, Fault::NONE);
+				const std::vector<std::pair<double, int>> after = MakeTaps(random, secondTempo, 12, 0.02, Fault::NONE);
+				audio::TapTempoEstimator estimator;
+				for (const std::pair<double, int>& tap : before) {
+					estimator.AddTap(tap.first);
+				}
+				const double offset = before.back().first + 60.0 / secondTempo - after.front().first;
+				int settled = (int)after.size();
+				for (size_t tap = 0; tap < after.size(); tap++) {
+					estimator.AddTap(after[tap].first + offset);
+					if (RelativeError(estimator, secondTempo) > 0.02) {
+						settled = (int)after.size();
+					} else if (settled == (int)after.size()) {
+						settled = (int)tap + 1;
+					}
+				}
+				tapsToSettle.push_back((double)settled);
+			}
+		}
+		state.counters["taps_to_settle_p50"] = Percentile(tapsToSettle, 50.0);
+		state.counters["taps_to_settle_p95"] = Percentile(tapsToSettle, 95.0);
+	});
+}
@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/TempoRamp.h"
+#include "Audio/Sinks/NullSink.h"
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+	const uint32_t BlockFrames = 512;
+
+	// Frames per UI frame at 60 Hz, for driving the tempo the way a per-frame update would
+	const uint32_t FrameBlockFrames = SampleRate / 60;
+
+	struct RampCase {
+		std::string name;
+		audio::TempoRamp ramp;
+		double (*tempoAt)(double beats);
+	};
+
+	// Each ramp runs from 60 to 240 BPM over about an hour. The tempo functions are written out independently
+	// of TempoRamp, to integrate numerically as the reference.
+	const std::vector<RampCase>& RampCases()
+	{
+		static const std::vector<RampCase> cases = {
+			{ "linear", audio::TempoRamp::Linear(60.0, 240.0, 7790.0),
+				[](double b) { return b >= 7790.0 ? 240.0 : 60.0 + 180.0 * b / 7790.0; } },
+			{ "exponential", audio::TempoRamp::Exponential(60.0, 240.0, 6654.0),
+				[](double b) { return b >= 6654.0 ? 240.0 : 60.0 * pow(4.0, b / 6654.0); } },
+			{ "stepped", audio::TempoRamp::Stepped(60.0, 240.0, 44, 180),
+				[](double b) { return b >= 44.0 * 180.0 ? 240.0 : 60.0 + floor(b / 44.0); } },
+			{ "stepped_down", audio::TempoRamp::Stepped(240.0, 60.0, 44, 180),
+				[](double b) { return b >= 44.0 * 180.0 ? 60.0 : 240.0 - floor(b / 44.0); } }
+		};
+		return cases;
+	}
+
+	// Sample position of every beat within the given length, integrating minutes per beat with five-point
+	// Gauss-Legendre quadrature over each beat in long double with a compensated sum. Tempo is constant over
+	// each beat of the stepped ramps, where the quadrature is exact.
+	std::vector<double> ReferenceBeatSamples(double (*tempoAt)(double beats), uint64_t lengthSamples)
+	{
+		const long double nodes[] = { 0.0L, -0.538469310105683091L, 0.538469310105683091L, -0.906179845938663993L, 0.906179845938663993L };
+		const long double weights[] = { 0.568888888888888889L, 0.478628670499366468L, 0.478628670499366468L, 0.236926885056189088L, 0.236926885056189088L };
+		const long double samplesPerMinute = 60.0L * SampleRate;
+		std::vector<double> beatSamples;
+		long double minutes = 0.0L;
+		long double compensation = 0.0L;
+		for (uint64_t beat = 0; minutes * samplesPerMinute < (long double)lengthSamples; beat++) {
+			beatSamples.push_back((double)(minutes * samplesPerMinute));
+			long double beatMinutes = 0.0L;
+			for (int i = 0; i < 5; i++) {
+				beatMinutes += weights[i] * 0.5L / (long double)tempoAt((double)beat + 0.5 + 0.5 * (double)nodes[i]);
+			}
+			const long double term = beatMinutes - compensation;
+			const long double sum = minutes + term;
+			compensation = (sum - minutes) - term;
+			minutes = sum;
+		}
+		return beatSamples;
+	}
+
+	// Renders single-sample clicks and returns the sample position of every onset. The setup function runs
+	// before each block with the first sample of the block.
+	template<typename SetupFunction>
+	std::vector<uint64_t> RenderOnsets(uint64_t lengthSamples, uint32_t blockFrames, SetupFunction setup)
+	{
+		static const float impulse[] = { 1.0f };
+		audio::AudioEngine engine(SampleRate, 1);
+		engine.SetBarCacheEnabled(false);
+		engine.SetToneSet({ { impulse, 1 }, { impulse, 1 } });
+		audio::NullSink sink(SampleRate, 1, blockFrames);
+		sink.Start(&engine);
+		std::vector<uint64_t> onsets;
+		for (uint64_t blockStart = 0; blockStart < lengthSamples; blockStart += blockFrames) {
+			setup(engine, blockStart);
+			sink.Pump(blockFrames);
+			const std::vector<float>& output = sink.GetLastBlock();
+			for (uint32_t frame = 0; frame < blockFrames; frame++) {
+				if (output[frame] != 0.0f) {
+					onsets.push_back(blockStart + frame);
+				}
+			}
+		}
+		sink.Stop();
+		return onsets;
+	}
+
+	double MaxOnsetError(const std::vector<uint64_t>& onsets, const std::vector<double>& reference)
+	{
+		if (onsets.size() != reference.size()) {
+			throw std::runtime_error("Rendered " + std::to_string(onsets.size()) + " onsets, expected " + std::to_string(reference.size()));
+		}
+		double maxError = 0.0;
+		for (size_t i = 0; i < onsets.size(); i++) {
+			maxError = max(maxError, fabs((double)onsets[i] - reference[i]));
+		}
+		return maxError;
+	}
+}
+
+void bench::RegisterTempoRampBenchmarks(Registry& registry)
+{
+	const uint64_t hourSamples = 3600ull * SampleRate;
+
+	for (const RampCase& rampCase : RampCases()) {
+
+		// Cost of finding where the next beat lands, which the audio thread does once per beat
+		registry.Add("TempoRamp/NextBeat/" + rampCase.name, [&rampCase](State& state) {
+			const double samplesPerMinute = 60.0 * SampleRate;
+			const uint64_t beatCount = 10000;
+			double total = 0.0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				for (uint64_t beat = 0; beat < beatCount; beat++) {
+					total += rampCase.ramp.GetSampleOffset((double)beat, samplesPerMinute);
+				}
+			}
+			DoNotOptimise(total);
+			state.SetItemsProcessed((double)beatCount);
+		});
+
+		// Plays an hour of the ramp through the engine and compares every onset with the reference integral.
+		// Rounding to whole samples allows half a sample; model error is the closed form before rounding. Fails
+		// the run if any onset is a whole sample or more out.
+		registry.Add("TempoRamp/Accuracy/" + rampCase.name + "/1h", [&rampCase, hourSamples](State& state) {
+			const std::vector<double> reference = ReferenceBeatSamples(rampCase.tempoAt, hourSamples);
+			double maxModelError = 0.0;
+			for (size_t beat = 0; beat < reference.size(); beat++) {
+				maxModelError = max(maxModelError, fabs(rampCase.ramp.GetSampleOffset((double)beat, 60.0 * SampleRate) - reference[beat]));
+			}
+			double maxOnsetError = 0.0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				const std::vector<uint64_t> onsets = RenderOnsets(hourSamples, BlockFrames, [&rampCase](audio::AudioEngine& engine, uint64_t blockStart) {
+					if (blockStart == 0) {
+						engine.SetTempoRamp(rampCase.ramp);
+						engine.Play();
+					}
+				});
+				maxOnsetError = max(maxOnsetError, MaxOnsetError(onsets, reference));
+			}
+			if (maxOnsetError >= 1.0) {
+				throw std::runtime_error(rampCase.name + " ramp onset was " + std::to_string(maxOnsetError) + " samples from the reference");
+			}
+			state.counters["max_onset_error_samples"] = maxOnsetError;
+			state.counters["max_model_error_samples"] = maxModelError;
+			state.counters["beats"] = (double)reference.size();
+		});
+	}
+
+	// The same linear ramp approximated by setting the tempo once per 60 Hz UI frame, for comparison
+	registry.Add("TempoRamp/Accuracy/linear/1h/per_frame_set_tempo", [hourSamples](State& state) {
+		const RampCase& rampCase = RampCases()[0];
+		const std::vector<double> reference = ReferenceBeatSamples(rampCase.tempoAt, hourSamples);
+		double maxOnsetError = 0.0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			const std::vector<uint64_t> onsets = RenderOnsets(hourSamples, FrameBlockFrames, [&rampCase](audio::AudioEngine& engine, uint64_t blockStart) {
+				engine.SetTempo(rampCase.tempoAt((double)engine.GetBeatIndex()));
+				if (blockStart == 0) {
+					engine.Play();
+				}
+			});
+			const size_t count = min(onsets.size(), reference.size());
+			for (size_t beat = 0; beat < count; beat++) {
+				maxOnsetError = max(maxOnsetError, fabs((double)onsets[beat] - reference[beat]));
+			}
+		}
+		state.counters["max_onset_error_samples"] = maxOnsetError;
+	});
+}
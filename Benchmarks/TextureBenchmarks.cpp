@@ -0,0 +1,19 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Content/Components/Textures/OverlayTexturePixels.h"
+
+void bench::RegisterTextureBenchmarks(Registry& registry)
+{
+	for (float dpi : Dpis()) {
+		registry.Add("Texture/GenerateOverlayTexturePixels/dpi:" + std::to_string((int)dpi), [dpi](State& state) {
+			std::vector<byte> textureData;
+			int width = 0, height = 0;
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				texture::GenerateOverlayTexturePixels(dpi, textureData, width, height);
+				DoNotOptimise(textureData.data());
+			}
+			state.SetItemsProcessed((double)(width * height));
+		});
+	}
+}
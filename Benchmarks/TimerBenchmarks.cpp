@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Common/StepTimer.h"
+#include "Content/Components/CardShuffle.h"
+
+namespace {
+
+	// The 128th, 244th and 254th shortest of the frame times the percentile run records, in ticks
+	const DX::FrameTimeStatistics::Percentiles ExpectedPercentiles = { 169987, 179121, 179750 };
+
+	// Each 60Hz step is 166666 ticks, just short of a 60th of a second, so 18 steps fall short of the shuffle's
+	// 0.3 s and it ends on the 19th
+	const uint64_t ExpectedShuffleUpdates = 19;
+}
+
+void bench::RegisterTimerBenchmarks(Registry& registry)
+{
+	registry.Add("StepTimer/Tick/variable", [](State& state) {
+		DX::StepTimer timer;
+		double totalSeconds = 0.0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			timer.Tick([&]() {
+				totalSeconds += timer.GetElapsedSeconds();
+			});
+		}
+		DoNotOptimise(totalSeconds);
+		state.SetItemsProcessed(1.0);
+	});
+
+	registry.Add("StepTimer/Tick/fixed:60Hz", [](State& state) {
+		DX::StepTimer timer;
+		timer.SetFixedTimeStep(true);
+		timer.SetTargetElapsedSeconds(1.0 / 60.0);
+		uint64_t updates = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			timer.Tick([&]() {
+				updates++;
+			});
+		}
+		DoNotOptimise(updates);
+		state.SetItemsProcessed(1.0);
+	});
+
+	registry.Add("StepTimer/Tick/fixed:60Hz/fake_clock", [](State& state) {
+		// Frames alternate between 15ms and 18ms, so fixed-step catch-up runs on a deterministic schedule. Neither
+		// is close enough to the target to be snapped to it, so every elapsed tick counts towards an update and
+		// anything but one update per whole step fails the run.
+		DX::BasicStepTimer<DX::FakeClock> timer;
+		timer.SetFixedTimeStep(true);
+		timer.SetTargetElapsedSeconds(1.0 / 60.0);
+		uint64_t updates = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			timer.GetClock().Advance((i & 1) ? 180000 : 150000);
+			timer.Tick([&]() {
+				updates++;
+			});
+		}
+		DoNotOptimise(updates);
+		state.SetItemsProcessed(1.0);
+
+		const uint64_t targetTicks = DX::StepTimer::SecondsToTicks(1.0 / 60.0);
+		const uint64_t elapsedTicks = 150000 * ((state.iterations + 1) / 2) + 180000 * (state.iterations / 2);
+		if (updates != elapsedTicks / targetTicks || timer.GetTotalTicks() != updates * targetTicks) {
+			throw std::runtime_error(std::to_string(updates) + " updates over " + std::to_string(elapsedTicks) + " ticks");
+		}
+	});
+
+	// Frame times of 16 to 18ms in a scattered order, filling the window; the percentiles must be exact
+	registry.Add("StepTimer/GetFrameTimePercentiles", [](State& state) {
+		DX::BasicStepTimer<DX::FakeClock> timer;
+		for (int frame = 0; frame < (int)DX::FrameTimeStatistics::WindowSize; frame++) {
+			timer.GetClock().Advance(160000 + (frame * 7919) % 20000);
+			timer.Tick([]() {});
+		}
+		uint64_t sum = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			auto percentiles = timer.GetFrameTimePercentiles();
+			sum += percentiles.p50 + percentiles.p95 + percentiles.p99;
+		}
+		DoNotOptimise(sum);
+		state.SetItemsProcessed(1.0);
+
+		const auto percentiles = timer.GetFrameTimePercentiles();
+		if (percentiles.p50 != ExpectedPercentiles.p50 || percentiles.p95 != ExpectedPercentiles.p95 || percentiles.p99 != ExpectedPercentiles.p99) {
+			throw std::runtime_error("Percentiles " + std::to_string(percentiles.p50) + ", " + std::to_string(percentiles.p95) + " and "
+				+ std::to_string(percentiles.p99) + " ticks");
+		}
+	});
+
+	// The settings cards' shuffle stepped at 60Hz from a fake clock, as the scene steps it from the app's timer.
+	// It must finish on the same update every time.
+	registry.Add("StepTimer/CardShuffle/fixed:60Hz/fake_clock", [](State& state) {
+		uint64_t wrongRuns = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			DX::BasicStepTimer<DX::FakeClock> timer;
+			timer.SetFixedTimeStep(true);
+			timer.SetTargetElapsedSeconds(1.0 / 60.0);
+			animation::CardShuffle shuffle;
+			shuffle.Start();
+			uint64_t updates = 0;
+			while (shuffle.IsAnimating()) {
+				timer.GetClock().Advance(166667);
+				timer.Tick([&]() {
+					updates++;
+					shuffle.Advance(timer.GetElapsedSeconds());
+				});
+			}
+			DoNotOptimise(shuffle.GetScaleIn());
+			wrongRuns += updates != ExpectedShuffleUpdates || shuffle.GetProgress() != 1.0f ? 1 : 0;
+		}
+		state.SetItemsProcessed((double)ExpectedShuffleUpdates);
+		if (wrongRuns > 0) {
+			throw std::runtime_error(std::to_string(wrongRuns) + " shuffles did not finish on update " + std::to_string(ExpectedShuffleUpdates));
+		}
+	});
+
+	registry.Add("StepTimer/TicksToSeconds", [](State& state) {
+		double sum = 0.0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			sum += DX::StepTimer::TicksToSeconds(DX::StepTimer::SecondsToTicks((double)(i & 1023) * 0.001));
+		}
+		DoNotOptimise(sum);
+		state.SetItemsProcessed(1.0);
+	});
+}
@@ -0,0 +1,553 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/Sinks/NullSink.h"
+#include "Audio/ToneSets/AdpcmClip.h"
+#include "Audio/ToneSets/AudioDecoder.h"
+#include "Audio/ToneSets/ClickSynth.h"
+#include "Audio/ToneSets/PolyphaseResampler.h"
+#include "Audio/ToneSets/ToneSetPool.h"
+
+#include <cstdio>
+#include <random>
+
+namespace {
+
+	const uint32_t SourceRate = 44100;
+	const uint32_t DeviceRate = 48000;
+
+	// Half a second of a decaying two-tone stereo click, as 16-bit samples
+	std::vector<int16_t> MakeStereoClick(float frequency)
+	{
+		const int frameCount = SourceRate / 2;
+		std::vector<int16_t> samples(frameCount * 2);
+		for (int i = 0; i < frameCount; i++) {
+			const float t = (float)i / (float)SourceRate;
+			const float envelope = expf(-t * 12.0f);
+			samples[2 * i] = (int16_t)(20000.0f * envelope * sinf(6.2831853f * frequency * t));
+			samples[2 * i + 1] = (int16_t)(20000.0f * envelope * sinf(6.2831853f * frequency * 1.5f * t));
+		}
+		return samples;
+	}
+
+	void PutLittleEndian(std::vector<byte>& file, uint32_t value, int byteCount)
+	{
+		for (int i = 0; i < byteCount; i++) {
+			file.push_back((byte)(value >> (8 * i)));
+		}
+	}
+
+	void PutTag(std::vector<byte>& file, const char* tag)
+	{
+		for (int i = 0; i < 4; i++) {
+			file.push_back((byte)tag[i]);
+		}
+	}
+
+	std::vector<byte> EncodeWav(const std::vector<int16_t>& samples)
+	{
+		const uint32_t dataBytes = (uint32_t)(samples.size() * 2);
+		std::vector<byte> file;
+		file.reserve(44 + dataBytes);
+		PutTag(file, "RIFF");
+		PutLittleEndian(file, 36 + dataBytes, 4);
+		PutTag(file, "WAVE");
+		PutTag(file, "fmt ");
+		PutLittleEndian(file, 16, 4);
+		PutLittleEndian(file, 1, 2);
+		PutLittleEndian(file, 2, 2);
+		PutLittleEndian(file, SourceRate, 4);
+		PutLittleEndian(file, SourceRate * 4, 4);
+		PutLittleEndian(file, 4, 2);
+		PutLittleEndian(file, 16, 2);
+		PutTag(file, "data");
+		PutLittleEndian(file, dataBytes, 4);
+		for (int16_t sample : samples) {
+			PutLittleEndian(file, (uint16_t)sample, 2);
+		}
+		return file;
+	}
+
+	class BitWriter {
+	public:
+		std::vector<byte> bytes;
+		int bitCount = 0;
+
+		void Write(uint64_t value, int count) {
+			for (int i = count - 1; i >= 0; i--) {
+				if (bitCount % 8 == 0) {
+					bytes.push_back(0);
+				}
+				bytes.back() |= (byte)(((value >> i) & 1) << (7 - bitCount % 8));
+				bitCount++;
+			}
+		}
+
+		void WriteRice(int32_t value, int parameter) {
+			const uint32_t folded = value >= 0 ? (uint32_t)value << 1 : ((uint32_t)(-(value + 1)) << 1) | 1;
+			for (uint32_t i = 0; i < (folded >> parameter); i++) {
+				Write(0, 1);
+			}
+			Write(1, 1);
+			Write(folded & ((1u << parameter) - 1), parameter);
+		}
+
+		void AlignToByte() {
+			bitCount = (bitCount + 7) & ~7;
+		}
+	};
+
+	// A minimal FLAC encoder, enough to produce realistic test input: mid/side stereo, second-order fixed
+	// prediction and one Rice partition per subframe. Checksums are left as zero, which the decoder ignores.
+	std::vector<byte> EncodeFlac(const std::vector<int16_t>& samples)
+	{
+		const uint32_t frameCount = (uint32_t)(samples.size() / 2);
+		const uint32_t blockSize = 4096;
+		BitWriter writer;
+		writer.bytes.reserve(samples.size() * 2);
+		writer.Write('f', 8); writer.Write('L', 8); writer.Write('a', 8); writer.Write('C', 8);
+		writer.Write(0x80, 8);
+		writer.Write(34, 24);
+		writer.Write(blockSize, 16);
+		writer.Write(blockSize, 16);
+		writer.Write(0, 24);
+		writer.Write(0, 24);
+		writer.Write(SourceRate, 20);
+		writer.Write(1, 3);
+		writer.Write(15, 5);
+		writer.Write(frameCount, 36);
+		writer.Write(0, 64);
+		writer.Write(0, 64);
+
+		for (uint32_t start = 0, frameNumber = 0; start < frameCount; start += blockSize, frameNumber++) {
+			const uint32_t length = min(blockSize, frameCount - start);
+			writer.Write(0xfff8, 16);
+			writer.Write(7, 4);
+			writer.Write(0, 4);
+			writer.Write(10, 4);
+			writer.Write(4, 3);
+			writer.Write(0, 1);
+			writer.Write(frameNumber, 8);
+			writer.Write(length - 1, 16);
+			writer.Write(0, 8);
+
+			std::vector<int32_t> channels[2] = { std::vector<int32_t>(length), std::vector<int32_t>(length) };
+			for (uint32_t i = 0; i < length; i++) {
+				const int32_t left = samples[2 * (start + i)];
+				const int32_t right = samples[2 * (start + i) + 1];
+				channels[0][i] = (left + right) >> 1;
+				channels[1][i] = left - right;
+			}
+			for (int channel = 0; channel < 2; channel++) {
+				const std::vector<int32_t>& signal = channels[channel];
+				const int bitsPerSample = channel == 1 ? 17 : 16;
+				const int order = length > 2 ? 2 : 0;
+				std::vector<int32_t> residual;
+				uint64_t magnitudeSum = 0;
+				for (uint32_t i = order; i < length; i++) {
+					residual.push_back(order == 2 ? signal[i] - 2 * signal[i - 1] + signal[i - 2] : signal[i]);
+					magnitudeSum += (uint64_t)abs(residual.back());
+				}
+				int parameter = 0;
+				while (parameter < 14 && ((uint64_t)1 << (parameter + 1)) * residual.size() < magnitudeSum) {
+					parameter++;
+				}
+				writer.Write(0, 1);
+				writer.Write(8 + order, 6);
+				writer.Write(0, 1);
+				for (int i = 0; i < order; i++) {
+					writer.Write((uint32_t)signal[i] & ((1u << bitsPerSample) - 1), bitsPerSample);
+				}
+				writer.Write(0, 2);
+				writer.Write(0, 4);
+				writer.Write(parameter, 4);
+				for (int32_t value : residual) {
+					writer.WriteRice(value, parameter);
+				}
+			}
+			writer.AlignToByte();
+			writer.Write(0, 16);
+		}
+		return writer.bytes;
+	}
+
+	struct ToneSetFiles {
+		std::string name;
+		std::vector<byte> accent;
+		std::vector<byte> normal;
+	};
+
+	// Four tone sets, half stored as WAV and half as FLAC
+	const std::vector<ToneSetFiles>& SourceToneSets()
+	{
+		static const std::vector<ToneSetFiles> toneSets = {
+			{ "Wood block", EncodeWav(MakeStereoClick(1800.0f)), EncodeWav(MakeStereoClick(1200.0f)) },
+			{ "Cowbell", EncodeFlac(MakeStereoClick(800.0f)), EncodeFlac(MakeStereoClick(540.0f)) },
+			{ "Rim shot", EncodeWav(MakeStereoClick(2400.0f)), EncodeWav(MakeStereoClick(2000.0f)) },
+			{ "Bell", EncodeFlac(MakeStereoClick(1320.0f)), EncodeFlac(MakeStereoClick(880.0f)) }
+		};
+		return toneSets;
+	}
+
+	struct SynthesisedToneSet {
+		std::string name;
+		audio::ClickPatch accent;
+		audio::ClickPatch normal;
+	};
+
+	// The same four tone sets as patches, one for each shape and one mixing them
+	const std::vector<SynthesisedToneSet>& SynthesisedToneSets()
+	{
+		static const std::vector<SynthesisedToneSet> toneSets = {
+			{ "Wood block", audio::ClickPatch::FilteredSine(1800.0f, 0.6f, 0.03f, 0.6f), audio::ClickPatch::FilteredSine(1200.0f, 0.6f, 0.03f, 0.6f) },
+			{ "Cowbell", audio::ClickPatch::FmBell(800.0f, 1.48f, 2.5f, 0.08f, 0.5f), audio::ClickPatch::FmBell(540.0f, 1.48f, 2.5f, 0.08f, 0.5f) },
+			{ "Rim shot", audio::ClickPatch::NoiseBurst(2400.0f, 1200.0f, 0.012f, 0.8f), audio::ClickPatch::NoiseBurst(2000.0f, 1000.0f, 0.012f, 0.8f) },
+			{ "Bell", audio::ClickPatch::FmBell(1320.0f, 3.5f, 4.0f, 0.3f, 0.4f), audio::ClickPatch::FilteredSine(880.0f, 0.3f, 0.3f, 0.4f) }
+		};
+		return toneSets;
+	}
+
+	uint64_t SourceFingerprint()
+	{
+		uint64_t fingerprint = audio::ToneSetPool::EmptyFingerprint;
+		for (const ToneSetFiles& files : SourceToneSets()) {
+			fingerprint = audio::ToneSetPool::Fingerprint(files.accent, fingerprint);
+			fingerprint = audio::ToneSetPool::Fingerprint(files.normal, fingerprint);
+		}
+		return fingerprint;
+	}
+
+	void AddSourceToneSets(audio::ToneSetPool& pool)
+	{
+		for (const ToneSetFiles& files : SourceToneSets()) {
+			pool.AddToneSet(files.name, files.accent, files.normal);
+		}
+	}
+
+	// The first source tone set's accent as the pool holds it, mono at the device rate
+	std::vector<float> DeviceRateClick()
+	{
+		audio::ToneSetPool pool(DeviceRate);
+		pool.AddToneSet(SourceToneSets()[0].name, SourceToneSets()[0].accent, SourceToneSets()[0].normal);
+		const audio::SampleView click = pool.GetToneSet(0).accent;
+		return std::vector<float>(click.samples, click.samples + click.length);
+	}
+
+	// Signal-to-noise ratio of a resampled 1kHz sine against the ideal one, ignoring the edges
+	double ResampledSineSnr(uint32_t inputRate, uint32_t outputRate)
+	{
+		std::vector<float> input(inputRate);
+		for (uint32_t i = 0; i < inputRate; i++) {
+			input[i] = sinf(6.2831853f * 1000.0f * (float)i / (float)inputRate);
+		}
+		const audio::PolyphaseResampler resampler(inputRate, outputRate);
+		const std::vector<float> output = resampler.Process(input.data(), input.size());
+		double signal = 0.0;
+		double noise = 0.0;
+		for (size_t i = outputRate / 10; i < output.size() - outputRate / 10; i++) {
+			const double ideal = sin(6.283185307179586 * 1000.0 * (double)i / (double)outputRate);
+			signal += ideal * ideal;
+			noise += (output[i] - ideal) * (output[i] - ideal);
+		}
+		return 10.0 * log10(signal / max(noise, 1e-30));
+	}
+}
+
+void bench::RegisterToneSetBenchmarks(Registry& registry)
+{
+	registry.Add("ToneSet/DecodeWav/16bit_stereo", [](State& state) {
+		const std::vector<byte>& file = SourceToneSets()[0].accent;
+		size_t frames = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			frames = audio::DecodeAudioFile(file).GetFrameCount();
+			DoNotOptimise(frames);
+		}
+		state.SetItemsProcessed((double)frames);
+	});
+
+	registry.Add("ToneSet/DecodeFlac/16bit_stereo", [](State& state) {
+		const std::vector<int16_t> click = MakeStereoClick(800.0f);
+		const std::vector<byte>& file = SourceToneSets()[1].accent;
+		audio::DecodedAudio decoded = { 0, 0, {} };
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			decoded = audio::DecodeAudioFile(file);
+			DoNotOptimise(decoded.samples.data());
+		}
+		float maxDifference = decoded.samples.size() == click.size() ? 0.0f : 1.0f;
+		for (size_t i = 0; i < min(click.size(), decoded.samples.size()); i++) {
+			maxDifference = max(maxDifference, fabsf(decoded.samples[i] - (float)click[i] / 32768.0f));
+		}
+		state.SetItemsProcessed((double)decoded.GetFrameCount());
+		state.counters["compression_ratio"] = (double)(click.size() * 2) / (double)file.size();
+		state.counters["max_difference_from_source"] = maxDifference;
+	});
+
+	const std::pair<uint32_t, uint32_t> conversions[] = { { 44100, 48000 }, { 22050, 48000 }, { 96000, 48000 }, { 48000, 44100 } };
+	for (const auto& conversion : conversions) {
+		const uint32_t inputRate = conversion.first;
+		const uint32_t outputRate = conversion.second;
+		registry.Add("ToneSet/Resample/" + std::to_string(inputRate) + "_to_" + std::to_string(outputRate), [inputRate, outputRate](State& state) {
+			const audio::PolyphaseResampler resampler(inputRate, outputRate);
+			const std::vector<float> input = audio::DecodeAudioFile(SourceToneSets()[0].accent).MixToMono();
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				const std::vector<float> output = resampler.Process(input.data(), input.size());
+				DoNotOptimise(output.data());
+			}
+			state.SetItemsProcessed((double)input.size());
+			state.counters["taps_per_phase"] = resampler.GetTapsPerPhase();
+			state.counters["sine_snr_db"] = ResampledSineSnr(inputRate, outputRate);
+		});
+	}
+
+	registry.Add("ToneSet/Pool/decode_and_resample", [](State& state) {
+		size_t memoryBytes = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::ToneSetPool pool(DeviceRate);
+			AddSourceToneSets(pool);
+			memoryBytes = pool.GetMemoryBytes();
+		}
+		state.SetItemsProcessed((double)SourceToneSets().size());
+		state.counters["heap_bytes"] = (double)memoryBytes;
+	});
+
+	// Tone sets held as patches, for comparison with decode_and_resample: nothing to decode and no samples held
+	registry.Add("ToneSet/Pool/synthesised", [](State& state) {
+		size_t memoryBytes = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::ToneSetPool pool(DeviceRate);
+			for (const SynthesisedToneSet& toneSet : SynthesisedToneSets()) {
+				pool.AddSynthesisedToneSet(toneSet.name, toneSet.accent, toneSet.normal);
+			}
+			memoryBytes = pool.GetMemoryBytes();
+		}
+		state.SetItemsProcessed((double)SynthesisedToneSets().size());
+		state.counters["heap_bytes"] = (double)memoryBytes;
+	});
+
+	registry.Add("ToneSet/Pool/decode_and_resample/compressed", [](State& state) {
+		size_t memoryBytes = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::ToneSetPool pool(DeviceRate);
+			pool.SetCompressionEnabled(true);
+			AddSourceToneSets(pool);
+			memoryBytes = pool.GetMemoryBytes();
+		}
+		state.SetItemsProcessed((double)SourceToneSets().size());
+		state.counters["heap_bytes"] = (double)memoryBytes;
+	});
+
+	// Loads the cache of decoded tone sets and compares both clicks of each with those it was saved from, failing
+	// the run on any difference
+	registry.Add("ToneSet/Pool/load_mapped_cache", [](State& state) {
+		const std::string path = "tone_set_cache_benchmark.bin";
+		const uint64_t fingerprint = SourceFingerprint();
+		audio::ToneSetPool source(DeviceRate);
+		AddSourceToneSets(source);
+		source.SaveCache(path, fingerprint);
+
+		// Touching every sample includes the cost of faulting in the mapped pages
+		float sum = 0.0f;
+		bool isIdentical = true;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::ToneSetPool pool(DeviceRate);
+			if (!pool.LoadCache(path, fingerprint)) {
+				throw std::runtime_error("Tone set cache was not loaded");
+			}
+			for (size_t t = 0; t < pool.GetToneSetCount(); t++) {
+				const audio::ToneSetView view = pool.GetToneSet(t);
+				for (uint32_t s = 0; s < view.accent.length; s++) {
+					sum += view.accent.samples[s];
+				}
+				const audio::ToneSetView original = source.GetToneSet(t);
+				for (const auto& clicks : { std::make_pair(view.accent, original.accent), std::make_pair(view.normal, original.normal) }) {
+					isIdentical = isIdentical && clicks.first.length == clicks.second.length &&
+						memcmp(clicks.first.samples, clicks.second.samples, clicks.second.length * sizeof(float)) == 0;
+				}
+			}
+		}
+		DoNotOptimise(sum);
+		std::remove(path.c_str());
+		if (!isIdentical) {
+			throw std::runtime_error("Tone sets loaded from the cache differed from those decoded");
+		}
+		state.SetItemsProcessed((double)SourceToneSets().size());
+		state.counters["identical_to_decoded"] = isIdentical ? 1.0 : 0.0;
+	});
+
+	// A cache holding sampled, compressed and synthesised tone sets together, which must all come back unchanged;
+	// any that does not fails the run
+	registry.Add("ToneSet/Pool/load_mixed_cache", [](State& state) {
+		const std::string path = "tone_set_mixed_cache_benchmark.bin";
+		const uint64_t fingerprint = SourceFingerprint();
+		audio::ToneSetPool source(DeviceRate);
+		AddSourceToneSets(source);
+		source.SetCompressionEnabled(true);
+		AddSourceToneSets(source);
+		for (const SynthesisedToneSet& toneSet : SynthesisedToneSets()) {
+			source.AddSynthesisedToneSet(toneSet.name, toneSet.accent, toneSet.normal);
+		}
+		source.SaveCache(path, fingerprint);
+
+		uint64_t mismatches = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			audio::ToneSetPool pool(DeviceRate);
+			if (!pool.LoadCache(path, fingerprint)) {
+				throw std::runtime_error("Tone set cache was not loaded");
+			}
+			for (size_t t = 0; t < pool.GetToneSetCount(); t++) {
+				const audio::ToneSetView view = pool.GetToneSet(t);
+				const audio::ToneSetView original = source.GetToneSet(t);
+				for (const auto& clicks : { std::make_pair(view.accent, original.accent), std::make_pair(view.normal, original.normal) }) {
+					const audio::SampleView& loaded = clicks.first;
+					const audio::SampleView& saved = clicks.second;
+					bool isSame = loaded.length == saved.length && (loaded.synth != nullptr) == (saved.synth != nullptr) &&
+						(loaded.compressed != nullptr) == (saved.compressed != nullptr);
+					if (isSame && saved.synth != nullptr) {
+						isSame = memcmp(&loaded.synth->GetPatch(), &saved.synth->GetPatch(), sizeof(audio::ClickPatch)) == 0;
+					} else if (isSame && saved.compressed != nullptr) {
+						isSame = loaded.compressed->GetScale() == saved.compressed->GetScale() &&
+							memcmp(loaded.compressed->GetBlocks(), saved.compressed->GetBlocks(), saved.compressed->GetEncodedBytes()) == 0;
+					} else if (isSame) {
+						isSame = memcmp(loaded.samples, saved.samples, saved.length * sizeof(float)) == 0;
+					}
+					mismatches += isSame ? 0 : 1;
+				}
+			}
+		}
+		std::remove(path.c_str());
+		if (mismatches > 0) {
+			throw std::runtime_error(std::to_string(mismatches) + " clicks loaded from the mixed cache differed from those saved");
+		}
+		state.SetItemsProcessed((double)source.GetToneSetCount());
+		state.counters["mismatches"] = (double)mismatches;
+	});
+
+	// compression_ratio is against float samples, and snr_db is of the decoded click against the original
+	registry.Add("ToneSet/Adpcm/encode", [](State& state) {
+		const std::vector<float> click = DeviceRateClick();
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			const audio::AdpcmClip clip(click.data(), (uint32_t)click.size());
+			DoNotOptimise(clip.GetBlocks()[0]);
+		}
+		const audio::AdpcmClip clip(click.data(), (uint32_t)click.size());
+		std::vector<float> decoded(click.size());
+		audio::AdpcmCursor cursor = { 0, 0, 0 };
+		clip.Decode(cursor, 0, clip.GetLength(), decoded.data());
+		double signal = 0.0;
+		double noise = 0.0;
+		for (size_t s = 0; s < click.size(); s++) {
+			signal += (double)click[s] * click[s];
+			noise += ((double)decoded[s] - click[s]) * ((double)decoded[s] - click[s]);
+		}
+		state.SetItemsProcessed((double)click.size());
+		state.counters["compression_ratio"] = (double)(click.size() * sizeof(float)) / (double)clip.GetEncodedBytes();
+		state.counters["snr_db"] = 10.0 * log10(signal / max(noise, 1e-30));
+	});
+
+	// Decodes as a voice does, a mixer block at a time from where the cursor was left
+	registry.Add("ToneSet/Adpcm/decode/block:256", [](State& state) {
+		const std::vector<float> click = DeviceRateClick();
+		const audio::AdpcmClip clip(click.data(), (uint32_t)click.size());
+		std::vector<float> decoded(256);
+		audio::AdpcmCursor cursor = { 0, 0, 0 };
+		uint32_t position = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			const uint32_t count = min(256u, clip.GetLength() - position);
+			clip.Decode(cursor, position, count, decoded.data());
+			position = position + count == clip.GetLength() ? 0 : position + count;
+			DoNotOptimise(decoded[0]);
+		}
+		state.SetItemsProcessed(256.0);
+	});
+
+	// Starts voices at random offsets and decodes random lengths from there, as a dissolved cached bar or a
+	// stolen and restarted voice would; seek_mismatches counts samples that differ from decoding in one go, and
+	// any fails the run
+	registry.Add("ToneSet/Adpcm/random_access", [](State& state) {
+		const std::vector<float> click = DeviceRateClick();
+		const audio::AdpcmClip clip(click.data(), (uint32_t)click.size());
+		std::vector<float> whole(clip.GetLength());
+		audio::AdpcmCursor cursor = { 0, 0, 0 };
+		clip.Decode(cursor, 0, clip.GetLength(), whole.data());
+
+		std::mt19937 random(46);
+		std::vector<float> piece(clip.GetLength());
+		uint64_t mismatches = 0;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			uint32_t position = random() % clip.GetLength();
+			cursor = { 0, 0, 0 };
+			for (int run = 0; run < 4 && position < clip.GetLength(); run++) {
+				const uint32_t count = min(1 + (uint32_t)(random() % 700), clip.GetLength() - position);
+				clip.Decode(cursor, position, count, piece.data());
+				for (uint32_t s = 0; s < count; s++) {
+					mismatches += piece[s] == whole[position + s] ? 0 : 1;
+				}
+				position += count;
+			}
+		}
+		if (mismatches > 0) {
+			throw std::runtime_error(std::to_string(mismatches) + " samples of the compressed click changed when decoded after a seek");
+		}
+		state.SetItemsProcessed(1.0);
+		state.counters["seek_mismatches"] = (double)mismatches;
+	});
+
+	// Renders each synthesised click whole, then again in blocks of awkward sizes from the same voice position;
+	// split_mismatches counts samples that differ, which must be none for the bar cache and export to match,
+	// so any fails the run
+	const std::pair<const char*, size_t> shapes[] = { { "filtered_sine", 0 }, { "fm_bell", 1 }, { "noise_burst", 2 } };
+	for (const auto& shape : shapes) {
+		const audio::ClickPatch patch = SynthesisedToneSets()[shape.second].accent;
+		registry.Add(std::string("ToneSet/ClickSynth/") + shape.first, [patch](State& state) {
+			const audio::ClickSynth synth(patch, DeviceRate);
+			std::vector<float> whole(synth.GetLength());
+			for (uint64_t i = 0; i < state.iterations; i++) {
+				synth.Render(0, synth.GetLength(), whole.data());
+				DoNotOptimise(whole[0]);
+			}
+
+			std::vector<float> split(synth.GetLength());
+			const uint32_t blockSizes[] = { 1, 37, 64, 441, 129, 3 };
+			for (uint32_t position = 0, block = 0; position < synth.GetLength(); block++) {
+				const uint32_t count = min(blockSizes[block % 6], synth.GetLength() - position);
+				synth.Render(position, count, split.data() + position);
+				position += count;
+			}
+			uint64_t mismatches = 0;
+			float peak = 0.0f;
+			for (uint32_t s = 0; s < synth.GetLength(); s++) {
+				mismatches += whole[s] == split[s] ? 0 : 1;
+				peak = max(peak, fabsf(whole[s]));
+			}
+			if (mismatches > 0) {
+				throw std::runtime_error(std::to_string(mismatches) + " samples of the synthesised click changed when rendered in blocks");
+			}
+			state.SetItemsProcessed((double)synth.GetLength());
+			state.counters["split_mismatches"] = (double)mismatches;
+			state.counters["peak"] = peak;
+			state.counters["length_ms"] = 1000.0 * synth.GetLength() / DeviceRate;
+		});
+	}
+
+	// Cycles through the tone sets on every block while playing quickly enough that clicks overlap
+	registry.Add("ToneSet/SwitchWhilePlaying/block:256", [](State& state) {
+		audio::ToneSetPool pool(DeviceRate);
+		AddSourceToneSets(pool);
+		audio::AudioEngine engine(DeviceRate, 2);
+		engine.SetTempo(300.0);
+		engine.Play();
+
+		// Without the bar cache, which would otherwise be rebuilt on every switch and dominate the timing
+		engine.SetBarCacheEnabled(false);
+		audio::NullSink sink(DeviceRate, 2, 256);
+		sink.Start(&engine);
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			engine.SetToneSet(pool.GetToneSet(i % pool.GetToneSetCount()));
+			sink.Pump(256);
+		}
+		sink.Stop();
+		DoNotOptimise(sink.GetLastBlock()[0]);
+		state.SetItemsProcessed(256.0);
+	});
+}
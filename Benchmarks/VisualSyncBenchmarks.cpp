@@ -0,0 +1,188 @@
+#include "pch.h"
+#include "Workloads.h"
+
+#include "Audio/AudioEngine.h"
+#include "Audio/VisualBeatSync.h"
+#include "Audio/Sinks/NullSink.h"
+#include "Common/StepTimer.h"
+
+#include <random>
+
+namespace {
+
+	const uint32_t SampleRate = 48000;
+	const uint32_t BlockFrames = 256;
+	const uint32_t BufferCount = 3;
+	const uint64_t ClockFrequency = 10000000;  // FakeClock's default
+
+	// A device whose crystal runs 100 ppm fast against the host clock, audio callbacks running up to 2ms late,
+	// UI updates up to 1ms late, and a 59.94 Hz display
+	const double DeviceSkew = 100e-6;
+	const double CallbackJitterSeconds = 0.002;
+	const double UpdateJitterSeconds = 0.001;
+	const double RefreshSeconds = 1001.0 / 60000.0;
+	const double SecondsPerBeat = 0.5;
+
+	// A flash can only show on a frame, so with the sound it lands within half a refresh either way. Following
+	// the audio clock, 95% of flashes must show within a whole refresh of their click.
+	const double MaxP95OffsetSeconds = RefreshSeconds;
+
+	struct SyncResult {
+		std::vector<double> trueOffsets;
+		audio::SyncOffsetStatistics::Summary measured;
+	};
+
+	uint64_t ToCounts(double seconds)
+	{
+		return (uint64_t)llround(seconds * ClockFrequency);
+	}
+
+	void AdvanceTo(DX::FakeClock& clock, uint64_t counter)
+	{
+		clock.Advance(counter - clock.GetCounter());
+	}
+
+	// When a click at this sample is actually heard, playing from the start. The sink renders three buffers at
+	// the start and each later one as the buffer three before it finishes, so from the fourth block on each is
+	// heard two blocks after it is rendered.
+	double HeardSeconds(uint64_t sample)
+	{
+		return (double)sample / (SampleRate * (1.0 + DeviceSkew));
+	}
+
+	double RenderSeconds(uint64_t block)
+	{
+		return block < BufferCount ? 0.0 : HeardSeconds((block - (BufferCount - 1)) * BlockFrames);
+	}
+
+	// Plays the metronome at 120 BPM, rendering blocks and updating the sync in host-time order, and compares the
+	// frame each flash first shows in with when its click is heard
+	SyncResult RunAudioClockSync(double seconds)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+		audio::BasicVisualBeatSync<DX::FakeClock> sync;
+		sync.SetOutputLatencyFrames((BufferCount - 1) * BlockFrames);
+		sync.SetDisplayLatencySeconds(RefreshSeconds);
+		audio::AudioEngine engine(SampleRate, 2);
+		engine.SetHostClock(&sync.GetClock());
+		audio::NullSink sink(SampleRate, 2, BlockFrames);
+		sink.Start(&engine);
+		engine.Play();
+
+		SyncResult result{};
+		uint64_t block = 0;
+		uint64_t renderCounter = 0;
+		uint64_t frame = 0;
+		uint64_t updateCounter = 0;
+		uint64_t flashCount = 0;
+		while (frame * RefreshSeconds < seconds) {
+			if (renderCounter <= updateCounter) {
+				AdvanceTo(sync.GetClock(), renderCounter);
+				sink.Pump(BlockFrames);
+				block++;
+				renderCounter = ToCounts(RenderSeconds(block) + (block < BufferCount ? 0.0 : CallbackJitterSeconds * unit(random)));
+				continue;
+			}
+			AdvanceTo(sync.GetClock(), updateCounter);
+			sync.Update(engine.GetPlaybackSnapshot());
+			if (sync.GetFlashCount() != flashCount) {
+				flashCount = sync.GetFlashCount();
+				const double shownSeconds = (frame + 1) * RefreshSeconds;
+				result.trueOffsets.push_back(shownSeconds - HeardSeconds(sync.GetFlashOnset().sample));
+			}
+			frame++;
+			updateCounter = ToCounts(frame * RefreshSeconds + UpdateJitterSeconds * unit(random));
+		}
+		result.measured = sync.GetOffsetStatistics().GetSummary();
+		return result;
+	}
+
+	// The same, with the scene counting beats from frame times alone, from Play on the first frame
+	SyncResult RunFrameClockSync(double seconds)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+		DX::BasicStepTimer<DX::FakeClock> timer;
+		SyncResult result{};
+		uint64_t nextBeat = 0;
+		for (uint64_t frame = 0; frame * RefreshSeconds < seconds; frame++) {
+			AdvanceTo(timer.GetClock(), ToCounts(frame * RefreshSeconds + UpdateJitterSeconds * unit(random)));
+			timer.Tick([]() {});
+			const double shownAtSeconds = timer.GetTotalSeconds() + RefreshSeconds;
+			if (shownAtSeconds + 0.5 * RefreshSeconds >= nextBeat * SecondsPerBeat) {
+				const uint64_t sample = nextBeat * (uint64_t)(SecondsPerBeat * SampleRate);
+				result.trueOffsets.push_back((frame + 1) * RefreshSeconds - HeardSeconds(sample));
+				nextBeat++;
+			}
+		}
+		return result;
+	}
+
+	// Returns the p95 of the offsets' magnitudes
+	double ReportOffsets(bench::State& state, std::vector<double> offsets)
+	{
+		double sum = 0.0;
+		for (double offset : offsets) {
+			sum += offset;
+		}
+		for (double& offset : offsets) {
+			offset = fabs(offset);
+		}
+		std::sort(offsets.begin(), offsets.end());
+		state.counters["flashes"] = (double)offsets.size();
+		state.counters["mean_offset_ms"] = 1000.0 * sum / offsets.size();
+		const double p95 = offsets[(offsets.size() * 95 + 99) / 100 - 1];
+		state.counters["p95_abs_offset_ms"] = 1000.0 * p95;
+		state.counters["max_abs_offset_ms"] = 1000.0 * offsets.back();
+		return p95;
+	}
+}
+
+void bench::RegisterVisualSyncBenchmarks(Registry& registry)
+{
+	// Per-frame cost on the UI thread of reading the snapshot and working out the flash
+	registry.Add("VisualSync/Update", [](State& state) {
+		audio::BasicVisualBeatSync<DX::FakeClock> sync;
+		audio::AudioEngine engine(SampleRate, 2);
+		engine.SetHostClock(&sync.GetClock());
+		audio::NullSink sink(SampleRate, 2, BlockFrames);
+		sink.Start(&engine);
+		engine.Play();
+		sink.Pump(BlockFrames);
+		float total = 0.0f;
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			sync.GetClock().Advance(ToCounts(RefreshSeconds));
+			sync.Update(engine.GetPlaybackSnapshot());
+			total += sync.GetFlashIntensity();
+		}
+		DoNotOptimise(total);
+		state.SetItemsProcessed(1.0);
+	});
+
+	// True offsets compare the frame a flash first shows in with when its click is heard; measured ones are what
+	// the sync itself records, from the snapshots alone. Either p95 beyond the bound fails the run.
+	registry.Add("VisualSync/Accuracy/audio_clock/10min", [](State& state) {
+		SyncResult result{};
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			result = RunAudioClockSync(600.0);
+		}
+		const double trueP95 = ReportOffsets(state, result.trueOffsets);
+		state.counters["measured_mean_offset_ms"] = 1000.0 * result.measured.mean;
+		state.counters["measured_stddev_offset_ms"] = 1000.0 * result.measured.standardDeviation;
+		state.counters["measured_p95_abs_offset_ms"] = 1000.0 * result.measured.p95Magnitude;
+		if (trueP95 > MaxP95OffsetSeconds || result.measured.p95Magnitude > MaxP95OffsetSeconds) {
+			throw std::runtime_error("p95 offsets of " + std::to_string(1000.0 * trueP95) + " ms true and "
+				+ std::to_string(1000.0 * result.measured.p95Magnitude) + " ms measured exceed a refresh");
+		}
+	});
+
+	// The frame clock is the drift the sync replaces, so its offsets are reported without a bound
+	registry.Add("VisualSync/Accuracy/frame_clock/10min", [](State& state) {
+		SyncResult result{};
+		for (uint64_t i = 0; i < state.iterations; i++) {
+			result = RunFrameClockSync(600.0);
+		}
+		ReportOffsets(state, result.trueOffsets);
+	});
+}
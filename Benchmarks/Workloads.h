@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Harness.h"
+
+namespace bench {
+
+	// Window sizes (in pixels) covering phones through to 4K desktops, in both orientations
+	inline const std::vector<winrt::Windows::Foundation::Size>& WindowSizes() {
+		static const std::vector<winrt::Windows::Foundation::Size> sizes = {
+			{ 360.0f, 640.0f }, { 640.0f, 360.0f }, { 375.0f, 812.0f }, { 812.0f, 375.0f },
+			{ 768.0f, 1024.0f }, { 1024.0f, 768.0f }, { 800.0f, 600.0f }, { 1280.0f, 720.0f },
+			{ 1280.0f, 800.0f }, { 1366.0f, 768.0f }, { 1440.0f, 900.0f }, { 1536.0f, 864.0f },
+			{ 1600.0f, 900.0f }, { 1680.0f, 1050.0f }, { 1920.0f, 1080.0f }, { 1920.0f, 1200.0f },
+			{ 2560.0f, 1440.0f }, { 2560.0f, 1600.0f }, { 3440.0f, 1440.0f }, { 3840.0f, 2160.0f }
+		};
+		return sizes;
+	}
+
+	// Effective DPIs at 100%, 150%, 200% and 300% display scaling
+	inline const std::vector<float>& Dpis() {
+		static const std::vector<float> dpis = { 96.0f, 144.0f, 192.0f, 288.0f };
+		return dpis;
+	}
+
+	void RegisterAudioBenchmarks(Registry& registry);
+	void RegisterBeatGridBenchmarks(Registry& registry);
+	void RegisterFontBenchmarks(Registry& registry);
+	void RegisterGeometryBenchmarks(Registry& registry);
+	void RegisterHitTestBenchmarks(Registry& registry);
+	void RegisterMidiBenchmarks(Registry& registry);
+	void RegisterNotationBenchmarks(Registry& registry);
+	void RegisterOnsetBenchmarks(Registry& registry);
+	void RegisterPlaybackStateBenchmarks(Registry& registry);
+	void RegisterRealtimeBenchmarks(Registry& registry);
+	void RegisterSessionBenchmarks(Registry& registry);
+	void RegisterSongBenchmarks(Registry& registry);
+	void RegisterTapTempoBenchmarks(Registry& registry);
+	void RegisterTempoRampBenchmarks(Registry& registry);
+	void RegisterTextureBenchmarks(Registry& registry);
+	void RegisterTimerBenchmarks(Registry& registry);
+	void RegisterToneSetBenchmarks(Registry& registry);
+	void RegisterVisualSyncBenchmarks(Registry& registry);
+}
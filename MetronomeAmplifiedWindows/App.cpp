@@ -167,5 +167,9 @@ void MetronomeAmplifiedWindows::App::OnPointerPressed(winrt::Windows::UI::Core::
 	winrt::Windows::Foundation::Size size = m_deviceResources->GetOutputSize();
 	float normalisedX = 2.0f * position.x / size.Width - 1.0f;
 	float normalisedY = -2.0f * position.y / size.Height + 1.0f;
-	m_main->OnPointerPressed(normalisedX, normalisedY);
+
+	// The pointer's timestamp, in microseconds, is when the input happened, which can be a frame or more before
+	// this handler runs
+	double inputSeconds = (double)args.CurrentPoint().Timestamp() / 1.0e6;
+	m_main->OnPointerPressed(normalisedX, normalisedY, inputSeconds);
 }
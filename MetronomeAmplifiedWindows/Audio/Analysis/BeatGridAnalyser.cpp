@@ -0,0 +1,645 @@
+#include "pch.h"
+#include "BeatGridAnalyser.h"
+#include "OnsetDetector.h"
+#include "RealFft.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+	const double Pi = 3.14159265358979323846;
+
+	// Candidate tempos are this far apart before refining, and the comb looks at this many multiples of each
+	const double TempoStepBeatsPerMinute = 0.5;
+	const int CombMultiples = 4;
+
+	// The envelope less its mean over this long either side of each hop, which leaves just the rises
+	const double NoiseFloorSeconds = 0.1;
+
+	// A grid's period is refined this far either side of the comb's, then again around the best of those
+	const double PeriodSearchRatio = 0.015;
+	const int PeriodSearchSteps = 30;
+
+	// The grid's phase is then moved up to this many hops either way, in this many steps each way
+	const double PhaseSearchHops = 4.0;
+	const int PhaseSearchSteps = 16;
+
+	// Metres a section is tried in
+	const int Metres[] = { 3, 4 };
+
+	// Chunks shared between the thread decoding them and the workers computing their envelopes
+	struct EnvelopeQueue {
+		std::mutex mutex;
+		std::condition_variable chunkQueued;
+		std::condition_variable chunkDone;
+		std::vector<std::vector<float>> samples;
+		std::vector<std::vector<float>> flux;
+		std::vector<std::vector<float>> lowBandFlux;
+		size_t nextChunk;
+		size_t doneCount;
+		uint64_t bufferedFrames;
+		bool isFinished;
+		bool isCancelled;
+		std::exception_ptr error;
+	};
+
+	// A run of windows at one tempo, and the grid found for it, in hops of the envelope
+	struct Segment {
+		size_t firstWindow;
+		size_t endWindow;
+		double beatsPerMinute;
+		double start;
+		double end;
+		double period;
+		double phase;
+		int beatsPerBar;
+		int downbeat;
+	};
+
+	std::vector<float> FindNovelty(const std::vector<float>& flux, size_t radius)
+	{
+		std::vector<double> sums(flux.size() + 1, 0.0);
+		for (size_t i = 0; i < flux.size(); i++) {
+			sums[i + 1] = sums[i] + flux[i];
+		}
+		std::vector<float> novelty(flux.size());
+		for (size_t i = 0; i < flux.size(); i++) {
+			const size_t first = i > radius ? i - radius : 0;
+			const size_t end = min(flux.size(), i + radius + 1);
+			const double mean = (sums[end] - sums[first]) / (double)(end - first);
+			novelty[i] = (float)max(0.0, flux[i] - mean);
+		}
+		return novelty;
+	}
+
+	// Largest novelty within a hop of a position, so that a beat between hops still finds its onset
+	double GetStrength(const std::vector<float>& novelty, double hop)
+	{
+		const int64_t centre = llround(hop);
+		double strength = 0.0;
+		for (int64_t i = max((int64_t)0, centre - 1); i <= centre + 1 && i < (int64_t)novelty.size(); i++) {
+			strength = max(strength, (double)novelty[(size_t)i]);
+		}
+		return strength;
+	}
+
+	// Autocorrelation of a window of the novelty, by the FFT of its power spectrum, divided by the number of
+	// products at each lag and normalised to one at lag zero. The FFT is at least twice the window, so that the
+	// correlation does not wrap round.
+	void Autocorrelate(const float* window, size_t length, audio::RealFft& fft, std::vector<float>& work, std::vector<float>& real, std::vector<float>& imaginary, std::vector<double>& correlation)
+	{
+		const size_t size = fft.GetSize();
+		double mean = 0.0;
+		for (size_t i = 0; i < length; i++) {
+			mean += window[i];
+		}
+		mean /= (double)length;
+		std::fill(work.begin(), work.end(), 0.0f);
+		for (size_t i = 0; i < length; i++) {
+			work[i] = (float)(window[i] - mean);
+		}
+		fft.Transform(work.data(), real.data(), imaginary.data());
+
+		// The power spectrum is real and even, so its forward transform is its inverse, times the size
+		for (size_t bin = 0; bin <= size / 2; bin++) {
+			work[bin] = real[bin] * real[bin] + imaginary[bin] * imaginary[bin];
+		}
+		for (size_t bin = 1; bin < size / 2; bin++) {
+			work[size - bin] = work[bin];
+		}
+		fft.Transform(work.data(), real.data(), imaginary.data());
+		correlation.assign(length / 2, 0.0);
+		for (size_t lag = 0; lag < correlation.size(); lag++) {
+			correlation[lag] = (double)real[lag] / (double)(length - lag);
+		}
+		if (correlation[0] > 0.0) {
+			const double scale = 1.0 / correlation[0];
+			for (double& value : correlation) {
+				value *= scale;
+			}
+		}
+	}
+
+	template<typename T>
+	double Interpolate(const std::vector<T>& values, double position)
+	{
+		if (position < 0.0) {
+			return 0.0;
+		}
+		const size_t index = (size_t)position;
+		if (index + 1 >= values.size()) {
+			return 0.0;
+		}
+		const double fraction = position - (double)index;
+		return values[index] + (values[index + 1] - values[index]) * fraction;
+	}
+
+	// Strength of the novelty's component at a beat period, over a stretch of it, and where that puts the beats
+	double MeasurePeriod(const std::vector<float>& novelty, size_t first, size_t end, double period, double& phase)
+	{
+		const double angle = -2.0 * Pi / period;
+		const double stepReal = cos(angle);
+		const double stepImaginary = sin(angle);
+		double rotationReal = cos(angle * (double)first);
+		double rotationImaginary = sin(angle * (double)first);
+		double sumReal = 0.0;
+		double sumImaginary = 0.0;
+		for (size_t i = first; i < end; i++) {
+			sumReal += novelty[i] * rotationReal;
+			sumImaginary += novelty[i] * rotationImaginary;
+			const double nextReal = rotationReal * stepReal - rotationImaginary * stepImaginary;
+			rotationImaginary = rotationReal * stepImaginary + rotationImaginary * stepReal;
+			rotationReal = nextReal;
+		}
+
+		// Pulses at phase + k * period sum to a multiple of e^(-2 pi i phase / period)
+		phase = fmod(-atan2(sumImaginary, sumReal) / (2.0 * Pi) * period + period, period);
+		return hypot(sumReal, sumImaginary);
+	}
+
+	// Refines a segment's period around the comb's, then finds its phase, metre and downbeat
+	void FitGrid(const std::vector<float>& novelty, const std::vector<float>& lowBandNovelty, double sampleRate, size_t first, size_t end, Segment& segment)
+	{
+		const double comb = 60.0 * sampleRate / segment.beatsPerMinute;
+		double best = -1.0;
+		double period = comb;
+		double range = PeriodSearchRatio * comb;
+		for (int pass = 0; pass < 2; pass++) {
+			const double centre = period;
+			for (int step = -PeriodSearchSteps; step <= PeriodSearchSteps; step++) {
+				const double candidate = centre + range * step / PeriodSearchSteps;
+				double phase;
+				const double strength = MeasurePeriod(novelty, first, end, candidate, phase);
+				if (strength > best) {
+					best = strength;
+					period = candidate;
+				}
+			}
+			range /= PeriodSearchSteps;
+		}
+		segment.period = period;
+		MeasurePeriod(novelty, first, end, period, segment.phase);
+
+		// That phase is of the component's centre, which trails the onsets by however long they ring, so the
+		// grid is then moved to where its beats land on the peaks themselves
+		double bestSum = -1.0;
+		double bestShift = 0.0;
+		for (int step = -PhaseSearchSteps; step <= PhaseSearchSteps; step++) {
+			const double shift = PhaseSearchHops * step / PhaseSearchSteps;
+			double sum = 0.0;
+			for (double beat = segment.phase + shift + ceil(((double)first - segment.phase - shift) / period) * period; beat < (double)end; beat += period) {
+				sum += Interpolate(novelty, beat);
+			}
+			if (sum > bestSum) {
+				bestSum = sum;
+				bestShift = shift;
+			}
+		}
+		segment.phase = fmod(segment.phase + bestShift + period, period);
+
+		// The metre and downbeat whose beats stand out most from the others, in both bands, each relative to
+		// the mean of its beats. A backbeat is often the loudest hit over all bins, but the low band only has it
+		// in the kick and bass that start the bar.
+		const int64_t firstBeat = (int64_t)ceil(((double)first - segment.phase) / period);
+		const int64_t endBeat = (int64_t)ceil(((double)end - segment.phase) / period);
+		const std::vector<float>* bands[] = { &novelty, &lowBandNovelty };
+		std::vector<double> strengths[2];
+		double means[2] = { 0.0, 0.0 };
+		for (int band = 0; band < 2; band++) {
+			for (int64_t beat = firstBeat; beat < endBeat; beat++) {
+				strengths[band].push_back(GetStrength(*bands[band], segment.phase + (double)beat * period));
+				means[band] += strengths[band].back();
+			}
+			means[band] = means[band] > 0.0 ? means[band] / (double)strengths[band].size() : 1.0;
+		}
+		double bestContrast = -INFINITY;
+		segment.beatsPerBar = 4;
+		segment.downbeat = 0;
+		for (int metre : Metres) {
+			for (int downbeat = 0; downbeat < metre; downbeat++) {
+				double contrast = 0.0;
+				for (int band = 0; band < 2; band++) {
+					double accented = 0.0;
+					double others = 0.0;
+					int64_t accentedCount = 0;
+					for (int64_t beat = firstBeat; beat < endBeat; beat++) {
+						const double strength = strengths[band][(size_t)(beat - firstBeat)];
+						if (((beat % metre) + metre) % metre == downbeat) {
+							accented += strength;
+							accentedCount++;
+						} else {
+							others += strength;
+						}
+					}
+					const int64_t otherCount = endBeat - firstBeat - accentedCount;
+					if (accentedCount > 0 && otherCount > 0) {
+						contrast += (accented / (double)accentedCount - others / (double)otherCount) / means[band];
+					}
+				}
+				if (contrast > bestContrast) {
+					bestContrast = contrast;
+					segment.beatsPerBar = metre;
+					segment.downbeat = downbeat;
+				}
+			}
+		}
+	}
+
+	// Position of the segment's downbeat at or after the given hop
+	double GetNextDownbeat(const Segment& segment, double hop)
+	{
+		const double bar = segment.period * segment.beatsPerBar;
+		const double origin = segment.phase + segment.downbeat * segment.period;
+		return origin + ceil((hop - origin) / bar - 1e-9) * bar;
+	}
+
+	// How well a grid fits between two hops: the novelty at its beats, less what beats anywhere would get
+	double ScoreBeats(const std::vector<float>& novelty, const Segment& segment, double from, double to, double baseline)
+	{
+		double score = 0.0;
+		for (double beat = segment.phase + ceil((from - segment.phase) / segment.period) * segment.period; beat < to; beat += segment.period) {
+			score += GetStrength(novelty, beat) - baseline;
+		}
+		return score;
+	}
+}
+
+audio::Song audio::BeatGrid::ToSong(const std::string& name) const
+{
+	Song song;
+	song.name = name;
+	for (size_t i = 0; i < sections.size(); i++) {
+		const BeatGridSection& section = sections[i];
+		SongSection songSection = { "Section " + std::to_string(i + 1), section.beatsPerBar, 4, 1, section.barCount, section.beatsPerMinute, {} };
+		for (int beat = 0; beat < section.beatsPerBar; beat++) {
+			songSection.pattern.push_back(beat == 0 ? PatternNote::ACCENT : PatternNote::NORMAL);
+		}
+		song.sections.push_back(songSection);
+	}
+	return song;
+}
+
+audio::BeatGridAnalyser::BeatGridAnalyser() :
+	m_threadCount(0),
+	m_peakBufferedFrames(0)
+{
+}
+
+void audio::BeatGridAnalyser::SetThreadCount(int threadCount)
+{
+	m_threadCount = max(0, threadCount);
+}
+
+int audio::BeatGridAnalyser::GetThreadCount() const
+{
+	const int threadCount = m_threadCount > 0 ? m_threadCount : (int)std::thread::hardware_concurrency();
+	return max(1, threadCount);
+}
+
+audio::BeatGrid audio::BeatGridAnalyser::Analyse(const byte* data, size_t size)
+{
+	StreamingDecoder decoder(data, size);
+	return FindBeats(ComputeEnvelope(decoder));
+}
+
+audio::OnsetEnvelope audio::BeatGridAnalyser::ComputeEnvelope(StreamingDecoder& decoder)
+{
+	const uint32_t sampleRate = decoder.GetSampleRate();
+	const uint32_t channelCount = decoder.GetChannelCount();
+	const OnsetDetector sizing(sampleRate);
+	const uint32_t hopSize = sizing.GetHopSize();
+	const uint32_t overlapHops = OnsetDetector::HopsPerFrame + 1;
+	const size_t overlap = (size_t)overlapHops * hopSize;
+	const size_t chunkFrames = (size_t)((uint64_t)ChunkSeconds * sampleRate / hopSize) * hopSize;
+	const size_t maxInFlight = ChunksInFlightPerThread * GetThreadCount();
+
+	EnvelopeQueue queue;
+	queue.nextChunk = 0;
+	queue.doneCount = 0;
+	queue.bufferedFrames = 0;
+	queue.isFinished = false;
+	queue.isCancelled = false;
+	m_peakBufferedFrames = 0;
+
+	// Each worker keeps one detector for all of its chunks. A chunk's first overlapHops hops only fill the
+	// detector's frame and previous spectrum, so their flux is left out.
+	auto computeChunks = [&queue, sampleRate, hopSize, overlapHops]() {
+		try {
+			OnsetDetector detector(sampleRate);
+			while (true) {
+				size_t chunkIndex;
+				std::vector<float> samples;
+				{
+					std::unique_lock<std::mutex> lock(queue.mutex);
+					queue.chunkQueued.wait(lock, [&queue]() {
+						return queue.isCancelled || queue.isFinished || queue.nextChunk < queue.samples.size();
+					});
+					if (queue.isCancelled || queue.nextChunk >= queue.samples.size()) {
+						return;
+					}
+					chunkIndex = queue.nextChunk++;
+					samples.swap(queue.samples[chunkIndex]);
+				}
+
+				detector.Reset();
+				const size_t hopCount = samples.size() / hopSize;
+				std::vector<float> flux(hopCount - overlapHops);
+				std::vector<float> lowBandFlux(hopCount - overlapHops);
+				for (size_t hop = 0; hop < hopCount; hop++) {
+					const float value = detector.TakeHop(samples.data() + hop * hopSize);
+					if (hop >= overlapHops) {
+						flux[hop - overlapHops] = value;
+						lowBandFlux[hop - overlapHops] = detector.GetLowBandFlux();
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.flux[chunkIndex] = std::move(flux);
+				queue.lowBandFlux[chunkIndex] = std::move(lowBandFlux);
+				queue.doneCount++;
+				queue.bufferedFrames -= samples.size();
+				queue.chunkDone.notify_all();
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.error) {
+				queue.error = std::current_exception();
+			}
+			queue.isCancelled = true;
+			queue.chunkDone.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < GetThreadCount(); i++) {
+		workers.emplace_back(computeChunks);
+	}
+
+	// The first chunk is preceded by silence, as a single pass would start from
+	auto queueChunk = [this, &queue, maxInFlight](std::vector<float>&& samples, size_t heldFrames) {
+		std::unique_lock<std::mutex> lock(queue.mutex);
+		queue.chunkDone.wait(lock, [&queue, maxInFlight]() { return queue.isCancelled || queue.samples.size() - queue.doneCount < maxInFlight; });
+		if (queue.isCancelled) {
+			return;
+		}
+		queue.bufferedFrames += samples.size();
+		m_peakBufferedFrames = max(m_peakBufferedFrames, queue.bufferedFrames + heldFrames);
+		queue.samples.push_back(std::move(samples));
+		queue.flux.emplace_back();
+		queue.lowBandFlux.emplace_back();
+		queue.chunkQueued.notify_one();
+	};
+	try {
+		std::vector<float> block;
+		std::vector<float> pending(overlap, 0.0f);
+		const float scale = 1.0f / (float)channelCount;
+		while (decoder.ReadBlock(block)) {
+			const size_t frameCount = block.size() / channelCount;
+			for (size_t frame = 0; frame < frameCount; frame++) {
+				float sum = 0.0f;
+				for (uint32_t channel = 0; channel < channelCount; channel++) {
+					sum += block[frame * channelCount + channel];
+				}
+				pending.push_back(sum * scale);
+			}
+			block.clear();
+			while (pending.size() >= overlap + chunkFrames) {
+				std::vector<float> chunk(pending.begin(), pending.begin() + overlap + chunkFrames);
+				pending.erase(pending.begin(), pending.begin() + chunkFrames);
+				queueChunk(std::move(chunk), pending.size());
+			}
+		}
+		if (pending.size() > overlap) {
+			pending.resize(overlap + (pending.size() - overlap + hopSize - 1) / hopSize * hopSize, 0.0f);
+			queueChunk(std::move(pending), 0);
+		}
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.error) {
+			queue.error = std::current_exception();
+		}
+		queue.isCancelled = true;
+	}
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.isFinished = true;
+		queue.chunkQueued.notify_all();
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	if (queue.error) {
+		std::rethrow_exception(queue.error);
+	}
+
+	OnsetEnvelope envelope = { sampleRate, hopSize, sizing.GetFrameSize(), decoder.GetFramesRead(), {}, {} };
+	for (size_t chunk = 0; chunk < queue.flux.size(); chunk++) {
+		envelope.flux.insert(envelope.flux.end(), queue.flux[chunk].begin(), queue.flux[chunk].end());
+		envelope.lowBandFlux.insert(envelope.lowBandFlux.end(), queue.lowBandFlux[chunk].begin(), queue.lowBandFlux[chunk].end());
+	}
+	return envelope;
+}
+
+audio::BeatGrid audio::BeatGridAnalyser::FindBeats(const OnsetEnvelope& envelope) const
+{
+	const double hopRate = (double)envelope.sampleRate / envelope.hopSize;
+	const size_t hopCount = envelope.flux.size();
+	const size_t windowHops = (size_t)llround(WindowSeconds * hopRate);
+	if (hopCount < windowHops / 2) {
+		throw std::runtime_error("Recording is too short to find a tempo in");
+	}
+	const std::vector<float> novelty = FindNovelty(envelope.flux, (size_t)llround(NoiseFloorSeconds * hopRate));
+	const std::vector<float> lowBandNovelty = FindNovelty(envelope.lowBandFlux, (size_t)llround(NoiseFloorSeconds * hopRate));
+
+	// Overlapping windows, the last of them ending with the envelope
+	const size_t windowLength = min(windowHops, hopCount);
+	const size_t windowStep = (size_t)llround(WindowHopSeconds * hopRate);
+	std::vector<size_t> windowStarts;
+	for (size_t start = 0; start + windowLength <= hopCount; start += windowStep) {
+		windowStarts.push_back(start);
+	}
+	if (windowStarts.back() + windowLength < hopCount) {
+		windowStarts.push_back(hopCount - windowLength);
+	}
+
+	// Comb scores of every candidate tempo in every window, weighted towards the preferred tempo
+	std::vector<double> tempos;
+	std::vector<double> preferences;
+	for (double bpm = MinBeatsPerMinute; bpm <= MaxBeatsPerMinute; bpm += TempoStepBeatsPerMinute) {
+		const double octaves = log2(bpm / PreferredBeatsPerMinute) / PreferenceOctaves;
+		tempos.push_back(bpm);
+		preferences.push_back(exp(-0.5 * octaves * octaves));
+	}
+	uint32_t fftSize = 4;
+	while (fftSize < 2 * windowLength) {
+		fftSize *= 2;
+	}
+	RealFft fft(fftSize);
+	std::vector<float> work(fftSize);
+	std::vector<float> real(fft.GetBinCount());
+	std::vector<float> imaginary(fft.GetBinCount());
+	std::vector<double> correlation;
+	std::vector<std::vector<double>> scores(windowStarts.size(), std::vector<double>(tempos.size()));
+	std::vector<double> windowTempos(windowStarts.size());
+	for (size_t window = 0; window < windowStarts.size(); window++) {
+		Autocorrelate(novelty.data() + windowStarts[window], windowLength, fft, work, real, imaginary, correlation);
+		size_t best = 0;
+		for (size_t i = 0; i < tempos.size(); i++) {
+			const double period = 60.0 * hopRate / tempos[i];
+			double score = 0.0;
+			for (int multiple = 1; multiple <= CombMultiples; multiple++) {
+				score += Interpolate(correlation, period * multiple) / multiple;
+			}
+			scores[window][i] = score * preferences[i];
+			best = scores[window][i] > scores[window][best] ? i : best;
+		}
+		windowTempos[window] = tempos[best];
+	}
+
+	// Runs of windows near one tempo, after a median of three has taken out any single window that strays
+	std::vector<double> smoothed(windowTempos);
+	for (size_t window = 1; window + 1 < windowTempos.size(); window++) {
+		double three[] = { windowTempos[window - 1], windowTempos[window], windowTempos[window + 1] };
+		std::sort(three, three + 3);
+		smoothed[window] = three[1];
+	}
+	const double splitOctaves = log2(1.0 + SectionTempoRatio);
+	std::vector<Segment> segments;
+	for (size_t window = 0; window < smoothed.size(); window++) {
+		if (segments.empty() || fabs(log2(smoothed[window] / segments.back().beatsPerMinute)) > splitOctaves) {
+			segments.push_back({ window, window + 1, smoothed[window], 0.0, 0.0, 0.0, 0.0, 4, 0 });
+		} else {
+			segments.back().endWindow = window + 1;
+		}
+	}
+
+	// Segments too short to be sections join whichever neighbour is nearer in tempo
+	while (segments.size() > 1) {
+		size_t shortest = 0;
+		for (size_t i = 1; i < segments.size(); i++) {
+			if (segments[i].endWindow - segments[i].firstWindow < segments[shortest].endWindow - segments[shortest].firstWindow) {
+				shortest = i;
+			}
+		}
+		if (segments[shortest].endWindow - segments[shortest].firstWindow >= MinSectionWindows) {
+			break;
+		}
+		size_t into = shortest == 0 ? 1 : shortest - 1;
+		if (shortest > 0 && shortest + 1 < segments.size() &&
+			fabs(log2(segments[shortest + 1].beatsPerMinute / segments[shortest].beatsPerMinute)) < fabs(log2(segments[shortest - 1].beatsPerMinute / segments[shortest].beatsPerMinute))) {
+			into = shortest + 1;
+		}
+		segments[into].firstWindow = min(segments[into].firstWindow, segments[shortest].firstWindow);
+		segments[into].endWindow = max(segments[into].endWindow, segments[shortest].endWindow);
+		segments.erase(segments.begin() + shortest);
+	}
+
+	// Each segment's tempo from the scores of all its windows together, refined by a parabola through the best
+	// and its neighbours. Segments meet halfway between the centres of their outermost windows.
+	for (size_t i = 0; i < segments.size(); i++) {
+		Segment& segment = segments[i];
+		std::vector<double> total(tempos.size(), 0.0);
+		for (size_t window = segment.firstWindow; window < segment.endWindow; window++) {
+			for (size_t t = 0; t < tempos.size(); t++) {
+				total[t] += scores[window][t];
+			}
+		}
+		const size_t best = (size_t)(std::max_element(total.begin(), total.end()) - total.begin());
+		double offset = 0.0;
+		if (best > 0 && best + 1 < total.size()) {
+			const double curvature = total[best - 1] - 2.0 * total[best] + total[best + 1];
+			offset = curvature < 0.0 ? 0.5 * (total[best - 1] - total[best + 1]) / curvature : 0.0;
+		}
+		segment.beatsPerMinute = tempos[best] + offset * TempoStepBeatsPerMinute;
+		segment.start = i == 0 ? 0.0 : 0.5 * (double)(windowStarts[segment.firstWindow - 1] + windowStarts[segment.firstWindow] + windowLength);
+		segment.end = i + 1 == segments.size() ? (double)hopCount : 0.5 * (double)(windowStarts[segment.endWindow - 1] + windowStarts[segment.endWindow] + windowLength);
+	}
+
+	// Grids are fitted away from the boundaries, where the windows straddle two tempos
+	for (size_t i = 0; i < segments.size(); i++) {
+		Segment& segment = segments[i];
+		const double margin = 0.5 * (double)windowLength;
+		double first = i == 0 ? segment.start : segment.start + margin;
+		double end = i + 1 == segments.size() ? segment.end : segment.end - margin;
+		if (end - first < 4.0 * 60.0 * hopRate / segment.beatsPerMinute) {
+			first = segment.start;
+			end = segment.end;
+		}
+		FitGrid(novelty, lowBandNovelty, hopRate, (size_t)first, (size_t)end, segment);
+	}
+
+	// Each boundary goes to the downbeat of the later section, within a window of the estimate, that best
+	// splits the stretch around it between the two grids
+	double baseline = 0.0;
+	for (size_t hop = 0; hop < hopCount; hop++) {
+		baseline += GetStrength(novelty, (double)hop);
+	}
+	baseline /= (double)hopCount;
+	std::vector<double> starts(segments.size());
+	for (size_t i = 1; i < segments.size(); i++) {
+		const Segment& before = segments[i - 1];
+		const Segment& after = segments[i];
+		const double estimate = after.start;
+		const double from = max(starts[i - 1], estimate - 1.5 * (double)windowLength);
+		const double to = min((double)hopCount, estimate + 1.5 * (double)windowLength);
+		double bestScore = -INFINITY;
+		starts[i] = GetNextDownbeat(after, estimate);
+		for (double candidate = GetNextDownbeat(after, max(from, estimate - (double)windowLength)); candidate <= estimate + (double)windowLength && candidate < to; candidate += after.period * after.beatsPerBar) {
+			const double score = ScoreBeats(novelty, before, from, candidate, baseline) + ScoreBeats(novelty, after, candidate, to, baseline);
+			if (score > bestScore) {
+				bestScore = score;
+				starts[i] = candidate;
+			}
+		}
+	}
+
+	// The song starts at the downbeat of the bar holding the first clear beat
+	const Segment& opening = segments[0];
+	std::vector<double> strengths;
+	for (double beat = opening.phase; beat < opening.end; beat += opening.period) {
+		strengths.push_back(GetStrength(novelty, beat));
+	}
+	double firstBeat = opening.phase;
+	if (!strengths.empty()) {
+		std::vector<double> sorted(strengths);
+		std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+		const double clearStrength = 0.5 * sorted[sorted.size() / 2];
+		for (size_t beat = 0; beat < strengths.size() && strengths[beat] < clearStrength; beat++) {
+			firstBeat += opening.period;
+		}
+	}
+	starts[0] = GetNextDownbeat(opening, firstBeat - opening.period * opening.beatsPerBar + 1e-6);
+	if (starts[0] < 0.0) {
+		starts[0] += opening.period * opening.beatsPerBar;
+	}
+
+	// Whole bars from each section's start to the next, at the tempo that fits them there exactly; the last
+	// runs to the end of the recording
+	BeatGrid grid = { envelope.sampleRate, envelope.frameCount, {}, {} };
+	const double endSample = (double)envelope.frameCount;
+	for (size_t i = 0; i < segments.size(); i++) {
+		const Segment& segment = segments[i];
+		const double start = envelope.GetSample(starts[i]);
+		const double barSamples = segment.period * segment.beatsPerBar * envelope.hopSize;
+		int barCount;
+		double beatsPerMinute;
+		if (i + 1 < segments.size()) {
+			const double length = envelope.GetSample(starts[i + 1]) - start;
+			barCount = max(1, (int)llround(length / barSamples));
+			beatsPerMinute = 60.0 * envelope.sampleRate * barCount * segment.beatsPerBar / length;
+		} else {
+			barCount = max(1, (int)floor((endSample - start) / barSamples));
+			beatsPerMinute = 60.0 * envelope.sampleRate / (segment.period * envelope.hopSize);
+		}
+		beatsPerMinute = round(beatsPerMinute * 1000.0) / 1000.0;
+		grid.sections.push_back({ start, beatsPerMinute, segment.beatsPerBar, barCount });
+		const double beatSamples = 60.0 * envelope.sampleRate / beatsPerMinute;
+		for (int beat = 0; beat < barCount * segment.beatsPerBar; beat++) {
+			grid.beatSamples.push_back(start + beat * beatSamples);
+		}
+	}
+	return grid;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../Songs/Song.h"
+#include "../ToneSets/AudioDecoder.h"
+
+namespace audio {
+
+	// Spectral flux of a whole file, over all bins and over the low band, one value per hop of an OnsetDetector
+	// at the file's sample rate
+	struct OnsetEnvelope {
+		uint32_t sampleRate;
+		uint32_t hopSize;
+		uint32_t frameSize;
+		uint64_t frameCount;
+		std::vector<float> flux;
+		std::vector<float> lowBandFlux;
+
+		// Where an onset peaking at the given hop lies, as in OnsetDetector::GetFluxSample
+		inline double GetSample(double hop) const { return (hop + 1.0) * hopSize - 0.5 * frameSize; }
+	};
+
+	// A run of bars at one tempo and metre, starting on a downbeat
+	struct BeatGridSection {
+		double startSample;
+		double beatsPerMinute;
+		int beatsPerBar;
+		int barCount;
+	};
+
+	// The beats found in a file. Sections follow one another without gaps, so that a song made from them and
+	// started with the file at the first section's start stays with it to the end.
+	struct BeatGrid {
+		uint32_t sampleRate;
+		uint64_t frameCount;
+		std::vector<BeatGridSection> sections;
+		std::vector<double> beatSamples;
+
+		// One step per beat, accenting each bar's first
+		Song ToSong(const std::string& name) const;
+	};
+
+	// Finds the tempo, metre and downbeats of a recording, for making a song to practise along with it. The file
+	// is decoded a block at a time and cut into chunks of ChunkSeconds, whose onset envelopes a pool of worker
+	// threads computes while the calling thread decodes the next, so only a few chunks are ever held. Each chunk
+	// starts a frame and a hop early, so that the envelope is the same, bit for bit, as one computed in a single
+	// pass. The envelope is then cut into overlapping windows, whose autocorrelations, taken by FFT, are scored
+	// by a comb over the first few multiples of each candidate beat period and weighted towards moderate tempos.
+	// Runs of windows agreeing on a tempo become sections. Each section's period and phase are refined by the
+	// strength of the envelope's component at the beat frequency, its metre and downbeat found from which beats
+	// are accented, over all bins and in the low band where kicks and bass notes mark bars, and its boundary with the next moved to the downbeat where one grid fits better than the
+	// other. Section tempos are then adjusted so that their whole bars span exactly from downbeat to downbeat.
+	class BeatGridAnalyser {
+	public:
+		static const uint32_t ChunkSeconds = 10;
+		static const size_t ChunksInFlightPerThread = 2;
+
+		static constexpr double WindowSeconds = 8.0;
+		static constexpr double WindowHopSeconds = 2.0;
+		static constexpr double MinBeatsPerMinute = 50.0;
+		static constexpr double MaxBeatsPerMinute = 220.0;
+
+		// Tempos are weighted by a log-normal curve with this centre and width in octaves, which settles whether
+		// the beat is the pulse found or twice or half of it
+		static constexpr double PreferredBeatsPerMinute = 120.0;
+		static constexpr double PreferenceOctaves = 1.0;
+
+		// Windows whose tempos differ by more than this ratio belong to different sections, and a section must
+		// span at least this many windows, so that a fill or a break does not make one of its own
+		static constexpr double SectionTempoRatio = 0.04;
+		static const size_t MinSectionWindows = 3;
+
+		BeatGridAnalyser();
+
+		// Zero, the default, uses one thread per hardware thread
+		void SetThreadCount(int threadCount);
+
+		// Throws std::runtime_error if the file cannot be decoded or is too short to hold a tempo
+		BeatGrid Analyse(const byte* data, size_t size);
+
+		// The two halves of Analyse. The decoder is read from where it is to the end.
+		OnsetEnvelope ComputeEnvelope(StreamingDecoder& decoder);
+		BeatGrid FindBeats(const OnsetEnvelope& envelope) const;
+
+		// Most decoded frames held at once during the last ComputeEnvelope, across the chunks in flight
+		inline uint64_t GetPeakBufferedFrames() const { return m_peakBufferedFrames; }
+		int GetThreadCount() const;
+
+	private:
+		int m_threadCount;
+		uint64_t m_peakBufferedFrames;
+	};
+}
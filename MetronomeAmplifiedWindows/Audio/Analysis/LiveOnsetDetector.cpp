@@ -0,0 +1,102 @@
+#include "pch.h"
+#include "LiveOnsetDetector.h"
+
+#include <chrono>
+
+audio::LiveOnsetDetector::LiveOnsetDetector(uint32_t sampleRate) :
+	m_detector(sampleRate),
+	m_ring((size_t)(RingSeconds * sampleRate)),
+	m_onsets(),
+	m_hop(m_detector.GetHopSize()),
+	m_thread(),
+	m_isRunning(false),
+	m_droppedFrameCount(0),
+	m_processedFrameCount(0),
+	m_lostOnsetCount(0),
+	m_busyNanoseconds(0)
+{
+}
+
+audio::LiveOnsetDetector::~LiveOnsetDetector()
+{
+	Stop();
+}
+
+void audio::LiveOnsetDetector::Start()
+{
+	Stop();
+	while (m_ring.Read(m_hop.data(), m_hop.size()) > 0) {
+	}
+	DetectedOnset onset;
+	while (m_onsets.TryPop(onset)) {
+	}
+	m_detector.Reset();
+	m_droppedFrameCount = 0;
+	m_processedFrameCount = 0;
+	m_lostOnsetCount = 0;
+	m_busyNanoseconds = 0;
+	m_isRunning = true;
+	m_thread = std::thread(&LiveOnsetDetector::Run, this);
+}
+
+void audio::LiveOnsetDetector::Stop()
+{
+	m_isRunning = false;
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void audio::LiveOnsetDetector::WriteInput(const float* samples, uint32_t frameCount, uint32_t channelCount)
+{
+	float mixed[MixFrames];
+	const float scale = 1.0f / (float)channelCount;
+	for (uint32_t start = 0; start < frameCount; start += MixFrames) {
+		const uint32_t frames = min(MixFrames, frameCount - start);
+		const float* frame = samples + (size_t)start * channelCount;
+		if (channelCount == 1) {
+			std::copy(frame, frame + frames, mixed);
+		} else {
+			for (uint32_t i = 0; i < frames; i++) {
+				float sum = 0.0f;
+				for (uint32_t channel = 0; channel < channelCount; channel++) {
+					sum += frame[channel];
+				}
+				mixed[i] = sum * scale;
+				frame += channelCount;
+			}
+		}
+		const size_t written = m_ring.Write(mixed, frames);
+		if (written < frames) {
+			m_droppedFrameCount.fetch_add(frames - written, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool audio::LiveOnsetDetector::TryGetOnset(DetectedOnset& onset)
+{
+	return m_onsets.TryPop(onset);
+}
+
+void audio::LiveOnsetDetector::Run()
+{
+	typedef std::chrono::steady_clock Clock;
+	const size_t hopSize = m_hop.size();
+	while (m_isRunning) {
+		if (m_ring.GetReadableCount() < hopSize) {
+			std::this_thread::sleep_for(std::chrono::duration<double>(PollSeconds));
+			continue;
+		}
+		const Clock::time_point start = Clock::now();
+		while (m_ring.GetReadableCount() >= hopSize) {
+			m_ring.Read(m_hop.data(), hopSize);
+			DetectedOnset onset;
+			if (m_detector.ProcessHop(m_hop.data(), onset) && !m_onsets.TryPush(onset)) {
+				m_lostOnsetCount.fetch_add(1, std::memory_order_relaxed);
+			}
+			m_processedFrameCount.fetch_add(hopSize, std::memory_order_relaxed);
+		}
+		const uint64_t busy = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		m_busyNanoseconds.fetch_add(busy, std::memory_order_relaxed);
+	}
+}
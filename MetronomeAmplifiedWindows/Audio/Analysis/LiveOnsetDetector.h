@@ -0,0 +1,60 @@
+#pragma once
+
+#include "OnsetDetector.h"
+#include "SampleRing.h"
+#include "../SpscQueue.h"
+
+#include <atomic>
+#include <thread>
+
+namespace audio {
+
+	// Runs an OnsetDetector on a worker thread of its own, so that the input device's callback only mixes its
+	// block down to mono and copies it into a lock-free ring. The worker takes a hop at a time off the ring,
+	// waiting PollSeconds whenever less than that is in, and passes onsets to the UI through a queue. Input that
+	// does not fit in the ring is dropped and counted; onsets found after a drop are early by that many frames.
+	class LiveOnsetDetector {
+	public:
+		static constexpr double RingSeconds = 1.0;
+		static constexpr double PollSeconds = 0.002;
+		static const size_t OnsetCapacity = 256;
+
+		// Input is mixed down in runs of this many frames at most, on the stack
+		static const uint32_t MixFrames = 256;
+
+		explicit LiveOnsetDetector(uint32_t sampleRate);
+		~LiveOnsetDetector();
+
+		// On the UI thread, while no input is being written. Start begins counting samples from zero again.
+		void Start();
+		void Stop();
+
+		// On the input device's thread. Never blocks or allocates.
+		void WriteInput(const float* samples, uint32_t frameCount, uint32_t channelCount);
+
+		// On the UI thread. Onsets the UI did not take in time for the queue to hold them are counted as lost.
+		bool TryGetOnset(DetectedOnset& onset);
+
+		inline uint32_t GetSampleRate() const { return m_detector.GetSampleRate(); }
+		inline uint64_t GetDroppedFrameCount() const { return m_droppedFrameCount.load(std::memory_order_relaxed); }
+		inline uint64_t GetProcessedFrameCount() const { return m_processedFrameCount.load(std::memory_order_relaxed); }
+		inline uint64_t GetLostOnsetCount() const { return m_lostOnsetCount.load(std::memory_order_relaxed); }
+
+		// Time the worker has spent in the detector, for how much of a core analysis takes
+		inline double GetBusySeconds() const { return 1.0e-9 * (double)m_busyNanoseconds.load(std::memory_order_relaxed); }
+
+	private:
+		OnsetDetector m_detector;
+		SampleRing m_ring;
+		SpscQueue<DetectedOnset, OnsetCapacity> m_onsets;
+		std::vector<float> m_hop;
+		std::thread m_thread;
+		std::atomic<bool> m_isRunning;
+		std::atomic<uint64_t> m_droppedFrameCount;
+		std::atomic<uint64_t> m_processedFrameCount;
+		std::atomic<uint64_t> m_lostOnsetCount;
+		std::atomic<uint64_t> m_busyNanoseconds;
+
+		void Run();
+	};
+}
@@ -0,0 +1,229 @@
+#include "pch.h"
+#include "OnsetDetector.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define ONSET_USE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ONSET_USE_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ONSET_USE_NEON
+#endif
+
+namespace {
+
+	const double Pi = 3.14159265358979323846;
+
+	uint32_t GetFrameSize(uint32_t sampleRate)
+	{
+		uint32_t size = 256;
+		while (size < audio::OnsetDetector::FrameSeconds * sampleRate) {
+			size *= 2;
+		}
+		return size;
+	}
+
+	void MultiplySamples(const float* a, const float* b, uint32_t count, float* destination)
+	{
+		uint32_t i = 0;
+#if defined(ONSET_USE_AVX)
+		for (; i + 8 <= count; i += 8) {
+			_mm256_storeu_ps(destination + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		}
+#elif defined(ONSET_USE_SSE)
+		for (; i + 4 <= count; i += 4) {
+			_mm_storeu_ps(destination + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		}
+#elif defined(ONSET_USE_NEON)
+		for (; i + 4 <= count; i += 4) {
+			vst1q_f32(destination + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+		}
+#endif
+		for (; i < count; i++) {
+			destination[i] = a[i] * b[i];
+		}
+	}
+
+	void ComputePowers(const float* real, const float* imaginary, uint32_t count, float* destination)
+	{
+		uint32_t i = 0;
+#if defined(ONSET_USE_AVX)
+		for (; i + 8 <= count; i += 8) {
+			const __m256 re = _mm256_loadu_ps(real + i);
+			const __m256 im = _mm256_loadu_ps(imaginary + i);
+			_mm256_storeu_ps(destination + i, _mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im)));
+		}
+#elif defined(ONSET_USE_SSE)
+		for (; i + 4 <= count; i += 4) {
+			const __m128 re = _mm_loadu_ps(real + i);
+			const __m128 im = _mm_loadu_ps(imaginary + i);
+			_mm_storeu_ps(destination + i, _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im)));
+		}
+#elif defined(ONSET_USE_NEON)
+		for (; i + 4 <= count; i += 4) {
+			const float32x4_t re = vld1q_f32(real + i);
+			const float32x4_t im = vld1q_f32(imaginary + i);
+			vst1q_f32(destination + i, vmlaq_f32(vmulq_f32(re, re), im, im));
+		}
+#endif
+		for (; i < count; i++) {
+			destination[i] = real[i] * real[i] + imaginary[i] * imaginary[i];
+		}
+	}
+
+	// Sum of how much each value rose from the last, ignoring falls
+	float SumRises(const float* current, const float* previous, uint32_t count)
+	{
+		uint32_t i = 0;
+		float sum = 0.0f;
+#if defined(ONSET_USE_AVX)
+		__m256 sums = _mm256_setzero_ps();
+		for (; i + 8 <= count; i += 8) {
+			const __m256 rise = _mm256_sub_ps(_mm256_loadu_ps(current + i), _mm256_loadu_ps(previous + i));
+			sums = _mm256_add_ps(sums, _mm256_max_ps(rise, _mm256_setzero_ps()));
+		}
+		const __m128 halves = _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+		float lanes[4];
+		_mm_storeu_ps(lanes, halves);
+		sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(ONSET_USE_SSE)
+		__m128 sums = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4) {
+			const __m128 rise = _mm_sub_ps(_mm_loadu_ps(current + i), _mm_loadu_ps(previous + i));
+			sums = _mm_add_ps(sums, _mm_max_ps(rise, _mm_setzero_ps()));
+		}
+		float lanes[4];
+		_mm_storeu_ps(lanes, sums);
+		sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(ONSET_USE_NEON)
+		float32x4_t sums = vdupq_n_f32(0.0f);
+		for (; i + 4 <= count; i += 4) {
+			const float32x4_t rise = vsubq_f32(vld1q_f32(current + i), vld1q_f32(previous + i));
+			sums = vaddq_f32(sums, vmaxq_f32(rise, vdupq_n_f32(0.0f)));
+		}
+		float lanes[4];
+		vst1q_f32(lanes, sums);
+		sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+		for (; i < count; i++) {
+			sum += max(current[i] - previous[i], 0.0f);
+		}
+		return sum;
+	}
+}
+
+audio::OnsetDetector::OnsetDetector(uint32_t sampleRate) :
+	m_sampleRate(sampleRate),
+	m_frameSize(::GetFrameSize(sampleRate)),
+	m_hopSize(m_frameSize / HopsPerFrame),
+	m_fft(m_frameSize),
+	m_window(m_frameSize),
+	m_frame(m_frameSize),
+	m_windowed(m_frameSize),
+	m_real(m_fft.GetBinCount()),
+	m_imaginary(m_fft.GetBinCount()),
+	m_magnitudes(m_fft.GetBinCount()),
+	m_previousMagnitudes(m_fft.GetBinCount()),
+	m_lowBandBinCount(std::clamp((uint32_t)(LowBandHz * m_frameSize / sampleRate), 1u, m_fft.GetBinCount() - 1)),
+	m_lowBandFlux(0.0f),
+	m_flux(),
+	m_hopCount(0),
+	m_peakLevel(0.0f),
+	m_peakDecay((float)pow(0.5, m_hopSize / (PeakHalfLifeSeconds * sampleRate))),
+	m_lastOnsetSample(0.0)
+{
+	// Periodic Hann, which overlaps at a quarter-frame hop without ripple
+	for (uint32_t i = 0; i < m_frameSize; i++) {
+		m_window[i] = (float)(0.5 - 0.5 * cos(2.0 * Pi * i / m_frameSize));
+	}
+	Reset();
+}
+
+void audio::OnsetDetector::Reset()
+{
+	std::fill(m_frame.begin(), m_frame.end(), 0.0f);
+	std::fill(m_previousMagnitudes.begin(), m_previousMagnitudes.end(), 0.0f);
+	m_flux.fill(0.0f);
+	m_lowBandFlux = 0.0f;
+	m_hopCount = 0;
+	m_peakLevel = 0.0f;
+	m_lastOnsetSample = -MinimumIntervalSeconds * m_sampleRate;
+}
+
+bool audio::OnsetDetector::ProcessHop(const float* samples, DetectedOnset& onset)
+{
+	TakeHop(samples);
+	return PickPeak(onset);
+}
+
+float audio::OnsetDetector::TakeHop(const float* samples)
+{
+	std::copy(m_frame.begin() + m_hopSize, m_frame.end(), m_frame.begin());
+	std::copy(samples, samples + m_hopSize, m_frame.end() - m_hopSize);
+	const float flux = ComputeFlux();
+	m_flux[m_hopCount % FluxHistory] = flux;
+	m_peakLevel = max(flux, m_peakLevel * m_peakDecay);
+	m_hopCount++;
+	return flux;
+}
+
+// Mean rise per bin of the compressed magnitudes since the last frame
+float audio::OnsetDetector::ComputeFlux()
+{
+	const uint32_t binCount = m_fft.GetBinCount();
+	MultiplySamples(m_frame.data(), m_window.data(), m_frameSize, m_windowed.data());
+	m_fft.Transform(m_windowed.data(), m_real.data(), m_imaginary.data());
+	ComputePowers(m_real.data(), m_imaginary.data(), binCount, m_magnitudes.data());
+
+	// Scaled so that a full-scale sine's bin has a magnitude of about one
+	const float scale = Compression * 4.0f / m_frameSize;
+	for (uint32_t bin = 0; bin < binCount; bin++) {
+		m_magnitudes[bin] = logf(1.0f + scale * sqrtf(m_magnitudes[bin]));
+	}
+	const float flux = SumRises(m_magnitudes.data(), m_previousMagnitudes.data(), binCount) / binCount;
+	m_lowBandFlux = SumRises(m_magnitudes.data() + 1, m_previousMagnitudes.data() + 1, m_lowBandBinCount) / m_lowBandBinCount;
+	m_magnitudes.swap(m_previousMagnitudes);
+	return flux;
+}
+
+// Looks at the hop LookaheadHops back, now that those after it are in
+bool audio::OnsetDetector::PickPeak(DetectedOnset& onset)
+{
+	if (m_hopCount < 2 * LookaheadHops + 1) {
+		return false;
+	}
+	const uint64_t candidate = m_hopCount - 1 - LookaheadHops;
+	const float flux = GetFlux(candidate);
+	for (uint64_t hop = candidate - LookaheadHops; hop <= candidate + LookaheadHops; hop++) {
+		if (hop < candidate ? GetFlux(hop) >= flux : GetFlux(hop) > flux) {
+			return false;
+		}
+	}
+
+	const uint64_t first = candidate > HistoryHops ? candidate - HistoryHops : 0;
+	float sum = 0.0f;
+	for (uint64_t hop = first; hop <= candidate + LookaheadHops; hop++) {
+		sum += GetFlux(hop);
+	}
+	const float mean = sum / (float)(candidate + LookaheadHops + 1 - first);
+	const float threshold = max(MeanFactor * mean + PeakFactor * m_peakLevel, MinimumFlux);
+	if (flux <= threshold) {
+		return false;
+	}
+
+	// Vertex of the parabola through the peak and its neighbours, in hops from the peak
+	const float before = GetFlux(candidate - 1);
+	const float after = GetFlux(candidate + 1);
+	const float curvature = before - 2.0f * flux + after;
+	const double vertex = curvature < 0.0f ? std::clamp(0.5 * (before - after) / curvature, -0.5, 0.5) : 0.0;
+
+	const double sample = GetFluxSample((double)candidate + vertex);
+	if (sample - m_lastOnsetSample < MinimumIntervalSeconds * m_sampleRate) {
+		return false;
+	}
+	m_lastOnsetSample = sample;
+	onset = { max(sample, 0.0), flux / threshold, GetSamplesProcessed() };
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "RealFft.h"
+
+#include <array>
+
+namespace audio {
+
+	// A note or hit found in the input, at a sample position counted from the detector's last reset
+	struct DetectedOnset {
+		double sample;
+
+		// How far the onset cleared the threshold, as a ratio; 1 is only just
+		float strength;
+
+		// Samples taken in when it was found, so that less the onset's own sample is the detector's latency
+		uint64_t detectedAtSample;
+	};
+
+	// Finds onsets in mono input as it arrives, a hop at a time. Each hop, the latest frame is windowed and
+	// transformed, and its spectral flux taken: how much the log-compressed magnitude of every bin rose since the
+	// last frame, summed. A hop whose flux is the largest of those LookaheadHops either side of it, and clears an
+	// adaptive threshold, is an onset. The threshold follows both the mean flux around the hop, so steady noise
+	// and sustained notes do not trigger it, and a slowly decaying peak level, so the tail of a loud hit does not
+	// either. The peak's position is refined between hops by a parabola through its neighbours. Onsets closer
+	// together than MinimumIntervalSeconds count once. Never allocates after construction.
+	class OnsetDetector {
+	public:
+		static constexpr double FrameSeconds = 0.02;
+		static const uint32_t HopsPerFrame = 4;
+		static const uint32_t LookaheadHops = 2;
+		static const uint32_t HistoryHops = 10;
+		static constexpr double MinimumIntervalSeconds = 0.05;
+		static constexpr double PeakHalfLifeSeconds = 2.0;
+
+		// Magnitudes go through log(1 + Compression * magnitude), which evens out loud and quiet hits
+		static constexpr float Compression = 100.0f;
+
+		// The threshold: this many times the mean flux around the hop, plus this fraction of the peak level,
+		// and never below the floor, which is in mean compressed units per bin
+		static constexpr float MeanFactor = 1.5f;
+		static constexpr float PeakFactor = 0.1f;
+		static constexpr float MinimumFlux = 0.02f;
+
+		// Bins below this make up the low band, where kicks and bass notes show
+		static constexpr float LowBandHz = 160.0f;
+
+		explicit OnsetDetector(uint32_t sampleRate);
+
+		// Takes the next GetHopSize samples and returns true if that found an onset
+		bool ProcessHop(const float* samples, DetectedOnset& onset);
+
+		// Takes the next GetHopSize samples and returns their flux without looking for an onset, for analysis
+		// of the flux itself. The flux of hop h peaks for an onset at sample GetFluxSample(h).
+		float TakeHop(const float* samples);
+		inline double GetFluxSample(double hop) const { return (hop + 1.0) * m_hopSize - 0.5 * m_frameSize; }
+
+		// Flux of the last hop taken over the low band alone, leaving out DC
+		inline float GetLowBandFlux() const { return m_lowBandFlux; }
+		void Reset();
+
+		inline uint32_t GetSampleRate() const { return m_sampleRate; }
+		inline uint32_t GetFrameSize() const { return m_frameSize; }
+		inline uint32_t GetHopSize() const { return m_hopSize; }
+		inline uint64_t GetSamplesProcessed() const { return m_hopCount * m_hopSize; }
+
+	private:
+		static const uint32_t FluxHistory = 16;
+		static_assert(HistoryHops + LookaheadHops + 1 <= FluxHistory, "Flux history too short for the threshold window");
+
+		uint32_t m_sampleRate;
+		uint32_t m_frameSize;
+		uint32_t m_hopSize;
+		RealFft m_fft;
+		std::vector<float> m_window;
+
+		// The latest frame of input, oldest first, and working buffers for its spectrum
+		std::vector<float> m_frame;
+		std::vector<float> m_windowed;
+		std::vector<float> m_real;
+		std::vector<float> m_imaginary;
+		std::vector<float> m_magnitudes;
+		std::vector<float> m_previousMagnitudes;
+		uint32_t m_lowBandBinCount;
+		float m_lowBandFlux;
+
+		// Flux of hop h is at m_flux[h % FluxHistory]
+		std::array<float, FluxHistory> m_flux;
+		uint64_t m_hopCount;
+		float m_peakLevel;
+		float m_peakDecay;
+		double m_lastOnsetSample;
+
+		float ComputeFlux();
+		bool PickPeak(DetectedOnset& onset);
+		inline float GetFlux(uint64_t hop) const { return m_flux[hop % FluxHistory]; }
+	};
+}
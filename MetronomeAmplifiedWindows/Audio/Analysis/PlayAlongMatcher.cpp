@@ -0,0 +1,55 @@
+#include "pch.h"
+#include "PlayAlongMatcher.h"
+
+audio::PlayAlongMatcher::PlayAlongMatcher(const SongTimeline& timeline) :
+	m_timeline(timeline),
+	m_inputOffset(0.0),
+	m_isHit(),
+	m_hitCount(0),
+	m_repeatCount(0),
+	m_offsets()
+{
+	Reset();
+}
+
+void audio::PlayAlongMatcher::Reset()
+{
+	m_isHit.assign(m_timeline.GetEventCount(), false);
+	m_hitCount = 0;
+	m_repeatCount = 0;
+	m_offsets.Reset();
+}
+
+bool audio::PlayAlongMatcher::Match(const DetectedOnset& onset, PlayAlongHit& hit)
+{
+	const size_t eventCount = m_timeline.GetEventCount();
+	if (eventCount == 0) {
+		return false;
+	}
+
+	// The nearest click is either the first at or after the onset or the one before that
+	const double sample = onset.sample + m_inputOffset;
+	const size_t next = m_timeline.FindEvent(sample > 0.0 ? (uint64_t)ceil(sample) : 0);
+	size_t event = min(next, eventCount - 1);
+	uint64_t eventSample = m_timeline.GetEventSample(event);
+	if (next > 0 && next < eventCount && (double)eventSample - sample > sample - (double)m_timeline.GetEventSample(next - 1)) {
+		event = next - 1;
+		eventSample = m_timeline.GetEventSample(event);
+	}
+
+	hit = { event, eventSample, sample - (double)eventSample, m_isHit[event] };
+	if (hit.isRepeat) {
+		m_repeatCount++;
+	} else {
+		m_isHit[event] = true;
+		m_hitCount++;
+		m_offsets.Record(hit.offsetSamples / (double)m_timeline.GetSampleRate());
+	}
+	return true;
+}
+
+uint64_t audio::PlayAlongMatcher::GetMissedCount(uint64_t sample) const
+{
+	const size_t end = min(m_timeline.FindEvent(sample), m_isHit.size());
+	return (uint64_t)std::count(m_isHit.begin(), m_isHit.begin() + end, false);
+}
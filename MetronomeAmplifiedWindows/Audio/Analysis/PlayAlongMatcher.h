@@ -0,0 +1,49 @@
+#pragma once
+
+#include "OnsetDetector.h"
+#include "../VisualBeatSync.h"
+
+namespace audio {
+
+	// The click a played onset was meant for, and how far from it the onset was, positive when late
+	struct PlayAlongHit {
+		size_t event;
+		uint64_t eventSample;
+		double offsetSamples;
+
+		// Another onset was already matched to the same click
+		bool isRepeat;
+	};
+
+	// Matches onsets detected in the input against the clicks of a compiled song, each to the nearest, for
+	// showing a player how far ahead or behind they are. Input samples map to song samples by an offset: the
+	// song sample playing as the input's sample 0 was captured, less the round trip from output to input. Offsets
+	// of first hits on each click are kept in the same statistics visual beat sync keeps, in seconds. On the UI
+	// thread; the timeline must outlive the matcher, and the matcher be reset after the timeline is recompiled.
+	class PlayAlongMatcher {
+	public:
+		explicit PlayAlongMatcher(const SongTimeline& timeline);
+
+		// Onsets before the first click or after the last go to those; a song with no clicks matches nothing
+		bool Match(const DetectedOnset& onset, PlayAlongHit& hit);
+		void Reset();
+
+		inline void SetInputOffset(double samples) { m_inputOffset = samples; }
+		inline double GetInputOffset() const { return m_inputOffset; }
+
+		inline uint64_t GetHitCount() const { return m_hitCount; }
+		inline uint64_t GetRepeatCount() const { return m_repeatCount; }
+		inline const SyncOffsetStatistics& GetOffsetStatistics() const { return m_offsets; }
+
+		// Clicks before the given song sample that nothing was matched to
+		uint64_t GetMissedCount(uint64_t sample) const;
+
+	private:
+		const SongTimeline& m_timeline;
+		double m_inputOffset;
+		std::vector<bool> m_isHit;
+		uint64_t m_hitCount;
+		uint64_t m_repeatCount;
+		SyncOffsetStatistics m_offsets;
+	};
+}
@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "RealFft.h"
+
+namespace {
+
+	const double Pi = 3.14159265358979323846;
+}
+
+audio::RealFft::RealFft(uint32_t size) :
+	m_size(size),
+	m_bitReversal(size / 2),
+	m_cosines(size / 2),
+	m_sines(size / 2),
+	m_workReal(size / 2),
+	m_workImaginary(size / 2)
+{
+	if (size < 4 || (size & (size - 1)) != 0) {
+		throw std::invalid_argument("FFT size must be a power of two of at least 4");
+	}
+	const uint32_t half = size / 2;
+	uint32_t bits = 0;
+	while ((1u << bits) < half) {
+		bits++;
+	}
+	for (uint32_t i = 0; i < half; i++) {
+		uint32_t reversed = 0;
+		for (uint32_t bit = 0; bit < bits; bit++) {
+			reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+		}
+		m_bitReversal[i] = reversed;
+		m_cosines[i] = (float)cos(2.0 * Pi * i / size);
+		m_sines[i] = (float)-sin(2.0 * Pi * i / size);
+	}
+}
+
+void audio::RealFft::Transform(const float* input, float* real, float* imaginary)
+{
+	const uint32_t half = m_size / 2;
+	float* re = m_workReal.data();
+	float* im = m_workImaginary.data();
+
+	// Even samples as the real part and odd ones as the imaginary, in bit-reversed order
+	for (uint32_t i = 0; i < half; i++) {
+		const uint32_t j = m_bitReversal[i];
+		re[j] = input[2 * i];
+		im[j] = input[2 * i + 1];
+	}
+
+	// Butterflies of the half-size transform, whose twiddles are every other one of the full size's
+	for (uint32_t length = 2; length <= half; length *= 2) {
+		const uint32_t span = length / 2;
+		const uint32_t stride = m_size / length;
+		for (uint32_t start = 0; start < half; start += length) {
+			for (uint32_t k = 0; k < span; k++) {
+				const float wr = m_cosines[k * stride];
+				const float wi = m_sines[k * stride];
+				const uint32_t a = start + k;
+				const uint32_t b = a + span;
+				const float tr = re[b] * wr - im[b] * wi;
+				const float ti = re[b] * wi + im[b] * wr;
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+
+	// Split into the spectra of the even and odd samples, E = (Z[k] + conj Z[n-k]) / 2 and
+	// O = (Z[k] - conj Z[n-k]) / 2i, then combine them as X[k] = E + W^k O
+	real[0] = re[0] + im[0];
+	imaginary[0] = 0.0f;
+	real[half] = re[0] - im[0];
+	imaginary[half] = 0.0f;
+	for (uint32_t k = 1; k < half; k++) {
+		const uint32_t mirror = half - k;
+		const float evenReal = 0.5f * (re[k] + re[mirror]);
+		const float evenImaginary = 0.5f * (im[k] - im[mirror]);
+		const float oddReal = 0.5f * (im[k] + im[mirror]);
+		const float oddImaginary = -0.5f * (re[k] - re[mirror]);
+		const float wr = m_cosines[k];
+		const float wi = m_sines[k];
+		real[k] = evenReal + oddReal * wr - oddImaginary * wi;
+		imaginary[k] = evenImaginary + oddReal * wi + oddImaginary * wr;
+	}
+}
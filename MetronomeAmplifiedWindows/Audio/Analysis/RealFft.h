@@ -0,0 +1,31 @@
+#pragma once
+
+namespace audio {
+
+	// Discrete Fourier transform of real input of a fixed power-of-two size. The input is packed into a complex
+	// signal of half the size, transformed by an iterative radix-2 FFT and then split back into the real input's
+	// spectrum, so a transform costs about half what a complex one of the full size would. Tables are built once;
+	// Transform never allocates.
+	class RealFft {
+	public:
+		// Throws std::invalid_argument unless the size is a power of two, at least 4
+		explicit RealFft(uint32_t size);
+
+		// Writes GetBinCount bins, from DC to Nyquist, as separate real and imaginary parts. Not thread-safe, as
+		// it works in buffers of its own.
+		void Transform(const float* input, float* real, float* imaginary);
+
+		inline uint32_t GetSize() const { return m_size; }
+		inline uint32_t GetBinCount() const { return m_size / 2 + 1; }
+
+	private:
+		uint32_t m_size;
+		std::vector<uint32_t> m_bitReversal;
+
+		// e^(-2 pi i k / size) for k below size / 2; the half-size FFT uses every other one
+		std::vector<float> m_cosines;
+		std::vector<float> m_sines;
+		std::vector<float> m_workReal;
+		std::vector<float> m_workImaginary;
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+
+namespace audio {
+
+	// Wait-free single-producer, single-consumer ring of samples, written and read in runs rather than one item
+	// at a time as SpscQueue is. The capacity is rounded up to a power of two and allocated on construction;
+	// neither side ever blocks or allocates after that.
+	class SampleRing {
+	public:
+		explicit SampleRing(size_t minimumCapacity) :
+			m_samples(RoundUpToPowerOfTwo(minimumCapacity)),
+			m_mask(m_samples.size() - 1),
+			m_head(0),
+			m_tail(0)
+		{
+		}
+
+		// Producer side. Writes as much as fits and returns how many samples that was.
+		size_t Write(const float* samples, size_t count) {
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+			const size_t head = m_head.load(std::memory_order_acquire);
+			count = min(count, m_samples.size() - (tail - head));
+			const size_t start = tail & m_mask;
+			const size_t firstRun = min(count, m_samples.size() - start);
+			std::copy(samples, samples + firstRun, m_samples.begin() + start);
+			std::copy(samples + firstRun, samples + count, m_samples.begin());
+			m_tail.store(tail + count, std::memory_order_release);
+			return count;
+		}
+
+		// Consumer side. Reads up to the given count and returns how many samples that was.
+		size_t Read(float* samples, size_t count) {
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			const size_t tail = m_tail.load(std::memory_order_acquire);
+			count = min(count, tail - head);
+			const size_t start = head & m_mask;
+			const size_t firstRun = min(count, m_samples.size() - start);
+			std::copy(m_samples.begin() + start, m_samples.begin() + start + firstRun, samples);
+			std::copy(m_samples.begin(), m_samples.begin() + (count - firstRun), samples + firstRun);
+			m_head.store(head + count, std::memory_order_release);
+			return count;
+		}
+
+		// Consumer side
+		size_t GetReadableCount() const {
+			return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_relaxed);
+		}
+
+		size_t GetCapacity() const { return m_samples.size(); }
+
+	private:
+		std::vector<float> m_samples;
+		size_t m_mask;
+		alignas(64) std::atomic<size_t> m_head;
+		alignas(64) std::atomic<size_t> m_tail;
+
+		static size_t RoundUpToPowerOfTwo(size_t value) {
+			size_t capacity = 1;
+			while (capacity < value) {
+				capacity *= 2;
+			}
+			return capacity;
+		}
+	};
+}
@@ -0,0 +1,1006 @@
+#include "pch.h"
+#include "AudioEngine.h"
+#include "Mixer.h"
+
+audio::AudioEngine::AudioEngine(uint32_t sampleRate, uint32_t channelCount) :
+	m_sampleRate(sampleRate),
+	m_channelCount(channelCount),
+	m_commands(),
+	m_toneSetChanges(),
+	m_tempoRampChanges(),
+	m_tempoChanges(120.0),
+	m_volumeChanges(1.0),
+	m_requestedBeatsPerMinute(120.0),
+	m_requestedBeatsPerBar(4),
+	m_requestedToneSet(),
+	m_isBarCacheEnabled(true),
+	m_barCacheMemoryBytes(0),
+	m_barCacheBuildCount(0),
+	m_isBarCacheStale(false),
+	m_hasTempoChanged(false),
+	m_lastTempoChangeCounter(0),
+	m_latestBarCache(0),
+	m_retiredBarCaches(),
+	m_publishedSongTimelines(),
+	m_retiredSongTimelines(),
+	m_isPlaying(false),
+	m_beatsPerBar(4),
+	m_toneSet(),
+	m_tempoRamp(TempoRamp::Constant(120.0)),
+	m_beatScale(sampleRate, 120.0, 1),
+	m_beatsPerMinute(120.0),
+	m_samplesPerBeat(60.0 * sampleRate / 120.0),
+	m_playheadSample(0),
+	m_beatIndex(0),
+	m_nextBeatSample(0),
+	m_anchorBeat(0),
+	m_anchorSample(0),
+	m_smoothingFrames(max(1u, (uint32_t)llround(SmoothingSeconds * sampleRate))),
+	m_glideStartSample(0),
+	m_glideFirstBeat(0),
+	m_glidePreviousBeatSample(0),
+	m_glideStartPhase(0.0),
+	m_glideStartRate(0.0),
+	m_glideEndRate(0.0),
+	m_volume(1.0f),
+	m_targetVolume(1.0f),
+	m_volumeStep(0.0f),
+	m_barCache(nullptr),
+	m_cachedBarVariant(nullptr),
+	m_cachedBarFirstBeat(0),
+	m_cachedBarStartSample(0),
+	m_cachedBarCount(0),
+	m_liveBarCount(0),
+	m_barCacheInvalidationCount(0),
+	m_songTimeline(nullptr),
+	m_songCursor(),
+	m_stopTimerState(StopTimerState::NONE),
+	m_isStopTimerAtBarLine(false),
+	m_playedFrames(0),
+	m_stopTimerTargetFrames(0),
+	m_stopFadeFrames(max(1u, (uint32_t)llround(StopFadeSeconds * sampleRate))),
+	m_stopFadeFramesRemaining(0),
+	m_stopTimerEvents(),
+	m_voices(),
+	m_defaultHostClock(),
+	m_hostClock(nullptr),
+	m_readHostClock(nullptr),
+	m_hostClockFrequency(1),
+	m_snapshot(),
+	m_publishedSnapshot(),
+	m_publishedPosition(),
+	m_midiOutput(nullptr),
+	m_partStreamFrame(0),
+	m_midiBeatSample(0),
+	m_midiNextBeatSample(0),
+	m_midiPulse(MidiOutput::PulsesPerBeat),
+	m_session(nullptr),
+	m_sessionClock(sampleRate),
+	m_isFollowingSession(false)
+{
+	m_voices.SetPolyphonyLimit(Polyphony);
+	SetHostClock(&m_defaultHostClock);
+	m_snapshot.sampleRate = sampleRate;
+}
+
+audio::AudioEngine::~AudioEngine()
+{
+	delete (BarCache*)(m_latestBarCache.exchange(0) & ~(uintptr_t)1);
+	CollectRetiredBarCaches();
+	delete m_barCache;
+
+	SongTimeline* timeline;
+	while (m_publishedSongTimelines.TryPop(timeline)) {
+		delete timeline;
+	}
+	CollectRetiredSongTimelines();
+	delete m_songTimeline;
+}
+
+bool audio::AudioEngine::Play()
+{
+	return m_commands.TryPush({ CommandType::PLAY, 0.0 });
+}
+
+bool audio::AudioEngine::Pause()
+{
+	return m_commands.TryPush({ CommandType::PAUSE, 0.0 });
+}
+
+bool audio::AudioEngine::Stop()
+{
+	return m_commands.TryPush({ CommandType::STOP, 0.0 });
+}
+
+bool audio::AudioEngine::SetBeatsPerBar(int beatsPerBar)
+{
+	beatsPerBar = max(1, beatsPerBar);
+	if (!m_commands.TryPush({ CommandType::SET_BEATS_PER_BAR, (double)beatsPerBar })) {
+		return false;
+	}
+	m_requestedBeatsPerBar = beatsPerBar;
+	RebuildBarCache();
+	return true;
+}
+
+bool audio::AudioEngine::SetTempo(double beatsPerMinute)
+{
+	if (beatsPerMinute <= 0.0) {
+		return false;
+	}
+	m_tempoChanges.Set(beatsPerMinute);
+	m_requestedBeatsPerMinute = beatsPerMinute;
+
+	// A lone change is built for straight away; one following another within the settle time, as a slider
+	// being dragged sends, is left for UpdateBarCache, so a drag builds bars once when it starts and once where
+	// it stops, rather than on every step
+	const uint64_t counter = m_readHostClock(m_hostClock);
+	const bool isSettled = !m_hasTempoChanged || counter - m_lastTempoChangeCounter >= GetBarCacheSettleCounts();
+	m_hasTempoChanged = true;
+	m_lastTempoChangeCounter = counter;
+	if (isSettled) {
+		RebuildBarCache();
+	} else {
+		m_isBarCacheStale = true;
+	}
+	return true;
+}
+
+bool audio::AudioEngine::SetVolume(double gain)
+{
+	if (gain < 0.0) {
+		return false;
+	}
+	m_volumeChanges.Set(gain);
+	return true;
+}
+
+bool audio::AudioEngine::SetToneSet(const ToneSetView& toneSet)
+{
+	if (!m_toneSetChanges.TryPush(toneSet)) {
+		return false;
+	}
+	m_requestedToneSet = toneSet;
+	RebuildBarCache();
+	return true;
+}
+
+bool audio::AudioEngine::SetTempoRamp(const TempoRamp& ramp)
+{
+	// Ramps are applied in order with other tempo commands, so check both queues have room before pushing
+	if (!m_commands.CanPush() || !m_tempoRampChanges.TryPush(ramp)) {
+		return false;
+	}
+	m_tempoChanges.Discard();
+	m_commands.TryPush({ CommandType::SET_TEMPO_RAMP, 0.0 });
+	m_requestedBeatsPerMinute = ramp.GetEndTempo();
+	RebuildBarCache();
+	return true;
+}
+
+bool audio::AudioEngine::SetSongTimeline(const SongTimeline* timeline)
+{
+	if (timeline != nullptr && timeline->GetSampleRate() != m_sampleRate) {
+		throw std::runtime_error("Song timeline was compiled for a different sample rate");
+	}
+	CollectRetiredSongTimelines();
+	std::unique_ptr<SongTimeline> copy(timeline != nullptr ? new SongTimeline(*timeline) : nullptr);
+	if (!m_commands.CanPush() || !m_publishedSongTimelines.TryPush(copy.get())) {
+		return false;
+	}
+	copy.release();
+	m_commands.TryPush({ CommandType::SET_SONG_TIMELINE, 0.0 });
+	return true;
+}
+
+bool audio::AudioEngine::Seek(uint64_t sample)
+{
+	return m_commands.TryPush({ CommandType::SEEK, (double)sample });
+}
+
+bool audio::AudioEngine::SetStopTimer(double seconds, bool isAtBarLine)
+{
+	const double frames = max(0.0, (double)llround(seconds * m_sampleRate));
+	return m_commands.TryPush({ isAtBarLine ? CommandType::SET_STOP_TIMER_AT_BAR : CommandType::SET_STOP_TIMER, frames });
+}
+
+bool audio::AudioEngine::CancelStopTimer()
+{
+	return m_commands.TryPush({ CommandType::CANCEL_STOP_TIMER, 0.0 });
+}
+
+void audio::AudioEngine::SetBarCacheEnabled(bool enabled)
+{
+	if (enabled != m_isBarCacheEnabled) {
+		m_isBarCacheEnabled = enabled;
+		RebuildBarCache();
+	}
+}
+
+audio::BarCacheStatistics audio::AudioEngine::GetBarCacheStatistics()
+{
+	return {
+		m_cachedBarCount.load(std::memory_order_relaxed),
+		m_liveBarCount.load(std::memory_order_relaxed),
+		m_barCacheInvalidationCount.load(std::memory_order_relaxed),
+		m_barCacheBuildCount,
+		m_barCacheMemoryBytes
+	};
+}
+
+void audio::AudioEngine::UpdateBarCache()
+{
+	if (m_isBarCacheStale && m_readHostClock(m_hostClock) - m_lastTempoChangeCounter >= GetBarCacheSettleCounts()) {
+		RebuildBarCache();
+	}
+}
+
+/// <summary>
+/// Render one block of interleaved output. Clicks still sounding from earlier blocks are continued first,
+/// then any beats falling inside this block are started at their exact sample offsets. A stop timer firing
+/// inside the block splits it, so that the part after it plays with the transport stopped.
+/// </summary>
+void audio::AudioEngine::Render(float* output, uint32_t frameCount)
+{
+	const uint64_t hostCounter = m_readHostClock(m_hostClock);
+	m_partStreamFrame = m_snapshot.streamFrame;
+	if (m_midiOutput != nullptr) {
+		m_midiOutput->BeginBlock(hostCounter, m_snapshot.streamFrame, frameCount);
+	}
+	EngineCommand command;
+	while (m_commands.TryPop(command)) {
+		ApplyCommand(command);
+	}
+	const bool isFollowingSession = m_session != nullptr && m_songTimeline == nullptr &&
+		m_sessionClock.BeginBlock(*m_session, hostCounter, m_snapshot.streamFrame, frameCount);
+	if (isFollowingSession != m_isFollowingSession) {
+		FollowSession(isFollowingSession);
+	}
+	ToneSetView toneSet;
+	while (m_toneSetChanges.TryPop(toneSet)) {
+		ApplyToneSet(toneSet);
+	}
+	double value;
+	if (m_tempoChanges.TryTake(value) && !m_isFollowingSession) {
+		ApplyTempo(value);
+	}
+	if (m_volumeChanges.TryTake(value)) {
+		ApplyVolume(value);
+	}
+	AcceptPublishedBarCache();
+
+	m_snapshot.hostCounter = hostCounter;
+	m_snapshot.playheadSample = m_playheadSample;
+	m_snapshot.blockFrames = frameCount;
+	m_snapshot.isPlaying = m_isPlaying;
+	m_snapshot.hasStopTimer = m_stopTimerState != StopTimerState::NONE;
+	m_snapshot.stopTimerRemainingFrames = m_snapshot.hasStopTimer ? GetFramesUntilStopTimer() : 0;
+
+	std::fill(output, output + (size_t)frameCount * m_channelCount, 0.0f);
+
+	uint32_t renderedFrames = 0;
+	while (renderedFrames < frameCount) {
+		m_partStreamFrame = m_snapshot.streamFrame + renderedFrames;
+		const uint32_t frames = (uint32_t)min((uint64_t)(frameCount - renderedFrames), m_isPlaying ? GetFramesUntilStopTimer() : UINT64_MAX);
+		if (frames == 0) {
+			AdvanceStopTimer(renderedFrames, hostCounter);
+			continue;
+		}
+		RenderFrames(output + (size_t)renderedFrames * m_channelCount, frames);
+		renderedFrames += frames;
+	}
+	RampVolume(output, frameCount);
+
+	RecordNextOnset();
+	m_publishedSnapshot.Store(m_snapshot);
+	m_snapshot.streamFrame += frameCount;
+	PublishPosition();
+}
+
+// Render part of a block, with the stop timer not due until its end at the soonest
+void audio::AudioEngine::RenderFrames(float* output, uint32_t frameCount)
+{
+	// Continue voices started in previous blocks, dropping those that have finished
+	MixVoices(m_voices, output, m_channelCount, frameCount);
+
+	if (m_isPlaying) {
+		m_playedFrames += frameCount;
+		if (m_songTimeline != nullptr) {
+			RenderSong(output, frameCount);
+		} else if (m_isFollowingSession) {
+			RenderSessionBeats(output, frameCount);
+		} else {
+			RenderMetronome(output, frameCount);
+		}
+	}
+
+	if (m_stopFadeFramesRemaining > 0) {
+		FadeOut(output, frameCount);
+	}
+}
+
+// Start a voice for each beat that falls inside this block, or one for the whole bar if it is cached
+void audio::AudioEngine::RenderMetronome(float* output, uint32_t frameCount)
+{
+	const uint64_t blockEnd = m_playheadSample + frameCount;
+	while (m_nextBeatSample < blockEnd) {
+		const uint32_t blockOffset = (uint32_t)(m_nextBeatSample - m_playheadSample);
+		if (m_cachedBarVariant != nullptr && m_beatIndex >= m_cachedBarFirstBeat + m_beatsPerBar) {
+			m_cachedBarVariant = nullptr;
+		}
+		if (m_beatIndex % m_beatsPerBar == 0) {
+			if (TryStartCachedBar(blockOffset, output, frameCount)) {
+				m_cachedBarCount.fetch_add(1, std::memory_order_relaxed);
+			} else {
+				m_liveBarCount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		const bool isAccent = (m_beatIndex % m_beatsPerBar) == 0;
+		RecordOnset(m_nextBeatSample, 1.0f, isAccent ? ToneVoice::ACCENT : ToneVoice::NORMAL);
+		if (m_midiOutput != nullptr) {
+			StartMidiBeat(m_nextBeatSample);
+			m_midiOutput->SendClick(GetStreamFrame(m_nextBeatSample), isAccent ? ToneVoice::ACCENT : ToneVoice::NORMAL, 1.0f);
+		}
+		if (m_cachedBarVariant == nullptr) {
+			const SampleView& click = isAccent ? m_toneSet.accent : m_toneSet.normal;
+			if (click.length > 0) {
+				Voice& voice = m_voices.Start(click, 0, 1.0f, 0.0f);
+				MixVoice(voice, output, m_channelCount, blockOffset, frameCount);
+			}
+		}
+		m_beatIndex++;
+		m_nextBeatSample = BeatSample(m_beatIndex);
+		FollowTempoRamp();
+	}
+	if (m_midiOutput != nullptr) {
+		SendMidiClock(blockEnd, m_nextBeatSample);
+	}
+	m_playheadSample = blockEnd;
+}
+
+// Start a voice for each session beat inside this block. The session's tempo need not be one the bar cache was
+// built for, so every click is mixed live. The next beat is picked up afresh from the session whenever the two
+// have drifted apart, as they have on joining it or after another peer's timeline took over.
+void audio::AudioEngine::RenderSessionBeats(float* output, uint32_t frameCount)
+{
+	const uint64_t blockEnd = m_playheadSample + frameCount;
+	const double beatNow = m_sessionClock.GetBeatAtFrame(m_partStreamFrame);
+	if ((double)m_beatIndex < beatNow - SessionSlackBeats || (double)m_beatIndex > beatNow + 1.0 + SessionSlackBeats) {
+		m_beatIndex = (uint64_t)max(0.0, ceil(beatNow));
+	}
+	m_nextBeatSample = SessionBeatSample(m_beatIndex);
+	while (m_nextBeatSample < blockEnd) {
+		const uint32_t blockOffset = (uint32_t)(m_nextBeatSample - m_playheadSample);
+		const bool isAccent = (m_beatIndex % m_beatsPerBar) == 0;
+		RecordOnset(m_nextBeatSample, 1.0f, isAccent ? ToneVoice::ACCENT : ToneVoice::NORMAL);
+		if (m_midiOutput != nullptr) {
+			StartMidiBeat(m_nextBeatSample);
+			m_midiOutput->SendClick(GetStreamFrame(m_nextBeatSample), isAccent ? ToneVoice::ACCENT : ToneVoice::NORMAL, 1.0f);
+		}
+		const SampleView& click = isAccent ? m_toneSet.accent : m_toneSet.normal;
+		if (click.length > 0) {
+			Voice& voice = m_voices.Start(click, 0, 1.0f, 0.0f);
+			MixVoice(voice, output, m_channelCount, blockOffset, frameCount);
+		}
+		m_beatIndex++;
+		m_nextBeatSample = SessionBeatSample(m_beatIndex);
+	}
+	m_beatsPerMinute = m_sessionClock.GetTempoAtBeat((double)m_beatIndex);
+	m_samplesPerBeat = 60.0 * m_sampleRate / m_beatsPerMinute;
+	if (m_midiOutput != nullptr) {
+		SendMidiClock(blockEnd, m_nextBeatSample);
+	}
+	m_playheadSample = blockEnd;
+}
+
+// Joining a session leaves the bar cache behind. Leaving one carries on from the next beat due, at the session's
+// tempo, as if a constant tempo had been set on the previous beat.
+void audio::AudioEngine::FollowSession(bool isFollowing)
+{
+	m_isFollowingSession = isFollowing;
+	DissolveCachedBar();
+	if (isFollowing || m_songTimeline != nullptr) {
+		return;
+	}
+	m_anchorBeat = m_beatIndex;
+	m_anchorSample = max(m_nextBeatSample, m_playheadSample);
+	m_glideFirstBeat = m_beatIndex;
+	m_glidePreviousBeatSample = m_anchorSample - min(m_anchorSample, (uint64_t)llround(m_samplesPerBeat));
+	m_tempoRamp = TempoRamp::Constant(m_beatsPerMinute);
+	m_beatScale = TickScale(m_sampleRate, m_beatsPerMinute, 1);
+	m_nextBeatSample = BeatSample(m_beatIndex);
+	FollowTempoRamp();
+}
+
+// Playhead sample at which a session beat is heard, or the playhead if that has already gone by
+uint64_t audio::AudioEngine::SessionBeatSample(uint64_t beatIndex)
+{
+	const uint64_t frame = m_sessionClock.GetFrameOfBeat((double)beatIndex);
+	return frame > m_partStreamFrame ? m_playheadSample + (frame - m_partStreamFrame) : m_playheadSample;
+}
+
+void audio::AudioEngine::ApplyCommand(const EngineCommand& command)
+{
+	switch (command.type) {
+	case CommandType::PLAY:
+		// Playing again from the end of a song starts it over
+		if (m_songTimeline != nullptr && m_playheadSample >= m_songTimeline->GetLengthSamples()) {
+			SeekSong(0);
+		}
+		EndStopFade();
+		SendMidiTransport(true, m_partStreamFrame);
+		m_isPlaying = true;
+		break;
+	case CommandType::PAUSE:
+		DissolveCachedBar();
+		SendMidiTransport(false, m_partStreamFrame);
+		m_isPlaying = false;
+		break;
+	case CommandType::STOP:
+		SendMidiTransport(false, m_partStreamFrame);
+		m_isPlaying = false;
+		m_voices.Clear();
+		m_cachedBarVariant = nullptr;
+		m_stopTimerState = StopTimerState::NONE;
+		m_stopFadeFramesRemaining = 0;
+		Rewind();
+		break;
+	case CommandType::SET_BEATS_PER_BAR:
+		ApplyBeatsPerBar((int)command.value);
+		break;
+	case CommandType::SET_SONG_TIMELINE:
+		ApplySongTimeline();
+		break;
+	case CommandType::SEEK:
+		SeekSong((uint64_t)command.value);
+		break;
+	case CommandType::SET_STOP_TIMER:
+	case CommandType::SET_STOP_TIMER_AT_BAR:
+		m_stopTimerState = StopTimerState::COUNTING;
+		m_isStopTimerAtBarLine = command.type == CommandType::SET_STOP_TIMER_AT_BAR;
+		m_stopTimerTargetFrames = m_playedFrames + (uint64_t)command.value;
+		break;
+	case CommandType::CANCEL_STOP_TIMER:
+		m_stopTimerState = StopTimerState::NONE;
+		break;
+	case CommandType::SET_TEMPO_RAMP: {
+		TempoRamp ramp;
+		if (m_tempoRampChanges.TryPop(ramp)) {
+			ApplyTempoRamp(ramp);
+		}
+		break;
+	}
+	}
+}
+
+void audio::AudioEngine::ApplyTempo(double beatsPerMinute)
+{
+	if (m_tempoRamp.IsConstant() && beatsPerMinute == m_tempoRamp.GetStartTempo()) {
+		return;
+	}
+	// Before the first beat, or while a song plays its own tempos, there is no beat to keep in step with
+	if (m_beatIndex == 0 || m_songTimeline != nullptr) {
+		ApplyTempoRamp(TempoRamp::Constant(beatsPerMinute));
+	} else {
+		GlideTempo(beatsPerMinute);
+	}
+}
+
+// Carry on from the same point in the beat, with the rate of beats per sample changing linearly from the current
+// beat's to the new tempo's over the smoothing time. The beats falling within the glide are worked out from it,
+// and the first beat after it anchors the new tempo's exact grid.
+void audio::AudioEngine::GlideTempo(double beatsPerMinute)
+{
+	if (m_barCache != nullptr && m_barCache->Matches(m_samplesPerBeat, m_beatsPerBar, m_toneSet)) {
+		m_barCacheInvalidationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	DissolveCachedBar();
+
+	const uint64_t previousBeatSample = BeatSample(m_beatIndex - 1);
+	const double beatSamples = (double)max(m_nextBeatSample - previousBeatSample, (uint64_t)1);
+	m_glideStartSample = m_playheadSample;
+	m_glideFirstBeat = m_beatIndex;
+	m_glidePreviousBeatSample = previousBeatSample;
+	m_glideStartPhase = min(1.0, (double)(m_playheadSample - min(previousBeatSample, m_playheadSample)) / beatSamples);
+	m_glideStartRate = 1.0 / beatSamples;
+	m_glideEndRate = beatsPerMinute / (60.0 * m_sampleRate);
+
+	// The first beat after the glide, counted from the last beat before it
+	const double glideBeats = 0.5 * (m_glideStartRate + m_glideEndRate) * m_smoothingFrames;
+	const double beatsAfterPrevious = max(1.0, ceil(m_glideStartPhase + glideBeats));
+	m_anchorBeat = m_beatIndex - 1 + (uint64_t)beatsAfterPrevious;
+	m_anchorSample = m_playheadSample + (uint64_t)llround(m_smoothingFrames + (beatsAfterPrevious - m_glideStartPhase - glideBeats) / m_glideEndRate);
+	m_tempoRamp = TempoRamp::Constant(beatsPerMinute);
+	m_beatScale = TickScale(m_sampleRate, beatsPerMinute, 1);
+	m_nextBeatSample = BeatSample(m_beatIndex);
+	FollowTempoRamp();
+}
+
+// Samples from the start of the glide to the beat solve rate0 t + (rate1 - rate0) t^2 / (2 T) = beats to go,
+// taking the root in the form that stays accurate when the two rates are close
+uint64_t audio::AudioEngine::GlideBeatSample(uint64_t beatIndex)
+{
+	if (beatIndex < m_glideFirstBeat) {
+		return m_glidePreviousBeatSample;
+	}
+	const double beats = (double)(beatIndex - m_glideFirstBeat + 1) - m_glideStartPhase;
+	const double curvature = (m_glideEndRate - m_glideStartRate) / (2.0 * m_smoothingFrames);
+	const double root = sqrt(max(0.0, m_glideStartRate * m_glideStartRate + 4.0 * curvature * beats));
+	return m_glideStartSample + (uint64_t)llround(2.0 * beats / (m_glideStartRate + root));
+}
+
+// Volume ramps linearly from where it is to the new gain over the smoothing time
+void audio::AudioEngine::ApplyVolume(double gain)
+{
+	m_targetVolume = (float)gain;
+	m_volumeStep = (m_targetVolume - m_volume) / (float)m_smoothingFrames;
+}
+
+void audio::AudioEngine::RampVolume(float* output, uint32_t frameCount)
+{
+	if (m_volume == m_targetVolume && m_volume == 1.0f) {
+		return;
+	}
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		if (m_volume != m_targetVolume) {
+			m_volume += m_volumeStep;
+			if ((m_volumeStep > 0.0f) == (m_volume > m_targetVolume)) {
+				m_volume = m_targetVolume;
+			}
+		}
+		for (uint32_t channel = 0; channel < m_channelCount; channel++) {
+			output[(size_t)frame * m_channelCount + channel] *= m_volume;
+		}
+	}
+}
+
+// Re-anchor the beat grid on the last beat played, so the next beat lands one beat of the new ramp after it
+void audio::AudioEngine::ApplyTempoRamp(const TempoRamp& ramp)
+{
+	if (m_barCache != nullptr && m_barCache->Matches(m_samplesPerBeat, m_beatsPerBar, m_toneSet)) {
+		m_barCacheInvalidationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	DissolveCachedBar();
+
+	if (m_beatIndex > 0) {
+		m_anchorSample = BeatSample(m_beatIndex - 1);
+		m_anchorBeat = m_beatIndex - 1;
+	}
+	m_tempoRamp = ramp;
+	m_beatScale = ramp.IsConstant() ? TickScale(m_sampleRate, ramp.GetStartTempo(), 1) : TickScale();
+	m_nextBeatSample = BeatSample(m_beatIndex);
+
+	// A faster tempo could put the next beat in the past; play it now and measure from here instead
+	if (m_nextBeatSample < m_playheadSample) {
+		m_anchorBeat = m_beatIndex;
+		m_anchorSample = m_playheadSample;
+		m_nextBeatSample = m_playheadSample;
+	}
+	FollowTempoRamp();
+}
+
+// Back to the first beat, or the start of the song
+void audio::AudioEngine::Rewind()
+{
+	m_playheadSample = 0;
+	m_beatIndex = 0;
+	m_anchorBeat = 0;
+	m_anchorSample = 0;
+	m_nextBeatSample = 0;
+	FollowTempoRamp();
+	m_songCursor.Seek(m_songTimeline, 0);
+	ForgetOnsets();
+	ResetMidiClock();
+}
+
+// Keep the current tempo, reported to the UI and used to match the bar cache, at the ramp's tempo for the next beat
+void audio::AudioEngine::FollowTempoRamp()
+{
+	const double beatsPerMinute = m_tempoRamp.GetTempoAt(m_beatIndex > m_anchorBeat ? (double)(m_beatIndex - m_anchorBeat) : 0.0);
+	if (beatsPerMinute != m_beatsPerMinute) {
+		m_beatsPerMinute = beatsPerMinute;
+		m_samplesPerBeat = 60.0 * m_sampleRate / beatsPerMinute;
+	}
+}
+
+void audio::AudioEngine::ApplyBeatsPerBar(int beatsPerBar)
+{
+	if (beatsPerBar == m_beatsPerBar) {
+		return;
+	}
+	if (m_barCache != nullptr && m_barCache->Matches(m_samplesPerBeat, m_beatsPerBar, m_toneSet)) {
+		m_barCacheInvalidationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	DissolveCachedBar();
+	m_beatsPerBar = beatsPerBar;
+}
+
+void audio::AudioEngine::ApplyToneSet(const ToneSetView& toneSet)
+{
+	if (toneSet == m_toneSet) {
+		return;
+	}
+	if (m_barCache != nullptr && m_barCache->Matches(m_samplesPerBeat, m_beatsPerBar, m_toneSet)) {
+		m_barCacheInvalidationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	DissolveCachedBar();
+	m_toneSet = toneSet;
+}
+
+// Beat positions are always computed from the anchor rather than accumulated, so rounding never drifts. At a
+// constant tempo they are exact as well.
+uint64_t audio::AudioEngine::BeatSample(uint64_t beatIndex)
+{
+	if (beatIndex < m_anchorBeat) {
+		return GlideBeatSample(beatIndex);
+	}
+	if (m_beatScale.IsValid()) {
+		return m_anchorSample + m_beatScale.ToSample(beatIndex - m_anchorBeat);
+	}
+	return m_anchorSample + (uint64_t)llround(m_tempoRamp.GetSampleOffset((double)(beatIndex - m_anchorBeat), 60.0 * m_sampleRate));
+}
+
+// Start a voice for each song event falling inside this block; the song stops itself once past the end
+void audio::AudioEngine::RenderSong(float* output, uint32_t frameCount)
+{
+	const uint64_t blockEnd = m_playheadSample + frameCount;
+	while (m_songCursor.GetNextEventSample() < blockEnd) {
+		const uint32_t blockOffset = (uint32_t)(m_songCursor.GetNextEventSample() - m_playheadSample);
+		const SampleView& click = m_songCursor.GetVoice() == ToneVoice::ACCENT ? m_toneSet.accent : m_toneSet.normal;
+		const float gain = GetNoteGain(m_songCursor.GetAccent());
+		RecordOnset(m_songCursor.GetNextEventSample(), gain, m_songCursor.GetVoice());
+		if (m_midiOutput != nullptr) {
+			SendSongMidiClock(m_songCursor.GetNextEventSample() + 1);
+			m_midiOutput->SendClick(GetStreamFrame(m_songCursor.GetNextEventSample()), m_songCursor.GetVoice(), gain);
+		}
+		if (click.length > 0) {
+			Voice& voice = m_voices.Start(click, 0, gain, 0.0f);
+			MixVoice(voice, output, m_channelCount, blockOffset, frameCount);
+		}
+		m_songCursor.Advance();
+	}
+	const uint64_t lengthSamples = m_songTimeline->GetLengthSamples();
+	if (m_midiOutput != nullptr) {
+		SendSongMidiClock(min(blockEnd, lengthSamples));
+		if (blockEnd >= lengthSamples) {
+			SendMidiTransport(false, GetStreamFrame(lengthSamples));
+		}
+	}
+	m_playheadSample = blockEnd;
+	if (m_playheadSample >= lengthSamples) {
+		m_playheadSample = lengthSamples;
+		m_isPlaying = false;
+	}
+}
+
+void audio::AudioEngine::RecordOnset(uint64_t sample, float gain, ToneVoice voice)
+{
+	m_snapshot.onsets[m_snapshot.onsetCount % PlaybackSnapshot::OnsetCapacity] = { sample, gain, voice };
+	m_snapshot.onsetCount++;
+}
+
+// The UI may need to show the next click before the block it falls in is rendered
+void audio::AudioEngine::RecordNextOnset()
+{
+	m_snapshot.hasNextOnset = false;
+	if (!m_isPlaying) {
+		return;
+	}
+	if (m_songTimeline == nullptr) {
+		const bool isAccent = (m_beatIndex % m_beatsPerBar) == 0;
+		m_snapshot.nextOnset = { m_nextBeatSample, 1.0f, isAccent ? ToneVoice::ACCENT : ToneVoice::NORMAL };
+		m_snapshot.hasNextOnset = true;
+	} else if (m_songCursor.GetNextEventSample() != SongCursor::EndOfSong) {
+		m_snapshot.nextOnset = { m_songCursor.GetNextEventSample(), GetNoteGain(m_songCursor.GetAccent()), m_songCursor.GetVoice() };
+		m_snapshot.hasNextOnset = true;
+	}
+}
+
+// After the playhead jumps, onsets already recorded no longer line up with it
+void audio::AudioEngine::ForgetOnsets()
+{
+	m_snapshot.seekOnsetCount = m_snapshot.onsetCount;
+}
+
+// Once a block, so the song's position is looked up in O(log n) sections and nothing allocates
+void audio::AudioEngine::PublishPosition()
+{
+	PlaybackPosition position = { m_snapshot.streamFrame, m_playheadSample, m_isPlaying, m_songTimeline != nullptr, 0, 0, 0, 0, 0.0 };
+	if (m_songTimeline != nullptr) {
+		const SongPosition songPosition = m_songTimeline->GetPosition(m_playheadSample > 0 ? m_playheadSample - 1 : 0);
+		position.section = songPosition.section;
+		position.bar = songPosition.bar;
+		position.beat = songPosition.beat;
+		position.beatsPerBar = songPosition.beatsPerBar;
+		position.beatsPerMinute = songPosition.beatsPerMinute;
+	} else {
+		const uint64_t beat = m_beatIndex > 0 ? m_beatIndex - 1 : 0;
+		position.bar = beat / m_beatsPerBar;
+		position.beat = (uint32_t)(beat % m_beatsPerBar);
+		position.beatsPerBar = (uint32_t)m_beatsPerBar;
+		position.beatsPerMinute = m_beatsPerMinute;
+	}
+	m_publishedPosition.Store(position);
+}
+
+// Stream frame of a playhead sample in the part of the block being rendered
+uint64_t audio::AudioEngine::GetStreamFrame(uint64_t sample)
+{
+	return m_partStreamFrame + (sample - m_playheadSample);
+}
+
+// Followers start from the top when playback does, and otherwise carry on from where they stopped
+void audio::AudioEngine::SendMidiTransport(bool isPlaying, uint64_t streamFrame)
+{
+	if (m_midiOutput == nullptr || isPlaying == m_isPlaying) {
+		return;
+	}
+	if (!isPlaying) {
+		m_midiOutput->SendStop(streamFrame);
+	} else if (m_playheadSample == 0) {
+		m_midiOutput->SendStart(streamFrame);
+	} else {
+		m_midiOutput->SendContinue(streamFrame);
+	}
+}
+
+// The current beat's pulses falling before the end sample, spread evenly up to where the next beat is now due.
+// Pulses whose time has already passed, because the next beat moved earlier, go out at the start of this part.
+void audio::AudioEngine::SendMidiClock(uint64_t endSample, uint64_t nextBeatSample)
+{
+	while (m_midiPulse < MidiOutput::PulsesPerBeat) {
+		const uint64_t pulseSample = max(m_playheadSample, m_midiBeatSample + m_midiPulse * (nextBeatSample - m_midiBeatSample) / MidiOutput::PulsesPerBeat);
+		if (pulseSample >= endSample) {
+			return;
+		}
+		m_midiOutput->SendClock(GetStreamFrame(pulseSample));
+		m_midiPulse++;
+	}
+}
+
+// Whatever is left of the last beat's pulses goes out with this one's first, so every beat has all 24
+void audio::AudioEngine::StartMidiBeat(uint64_t beatSample)
+{
+	SendMidiClock(beatSample + 1, beatSample);
+	m_midiBeatSample = beatSample;
+	m_midiOutput->SendClock(GetStreamFrame(beatSample));
+	m_midiPulse = 1;
+}
+
+// A song's beats come from its timeline, each found as the one before it starts, since they need not fall on events
+void audio::AudioEngine::SendSongMidiClock(uint64_t endSample)
+{
+	SendMidiClock(endSample, m_midiNextBeatSample);
+	while (m_midiPulse == MidiOutput::PulsesPerBeat && m_midiNextBeatSample < endSample) {
+		m_midiBeatSample = m_midiNextBeatSample;
+		m_midiPulse = 0;
+		m_midiNextBeatSample = m_songTimeline->FindNextBeat(m_midiBeatSample + 1);
+		SendMidiClock(endSample, m_midiNextBeatSample);
+	}
+}
+
+// After the playhead jumps, the clock waits for the next beat rather than finishing the one it was in
+void audio::AudioEngine::ResetMidiClock()
+{
+	m_midiPulse = MidiOutput::PulsesPerBeat;
+	m_midiNextBeatSample = m_songTimeline != nullptr ? m_songTimeline->FindNextBeat(m_playheadSample) : 0;
+}
+
+void audio::AudioEngine::CollectRetiredSongTimelines()
+{
+	SongTimeline* timeline;
+	while (m_retiredSongTimelines.TryPop(timeline)) {
+		delete timeline;
+	}
+}
+
+// Audio thread. Voices never point into a timeline, so a new one can be swapped in straight away.
+void audio::AudioEngine::ApplySongTimeline()
+{
+	SongTimeline* timeline;
+	if (!m_publishedSongTimelines.TryPop(timeline)) {
+		return;
+	}
+	const bool isSwitchingMode = (timeline == nullptr) != (m_songTimeline == nullptr);
+	if (m_songTimeline != nullptr) {
+		m_retiredSongTimelines.TryPush(m_songTimeline);
+	}
+	m_songTimeline = timeline;
+	if (isSwitchingMode) {
+		DissolveCachedBar();
+		Rewind();
+	} else {
+		m_songCursor.Seek(m_songTimeline, m_playheadSample);
+		if (m_songTimeline != nullptr) {
+			m_midiNextBeatSample = m_songTimeline->FindNextBeat(m_playheadSample);
+		}
+	}
+}
+
+void audio::AudioEngine::SeekSong(uint64_t sample)
+{
+	if (m_songTimeline == nullptr) {
+		return;
+	}
+	m_voices.Clear();
+	m_stopFadeFramesRemaining = 0;
+	m_playheadSample = min(sample, m_songTimeline->GetLengthSamples());
+	m_songCursor.Seek(m_songTimeline, m_playheadSample);
+	ForgetOnsets();
+	ResetMidiClock();
+}
+
+// Frames of playing until the stop timer is due, or UINT64_MAX if there is no timer
+uint64_t audio::AudioEngine::GetFramesUntilStopTimer()
+{
+	switch (m_stopTimerState) {
+	case StopTimerState::COUNTING:
+		return m_stopTimerTargetFrames - m_playedFrames;
+	case StopTimerState::WAITING_FOR_BAR_LINE:
+		return FindNextBarLine() - m_playheadSample;
+	default:
+		return UINT64_MAX;
+	}
+}
+
+// Playhead sample of the next bar line at or after the playhead. Worked out afresh each time, as tempo and time
+// signature changes move it.
+uint64_t audio::AudioEngine::FindNextBarLine()
+{
+	if (m_songTimeline != nullptr) {
+		return m_songTimeline->FindNextBarLine(m_playheadSample);
+	}
+	const uint64_t barBeat = (m_beatIndex + m_beatsPerBar - 1) / m_beatsPerBar * m_beatsPerBar;
+	if (barBeat == m_beatIndex) {
+		return m_nextBeatSample;
+	}
+	return m_isFollowingSession ? SessionBeatSample(barBeat) : BeatSample(barBeat);
+}
+
+// The stop timer is due at this offset in the block: wait for the bar line if asked to, or else stop
+void audio::AudioEngine::AdvanceStopTimer(uint32_t blockOffset, uint64_t hostCounter)
+{
+	if (m_stopTimerState == StopTimerState::COUNTING && m_isStopTimerAtBarLine) {
+		m_stopTimerState = StopTimerState::WAITING_FOR_BAR_LINE;
+		return;
+	}
+	m_stopTimerState = StopTimerState::NONE;
+	DissolveCachedBar();
+	SendMidiTransport(false, m_partStreamFrame);
+	m_isPlaying = false;
+	m_stopFadeFramesRemaining = m_stopFadeFrames;
+	m_stopTimerEvents.TryPush({ m_playheadSample, m_snapshot.streamFrame + blockOffset, hostCounter });
+}
+
+// Linear fade of everything still sounding after the stop timer fired; the voices are dropped once it ends
+void audio::AudioEngine::FadeOut(float* output, uint32_t frameCount)
+{
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		const float gain = m_stopFadeFramesRemaining > 0 ? (float)(--m_stopFadeFramesRemaining) / (float)m_stopFadeFrames : 0.0f;
+		for (uint32_t channel = 0; channel < m_channelCount; channel++) {
+			output[(size_t)frame * m_channelCount + channel] *= gain;
+		}
+	}
+	if (m_stopFadeFramesRemaining == 0) {
+		m_voices.Clear();
+	}
+}
+
+// Playing again, or jumping elsewhere, cuts off what was fading
+void audio::AudioEngine::EndStopFade()
+{
+	if (m_stopFadeFramesRemaining > 0) {
+		m_voices.Clear();
+		m_stopFadeFramesRemaining = 0;
+	}
+}
+
+// UI thread. Renders bars for the requested settings and hands them to the audio thread; until they arrive,
+// the old cache no longer matches and bars are mixed live.
+void audio::AudioEngine::RebuildBarCache()
+{
+	CollectRetiredBarCaches();
+	m_isBarCacheStale = false;
+	std::unique_ptr<BarCache> cache;
+	if (m_isBarCacheEnabled) {
+		cache = BarCache::Build(60.0 * m_sampleRate / m_requestedBeatsPerMinute, m_requestedBeatsPerBar, m_requestedToneSet);
+		m_barCacheBuildCount++;
+	}
+	m_barCacheMemoryBytes = cache ? cache->GetMemoryBytes() : 0;
+	const uintptr_t displaced = m_latestBarCache.exchange((uintptr_t)cache.release() | 1, std::memory_order_acq_rel);
+	delete (BarCache*)(displaced & ~(uintptr_t)1);
+}
+
+uint64_t audio::AudioEngine::GetBarCacheSettleCounts()
+{
+	return (uint64_t)llround(BarCacheSettleSeconds * (double)m_hostClockFrequency);
+}
+
+void audio::AudioEngine::CollectRetiredBarCaches()
+{
+	BarCache* cache;
+	while (m_retiredBarCaches.TryPop(cache)) {
+		delete cache;
+	}
+}
+
+// Audio thread. A new cache is only swapped in once no voice is still playing from the current one; until
+// then newer caches replace it in the slot.
+void audio::AudioEngine::AcceptPublishedBarCache()
+{
+	if (m_latestBarCache.load(std::memory_order_relaxed) == 0 || IsBarCacheInUse()) {
+		return;
+	}
+	const uintptr_t latest = m_latestBarCache.exchange(0, std::memory_order_acq_rel);
+	if (latest == 0) {
+		return;
+	}
+	if (m_barCache != nullptr) {
+		m_retiredBarCaches.TryPush(m_barCache);
+	}
+	m_barCache = (BarCache*)(latest & ~(uintptr_t)1);
+}
+
+bool audio::AudioEngine::IsBarCacheInUse()
+{
+	if (m_cachedBarVariant != nullptr) {
+		return true;
+	}
+	for (int i = 0; i < m_voices.GetActiveCount(); i++) {
+		if (m_voices.Get(i).cachedBar != nullptr) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Start the bar beginning at the next beat as a single voice, if the cache holds a variant whose beat offsets
+// are exactly the ones this bar would have been played with
+bool audio::AudioEngine::TryStartCachedBar(uint32_t blockOffset, float* output, uint32_t frameCount)
+{
+	if (m_barCache == nullptr || !m_barCache->Matches(m_samplesPerBeat, m_beatsPerBar, m_toneSet)) {
+		return false;
+	}
+	for (const BarCacheVariant& variant : m_barCache->GetVariants()) {
+		bool matches = true;
+		for (int beat = 1; beat < m_beatsPerBar && matches; beat++) {
+			matches = BeatSample(m_beatIndex + beat) - m_nextBeatSample == variant.beatOffsets[beat];
+		}
+		if (matches) {
+			m_cachedBarVariant = &variant;
+			m_cachedBarFirstBeat = m_beatIndex;
+			m_cachedBarStartSample = m_nextBeatSample;
+			Voice& voice = m_voices.Start(nullptr, &variant, variant.length, 0, 1.0f, 0.0f);
+			MixVoice(voice, output, m_channelCount, blockOffset, frameCount);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Replace a partly played cached bar with voices for just the clicks already started, so that the beats still
+// to come can be played live under new settings
+void audio::AudioEngine::DissolveCachedBar()
+{
+	if (m_cachedBarVariant == nullptr) {
+		return;
+	}
+	// The previous bar may be the same variant and still ringing, so match on position as well
+	const uint64_t barPosition = m_playheadSample - m_cachedBarStartSample;
+	for (int i = 0; i < m_voices.GetActiveCount(); i++) {
+		if (m_voices.Get(i).cachedBar == m_cachedBarVariant && m_voices.Get(i).position == barPosition) {
+			m_voices.Remove(i);
+			break;
+		}
+	}
+	const ToneSetView& toneSet = m_barCache->GetToneSet();
+	for (uint64_t beat = m_cachedBarFirstBeat; beat < m_beatIndex; beat++) {
+		const SampleView& click = beat == m_cachedBarFirstBeat ? toneSet.accent : toneSet.normal;
+		const uint64_t onset = m_cachedBarStartSample + m_cachedBarVariant->beatOffsets[beat - m_cachedBarFirstBeat];
+		const uint64_t elapsed = m_playheadSample - onset;
+		if (elapsed < click.length) {
+			m_voices.Start(click, (uint32_t)elapsed, 1.0f, 0.0f);
+		}
+	}
+	m_cachedBarVariant = nullptr;
+}
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "BarCache.h"
+#include "CoalescedParameter.h"
+#include "EngineCommand.h"
+#include "PlaybackSnapshot.h"
+#include "VoicePool.h"
+#include "SeqLock.h"
+#include "SpscQueue.h"
+#include "TempoRamp.h"
+#include "TickScale.h"
+#include "TripleBuffer.h"
+#include "Midi/MidiOutput.h"
+#include "Session/SessionBeatClock.h"
+#include "Songs/SongTimeline.h"
+#include "Sinks/BaseSink.h"
+#include "../Common/ClockSource.h"
+
+namespace audio {
+
+	// Renders metronome clicks by mixing mono PCM clicks from a tone set into the output at exact sample offsets.
+	// Control methods (Play, Pause, Stop, SetTempoRamp, SetBeatsPerBar, SetToneSet) are called from the UI thread and
+	// only enqueue a command; Render runs on the audio thread, applies queued commands at the start of each block,
+	// and never allocates or takes a lock. Tempo and volume, which sliders change continuously, bypass the queue
+	// and are taken at most once a block, the latest change winning.
+	// While the tempo and time signature hold steady, whole bars are played from a pre-rendered BarCache built
+	// on the UI thread, falling back to mixing individual clicks whenever the cache does not match. A tempo
+	// slider being dragged only has bars built for where it settles.
+	// Tempo follows a TempoRamp anchored on the last beat played when it was applied; a fixed tempo is a constant ramp,
+	// whose beats are placed by a TickScale in exact integer arithmetic so that they never drift. While playing, a
+	// new fixed tempo keeps the beat's phase and glides to the new tempo over SmoothingSeconds, and volume
+	// changes are ramped sample by sample over the same time.
+	// With a song timeline set, the engine plays the song's events from a cursor instead of the beat grid, and the
+	// playhead is the position in the song.
+	// After each block the engine publishes a PlaybackSnapshot, stamped with the host clock, for the UI to follow,
+	// and a PlaybackPosition through a triple buffer, which one UI thread reads every frame without ever waiting.
+	// A stop timer stops playback at an exact sample, splitting the block there, and fades out the clicks still
+	// sounding instead of cutting them off.
+	// With a MidiOutput set, the engine also sends MIDI clock, transport and clicks timed by the sample clock.
+	// With a SessionSync set and running, the metronome plays the session's beats instead of its own, so that it
+	// stays in step with the other devices in the session.
+	class AudioEngine : public AudioSource {
+	public:
+		static const int Polyphony = 32;
+		static const size_t CommandQueueCapacity = 64;
+		static const size_t RetiredBarCacheQueueCapacity = 4;
+		static const size_t ToneSetQueueCapacity = 8;
+		static const size_t TempoRampQueueCapacity = 8;
+		static const size_t SongTimelineQueueCapacity = 8;
+		static const size_t StopTimerEventQueueCapacity = 8;
+		static constexpr double StopFadeSeconds = 0.01;
+		static constexpr double SmoothingSeconds = 0.05;
+
+		// How long the tempo must hold still after a run of changes before bars are built for it
+		static constexpr double BarCacheSettleSeconds = 0.15;
+
+		// How far the session may move away from the next beat due before that beat is given up for the session's
+		static constexpr double SessionSlackBeats = 0.5;
+
+		AudioEngine(uint32_t sampleRate, uint32_t channelCount);
+		~AudioEngine();
+
+		// UI thread. Each returns false if the command queue is full.
+		bool Play();
+		bool Pause();
+		bool Stop();
+		bool SetBeatsPerBar(int beatsPerBar);
+
+		// UI thread. As often as the input changes; never queues more than one change a block, and returns false
+		// only for a tempo that is not positive or a negative gain. A tempo set straight after another is played
+		// live until UpdateBarCache finds it has settled.
+		bool SetTempo(double beatsPerMinute);
+		bool SetVolume(double gain);
+
+		// Any thread
+		inline ParameterChangeStatistics GetTempoChangeStatistics() const { return m_tempoChanges.GetStatistics(); }
+		inline ParameterChangeStatistics GetVolumeChangeStatistics() const { return m_volumeChanges.GetStatistics(); }
+
+		// UI thread. Clicks already sounding finish on the old tone set, whose samples must stay valid until they
+		// have; beats from the next block on use the new one.
+		bool SetToneSet(const ToneSetView& toneSet);
+
+		// UI thread. The ramp starts from the last beat played, so the next beat comes at the ramp's start tempo.
+		// Bars for its end tempo are cached, to take over once it has finished ramping. Overrides any tempo set
+		// since the last block.
+		bool SetTempoRamp(const TempoRamp& ramp);
+
+		// UI thread. Plays a copy of the timeline, or the metronome again when null. Replacing one song timeline
+		// with another keeps the position, so edits apply while playing; switching between song and metronome
+		// starts from the beginning.
+		bool SetSongTimeline(const SongTimeline* timeline);
+
+		// UI thread. Fast-forward and rewind jump straight to a position in the song, cutting off clicks still
+		// sounding. Ignored while playing the metronome.
+		bool Seek(uint64_t sample);
+
+		// UI thread. Stops playback once the given time has been played, replacing any timer already set. Time
+		// spent paused does not count, and stopping by hand cancels the timer. At a bar line, it waits for the
+		// next bar to start once the time is up, and stops just before its first click.
+		bool SetStopTimer(double seconds, bool isAtBarLine);
+		bool CancelStopTimer();
+
+		// UI thread. Takes the oldest notice of the stop timer having fired, if there is one.
+		inline bool TryGetStopTimerEvent(StopTimerEvent& event) { return m_stopTimerEvents.TryPop(event); }
+
+		// UI thread. Disable while the tempo is ramping or the pattern is being edited, so that bars are not
+		// re-rendered on every change.
+		void SetBarCacheEnabled(bool enabled);
+		BarCacheStatistics GetBarCacheStatistics();
+
+		// UI thread, once a frame. Builds bars for a tempo that has held still for BarCacheSettleSeconds since
+		// the last of a run of changes.
+		void UpdateBarCache();
+
+		// UI thread, before the sink starts. Snapshots are stamped with this clock, which must outlive the engine;
+		// until set, the engine uses its own DX::DefaultClock.
+		template<typename TClock>
+		void SetHostClock(const TClock* clock) {
+			m_hostClock = clock;
+			m_readHostClock = [](const void* hostClock) { return ((const TClock*)hostClock)->GetCounter(); };
+			m_hostClockFrequency = clock->GetFrequency();
+		}
+
+		// UI thread, before the sink starts. Sends 24 clock pulses to every beat, start, stop and continue as the
+		// transport changes, and each click's note through the given output, which must outlive the engine. Pulses
+		// are spread evenly up to where the next beat is due; any still unsent when it comes go out with it.
+		inline void SetMidiOutput(MidiOutput* output) { m_midiOutput = output; }
+
+		// UI thread, before the sink starts. While the session runs, the metronome plays its beats, accented by
+		// this engine's beats per bar, and its tempo; tempos set on the engine meanwhile are ignored, and once the
+		// session stops the metronome carries on at the session's last tempo. Songs play as usual. The session
+		// must use the engine's host clock and outlive the engine; the latencies are as for MidiOutput.
+		inline void SetSession(const SessionSync* session, uint32_t outputLatencyFrames, double deviceLatencySeconds) {
+			m_session = session;
+			m_sessionClock.SetLatency(outputLatencyFrames, deviceLatencySeconds);
+		}
+
+		// Any thread. The position, and the clicks started, as of the last block rendered.
+		inline PlaybackSnapshot GetPlaybackSnapshot() const { return m_publishedSnapshot.Load(); }
+
+		// One UI thread only, usually from Scene::Update. The section, bar, beat and tempo as of the last block
+		// rendered, all from the same block; valid until the next call.
+		inline const PlaybackPosition& ReadPlaybackPosition() { return m_publishedPosition.Read(); }
+
+		// Audio thread
+		virtual void Render(float* output, uint32_t frameCount) override;
+
+		// Audio thread, or any thread while not rendering
+		inline uint64_t GetPlayheadSample() { return m_playheadSample; }
+		inline uint64_t GetBeatIndex() { return m_beatIndex; }
+		inline bool IsPlaying() { return m_isPlaying; }
+		inline double GetTempo() { return m_beatsPerMinute; }
+
+	private:
+		uint32_t m_sampleRate;
+		uint32_t m_channelCount;
+		SpscQueue<EngineCommand, CommandQueueCapacity> m_commands;
+		SpscQueue<ToneSetView, ToneSetQueueCapacity> m_toneSetChanges;
+		SpscQueue<TempoRamp, TempoRampQueueCapacity> m_tempoRampChanges;
+		CoalescedParameter m_tempoChanges;
+		CoalescedParameter m_volumeChanges;
+
+		// UI-side copy of the settings the bar cache is built for
+		double m_requestedBeatsPerMinute;
+		int m_requestedBeatsPerBar;
+		ToneSetView m_requestedToneSet;
+		bool m_isBarCacheEnabled;
+		size_t m_barCacheMemoryBytes;
+		uint64_t m_barCacheBuildCount;
+
+		// A tempo set within the settle time of the one before waits for UpdateBarCache to build its bars
+		bool m_isBarCacheStale;
+		bool m_hasTempoChanged;
+		uint64_t m_lastTempoChangeCounter;
+
+		// The newest cache waits in a single slot for the audio thread, so it always replaces one published before
+		// it. A cache displaced from the slot was never seen by the audio thread and is deleted on the UI thread;
+		// one the audio thread lets go of comes back through a queue to be deleted there. The slot holds the
+		// cache pointer with its low bit set, since null is a valid cache, and zero when nothing is waiting.
+		// Retired caches are collected before every publish, and the audio thread retires at most one per
+		// publish, so the return queue never fills.
+		std::atomic<uintptr_t> m_latestBarCache;
+		SpscQueue<BarCache*, RetiredBarCacheQueueCapacity> m_retiredBarCaches;
+
+		// Song timelines are handed over and retired much as bar caches are, in order with the other commands
+		SpscQueue<SongTimeline*, SongTimelineQueueCapacity> m_publishedSongTimelines;
+		SpscQueue<SongTimeline*, 2 * SongTimelineQueueCapacity> m_retiredSongTimelines;
+
+		// Transport state, owned by the audio thread
+		bool m_isPlaying;
+		int m_beatsPerBar;
+		ToneSetView m_toneSet;
+		TempoRamp m_tempoRamp;
+		TickScale m_beatScale;
+		double m_beatsPerMinute;
+		double m_samplesPerBeat;
+		uint64_t m_playheadSample;
+		uint64_t m_beatIndex;
+		uint64_t m_nextBeatSample;
+		uint64_t m_anchorBeat;
+		uint64_t m_anchorSample;
+
+		// Beats before the anchor fall within a tempo glide, which started at the playhead some way through the
+		// beat before its first beat, changing the rate in beats per sample linearly over the smoothing time
+		uint32_t m_smoothingFrames;
+		uint64_t m_glideStartSample;
+		uint64_t m_glideFirstBeat;
+		uint64_t m_glidePreviousBeatSample;
+		double m_glideStartPhase;
+		double m_glideStartRate;
+		double m_glideEndRate;
+
+		// Output gain, ramping towards the volume last set
+		float m_volume;
+		float m_targetVolume;
+		float m_volumeStep;
+
+		// Bar cache state, owned by the audio thread
+		BarCache* m_barCache;
+		const BarCacheVariant* m_cachedBarVariant;
+		uint64_t m_cachedBarFirstBeat;
+		uint64_t m_cachedBarStartSample;
+		std::atomic<uint64_t> m_cachedBarCount;
+		std::atomic<uint64_t> m_liveBarCount;
+		std::atomic<uint64_t> m_barCacheInvalidationCount;
+
+		// Song state, owned by the audio thread
+		SongTimeline* m_songTimeline;
+		SongCursor m_songCursor;
+
+		// Stop timer state, owned by the audio thread. The timer counts frames played, so pausing pauses it.
+		enum class StopTimerState {
+			NONE,
+			COUNTING,
+			WAITING_FOR_BAR_LINE
+		};
+		StopTimerState m_stopTimerState;
+		bool m_isStopTimerAtBarLine;
+		uint64_t m_playedFrames;
+		uint64_t m_stopTimerTargetFrames;
+		uint32_t m_stopFadeFrames;
+		uint32_t m_stopFadeFramesRemaining;
+		SpscQueue<StopTimerEvent, StopTimerEventQueueCapacity> m_stopTimerEvents;
+
+		VoicePool m_voices;
+
+		// Snapshot built up by the audio thread over a block, then published for the UI
+		DX::DefaultClock m_defaultHostClock;
+		const void* m_hostClock;
+		uint64_t (*m_readHostClock)(const void* hostClock);
+		uint64_t m_hostClockFrequency;
+		PlaybackSnapshot m_snapshot;
+		SeqLock<PlaybackSnapshot> m_publishedSnapshot;
+		TripleBuffer<PlaybackPosition> m_publishedPosition;
+
+		// MIDI state, owned by the audio thread. Messages are timed by the stream frame of the part of the block
+		// being rendered; the clock is partway through the beat at the given sample until all its pulses are sent.
+		MidiOutput* m_midiOutput;
+		uint64_t m_partStreamFrame;
+		uint64_t m_midiBeatSample;
+		uint64_t m_midiNextBeatSample;
+		uint32_t m_midiPulse;
+
+		// Session state, owned by the audio thread
+		const SessionSync* m_session;
+		SessionBeatClock m_sessionClock;
+		bool m_isFollowingSession;
+
+		void ApplyCommand(const EngineCommand& command);
+		void ApplyTempo(double beatsPerMinute);
+		void GlideTempo(double beatsPerMinute);
+		uint64_t GlideBeatSample(uint64_t beatIndex);
+		void ApplyVolume(double gain);
+		void RampVolume(float* output, uint32_t frameCount);
+		void ApplyTempoRamp(const TempoRamp& ramp);
+		void FollowTempoRamp();
+		void Rewind();
+		void ApplyBeatsPerBar(int beatsPerBar);
+		void ApplyToneSet(const ToneSetView& toneSet);
+		uint64_t BeatSample(uint64_t beatIndex);
+
+		void RenderFrames(float* output, uint32_t frameCount);
+		void RenderMetronome(float* output, uint32_t frameCount);
+		void RenderSong(float* output, uint32_t frameCount);
+		void RenderSessionBeats(float* output, uint32_t frameCount);
+		void FollowSession(bool isFollowing);
+		uint64_t SessionBeatSample(uint64_t beatIndex);
+		void RecordOnset(uint64_t sample, float gain, ToneVoice voice);
+		void RecordNextOnset();
+		void ForgetOnsets();
+		void PublishPosition();
+		uint64_t GetStreamFrame(uint64_t sample);
+		void SendMidiTransport(bool isPlaying, uint64_t streamFrame);
+		void SendMidiClock(uint64_t endSample, uint64_t nextBeatSample);
+		void StartMidiBeat(uint64_t beatSample);
+		void SendSongMidiClock(uint64_t endSample);
+		void ResetMidiClock();
+		void CollectRetiredSongTimelines();
+		void ApplySongTimeline();
+		void SeekSong(uint64_t sample);
+
+		uint64_t GetFramesUntilStopTimer();
+		uint64_t FindNextBarLine();
+		void AdvanceStopTimer(uint32_t blockOffset, uint64_t hostCounter);
+		void FadeOut(float* output, uint32_t frameCount);
+		void EndStopFade();
+
+		void RebuildBarCache();
+		uint64_t GetBarCacheSettleCounts();
+		void CollectRetiredBarCaches();
+		void AcceptPublishedBarCache();
+		bool IsBarCacheInUse();
+		bool TryStartCachedBar(uint32_t blockOffset, float* output, uint32_t frameCount);
+		void DissolveCachedBar();
+
+	};
+}
@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "BarCache.h"
+
+audio::BarCache::BarCache(double samplesPerBeat, int beatsPerBar, const ToneSetView& toneSet) :
+	m_samplesPerBeat(samplesPerBeat),
+	m_beatsPerBar(beatsPerBar),
+	m_toneSet(toneSet),
+	m_variants(),
+	m_memoryBytes(0)
+{
+}
+
+/// <summary>
+/// Render every bar variant that can occur at this tempo. A bar starting at fractional position f (in samples,
+/// relative to the tempo anchor) has its beats at llround(f + k * samplesPerBeat) - llround(f). That pattern only
+/// changes where some f + k * samplesPerBeat crosses a half sample, so evaluating f at the midpoint of each
+/// interval between those crossings finds all of them.
+/// </summary>
+std::unique_ptr<audio::BarCache> audio::BarCache::Build(double samplesPerBeat, int beatsPerBar, const ToneSetView& toneSet)
+{
+	if (toneSet.accent.length == 0 && toneSet.normal.length == 0) {
+		return nullptr;
+	}
+
+	std::vector<double> crossings = { 0.0, 1.0 };
+	for (int beat = 0; beat < beatsPerBar; beat++) {
+		const double crossing = 0.5 - (double)beat * samplesPerBeat;
+		crossings.push_back(crossing - floor(crossing));
+	}
+	std::sort(crossings.begin(), crossings.end());
+
+	// Synthesised and compressed clicks are rendered once for all the variants; they render the same from any
+	// position, so the cached bars still match clicks started live
+	std::vector<float> rendered[2];
+	const float* clickSamples[2] = { toneSet.accent.samples, toneSet.normal.samples };
+	const SampleView* clicks[2] = { &toneSet.accent, &toneSet.normal };
+	for (int i = 0; i < 2; i++) {
+		if (clicks[i]->synth != nullptr) {
+			rendered[i].resize(clicks[i]->length);
+			clicks[i]->synth->Render(0, clicks[i]->length, rendered[i].data());
+			clickSamples[i] = rendered[i].data();
+		} else if (clicks[i]->compressed != nullptr) {
+			AdpcmCursor cursor = { 0, 0, 0 };
+			rendered[i].resize(clicks[i]->length);
+			clicks[i]->compressed->Decode(cursor, 0, clicks[i]->length, rendered[i].data());
+			clickSamples[i] = rendered[i].data();
+		}
+	}
+
+	std::unique_ptr<BarCache> cache(new BarCache(samplesPerBeat, beatsPerBar, toneSet));
+	for (size_t i = 0; i + 1 < crossings.size(); i++) {
+		if (crossings[i + 1] - crossings[i] < 1e-9) {
+			continue;
+		}
+		const double startFraction = 0.5 * (crossings[i] + crossings[i + 1]);
+		const long long startSample = llround(startFraction);
+
+		std::vector<uint32_t> beatOffsets(beatsPerBar);
+		for (int beat = 0; beat < beatsPerBar; beat++) {
+			beatOffsets[beat] = (uint32_t)(llround(startFraction + (double)beat * samplesPerBeat) - startSample);
+		}
+		bool isDuplicate = false;
+		for (const BarCacheVariant& variant : cache->m_variants) {
+			isDuplicate = isDuplicate || variant.beatOffsets == beatOffsets;
+		}
+		if (isDuplicate) {
+			continue;
+		}
+
+		// Merge the clicks' extents into spans; offsets are ascending so each click either extends the last span
+		// or starts a new one
+		std::vector<std::pair<uint32_t, uint32_t>> extents;
+		for (int beat = 0; beat < beatsPerBar; beat++) {
+			const uint32_t clickLength = (beat == 0 ? toneSet.accent : toneSet.normal).length;
+			if (clickLength == 0) {
+				continue;
+			}
+			if (!extents.empty() && beatOffsets[beat] <= extents.back().second) {
+				extents.back().second = max(extents.back().second, beatOffsets[beat] + clickLength);
+			} else {
+				extents.push_back({ beatOffsets[beat], beatOffsets[beat] + clickLength });
+			}
+		}
+
+		if (extents.empty()) {
+			return nullptr;
+		}
+
+		BarCacheVariant variant = { beatOffsets, {}, {}, extents.back().second };
+		size_t sampleCount = 0;
+		for (const auto& extent : extents) {
+			sampleCount += extent.second - extent.first;
+		}
+		cache->m_memoryBytes += sampleCount * sizeof(float) + extents.size() * sizeof(BarCacheSpan) + beatsPerBar * sizeof(uint32_t);
+		if (cache->m_memoryBytes > MaxMemoryBytes) {
+			return nullptr;
+		}
+
+		variant.samples.resize(sampleCount, 0.0f);
+		uint32_t sampleOffset = 0;
+		for (const auto& extent : extents) {
+			variant.spans.push_back({ extent.first, extent.second - extent.first, sampleOffset });
+			sampleOffset += extent.second - extent.first;
+		}
+		for (int beat = 0; beat < beatsPerBar; beat++) {
+			const SampleView& click = beat == 0 ? toneSet.accent : toneSet.normal;
+			const float* samples = clickSamples[beat == 0 ? 0 : 1];
+			for (const BarCacheSpan& span : variant.spans) {
+				if (beatOffsets[beat] >= span.barOffset && beatOffsets[beat] < span.barOffset + span.length) {
+					float* destination = variant.samples.data() + span.sampleOffset + (beatOffsets[beat] - span.barOffset);
+					for (uint32_t sample = 0; sample < click.length; sample++) {
+						destination[sample] += samples[sample];
+					}
+				}
+			}
+		}
+		cache->m_variants.push_back(std::move(variant));
+	}
+	return cache;
+}
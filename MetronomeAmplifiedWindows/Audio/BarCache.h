@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ToneSets/ToneSetView.h"
+
+namespace audio {
+
+	// A stretch of a cached bar where at least one click is sounding; silence between clicks is not stored
+	struct BarCacheSpan {
+		uint32_t barOffset;
+		uint32_t length;
+		uint32_t sampleOffset;
+	};
+
+	// One bar of clicks pre-mixed into mono spans, for one particular rounding of beat positions.
+	// beatOffsets[k] is the sample offset of beat k from the start of the bar, and length runs to the end of the
+	// last click, which may be past the start of the next bar.
+	struct BarCacheVariant {
+		std::vector<uint32_t> beatOffsets;
+		std::vector<BarCacheSpan> spans;
+		std::vector<float> samples;
+		uint32_t length;
+	};
+
+	// Immutable set of pre-rendered bars for one tempo, time signature and tone set. When a beat lands between two samples,
+	// the beat positions within a bar round differently depending on where the bar starts, so one variant is
+	// rendered for each distinct rounding pattern. The audio thread picks the variant matching the bar about
+	// to play and plays it as a single voice, which matches starting each click separately up to the rounding of
+	// float additions where clicks overlap.
+	class BarCache {
+	public:
+		static const size_t MaxMemoryBytes = 32 * 1024 * 1024;
+
+		// Returns null if there is nothing to cache or the cache would exceed MaxMemoryBytes
+		static std::unique_ptr<BarCache> Build(double samplesPerBeat, int beatsPerBar, const ToneSetView& toneSet);
+
+		inline bool Matches(double samplesPerBeat, int beatsPerBar, const ToneSetView& toneSet) const {
+			return m_samplesPerBeat == samplesPerBeat && m_beatsPerBar == beatsPerBar && m_toneSet == toneSet;
+		}
+		inline const ToneSetView& GetToneSet() const { return m_toneSet; }
+		inline const std::vector<BarCacheVariant>& GetVariants() const { return m_variants; }
+		inline size_t GetMemoryBytes() const { return m_memoryBytes; }
+
+	private:
+		double m_samplesPerBeat;
+		int m_beatsPerBar;
+		ToneSetView m_toneSet;
+		std::vector<BarCacheVariant> m_variants;
+		size_t m_memoryBytes;
+
+		BarCache(double samplesPerBeat, int beatsPerBar, const ToneSetView& toneSet);
+	};
+
+	// Counters describing how often playback was served from the bar cache. Bar counts only include bars
+	// started while playing; invalidations count the times a matching cache went stale, and builds the caches
+	// rendered on the UI thread.
+	struct BarCacheStatistics {
+		uint64_t cachedBars;
+		uint64_t liveBars;
+		uint64_t invalidations;
+		uint64_t builds;
+		size_t memoryBytes;
+	};
+}
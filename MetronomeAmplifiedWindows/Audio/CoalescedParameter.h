@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+
+namespace audio {
+
+	// Changes asked for, those overtaken by a later change before the audio thread took them, and those taken
+	struct ParameterChangeStatistics {
+		uint64_t requested;
+		uint64_t coalesced;
+		uint64_t applied;
+	};
+
+	// A setting the UI thread can change as often as it likes, such as the tempo while its slider is dragged,
+	// which the audio thread takes at most once a block. Changes made between two blocks are coalesced into the
+	// last of them, so they never take up room in the command queue. Neither side ever waits.
+	class CoalescedParameter {
+	public:
+		explicit CoalescedParameter(double value) :
+			m_value(value),
+			m_isPending(false),
+			m_requestedCount(0),
+			m_coalescedCount(0),
+			m_appliedCount(0)
+		{
+		}
+
+		// UI thread
+		void Set(double value) {
+			m_value.store(value, std::memory_order_relaxed);
+			m_requestedCount.fetch_add(1, std::memory_order_relaxed);
+			if (m_isPending.exchange(true, std::memory_order_acq_rel)) {
+				m_coalescedCount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		// UI thread. Drops the change waiting, if any, when a command about to be sent overrides it.
+		void Discard() {
+			if (m_isPending.exchange(false, std::memory_order_acq_rel)) {
+				m_coalescedCount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		// Audio thread. Takes the latest change if one is waiting.
+		bool TryTake(double& value) {
+			if (!m_isPending.load(std::memory_order_relaxed) || !m_isPending.exchange(false, std::memory_order_acq_rel)) {
+				return false;
+			}
+			value = m_value.load(std::memory_order_relaxed);
+			m_appliedCount.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		ParameterChangeStatistics GetStatistics() const {
+			return {
+				m_requestedCount.load(std::memory_order_relaxed),
+				m_coalescedCount.load(std::memory_order_relaxed),
+				m_appliedCount.load(std::memory_order_relaxed)
+			};
+		}
+
+	private:
+		std::atomic<double> m_value;
+		std::atomic<bool> m_isPending;
+		std::atomic<uint64_t> m_requestedCount;
+		std::atomic<uint64_t> m_coalescedCount;
+		std::atomic<uint64_t> m_appliedCount;
+	};
+}
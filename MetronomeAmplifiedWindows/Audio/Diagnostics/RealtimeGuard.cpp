@@ -0,0 +1,306 @@
+#include "pch.h"
+#include "RealtimeGuard.h"
+
+#include <cstdio>
+#include <new>
+
+#if defined(AUDIO_REALTIME_CHECKS) && !defined(_WIN32)
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+	thread_local bool t_isRealtime = false;
+
+	std::atomic<uint64_t> g_violationCount(0);
+	audio::RealtimeViolation g_violations[audio::MaxRecordedRealtimeViolations];
+	std::atomic<bool> g_isViolationRecorded[audio::MaxRecordedRealtimeViolations];
+
+	const char* GetTypeName(audio::RealtimeViolationType type)
+	{
+		switch (type) {
+		case audio::RealtimeViolationType::ALLOCATION: return "allocation";
+		case audio::RealtimeViolationType::DEALLOCATION: return "deallocation";
+		case audio::RealtimeViolationType::LOCK: return "lock";
+		case audio::RealtimeViolationType::SYSTEM_CALL: return "system call";
+		}
+		return "unknown";
+	}
+
+	int CaptureStack(void** frames, int maxFrames)
+	{
+#if !defined(AUDIO_REALTIME_CHECKS)
+		return 0;
+#elif defined(_WIN32)
+		return (int)RtlCaptureStackBackTrace(2, (ULONG)maxFrames, frames, nullptr);
+#else
+		return backtrace(frames, maxFrames);
+#endif
+	}
+
+#if defined(AUDIO_REALTIME_CHECKS) && !defined(_WIN32)
+	// The first backtrace loads the unwinder, which allocates, so get that done before any thread is real-time
+	const int BacktraceWarmUp = []() {
+		void* frame;
+		return backtrace(&frame, 1);
+	}();
+
+	// The C library's own definition of a function interposed below, looked up once
+	template<typename TFunction>
+	TFunction* FindNextDefinition(std::atomic<void*>& cache, const char* name)
+	{
+		void* function = cache.load(std::memory_order_relaxed);
+		if (function == nullptr) {
+			function = dlsym(RTLD_NEXT, name);
+			cache.store(function, std::memory_order_relaxed);
+		}
+		return (TFunction*)function;
+	}
+#endif
+}
+
+audio::RealtimeScope::RealtimeScope() :
+	m_wasRealtime(t_isRealtime)
+{
+	t_isRealtime = true;
+}
+
+audio::RealtimeScope::~RealtimeScope()
+{
+	t_isRealtime = m_wasRealtime;
+}
+
+bool audio::AreRealtimeChecksEnabled()
+{
+#if defined(AUDIO_REALTIME_CHECKS)
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool audio::IsRealtimeThread()
+{
+	return t_isRealtime;
+}
+
+uint64_t audio::GetRealtimeViolationCount()
+{
+	return g_violationCount.load(std::memory_order_relaxed);
+}
+
+void audio::ReportRealtimeViolation(RealtimeViolationType type, const char* function)
+{
+	// Anything the hooks catch while this one is being recorded is not a violation of its own
+	const bool wasRealtime = t_isRealtime;
+	t_isRealtime = false;
+	const uint64_t index = g_violationCount.fetch_add(1, std::memory_order_relaxed);
+	if (index < MaxRecordedRealtimeViolations) {
+		RealtimeViolation& violation = g_violations[index];
+		violation.type = type;
+		violation.function = function;
+		violation.stackFrameCount = CaptureStack(violation.stackFrames, RealtimeViolation::MaxStackFrames);
+		g_isViolationRecorded[index].store(true, std::memory_order_release);
+	}
+	t_isRealtime = wasRealtime;
+}
+
+std::vector<audio::RealtimeViolation> audio::GetRealtimeViolations()
+{
+	std::vector<RealtimeViolation> violations;
+	const uint64_t count = min(GetRealtimeViolationCount(), (uint64_t)MaxRecordedRealtimeViolations);
+	for (uint64_t i = 0; i < count; i++) {
+		if (g_isViolationRecorded[i].load(std::memory_order_acquire)) {
+			violations.push_back(g_violations[i]);
+		}
+	}
+	return violations;
+}
+
+void audio::ClearRealtimeViolations()
+{
+	for (std::atomic<bool>& isRecorded : g_isViolationRecorded) {
+		isRecorded.store(false, std::memory_order_relaxed);
+	}
+	g_violationCount.store(0, std::memory_order_release);
+}
+
+void audio::LogRealtimeViolations()
+{
+	const std::vector<RealtimeViolation> violations = GetRealtimeViolations();
+	const uint64_t count = GetRealtimeViolationCount();
+	char line[256];
+	for (const RealtimeViolation& violation : violations) {
+		snprintf(line, sizeof(line), "Real-time violation: %s in %s\n", GetTypeName(violation.type), violation.function);
+#if defined(_WIN32)
+		OutputDebugStringA(line);
+		for (int frame = 0; frame < violation.stackFrameCount; frame++) {
+			snprintf(line, sizeof(line), "    %p\n", violation.stackFrames[frame]);
+			OutputDebugStringA(line);
+		}
+#else
+		fputs(line, stderr);
+		fflush(stderr);
+#if defined(AUDIO_REALTIME_CHECKS)
+		backtrace_symbols_fd(violation.stackFrames, violation.stackFrameCount, fileno(stderr));
+#endif
+#endif
+	}
+	if (count > violations.size()) {
+		snprintf(line, sizeof(line), "%llu further real-time violations were counted but not recorded\n", (unsigned long long)(count - violations.size()));
+#if defined(_WIN32)
+		OutputDebugStringA(line);
+#else
+		fputs(line, stderr);
+#endif
+	}
+}
+
+#if defined(AUDIO_REALTIME_CHECKS)
+
+// Replacements for the global allocation functions, which every C++ allocation in the app goes through
+
+void* operator new(size_t size)
+{
+	if (t_isRealtime) {
+		audio::ReportRealtimeViolation(audio::RealtimeViolationType::ALLOCATION, "operator new");
+	}
+	void* memory = malloc(size > 0 ? size : 1);
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	if (t_isRealtime) {
+		audio::ReportRealtimeViolation(audio::RealtimeViolationType::ALLOCATION, "operator new");
+	}
+	return malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	if (t_isRealtime) {
+		audio::ReportRealtimeViolation(audio::RealtimeViolationType::ALLOCATION, "operator new");
+	}
+#if defined(_WIN32)
+	void* memory = _aligned_malloc(size > 0 ? size : 1, (size_t)alignment);
+#else
+	void* memory = nullptr;
+	if (posix_memalign(&memory, max((size_t)alignment, sizeof(void*)), size > 0 ? size : 1) != 0) {
+		memory = nullptr;
+	}
+#endif
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (memory != nullptr && t_isRealtime) {
+		audio::ReportRealtimeViolation(audio::RealtimeViolationType::DEALLOCATION, "operator delete");
+	}
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	if (memory != nullptr && t_isRealtime) {
+		audio::ReportRealtimeViolation(audio::RealtimeViolationType::DEALLOCATION, "operator delete");
+	}
+#if defined(_WIN32)
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+#if !defined(_WIN32)
+
+// Interposers for the C library calls that can block: each reports the call if made on a real-time thread,
+// then forwards to the library's own definition. Exception specifications match the library's declarations.
+#define REALTIME_INTERPOSE(type, ReturnType, name, parameters, arguments, ...) \
+	extern "C" ReturnType name parameters __VA_ARGS__ \
+	{ \
+		static std::atomic<void*> next(nullptr); \
+		if (t_isRealtime) { \
+			audio::ReportRealtimeViolation(audio::RealtimeViolationType::type, #name); \
+		} \
+		return FindNextDefinition<ReturnType parameters>(next, #name) arguments; \
+	}
+
+REALTIME_INTERPOSE(LOCK, int, pthread_mutex_lock, (pthread_mutex_t* mutex), (mutex), noexcept)
+REALTIME_INTERPOSE(LOCK, int, pthread_rwlock_rdlock, (pthread_rwlock_t* lock), (lock), noexcept)
+REALTIME_INTERPOSE(LOCK, int, pthread_rwlock_wrlock, (pthread_rwlock_t* lock), (lock), noexcept)
+REALTIME_INTERPOSE(LOCK, int, pthread_cond_wait, (pthread_cond_t* condition, pthread_mutex_t* mutex), (condition, mutex))
+REALTIME_INTERPOSE(LOCK, int, pthread_cond_timedwait, (pthread_cond_t* condition, pthread_mutex_t* mutex, const timespec* time), (condition, mutex, time))
+REALTIME_INTERPOSE(LOCK, int, sem_wait, (sem_t* semaphore), (semaphore))
+REALTIME_INTERPOSE(SYSTEM_CALL, ssize_t, read, (int file, void* buffer, size_t size), (file, buffer, size))
+REALTIME_INTERPOSE(SYSTEM_CALL, ssize_t, write, (int file, const void* buffer, size_t size), (file, buffer, size))
+REALTIME_INTERPOSE(SYSTEM_CALL, int, poll, (pollfd* files, nfds_t count, int timeout), (files, count, timeout))
+REALTIME_INTERPOSE(SYSTEM_CALL, int, nanosleep, (const timespec* duration, timespec* remaining), (duration, remaining))
+REALTIME_INTERPOSE(SYSTEM_CALL, int, clock_nanosleep, (clockid_t clock, int flags, const timespec* time, timespec* remaining), (clock, flags, time, remaining))
+REALTIME_INTERPOSE(SYSTEM_CALL, int, usleep, (useconds_t duration), (duration))
+REALTIME_INTERPOSE(SYSTEM_CALL, int, sched_yield, (), (), noexcept)
+REALTIME_INTERPOSE(SYSTEM_CALL, void*, mmap, (void* address, size_t length, int protection, int flags, int file, off_t offset), (address, length, protection, flags, file, offset), noexcept)
+REALTIME_INTERPOSE(SYSTEM_CALL, int, munmap, (void* address, size_t length), (address, length), noexcept)
+
+#endif
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+
+namespace audio {
+
+	// Things done on a real-time thread that can block it for an unbounded time
+	enum class RealtimeViolationType : uint8_t {
+		ALLOCATION,
+		DEALLOCATION,
+		LOCK,
+		SYSTEM_CALL
+	};
+
+	struct RealtimeViolation {
+		static const int MaxStackFrames = 24;
+
+		RealtimeViolationType type;
+		const char* function;
+		int stackFrameCount;
+		void* stackFrames[MaxStackFrames];
+	};
+
+	const size_t MaxRecordedRealtimeViolations = 64;
+
+	// Marks the calling thread as real-time while in scope. Scopes nest.
+	// Built with AUDIO_REALTIME_CHECKS, the app replaces the global allocation functions, and on Linux also
+	// interposes the C library's lock, wait, sleep and I/O calls, so that any of them made on a marked thread is
+	// caught. Every violation is counted, and the first MaxRecordedRealtimeViolations are kept with their stacks
+	// to be logged later from an ordinary thread, as logging on the spot would block the audio thread itself.
+	// Without the define, scopes only mark the thread and nothing is caught.
+	class RealtimeScope {
+	public:
+		RealtimeScope();
+		~RealtimeScope();
+
+		RealtimeScope(const RealtimeScope&) = delete;
+		RealtimeScope& operator=(const RealtimeScope&) = delete;
+
+	private:
+		bool m_wasRealtime;
+	};
+
+	bool AreRealtimeChecksEnabled();
+	bool IsRealtimeThread();
+	uint64_t GetRealtimeViolationCount();
+
+	// Called by the hooks. Records the calling thread's stack without allocating.
+	void ReportRealtimeViolation(RealtimeViolationType type, const char* function);
+
+	// Only while no real-time thread is running
+	std::vector<RealtimeViolation> GetRealtimeViolations();
+	void ClearRealtimeViolations();
+
+	// Writes each recorded violation and its stack to stderr, or to the debugger output on Windows
+	void LogRealtimeViolations();
+}
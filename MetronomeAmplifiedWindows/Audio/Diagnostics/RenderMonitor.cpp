@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "RenderMonitor.h"
+#include "RealtimeGuard.h"
+
+audio::RenderLoadHistogram::RenderLoadHistogram() :
+	m_buckets(),
+	m_count(0)
+{
+	Reset();
+}
+
+void audio::RenderLoadHistogram::Record(double loadPercent)
+{
+	const double position = loadPercent * BucketsPerPercent;
+	const int bucket = position < (double)(BucketCount - 1) ? (int)max(0.0, position) : BucketCount - 1;
+	m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_release);
+}
+
+uint64_t audio::RenderLoadHistogram::GetCount() const
+{
+	return m_count.load(std::memory_order_acquire);
+}
+
+double audio::RenderLoadHistogram::GetPercentile(double percentile) const
+{
+	uint64_t counts[BucketCount];
+	uint64_t total = 0;
+	for (int i = 0; i < BucketCount; i++) {
+		counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	if (total == 0) {
+		return 0.0;
+	}
+	const uint64_t rank = max((uint64_t)1, (uint64_t)ceil(percentile / 100.0 * (double)total));
+	uint64_t seen = 0;
+	for (int i = 0; i < BucketCount; i++) {
+		seen += counts[i];
+		if (seen >= rank) {
+			return (double)(i + 1) / BucketsPerPercent;
+		}
+	}
+	return (double)BucketCount / BucketsPerPercent;
+}
+
+void audio::RenderLoadHistogram::Reset()
+{
+	for (std::atomic<uint64_t>& bucket : m_buckets) {
+		bucket.store(0, std::memory_order_relaxed);
+	}
+	m_count.store(0, std::memory_order_relaxed);
+}
+
+audio::RenderMonitor::RenderMonitor(AudioSource* source, uint32_t sampleRate) :
+	m_source(source),
+	m_sampleRate(sampleRate),
+	m_clock(),
+	m_clockFrequency(m_clock.GetFrequency()),
+	m_loads(),
+	m_xrunCount(0),
+	m_maxRenderCounts(0)
+{
+}
+
+void audio::RenderMonitor::Render(float* output, uint32_t frameCount)
+{
+	const uint64_t start = m_clock.GetCounter();
+	{
+		RealtimeScope scope;
+		m_source->Render(output, frameCount);
+	}
+	const uint64_t elapsed = m_clock.GetCounter() - start;
+
+	const double deadlineCounts = (double)frameCount * m_clockFrequency / m_sampleRate;
+	m_loads.Record(100.0 * (double)elapsed / deadlineCounts);
+	if ((double)elapsed > deadlineCounts) {
+		m_xrunCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (elapsed > m_maxRenderCounts.load(std::memory_order_relaxed)) {
+		m_maxRenderCounts.store(elapsed, std::memory_order_relaxed);
+	}
+}
+
+double audio::RenderMonitor::GetMaxRenderSeconds() const
+{
+	return (double)m_maxRenderCounts.load(std::memory_order_relaxed) / m_clockFrequency;
+}
+
+void audio::RenderMonitor::Reset()
+{
+	m_loads.Reset();
+	m_xrunCount.store(0, std::memory_order_relaxed);
+	m_maxRenderCounts.store(0, std::memory_order_relaxed);
+}
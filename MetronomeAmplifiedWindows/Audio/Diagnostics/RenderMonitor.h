@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../Sinks/BaseSink.h"
+#include "../../Common/ClockSource.h"
+
+#include <atomic>
+
+namespace audio {
+
+	// Render times as a percentage of the block's deadline, in quarter-percent buckets up to twice the deadline
+	// with one more for anything slower. Recording is lock-free, so the audio thread can record while others read.
+	class RenderLoadHistogram {
+	public:
+		static const int BucketsPerPercent = 4;
+		static const int BucketCount = 200 * BucketsPerPercent + 1;
+
+		RenderLoadHistogram();
+
+		void Record(double loadPercent);
+		uint64_t GetCount() const;
+
+		// Upper edge of the bucket holding the given percentile, in percent, or above 200 for the slowest bucket
+		double GetPercentile(double percentile) const;
+
+		// Only while nothing is recording
+		void Reset();
+
+	private:
+		std::atomic<uint64_t> m_buckets[BucketCount];
+		std::atomic<uint64_t> m_count;
+	};
+
+	// Wraps the source a sink renders, marking the audio thread real-time while the source renders and timing
+	// each callback against its deadline, the length of the block at the sample rate. A callback that runs past
+	// its deadline would have left the device short of audio, and counts as an xrun.
+	class RenderMonitor : public AudioSource {
+	public:
+		RenderMonitor(AudioSource* source, uint32_t sampleRate);
+
+		virtual void Render(float* output, uint32_t frameCount) override;
+
+		inline const RenderLoadHistogram& GetLoadHistogram() const { return m_loads; }
+		inline uint64_t GetCallbackCount() const { return m_loads.GetCount(); }
+		inline uint64_t GetXrunCount() const { return m_xrunCount.load(std::memory_order_relaxed); }
+		double GetMaxRenderSeconds() const;
+
+		// Only while nothing is rendering
+		void Reset();
+
+	private:
+		AudioSource* m_source;
+		uint32_t m_sampleRate;
+		DX::DefaultClock m_clock;
+		uint64_t m_clockFrequency;
+		RenderLoadHistogram m_loads;
+		std::atomic<uint64_t> m_xrunCount;
+		std::atomic<uint64_t> m_maxRenderCounts;
+	};
+}
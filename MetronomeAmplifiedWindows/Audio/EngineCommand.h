@@ -0,0 +1,25 @@
+#pragma once
+
+namespace audio {
+
+	enum class CommandType {
+		PLAY,
+		PAUSE,
+		STOP,
+		SET_BEATS_PER_BAR,
+		SET_TEMPO_RAMP,
+		SET_SONG_TIMELINE,
+		SEEK,
+		SET_STOP_TIMER,
+		SET_STOP_TIMER_AT_BAR,
+		CANCEL_STOP_TIMER
+	};
+
+	// A control message sent from the UI thread to the audio thread. SET_TEMPO_RAMP and SET_SONG_TIMELINE carry
+	// no value; they mark where in the command order to take the next ramp or timeline from the engine's queue for
+	// it. SEEK carries a sample position in the song, and the stop timers a number of frames to play.
+	struct EngineCommand {
+		CommandType type;
+		double value;
+	};
+}
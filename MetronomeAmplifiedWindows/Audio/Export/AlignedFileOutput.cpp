@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "AlignedFileOutput.h"
+
+audio::AlignedFileOutput::AlignedFileOutput(const std::string& filePath) :
+	m_file(),
+	m_buffer(new (std::align_val_t(Alignment)) byte[BlockBytes]),
+	m_bufferedBytes(0),
+	m_flushedBytes(0)
+{
+	// Must come before opening to take effect; whole blocks then go straight to the OS
+	m_file.rdbuf()->pubsetbuf(nullptr, 0);
+	m_file.open(filePath, std::ios::binary | std::ios::trunc);
+	if (!m_file) {
+		throw std::runtime_error("Cannot open file for writing");
+	}
+}
+
+// Errors writing the last block go unreported here; call Close first to see them
+audio::AlignedFileOutput::~AlignedFileOutput()
+{
+	if (m_file.is_open()) {
+		Flush();
+		m_file.close();
+	}
+}
+
+void audio::AlignedFileOutput::Append(const void* data, size_t size)
+{
+	const byte* source = (const byte*)data;
+	while (size > 0) {
+		const size_t bytes = min(size, BlockBytes - m_bufferedBytes);
+		memcpy(m_buffer.get() + m_bufferedBytes, source, bytes);
+		m_bufferedBytes += bytes;
+		source += bytes;
+		size -= bytes;
+		if (m_bufferedBytes == BlockBytes && !Flush()) {
+			throw std::runtime_error("Cannot write file");
+		}
+	}
+}
+
+void audio::AlignedFileOutput::Patch(uint64_t offset, const void* data, size_t size)
+{
+	if (offset + size > GetSize()) {
+		throw std::runtime_error("Cannot patch past the end of the file");
+	}
+	if (!Flush()) {
+		throw std::runtime_error("Cannot write file");
+	}
+	m_file.seekp((std::streamoff)offset);
+	m_file.write((const char*)data, (std::streamsize)size);
+	m_file.seekp(0, std::ios::end);
+	if (!m_file) {
+		throw std::runtime_error("Cannot write file");
+	}
+}
+
+void audio::AlignedFileOutput::Close()
+{
+	if (!m_file.is_open()) {
+		return;
+	}
+	const bool isWritten = Flush();
+	m_file.close();
+	if (!isWritten || !m_file) {
+		throw std::runtime_error("Cannot write file");
+	}
+}
+
+bool audio::AlignedFileOutput::Flush()
+{
+	if (m_bufferedBytes > 0) {
+		m_file.write((const char*)m_buffer.get(), (std::streamsize)m_bufferedBytes);
+		m_flushedBytes += m_bufferedBytes;
+		m_bufferedBytes = 0;
+	}
+	return !m_file.fail();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+
+namespace audio {
+
+	// Writes a file in large blocks from a buffer aligned to the storage device's pages, bypassing the stream's
+	// own buffering. Every write but the last is BlockBytes long and starts at a multiple of BlockBytes in the
+	// file, so headers should be appended first and patched once their contents are known.
+	class AlignedFileOutput {
+	public:
+		static const size_t BlockBytes = 1 << 20;
+		static const size_t Alignment = 4096;
+
+		// Throws std::runtime_error if the file cannot be created
+		explicit AlignedFileOutput(const std::string& filePath);
+		~AlignedFileOutput();
+		AlignedFileOutput(const AlignedFileOutput&) = delete;
+		AlignedFileOutput& operator=(const AlignedFileOutput&) = delete;
+
+		void Append(const void* data, size_t size);
+
+		// Writes out whatever is buffered, then overwrites bytes already appended. Meant for finishing a file,
+		// as blocks appended afterwards are no longer aligned.
+		void Patch(uint64_t offset, const void* data, size_t size);
+
+		// Throws std::runtime_error if anything failed to write
+		void Close();
+
+		inline uint64_t GetSize() const { return m_flushedBytes + m_bufferedBytes; }
+		inline bool IsOpen() const { return m_file.is_open(); }
+
+	private:
+		struct AlignedDelete {
+			void operator()(byte* buffer) const { operator delete[](buffer, std::align_val_t(Alignment)); }
+		};
+
+		std::ofstream m_file;
+		std::unique_ptr<byte[], AlignedDelete> m_buffer;
+		size_t m_bufferedBytes;
+		uint64_t m_flushedBytes;
+
+		bool Flush();
+	};
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace audio {
+
+	// Destination for exported audio, fed interleaved float blocks in order from one thread
+	class AudioWriter {
+	public:
+		virtual ~AudioWriter() {}
+		virtual void Write(const float* samples, uint64_t frameCount) = 0;
+	};
+}
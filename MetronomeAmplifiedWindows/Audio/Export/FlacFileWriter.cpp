@@ -0,0 +1,411 @@
+#include "pch.h"
+#include "FlacFileWriter.h"
+
+#include <array>
+
+namespace {
+
+	// Writes big-endian bit fields, as used throughout FLAC frames
+	class BitWriter {
+	private:
+		std::vector<byte>& m_bytes;
+		uint64_t m_accumulator;
+		int m_bitCount;
+
+	public:
+		explicit BitWriter(std::vector<byte>& bytes) : m_bytes(bytes), m_accumulator(0), m_bitCount(0) {}
+
+		// Up to 32 bits, most significant first
+		void WriteBits(uint32_t value, int count) {
+			m_accumulator = (m_accumulator << count) | (value & ((1ull << count) - 1));
+			m_bitCount += count;
+			while (m_bitCount >= 8) {
+				m_bitCount -= 8;
+				m_bytes.push_back((byte)(m_accumulator >> m_bitCount));
+			}
+		}
+
+		inline void WriteSignedBits(int32_t value, int count) {
+			WriteBits((uint32_t)value, count);
+		}
+
+		// Zero bits, then a one bit
+		void WriteUnary(uint32_t zeros) {
+			while (zeros >= 32) {
+				WriteBits(0, 32);
+				zeros -= 32;
+			}
+			WriteBits(1, (int)zeros + 1);
+		}
+
+		// Zig-zag folded residual: unary quotient, then the remainder in a fixed number of bits
+		void WriteRice(uint32_t folded, int parameter) {
+			const uint32_t quotient = folded >> parameter;
+			if ((uint64_t)quotient + 1 + parameter <= 32) {
+				WriteBits((1u << parameter) | (folded & ((1u << parameter) - 1)), (int)quotient + 1 + parameter);
+			} else {
+				WriteUnary(quotient);
+				WriteBits(folded, parameter);
+			}
+		}
+
+		// Frame and sample numbers use the UTF-8 style variable-length coding
+		void WriteUtf8Number(uint64_t value) {
+			if (value < 0x80) {
+				WriteBits((uint32_t)value, 8);
+				return;
+			}
+			int extraBytes = 1;
+			while (extraBytes < 6 && value >= (1ull << (6 * extraBytes + 6 - extraBytes))) {
+				extraBytes++;
+			}
+			const uint32_t lead = (0xff00u >> (extraBytes + 1)) & 0xff;
+			WriteBits(lead | (uint32_t)(value >> (6 * extraBytes)), 8);
+			for (int i = extraBytes - 1; i >= 0; i--) {
+				WriteBits(0x80 | (uint32_t)((value >> (6 * i)) & 0x3f), 8);
+			}
+		}
+
+		void AlignToByte() {
+			if (m_bitCount > 0) {
+				WriteBits(0, 8 - m_bitCount);
+			}
+		}
+	};
+
+	const std::array<uint8_t, 256> Crc8Table = []() {
+		std::array<uint8_t, 256> table = {};
+		for (int i = 0; i < 256; i++) {
+			uint8_t crc = (uint8_t)i;
+			for (int bit = 0; bit < 8; bit++) {
+				crc = (uint8_t)((crc & 0x80) != 0 ? (crc << 1) ^ 0x07 : crc << 1);
+			}
+			table[i] = crc;
+		}
+		return table;
+	}();
+
+	const std::array<uint16_t, 256> Crc16Table = []() {
+		std::array<uint16_t, 256> table = {};
+		for (int i = 0; i < 256; i++) {
+			uint16_t crc = (uint16_t)(i << 8);
+			for (int bit = 0; bit < 8; bit++) {
+				crc = (uint16_t)((crc & 0x8000) != 0 ? (crc << 1) ^ 0x8005 : crc << 1);
+			}
+			table[i] = crc;
+		}
+		return table;
+	}();
+
+	uint8_t Crc8(const byte* data, size_t size)
+	{
+		uint8_t crc = 0;
+		for (size_t i = 0; i < size; i++) {
+			crc = Crc8Table[crc ^ data[i]];
+		}
+		return crc;
+	}
+
+	uint16_t Crc16(const byte* data, size_t size)
+	{
+		uint16_t crc = 0;
+		for (size_t i = 0; i < size; i++) {
+			crc = (uint16_t)((crc << 8) ^ Crc16Table[(crc >> 8) ^ data[i]]);
+		}
+		return crc;
+	}
+
+	inline int32_t FixedResidual(const int32_t* x, uint32_t i, int order)
+	{
+		switch (order) {
+		case 1: return x[i] - x[i - 1];
+		case 2: return (int32_t)((int64_t)x[i] - 2 * (int64_t)x[i - 1] + x[i - 2]);
+		case 3: return (int32_t)((int64_t)x[i] - 3 * (int64_t)x[i - 1] + 3 * (int64_t)x[i - 2] - x[i - 3]);
+		case 4: return (int32_t)((int64_t)x[i] - 4 * (int64_t)x[i - 1] + 6 * (int64_t)x[i - 2] - 4 * (int64_t)x[i - 3] + x[i - 4]);
+		default: return x[i];
+		}
+	}
+
+	inline uint32_t Fold(int32_t residual)
+	{
+		return ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+	}
+
+	enum class SubframeType {
+		CONSTANT,
+		VERBATIM,
+		FIXED
+	};
+
+	// How one channel of a frame is to be coded, and what that costs in bits
+	struct SubframePlan {
+		SubframeType type;
+		int order;
+		int partitionOrder;
+		bool isRice2;
+		uint64_t bits;
+		uint8_t parameters[1 << audio::FlacFileWriter::MaxPartitionOrder];
+	};
+
+	// Rice parameter with the fewest bits for a partition, counting each quotient as if the partition's sum were
+	// spread evenly, which never undercounts
+	int ChooseRiceParameter(uint64_t sum, uint32_t count, uint64_t& bits)
+	{
+		int best = 0;
+		bits = UINT64_MAX;
+		for (int parameter = 0; parameter <= 30; parameter++) {
+			const uint64_t cost = (uint64_t)count * (parameter + 1) + (sum >> parameter);
+			if (cost < bits) {
+				bits = cost;
+				best = parameter;
+			}
+		}
+		return best;
+	}
+
+	SubframePlan PlanSubframe(const int32_t* x, uint32_t n, int bitsPerSample)
+	{
+		SubframePlan plan = {};
+		plan.type = SubframeType::CONSTANT;
+		plan.bits = 8 + bitsPerSample;
+		if (std::all_of(x, x + n, [x](int32_t sample) { return sample == x[0]; })) {
+			return plan;
+		}
+		plan.type = SubframeType::VERBATIM;
+		plan.bits = 8 + (uint64_t)n * bitsPerSample;
+
+		// Pick the predictor order with the smallest residual, compared over the same samples
+		const int maxOrder = (int)min(4u, n - 1);
+		uint64_t absoluteSums[5] = {};
+		for (uint32_t i = maxOrder; i < n; i++) {
+			for (int order = 0; order <= maxOrder; order++) {
+				absoluteSums[order] += (uint64_t)llabs(FixedResidual(x, i, order));
+			}
+		}
+		const int order = (int)(std::min_element(absoluteSums, absoluteSums + maxOrder + 1) - absoluteSums);
+
+		// Sums of folded residuals for the finest partitioning, merged pairwise for each coarser one
+		int maxPartitionOrder = 0;
+		while (maxPartitionOrder < audio::FlacFileWriter::MaxPartitionOrder && n % (2u << maxPartitionOrder) == 0 &&
+			(n >> (maxPartitionOrder + 1)) >= (uint32_t)order) {
+			maxPartitionOrder++;
+		}
+		uint64_t sums[1 << audio::FlacFileWriter::MaxPartitionOrder] = {};
+		const uint32_t finestSize = n >> maxPartitionOrder;
+		for (uint32_t i = order; i < n; i++) {
+			sums[i / finestSize] += Fold(FixedResidual(x, i, order));
+		}
+
+		for (int partitionOrder = maxPartitionOrder; partitionOrder >= 0; partitionOrder--) {
+			const uint32_t partitionCount = 1u << partitionOrder;
+			const uint32_t partitionSize = n >> partitionOrder;
+			uint8_t parameters[1 << audio::FlacFileWriter::MaxPartitionOrder];
+			uint64_t bits = 8 + (uint64_t)order * bitsPerSample + 2 + 4;
+			int maxParameter = 0;
+			for (uint32_t partition = 0; partition < partitionCount; partition++) {
+				uint64_t partitionBits;
+				parameters[partition] = (uint8_t)ChooseRiceParameter(sums[partition], partitionSize - (partition == 0 ? order : 0), partitionBits);
+				maxParameter = max(maxParameter, (int)parameters[partition]);
+				bits += partitionBits;
+			}
+			const bool isRice2 = maxParameter > 14;
+			bits += (uint64_t)partitionCount * (isRice2 ? 5 : 4);
+			if (bits < plan.bits) {
+				plan.type = SubframeType::FIXED;
+				plan.order = order;
+				plan.partitionOrder = partitionOrder;
+				plan.isRice2 = isRice2;
+				plan.bits = bits;
+				memcpy(plan.parameters, parameters, partitionCount);
+			}
+			for (uint32_t partition = 0; partition < partitionCount / 2; partition++) {
+				sums[partition] = sums[2 * partition] + sums[2 * partition + 1];
+			}
+		}
+		return plan;
+	}
+
+	void WriteSubframe(BitWriter& writer, const SubframePlan& plan, const int32_t* x, uint32_t n, int bitsPerSample)
+	{
+		writer.WriteBits(0, 1);
+		switch (plan.type) {
+		case SubframeType::CONSTANT:
+			writer.WriteBits(0, 6);
+			writer.WriteBits(0, 1);
+			writer.WriteSignedBits(x[0], bitsPerSample);
+			break;
+		case SubframeType::VERBATIM:
+			writer.WriteBits(1, 6);
+			writer.WriteBits(0, 1);
+			for (uint32_t i = 0; i < n; i++) {
+				writer.WriteSignedBits(x[i], bitsPerSample);
+			}
+			break;
+		case SubframeType::FIXED: {
+			writer.WriteBits(8 + plan.order, 6);
+			writer.WriteBits(0, 1);
+			for (int i = 0; i < plan.order; i++) {
+				writer.WriteSignedBits(x[i], bitsPerSample);
+			}
+			writer.WriteBits(plan.isRice2 ? 1 : 0, 2);
+			writer.WriteBits(plan.partitionOrder, 4);
+			const uint32_t partitionSize = n >> plan.partitionOrder;
+			uint32_t i = plan.order;
+			for (uint32_t partition = 0; partition < (1u << plan.partitionOrder); partition++) {
+				const int parameter = plan.parameters[partition];
+				writer.WriteBits(parameter, plan.isRice2 ? 5 : 4);
+				for (const uint32_t end = (partition + 1) * partitionSize; i < end; i++) {
+					writer.WriteRice(Fold(FixedResidual(x, i, plan.order)), parameter);
+				}
+			}
+			break;
+		}
+		}
+	}
+}
+
+audio::FlacFileWriter::FlacFileWriter(const std::string& filePath, uint32_t sampleRate, uint32_t channelCount, uint32_t bitsPerSample) :
+	m_output(filePath),
+	m_sampleRate(sampleRate),
+	m_channelCount(channelCount),
+	m_bitsPerSample(bitsPerSample),
+	m_framesWritten(0),
+	m_frameNumber(0),
+	m_minFrameBytes(0),
+	m_maxFrameBytes(0),
+	m_pending((size_t)BlockFrames * channelCount),
+	m_pendingFrames(0),
+	m_side(BlockFrames),
+	m_frame()
+{
+	if (bitsPerSample != 16 && bitsPerSample != 24) {
+		throw std::runtime_error("FLAC export supports 16 or 24 bits per sample");
+	}
+	if (channelCount < 1 || channelCount > 8) {
+		throw std::runtime_error("FLAC supports 1 to 8 channels");
+	}
+	const std::vector<byte> streamInfo = MakeStreamInfo();
+	m_output.Append(streamInfo.data(), streamInfo.size());
+}
+
+// Errors cannot be reported from here; call Finish to see them
+audio::FlacFileWriter::~FlacFileWriter()
+{
+	try {
+		Finish();
+	} catch (const std::runtime_error&) {
+	}
+}
+
+void audio::FlacFileWriter::Write(const float* samples, uint64_t frameCount)
+{
+	const double scale = (double)(1u << (m_bitsPerSample - 1));
+	for (uint64_t frame = 0; frame < frameCount; frame++) {
+		for (uint32_t channel = 0; channel < m_channelCount; channel++) {
+			const double value = nearbyint((double)*samples++ * scale);
+			m_pending[(size_t)channel * BlockFrames + m_pendingFrames] = (int32_t)max(-scale, min(scale - 1.0, value));
+		}
+		if (++m_pendingFrames == BlockFrames) {
+			EncodeFrame();
+		}
+	}
+	m_framesWritten += frameCount;
+}
+
+void audio::FlacFileWriter::Finish()
+{
+	if (!m_output.IsOpen()) {
+		return;
+	}
+	if (m_pendingFrames > 0) {
+		EncodeFrame();
+	}
+	const std::vector<byte> streamInfo = MakeStreamInfo();
+	m_output.Patch(0, streamInfo.data(), streamInfo.size());
+	m_output.Close();
+}
+
+void audio::FlacFileWriter::EncodeFrame()
+{
+	const uint32_t n = m_pendingFrames;
+	const int bits = (int)m_bitsPerSample;
+	const int32_t* channels[8];
+	SubframePlan plans[8];
+	for (uint32_t channel = 0; channel < m_channelCount; channel++) {
+		channels[channel] = m_pending.data() + (size_t)channel * BlockFrames;
+		plans[channel] = PlanSubframe(channels[channel], n, bits);
+	}
+
+	// Left and side, or side and right, when the difference codes smaller than the channel it replaces
+	uint32_t channelCode = m_channelCount - 1;
+	if (m_channelCount == 2) {
+		for (uint32_t i = 0; i < n; i++) {
+			m_side[i] = channels[0][i] - channels[1][i];
+		}
+		const SubframePlan side = PlanSubframe(m_side.data(), n, bits + 1);
+		if (side.bits < max(plans[0].bits, plans[1].bits)) {
+			if (plans[0].bits <= plans[1].bits) {
+				channelCode = 8;
+				channels[1] = m_side.data();
+				plans[1] = side;
+			} else {
+				channelCode = 9;
+				channels[0] = m_side.data();
+				plans[0] = side;
+			}
+		}
+	}
+
+	m_frame.clear();
+	BitWriter writer(m_frame);
+	writer.WriteBits(0x3ffe, 14);
+	writer.WriteBits(0, 1);
+	writer.WriteBits(0, 1);
+	writer.WriteBits(n == BlockFrames ? 12 : 7, 4);
+	writer.WriteBits(0, 4);
+	writer.WriteBits(channelCode, 4);
+	writer.WriteBits(bits == 16 ? 4 : 6, 3);
+	writer.WriteBits(0, 1);
+	writer.WriteUtf8Number(m_frameNumber);
+	if (n != BlockFrames) {
+		writer.WriteBits(n - 1, 16);
+	}
+	writer.WriteBits(Crc8(m_frame.data(), m_frame.size()), 8);
+
+	for (uint32_t channel = 0; channel < m_channelCount; channel++) {
+		const bool isSide = (channelCode == 8 && channel == 1) || (channelCode == 9 && channel == 0);
+		WriteSubframe(writer, plans[channel], channels[channel], n, bits + (isSide ? 1 : 0));
+	}
+	writer.AlignToByte();
+	writer.WriteBits(Crc16(m_frame.data(), m_frame.size()), 16);
+
+	m_output.Append(m_frame.data(), m_frame.size());
+	const uint32_t frameBytes = (uint32_t)m_frame.size();
+	m_minFrameBytes = m_frameNumber == 0 ? frameBytes : min(m_minFrameBytes, frameBytes);
+	m_maxFrameBytes = max(m_maxFrameBytes, frameBytes);
+	m_frameNumber++;
+	m_pendingFrames = 0;
+}
+
+// The stream marker and a STREAMINFO block, which is the only metadata written. The MD5 is left unset.
+std::vector<byte> audio::FlacFileWriter::MakeStreamInfo() const
+{
+	std::vector<byte> bytes = { 'f', 'L', 'a', 'C' };
+	BitWriter writer(bytes);
+	writer.WriteBits(1, 1);
+	writer.WriteBits(0, 7);
+	writer.WriteBits(34, 24);
+	writer.WriteBits(BlockFrames, 16);
+	writer.WriteBits(BlockFrames, 16);
+	writer.WriteBits(m_minFrameBytes, 24);
+	writer.WriteBits(m_maxFrameBytes, 24);
+	writer.WriteBits(m_sampleRate, 20);
+	writer.WriteBits(m_channelCount - 1, 3);
+	writer.WriteBits(m_bitsPerSample - 1, 5);
+	writer.WriteBits((uint32_t)(m_framesWritten >> 32), 4);
+	writer.WriteBits((uint32_t)m_framesWritten, 32);
+	for (int i = 0; i < 4; i++) {
+		writer.WriteBits(0, 32);
+	}
+	return bytes;
+}
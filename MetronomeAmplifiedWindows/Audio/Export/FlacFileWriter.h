@@ -0,0 +1,50 @@
+#pragma once
+
+#include "AlignedFileOutput.h"
+#include "AudioWriter.h"
+
+namespace audio {
+
+	// Encodes 16- or 24-bit FLAC, which keeps exports of mostly silent click tracks small. Samples are rounded to
+	// the nearest step and clipped. Each frame takes whichever of a constant, verbatim or fixed-predictor
+	// subframe codes smallest, with Rice partitions sized to the residual; stereo frames code the difference
+	// between the channels in place of one of them when that is smaller. STREAMINFO is completed by Finish, or by
+	// the destructor if Finish was not called.
+	class FlacFileWriter : public AudioWriter {
+	public:
+		static const uint32_t BlockFrames = 4096;
+		static const int MaxPartitionOrder = 8;
+
+		// Throws std::runtime_error for other sample sizes, more than 8 channels, or if the file cannot be created
+		FlacFileWriter(const std::string& filePath, uint32_t sampleRate, uint32_t channelCount, uint32_t bitsPerSample);
+		virtual ~FlacFileWriter() override;
+
+		virtual void Write(const float* samples, uint64_t frameCount) override;
+
+		// Throws std::runtime_error if anything failed to write
+		void Finish();
+
+		inline uint64_t GetFramesWritten() const { return m_framesWritten; }
+		inline uint64_t GetBytesWritten() const { return m_output.GetSize(); }
+
+	private:
+		AlignedFileOutput m_output;
+		uint32_t m_sampleRate;
+		uint32_t m_channelCount;
+		uint32_t m_bitsPerSample;
+		uint64_t m_framesWritten;
+		uint64_t m_frameNumber;
+		uint32_t m_minFrameBytes;
+		uint32_t m_maxFrameBytes;
+
+		// Samples waiting for a whole block, one channel after another
+		std::vector<int32_t> m_pending;
+		uint32_t m_pendingFrames;
+
+		std::vector<int32_t> m_side;
+		std::vector<byte> m_frame;
+
+		void EncodeFrame();
+		std::vector<byte> MakeStreamInfo() const;
+	};
+}
@@ -0,0 +1,196 @@
+#include "pch.h"
+#include "SongExporter.h"
+#include "../AudioEngine.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+	// Chunks shared between the workers and the thread writing them out
+	struct ExportQueue {
+		std::mutex mutex;
+		std::condition_variable chunkRendered;
+		std::condition_variable chunkWritten;
+		size_t nextChunk;
+		size_t writtenCount;
+		std::vector<std::vector<float>> rendered;
+		std::vector<bool> isRendered;
+		bool isCancelled;
+		std::exception_ptr error;
+	};
+}
+
+audio::SongExporter::SongExporter(const SongTimeline& timeline, const ToneSetView& toneSet, uint32_t channelCount) :
+	m_timeline(timeline),
+	m_toneSet(toneSet),
+	m_channelCount(channelCount),
+	m_prerollFrames(max(toneSet.accent.length, toneSet.normal.length)),
+	m_threadCount(0),
+	m_chunks()
+{
+	PlanChunks();
+}
+
+void audio::SongExporter::SetThreadCount(int threadCount)
+{
+	m_threadCount = max(0, threadCount);
+}
+
+int audio::SongExporter::GetThreadCount() const
+{
+	const int threadCount = m_threadCount > 0 ? m_threadCount : (int)std::thread::hardware_concurrency();
+	return max(1, min(threadCount, (int)m_chunks.size()));
+}
+
+void audio::SongExporter::Export(AudioWriter& writer)
+{
+	ExportQueue queue;
+	queue.nextChunk = 0;
+	queue.writtenCount = 0;
+	queue.rendered.resize(m_chunks.size());
+	queue.isRendered.resize(m_chunks.size(), false);
+	queue.isCancelled = false;
+	const size_t maxInFlight = ChunksInFlightPerThread * GetThreadCount();
+
+	// Each worker keeps one engine for all of its chunks, seeking it to just before each one
+	auto renderChunks = [this, &queue, maxInFlight]() {
+		try {
+			AudioEngine engine(m_timeline.GetSampleRate(), m_channelCount);
+			engine.SetBarCacheEnabled(false);
+			engine.SetToneSet(m_toneSet);
+			engine.SetSongTimeline(&m_timeline);
+			std::vector<float> discarded((size_t)BlockFrames * m_channelCount);
+			while (true) {
+				size_t chunkIndex;
+				{
+					std::unique_lock<std::mutex> lock(queue.mutex);
+					queue.chunkWritten.wait(lock, [&queue, maxInFlight, this]() {
+						return queue.isCancelled || queue.nextChunk >= m_chunks.size() || queue.nextChunk < queue.writtenCount + maxInFlight;
+					});
+					if (queue.isCancelled || queue.nextChunk >= m_chunks.size()) {
+						return;
+					}
+					chunkIndex = queue.nextChunk++;
+				}
+
+				const ExportChunk& chunk = m_chunks[chunkIndex];
+				const uint64_t prerollStart = chunk.startFrame - min((uint64_t)m_prerollFrames, chunk.startFrame);
+				engine.Seek(prerollStart);
+				engine.Play();
+				for (uint64_t frame = prerollStart; frame < chunk.startFrame; frame += BlockFrames) {
+					engine.Render(discarded.data(), (uint32_t)min((uint64_t)BlockFrames, chunk.startFrame - frame));
+				}
+				std::vector<float> samples((size_t)(chunk.endFrame - chunk.startFrame) * m_channelCount);
+				for (uint64_t frame = 0; frame < chunk.endFrame - chunk.startFrame; frame += BlockFrames) {
+					engine.Render(samples.data() + (size_t)frame * m_channelCount, (uint32_t)min((uint64_t)BlockFrames, chunk.endFrame - chunk.startFrame - frame));
+				}
+
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.rendered[chunkIndex] = std::move(samples);
+				queue.isRendered[chunkIndex] = true;
+				queue.chunkRendered.notify_all();
+			}
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.error) {
+				queue.error = std::current_exception();
+			}
+			queue.isCancelled = true;
+			queue.chunkRendered.notify_all();
+			queue.chunkWritten.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < GetThreadCount(); i++) {
+		workers.emplace_back(renderChunks);
+	}
+
+	try {
+		for (size_t chunkIndex = 0; chunkIndex < m_chunks.size(); chunkIndex++) {
+			std::vector<float> samples;
+			{
+				std::unique_lock<std::mutex> lock(queue.mutex);
+				queue.chunkRendered.wait(lock, [&queue, chunkIndex]() { return queue.isCancelled || queue.isRendered[chunkIndex]; });
+				if (queue.isCancelled) {
+					break;
+				}
+				samples.swap(queue.rendered[chunkIndex]);
+			}
+			writer.Write(samples.data(), samples.size() / m_channelCount);
+
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.writtenCount++;
+			queue.chunkWritten.notify_all();
+		}
+	} catch (...) {
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.error) {
+			queue.error = std::current_exception();
+		}
+		queue.isCancelled = true;
+		queue.chunkWritten.notify_all();
+	}
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	if (queue.error) {
+		std::rethrow_exception(queue.error);
+	}
+}
+
+// Whether rendering could ever need more voices than the engine has, counting every click as sounding from its
+// start until the end of the playback block its tail finishes in
+bool audio::SongExporter::CanSplit() const
+{
+	const uint64_t window = (uint64_t)m_prerollFrames + MaxPlaybackBlockFrames;
+	SongCursor first;
+	SongCursor last;
+	first.Seek(&m_timeline, 0);
+	last.Seek(&m_timeline, 0);
+	int sounding = 0;
+	while (last.GetNextEventSample() != SongCursor::EndOfSong) {
+		while (last.GetNextEventSample() - first.GetNextEventSample() >= window) {
+			first.Advance();
+			sounding--;
+		}
+		last.Advance();
+		if (++sounding > AudioEngine::Polyphony) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void audio::SongExporter::PlanChunks()
+{
+	const uint64_t lengthFrames = m_timeline.GetLengthSamples();
+	const uint64_t targetFrames = (uint64_t)TargetChunkSeconds * m_timeline.GetSampleRate();
+	m_chunks.clear();
+	if (CanSplit()) {
+		// Chunks end on the first section boundary at least the target length in, with sections of twice the
+		// target or more cut into target-length pieces first
+		uint64_t chunkStart = 0;
+		for (uint64_t boundary : m_timeline.GetSectionStartSamples()) {
+			if (boundary - chunkStart < targetFrames && boundary < lengthFrames) {
+				continue;
+			}
+			while (boundary - chunkStart >= 2 * targetFrames) {
+				m_chunks.push_back({ chunkStart, chunkStart + targetFrames });
+				chunkStart += targetFrames;
+			}
+			if (boundary > chunkStart) {
+				m_chunks.push_back({ chunkStart, boundary });
+				chunkStart = boundary;
+			}
+		}
+	}
+	if (m_chunks.empty()) {
+		m_chunks.push_back({ 0, lengthFrames });
+	}
+	m_chunks.back().endFrame = lengthFrames + m_prerollFrames;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "AudioWriter.h"
+#include "../Songs/SongTimeline.h"
+#include "../ToneSets/ToneSetView.h"
+
+namespace audio {
+
+	// Output frames [startFrame, endFrame), rendered by one worker in one go
+	struct ExportChunk {
+		uint64_t startFrame;
+		uint64_t endFrame;
+	};
+
+	// Renders a song faster than real time, for saving as a practice track. The output is cut into chunks at
+	// section boundaries, merging short sections and splitting long ones to about TargetChunkSeconds, and a pool
+	// of worker threads renders the chunks with an AudioEngine each while the calling thread hands finished ones
+	// to the writer in order. Each chunk is started the longest click's length early, so that clicks ringing on
+	// across its start are already sounding when it gets there. As the engine sums voices in the order they
+	// started, the result is the same, bit for bit, as playing the song through from the start at any block size
+	// up to MaxPlaybackBlockFrames. That only holds while no voice is stolen, which depends on clicks from before
+	// the chunk, so songs dense enough to reach the engine's polyphony are rendered as a single chunk, matching
+	// playback in blocks of BlockFrames.
+	// The export runs past the end of the song by the longest click, so that the last clicks ring out.
+	class SongExporter {
+	public:
+		static const uint32_t BlockFrames = 1024;
+		static const uint32_t MaxPlaybackBlockFrames = 4096;
+		static const uint32_t TargetChunkSeconds = 10;
+
+		// Workers render at most this many chunks ahead of the writer, to bound the memory held
+		static const size_t ChunksInFlightPerThread = 2;
+
+		// The timeline and tone set samples must stay valid and unchanged while the exporter is used
+		SongExporter(const SongTimeline& timeline, const ToneSetView& toneSet, uint32_t channelCount);
+
+		// Zero, the default, uses one thread per hardware thread
+		void SetThreadCount(int threadCount);
+
+		// Renders every chunk and writes them in order. Rethrows anything thrown by the writer or a worker, once
+		// all of the workers have stopped.
+		void Export(AudioWriter& writer);
+
+		inline uint32_t GetSampleRate() const { return m_timeline.GetSampleRate(); }
+		inline uint32_t GetChannelCount() const { return m_channelCount; }
+		inline uint64_t GetFrameCount() const { return m_chunks.empty() ? 0 : m_chunks.back().endFrame; }
+		inline const std::vector<ExportChunk>& GetChunks() const { return m_chunks; }
+		int GetThreadCount() const;
+
+	private:
+		const SongTimeline& m_timeline;
+		ToneSetView m_toneSet;
+		uint32_t m_channelCount;
+		uint32_t m_prerollFrames;
+		int m_threadCount;
+		std::vector<ExportChunk> m_chunks;
+
+		bool CanSplit() const;
+		void PlanChunks();
+	};
+}
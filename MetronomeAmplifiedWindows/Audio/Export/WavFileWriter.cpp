@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "WavFileWriter.h"
+
+namespace {
+	void PutUint16(byte*& destination, uint16_t value) {
+		*destination++ = (byte)(value & 0xff);
+		*destination++ = (byte)(value >> 8);
+	}
+
+	void PutUint32(byte*& destination, uint32_t value) {
+		for (int i = 0; i < 4; i++) {
+			*destination++ = (byte)((value >> (8 * i)) & 0xff);
+		}
+	}
+
+	void PutTag(byte*& destination, const char* tag) {
+		memcpy(destination, tag, 4);
+		destination += 4;
+	}
+}
+
+audio::WavFileWriter::WavFileWriter(const std::string& filePath, uint32_t sampleRate, uint32_t channelCount) :
+	m_output(filePath),
+	m_sampleRate(sampleRate),
+	m_channelCount(channelCount),
+	m_framesWritten(0)
+{
+	byte header[HeaderBytes];
+	MakeHeader(0, header);
+	m_output.Append(header, HeaderBytes);
+}
+
+// Errors cannot be reported from here; call Finish to see them
+audio::WavFileWriter::~WavFileWriter()
+{
+	try {
+		Finish();
+	} catch (const std::runtime_error&) {
+	}
+}
+
+void audio::WavFileWriter::Write(const float* samples, uint64_t frameCount)
+{
+	const uint64_t bytesPerFrame = m_channelCount * sizeof(float);
+	if ((m_framesWritten + frameCount) * bytesPerFrame > UINT32_MAX - (HeaderBytes - 8)) {
+		throw std::runtime_error("Audio is too long for a WAV file");
+	}
+	m_output.Append(samples, (size_t)(frameCount * bytesPerFrame));
+	m_framesWritten += frameCount;
+}
+
+void audio::WavFileWriter::Finish()
+{
+	if (!m_output.IsOpen()) {
+		return;
+	}
+	byte header[HeaderBytes];
+	MakeHeader(m_framesWritten, header);
+	m_output.Patch(0, header, HeaderBytes);
+	m_output.Close();
+}
+
+// Canonical 44-byte RIFF header for IEEE float PCM
+void audio::WavFileWriter::MakeHeader(uint64_t frameCount, byte* header) const
+{
+	const uint32_t bytesPerFrame = m_channelCount * sizeof(float);
+	const uint32_t dataBytes = (uint32_t)(frameCount * bytesPerFrame);
+	PutTag(header, "RIFF");
+	PutUint32(header, (uint32_t)(HeaderBytes - 8) + dataBytes);
+	PutTag(header, "WAVE");
+	PutTag(header, "fmt ");
+	PutUint32(header, 16);
+	PutUint16(header, 3);
+	PutUint16(header, (uint16_t)m_channelCount);
+	PutUint32(header, m_sampleRate);
+	PutUint32(header, m_sampleRate * bytesPerFrame);
+	PutUint16(header, (uint16_t)bytesPerFrame);
+	PutUint16(header, 32);
+	PutTag(header, "data");
+	PutUint32(header, dataBytes);
+}
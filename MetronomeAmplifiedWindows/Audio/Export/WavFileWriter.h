@@ -0,0 +1,34 @@
+#pragma once
+
+#include "AlignedFileOutput.h"
+#include "AudioWriter.h"
+
+namespace audio {
+
+	// Writes 32-bit float WAV, so that the file holds exactly the samples rendered. The header is completed by
+	// Finish, or by the destructor if Finish was not called.
+	class WavFileWriter : public AudioWriter {
+	public:
+		static const size_t HeaderBytes = 44;
+
+		// Throws std::runtime_error if the file cannot be created
+		WavFileWriter(const std::string& filePath, uint32_t sampleRate, uint32_t channelCount);
+		virtual ~WavFileWriter() override;
+
+		// Throws std::runtime_error once the data would pass the 4 GiB a WAV file can hold
+		virtual void Write(const float* samples, uint64_t frameCount) override;
+
+		// Throws std::runtime_error if anything failed to write
+		void Finish();
+
+		inline uint64_t GetFramesWritten() const { return m_framesWritten; }
+
+	private:
+		AlignedFileOutput m_output;
+		uint32_t m_sampleRate;
+		uint32_t m_channelCount;
+		uint64_t m_framesWritten;
+
+		void MakeHeader(uint64_t frameCount, byte* header) const;
+	};
+}
@@ -0,0 +1,31 @@
+#include "pch.h"
+#include "LoopbackMidiPort.h"
+
+audio::LoopbackMidiPort::LoopbackMidiPort(size_t capacity) :
+	m_clock(),
+	m_messages(capacity),
+	m_messageCount(0),
+	m_overflowCount(0)
+{
+}
+
+void audio::LoopbackMidiPort::Send(const uint8_t* bytes, uint32_t length)
+{
+	const uint64_t counter = m_clock.GetCounter();
+	const size_t count = m_messageCount.load(std::memory_order_relaxed);
+	if (count == m_messages.size() || length > sizeof(ReceivedMidiMessage::bytes)) {
+		m_overflowCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	ReceivedMidiMessage& message = m_messages[count];
+	message.counter = counter;
+	std::copy(bytes, bytes + length, message.bytes);
+	message.length = (uint8_t)length;
+	m_messageCount.store(count + 1, std::memory_order_release);
+}
+
+void audio::LoopbackMidiPort::Clear()
+{
+	m_messageCount = 0;
+	m_overflowCount = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "MidiPort.h"
+#include "../../Common/ClockSource.h"
+
+#include <atomic>
+
+namespace audio {
+
+	// A message as it arrived at a LoopbackMidiPort, stamped with the host clock
+	struct ReceivedMidiMessage {
+		uint64_t counter;
+		uint8_t bytes[3];
+		uint8_t length;
+	};
+
+	// In-process stand-in for a MIDI device, for measuring how closely messages keep to their schedule without
+	// any hardware. It keeps every message it is sent, with the host count at which it arrived, in storage set
+	// aside up front, so that receiving never allocates; messages beyond its capacity are counted and dropped.
+	class LoopbackMidiPort : public MidiPort {
+	public:
+		explicit LoopbackMidiPort(size_t capacity);
+
+		virtual void Send(const uint8_t* bytes, uint32_t length) override;
+
+		// While nothing is sending, such as after MidiOutput::Stop
+		void Clear();
+		inline const ReceivedMidiMessage* GetMessages() const { return m_messages.data(); }
+		inline size_t GetMessageCount() const { return m_messageCount.load(std::memory_order_acquire); }
+		inline uint64_t GetOverflowCount() const { return m_overflowCount.load(std::memory_order_relaxed); }
+		inline uint64_t GetFrequency() const { return m_clock.GetFrequency(); }
+
+	private:
+		DX::DefaultClock m_clock;
+		std::vector<ReceivedMidiMessage> m_messages;
+		std::atomic<size_t> m_messageCount;
+		std::atomic<uint64_t> m_overflowCount;
+	};
+}
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "MidiOutput.h"
+
+#include <chrono>
+
+audio::MidiOutput::MidiOutput(MidiPort& port, uint32_t sampleRate) :
+	m_port(port),
+	m_clock(),
+	m_frequency(0),
+	m_sampleRate(sampleRate),
+	m_outputLatencyFrames(0),
+	m_deviceLatencySeconds(0.0),
+	m_isClickNotesEnabled(false),
+	m_channel(9),
+	m_accentNote(76),
+	m_normalNote(77),
+	m_hasMapping(false),
+	m_originFrame(0),
+	m_originCounter(0.0),
+	m_isNoteHeld(false),
+	m_heldNote(0),
+	m_messages(),
+	m_thread(),
+	m_isRunning(false),
+	m_sentMessageCount(0),
+	m_droppedMessageCount(0),
+	m_lateness()
+{
+	if (sampleRate == 0) {
+		throw std::invalid_argument("Sample rate must be positive");
+	}
+	m_frequency = m_clock.GetFrequency();
+}
+
+audio::MidiOutput::~MidiOutput()
+{
+	Stop();
+}
+
+void audio::MidiOutput::Start()
+{
+	Stop();
+	ScheduledMidiMessage message;
+	while (m_messages.TryPop(message)) {
+	}
+	m_lateness.Reset();
+	m_sentMessageCount = 0;
+	m_droppedMessageCount = 0;
+	m_isRunning = true;
+	m_thread = std::thread(&MidiOutput::Run, this);
+}
+
+void audio::MidiOutput::Stop()
+{
+	m_isRunning = false;
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void audio::MidiOutput::SetClickNotes(bool isEnabled, uint8_t channel, uint8_t accentNote, uint8_t normalNote)
+{
+	m_isClickNotesEnabled = isEnabled;
+	m_channel = channel & 0x0f;
+	m_accentNote = accentNote & 0x7f;
+	m_normalNote = normalNote & 0x7f;
+}
+
+// Ease the mapping towards when this block will be heard, or jump straight to it after a dropout
+void audio::MidiOutput::BeginBlock(uint64_t hostCounter, uint64_t streamFrame, uint32_t frameCount)
+{
+	const double countsPerFrame = (double)m_frequency / m_sampleRate;
+	const double latencySeconds = (double)m_outputLatencyFrames / m_sampleRate + m_deviceLatencySeconds;
+	const double heardCounter = (double)hostCounter + latencySeconds * m_frequency;
+	const double expectedCounter = m_originCounter + (double)(int64_t)(streamFrame - m_originFrame) * countsPerFrame;
+	const double error = heardCounter - expectedCounter;
+	const bool isJump = !m_hasMapping || fabs(error) > SnapBlocks * frameCount * countsPerFrame;
+	m_originCounter = isJump ? heardCounter : expectedCounter + Smoothing * error;
+	m_originFrame = streamFrame;
+	m_hasMapping = true;
+}
+
+void audio::MidiOutput::SendClock(uint64_t streamFrame)
+{
+	Schedule(streamFrame, (uint8_t)MidiStatus::TIMING_CLOCK, 1, 0, 0);
+}
+
+void audio::MidiOutput::SendStart(uint64_t streamFrame)
+{
+	Schedule(streamFrame, (uint8_t)MidiStatus::START, 1, 0, 0);
+}
+
+void audio::MidiOutput::SendContinue(uint64_t streamFrame)
+{
+	Schedule(streamFrame, (uint8_t)MidiStatus::CONTINUE, 1, 0, 0);
+}
+
+void audio::MidiOutput::SendStop(uint64_t streamFrame)
+{
+	ReleaseNote(streamFrame);
+	Schedule(streamFrame, (uint8_t)MidiStatus::STOP, 1, 0, 0);
+}
+
+void audio::MidiOutput::SendClick(uint64_t streamFrame, ToneVoice voice, float gain)
+{
+	if (!m_isClickNotesEnabled) {
+		return;
+	}
+	ReleaseNote(streamFrame);
+	const uint8_t note = voice == ToneVoice::ACCENT ? m_accentNote : m_normalNote;
+	const uint8_t velocity = (uint8_t)max(1l, min(127l, lrintf(gain * 127.0f)));
+	Schedule(streamFrame, (uint8_t)MidiStatus::NOTE_ON | m_channel, 3, note, velocity);
+	m_heldNote = note;
+	m_isNoteHeld = true;
+}
+
+// A note on with no velocity, which every device takes as a note off
+void audio::MidiOutput::ReleaseNote(uint64_t streamFrame)
+{
+	if (m_isNoteHeld) {
+		Schedule(streamFrame, (uint8_t)MidiStatus::NOTE_ON | m_channel, 3, m_heldNote, 0);
+		m_isNoteHeld = false;
+	}
+}
+
+void audio::MidiOutput::Schedule(uint64_t streamFrame, uint8_t status, uint32_t length, uint8_t data1, uint8_t data2)
+{
+	const double countsPerFrame = (double)m_frequency / m_sampleRate;
+	const double dueCounter = m_originCounter + (double)(int64_t)(streamFrame - m_originFrame) * countsPerFrame;
+	const ScheduledMidiMessage message = { (uint64_t)max(0.0, dueCounter), { status, data1, data2 }, (uint8_t)length };
+	if (!m_messages.TryPush(message)) {
+		m_droppedMessageCount.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+// Messages arrive in the order they are due, so only the one at the front is ever waited for
+void audio::MidiOutput::Run()
+{
+	const uint64_t spinCounts = (uint64_t)(SpinSeconds * m_frequency);
+	ScheduledMidiMessage message;
+	bool hasMessage = false;
+	while (m_isRunning) {
+		if (!hasMessage && !m_messages.TryPop(message)) {
+			std::this_thread::sleep_for(std::chrono::duration<double>(PollSeconds));
+			continue;
+		}
+		hasMessage = true;
+		const uint64_t now = m_clock.GetCounter();
+		if (now < message.dueCounter) {
+			const uint64_t wait = message.dueCounter - now;
+			if (wait > spinCounts) {
+				std::this_thread::sleep_for(std::chrono::duration<double>(min(PollSeconds, (double)(wait - spinCounts) / m_frequency)));
+			} else {
+				std::this_thread::yield();
+			}
+			continue;
+		}
+		m_port.Send(message.bytes, message.length);
+		m_lateness.Record((double)(now - message.dueCounter) / m_frequency);
+		m_sentMessageCount.fetch_add(1, std::memory_order_relaxed);
+		hasMessage = false;
+	}
+}
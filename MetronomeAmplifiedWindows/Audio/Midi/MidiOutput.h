@@ -0,0 +1,120 @@
+#pragma once
+
+#include "MidiPort.h"
+#include "../SpscQueue.h"
+#include "../VisualBeatSync.h"
+#include "../Songs/SongTimeline.h"
+#include "../../Common/ClockSource.h"
+
+#include <atomic>
+#include <thread>
+
+namespace audio {
+
+	// Status bytes of the messages MidiOutput sends
+	enum class MidiStatus : uint8_t {
+		NOTE_ON = 0x90,
+		TIMING_CLOCK = 0xf8,
+		START = 0xfa,
+		CONTINUE = 0xfb,
+		STOP = 0xfc
+	};
+
+	// A message waiting for the host clock to reach its due count
+	struct ScheduledMidiMessage {
+		uint64_t dueCounter;
+		uint8_t bytes[3];
+		uint8_t length;
+	};
+
+	// Sends MIDI clock at 24 pulses a beat, start, stop and continue, and optionally a note for every click, in
+	// time with the clicks being heard. The audio thread schedules each message at the stream frame it falls on,
+	// and frames are mapped to host counts as BasicVisualBeatSync maps them: a block's first frame is heard the
+	// output latency after the block was rendered, eased towards each new block so that callback jitter does not
+	// carry through. Messages therefore go out about that latency ahead, through a lock-free queue, to a sender
+	// thread of its own that sleeps until one is nearly due and then spins until it is, and how late each was
+	// sent is recorded. The engine's host clock must be a DX::DefaultClock, as the sender's is.
+	class MidiOutput {
+	public:
+		static const uint32_t PulsesPerBeat = 24;
+		static const size_t QueueCapacity = 1024;
+
+		// Fraction of each new block's timing error taken into the mapping
+		static constexpr double Smoothing = 0.125;
+
+		// Errors beyond this many blocks are a jump in the stream rather than jitter
+		static constexpr double SnapBlocks = 4.0;
+
+		// The sender spins once a message is this close to due, and otherwise sleeps for at most PollSeconds
+		static constexpr double SpinSeconds = 0.001;
+		static constexpr double PollSeconds = 0.001;
+
+		// The port must outlive the output
+		MidiOutput(MidiPort& port, uint32_t sampleRate);
+		~MidiOutput();
+
+		// UI thread. Starting discards anything still queued, and the lateness statistics.
+		void Start();
+		void Stop();
+
+		// UI thread, before the sink starts. The sink's buffering, from BaseSink::GetOutputLatencyFrames, and the
+		// further delay in the device that the user has calibrated.
+		inline void SetOutputLatencyFrames(uint32_t frames) { m_outputLatencyFrames = frames; }
+		inline void SetDeviceLatencySeconds(double seconds) { m_deviceLatencySeconds = seconds; }
+
+		// UI thread, before the sink starts. Each click's note is held until the next click or until playback
+		// stops, with a velocity from the click's gain. Channels count from zero. Notes are off until set, and
+		// default to the General MIDI wood blocks on the drum channel.
+		void SetClickNotes(bool isEnabled, uint8_t channel, uint8_t accentNote, uint8_t normalNote);
+
+		// Audio thread, at the start of every block before anything in it is scheduled
+		void BeginBlock(uint64_t hostCounter, uint64_t streamFrame, uint32_t frameCount);
+
+		// Audio thread, in order of stream frame. None of them blocks or allocates; messages the queue has no room
+		// for are dropped and counted.
+		void SendClock(uint64_t streamFrame);
+		void SendStart(uint64_t streamFrame);
+		void SendContinue(uint64_t streamFrame);
+		void SendStop(uint64_t streamFrame);
+		void SendClick(uint64_t streamFrame, ToneVoice voice, float gain);
+
+		// Any thread
+		inline uint64_t GetSentMessageCount() const { return m_sentMessageCount.load(std::memory_order_relaxed); }
+		inline uint64_t GetDroppedMessageCount() const { return m_droppedMessageCount.load(std::memory_order_relaxed); }
+
+		// UI thread, while the sender is stopped. How late messages were sent, in seconds.
+		inline const SyncOffsetStatistics& GetLatenessStatistics() const { return m_lateness; }
+
+	private:
+		MidiPort& m_port;
+		DX::DefaultClock m_clock;
+		uint64_t m_frequency;
+		uint32_t m_sampleRate;
+		uint32_t m_outputLatencyFrames;
+		double m_deviceLatencySeconds;
+		bool m_isClickNotesEnabled;
+		uint8_t m_channel;
+		uint8_t m_accentNote;
+		uint8_t m_normalNote;
+
+		// Host count at which the origin frame is heard, moving at the nominal sample rate; owned by the audio thread
+		bool m_hasMapping;
+		uint64_t m_originFrame;
+		double m_originCounter;
+		bool m_isNoteHeld;
+		uint8_t m_heldNote;
+
+		SpscQueue<ScheduledMidiMessage, QueueCapacity> m_messages;
+		std::thread m_thread;
+		std::atomic<bool> m_isRunning;
+		std::atomic<uint64_t> m_sentMessageCount;
+		std::atomic<uint64_t> m_droppedMessageCount;
+
+		// Owned by the sender thread while it runs
+		SyncOffsetStatistics m_lateness;
+
+		void Schedule(uint64_t streamFrame, uint8_t status, uint32_t length, uint8_t data1, uint8_t data2);
+		void ReleaseNote(uint64_t streamFrame);
+		void Run();
+	};
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace audio {
+
+	// Destination for MIDI messages, called on MidiOutput's sender thread only. Each call is one whole message
+	// of one to three bytes, sent as soon as it is due, so a port should pass it on without queueing it again.
+	class MidiPort {
+	public:
+		virtual ~MidiPort() {}
+		virtual void Send(const uint8_t* bytes, uint32_t length) = 0;
+	};
+}
@@ -0,0 +1,24 @@
+#include "pch.h"
+#include "WinRtMidiPort.h"
+
+audio::WinRtMidiPort::WinRtMidiPort(winrt::Windows::Devices::Midi::IMidiOutPort port) :
+	m_port(port),
+	m_buffer(3)
+{
+	if (m_port == nullptr) {
+		throw std::invalid_argument("No MIDI output port");
+	}
+}
+
+audio::WinRtMidiPort::~WinRtMidiPort()
+{
+	m_port.Close();
+}
+
+void audio::WinRtMidiPort::Send(const uint8_t* bytes, uint32_t length)
+{
+	length = min(length, m_buffer.Capacity());
+	std::copy(bytes, bytes + length, m_buffer.data());
+	m_buffer.Length(length);
+	m_port.SendBuffer(m_buffer);
+}
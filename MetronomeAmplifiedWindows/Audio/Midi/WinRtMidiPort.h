@@ -0,0 +1,20 @@
+#pragma once
+
+#include "MidiPort.h"
+
+namespace audio {
+
+	// Port that sends through a Windows.Devices.Midi output port, such as one from MidiOutPort::FromIdAsync. Each
+	// message is copied into one buffer kept for the purpose, so sending never allocates.
+	class WinRtMidiPort : public MidiPort {
+	public:
+		explicit WinRtMidiPort(winrt::Windows::Devices::Midi::IMidiOutPort port);
+		virtual ~WinRtMidiPort();
+
+		virtual void Send(const uint8_t* bytes, uint32_t length) override;
+
+	private:
+		winrt::Windows::Devices::Midi::IMidiOutPort m_port;
+		winrt::Windows::Storage::Streams::Buffer m_buffer;
+	};
+}
@@ -0,0 +1,161 @@
+#include "pch.h"
+#include "Mixer.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MIXER_USE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIXER_USE_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MIXER_USE_NEON
+#endif
+
+namespace {
+
+	// Synthesised and compressed clicks are rendered this much at a time, a few tiles that stay in the L1 cache
+	const uint32_t RenderedFrames = 4 * audio::ClickSynth::TileFrames;
+
+	void MixMono(const float* source, uint32_t frameCount, float gain, float* destination)
+	{
+		uint32_t frame = 0;
+#if defined(MIXER_USE_AVX)
+		const __m256 gains = _mm256_set1_ps(gain);
+		for (; frame + 8 <= frameCount; frame += 8) {
+			const __m256 mixed = _mm256_add_ps(_mm256_loadu_ps(destination + frame), _mm256_mul_ps(_mm256_loadu_ps(source + frame), gains));
+			_mm256_storeu_ps(destination + frame, mixed);
+		}
+#elif defined(MIXER_USE_SSE)
+		const __m128 gains = _mm_set1_ps(gain);
+		for (; frame + 4 <= frameCount; frame += 4) {
+			const __m128 mixed = _mm_add_ps(_mm_loadu_ps(destination + frame), _mm_mul_ps(_mm_loadu_ps(source + frame), gains));
+			_mm_storeu_ps(destination + frame, mixed);
+		}
+#elif defined(MIXER_USE_NEON)
+		for (; frame + 4 <= frameCount; frame += 4) {
+			vst1q_f32(destination + frame, vmlaq_n_f32(vld1q_f32(destination + frame), vld1q_f32(source + frame), gain));
+		}
+#endif
+		for (; frame < frameCount; frame++) {
+			destination[frame] += source[frame] * gain;
+		}
+	}
+
+	void MixStereo(const float* source, uint32_t frameCount, float leftGain, float rightGain, float* destination)
+	{
+		uint32_t frame = 0;
+#if defined(MIXER_USE_AVX)
+		// Unpacking works within 128-bit lanes, so the halves are swapped back into frame order afterwards
+		const __m256 leftGains = _mm256_set1_ps(leftGain);
+		const __m256 rightGains = _mm256_set1_ps(rightGain);
+		for (; frame + 8 <= frameCount; frame += 8) {
+			const __m256 samples = _mm256_loadu_ps(source + frame);
+			const __m256 left = _mm256_mul_ps(samples, leftGains);
+			const __m256 right = _mm256_mul_ps(samples, rightGains);
+			const __m256 low = _mm256_unpacklo_ps(left, right);
+			const __m256 high = _mm256_unpackhi_ps(left, right);
+			float* out = destination + 2 * frame;
+			_mm256_storeu_ps(out, _mm256_add_ps(_mm256_loadu_ps(out), _mm256_permute2f128_ps(low, high, 0x20)));
+			_mm256_storeu_ps(out + 8, _mm256_add_ps(_mm256_loadu_ps(out + 8), _mm256_permute2f128_ps(low, high, 0x31)));
+		}
+#elif defined(MIXER_USE_SSE)
+		const __m128 leftGains = _mm_set1_ps(leftGain);
+		const __m128 rightGains = _mm_set1_ps(rightGain);
+		for (; frame + 4 <= frameCount; frame += 4) {
+			const __m128 samples = _mm_loadu_ps(source + frame);
+			const __m128 left = _mm_mul_ps(samples, leftGains);
+			const __m128 right = _mm_mul_ps(samples, rightGains);
+			float* out = destination + 2 * frame;
+			_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_unpacklo_ps(left, right)));
+			_mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_unpackhi_ps(left, right)));
+		}
+#elif defined(MIXER_USE_NEON)
+		for (; frame + 4 <= frameCount; frame += 4) {
+			const float32x4_t samples = vld1q_f32(source + frame);
+			float* out = destination + 2 * frame;
+			float32x4x2_t mixed = vld2q_f32(out);
+			mixed.val[0] = vmlaq_n_f32(mixed.val[0], samples, leftGain);
+			mixed.val[1] = vmlaq_n_f32(mixed.val[1], samples, rightGain);
+			vst2q_f32(out, mixed);
+		}
+#endif
+		for (; frame < frameCount; frame++) {
+			destination[2 * frame] += source[frame] * leftGain;
+			destination[2 * frame + 1] += source[frame] * rightGain;
+		}
+	}
+}
+
+void audio::MixSamples(const float* source, uint32_t frameCount, float leftGain, float rightGain, uint32_t channelCount, float* destination)
+{
+	if (channelCount == 1) {
+		MixMono(source, frameCount, leftGain, destination);
+		return;
+	}
+	if (channelCount == 2) {
+		MixStereo(source, frameCount, leftGain, rightGain, destination);
+		return;
+	}
+	for (uint32_t frame = 0; frame < frameCount; frame++) {
+		for (uint32_t channel = 0; channel < channelCount; channel++) {
+			destination[channel] += source[frame] * (channel == 1 ? rightGain : leftGain);
+		}
+		destination += channelCount;
+	}
+}
+
+void audio::MixVoice(Voice& voice, float* output, uint32_t channelCount, uint32_t blockOffset, uint32_t frameCount)
+{
+	const uint32_t frames = min(frameCount - blockOffset, voice.length - voice.position);
+	float* destination = output + (size_t)blockOffset * channelCount;
+	if (voice.synth != nullptr) {
+		float rendered[RenderedFrames];
+		for (uint32_t done = 0; done < frames; done += RenderedFrames) {
+			const uint32_t count = min(RenderedFrames, frames - done);
+			voice.synth->Render(voice.position + done, count, rendered);
+			MixSamples(rendered, count, voice.leftGain, voice.rightGain, channelCount, destination + (size_t)done * channelCount);
+		}
+	} else if (voice.compressed != nullptr) {
+		float decoded[RenderedFrames];
+		for (uint32_t done = 0; done < frames; done += RenderedFrames) {
+			const uint32_t count = min(RenderedFrames, frames - done);
+			voice.compressed->Decode(voice.cursor, voice.position + done, count, decoded);
+			MixSamples(decoded, count, voice.leftGain, voice.rightGain, channelCount, destination + (size_t)done * channelCount);
+		}
+	} else if (voice.cachedBar == nullptr) {
+		MixSamples(voice.samples + voice.position, frames, voice.leftGain, voice.rightGain, channelCount, destination);
+	} else {
+		// Only the audible spans overlapping this stretch of the bar need mixing
+		const uint32_t start = voice.position;
+		const uint32_t end = voice.position + frames;
+		for (const BarCacheSpan& span : voice.cachedBar->spans) {
+			const uint32_t spanStart = max(start, span.barOffset);
+			const uint32_t spanEnd = min(end, span.barOffset + span.length);
+			if (spanStart < spanEnd) {
+				MixSamples(
+					voice.cachedBar->samples.data() + span.sampleOffset + (spanStart - span.barOffset),
+					spanEnd - spanStart,
+					voice.leftGain,
+					voice.rightGain,
+					channelCount,
+					destination + (size_t)(spanStart - start) * channelCount);
+			}
+		}
+	}
+	voice.position += frames;
+}
+
+void audio::MixVoices(VoicePool& voices, float* output, uint32_t channelCount, uint32_t frameCount)
+{
+	int voiceIndex = 0;
+	while (voiceIndex < voices.GetActiveCount()) {
+		Voice& voice = voices.Get(voiceIndex);
+		MixVoice(voice, output, channelCount, 0, frameCount);
+		if (voice.position >= voice.length) {
+			voices.Remove(voiceIndex);
+		} else {
+			voiceIndex++;
+		}
+	}
+}
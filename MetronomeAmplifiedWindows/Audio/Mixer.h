@@ -0,0 +1,19 @@
+#pragma once
+
+#include "VoicePool.h"
+
+namespace audio {
+
+	// Adds a mono signal into interleaved output. Stereo output takes the left and right gains; mono output and
+	// any channels beyond the first two take the left gain. Uses AVX, SSE2 or NEON kernels where the build
+	// targets them.
+	void MixSamples(const float* source, uint32_t frameCount, float leftGain, float rightGain, uint32_t channelCount, float* destination);
+
+	// Mixes as much of the voice as fits from blockOffset to the end of the block, and advances its position.
+	// Synthesised and compressed clicks are rendered a few hundred frames at a time into a buffer on the stack
+	// and mixed from there, compressed ones decoding on from where the voice's cursor left off.
+	void MixVoice(Voice& voice, float* output, uint32_t channelCount, uint32_t blockOffset, uint32_t frameCount);
+
+	// Continues every active voice through the block, removing those that finish
+	void MixVoices(VoicePool& voices, float* output, uint32_t channelCount, uint32_t frameCount);
+}
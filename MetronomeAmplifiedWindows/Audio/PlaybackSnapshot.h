@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Songs/SongTimeline.h"
+
+namespace audio {
+
+	// A click the engine has started, numbered in the order they were started
+	struct OnsetRecord {
+		uint64_t sample;
+		float gain;
+		ToneVoice voice;
+	};
+
+	// What the audio thread last rendered, published at the end of every block for the UI to extrapolate from.
+	// The host count is read from the engine's host clock as the block was requested, and the sink's buffering
+	// decides how long after that its first sample is heard.
+	struct PlaybackSnapshot {
+		static const int OnsetCapacity = 8;
+
+		uint64_t hostCounter;
+		uint64_t streamFrame;
+		uint64_t playheadSample;
+		uint32_t blockFrames;
+		uint32_t sampleRate;
+		bool isPlaying;
+
+		// The most recent onsets, each at onsets[number % OnsetCapacity]. Those numbered below seekOnsetCount
+		// were started before the last seek or rewind, so their samples are from an old position.
+		uint64_t onsetCount;
+		uint64_t seekOnsetCount;
+		OnsetRecord onsets[OnsetCapacity];
+
+		// The click due to be started next, numbered onsetCount, so that it can be shown before it is rendered.
+		// Settings changed before then can still move it.
+		bool hasNextOnset;
+		OnsetRecord nextOnset;
+
+		// Frames left to play before the stop timer fires, counting to the bar line once it is waiting for one
+		bool hasStopTimer;
+		uint64_t stopTimerRemainingFrames;
+
+		inline const OnsetRecord& GetOnset(uint64_t number) const { return onsets[number % OnsetCapacity]; }
+	};
+
+	// Where playback has got to as of the end of the last block, for scenes to show every frame. Bars and beats
+	// count from zero: in a song, within the current section, and on the metronome, since it was last rewound.
+	// The beat is the last one started at or before the playhead, or zero before the first.
+	struct PlaybackPosition {
+		uint64_t streamFrame;
+		uint64_t playheadSample;
+		bool isPlaying;
+		bool isSong;
+		uint32_t section;
+		uint64_t bar;
+		uint32_t beat;
+		uint32_t beatsPerBar;
+		double beatsPerMinute;
+	};
+
+	// Sent to the UI when the stop timer stops playback. Stream frames count every frame rendered, as in the
+	// snapshot, and the host count is the one the snapshot of the block it fired in was stamped with.
+	struct StopTimerEvent {
+		uint64_t playheadSample;
+		uint64_t streamFrame;
+		uint64_t hostCounter;
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+namespace audio {
+
+	// Hands a small value from one writer thread to any number of readers without either side blocking. The
+	// writer never waits; a reader that overlaps a store sees the sequence change and tries again. The value is
+	// held as relaxed atomic words, so a read racing a store is well defined and simply discarded.
+	template<typename T>
+	class SeqLock {
+		static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied word by word");
+
+	public:
+		SeqLock() : m_sequence(0) {
+			for (std::atomic<uint64_t>& word : m_words) {
+				word.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		// Writer thread only
+		void Store(const T& value) {
+			uint64_t words[WordCount] = {};
+			memcpy(words, &value, sizeof(T));
+			const uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+			m_sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			for (size_t i = 0; i < WordCount; i++) {
+				m_words[i].store(words[i], std::memory_order_relaxed);
+			}
+			m_sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		// Returns false, leaving value untouched, if a store was in progress
+		bool TryLoad(T& value) const {
+			const uint32_t before = m_sequence.load(std::memory_order_acquire);
+			if ((before & 1) != 0) {
+				return false;
+			}
+			uint64_t words[WordCount];
+			for (size_t i = 0; i < WordCount; i++) {
+				words[i] = m_words[i].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (m_sequence.load(std::memory_order_relaxed) != before) {
+				return false;
+			}
+			memcpy(&value, words, sizeof(T));
+			return true;
+		}
+
+		// Not for the writer thread, which could wait on its own store
+		T Load() const {
+			T value;
+			while (!TryLoad(value)) {
+				std::this_thread::yield();
+			}
+			return value;
+		}
+
+	private:
+		static const size_t WordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+		std::atomic<uint32_t> m_sequence;
+		std::atomic<uint64_t> m_words[WordCount];
+	};
+}
@@ -0,0 +1,41 @@
+#include "pch.h"
+#include "ClockOffsetEstimator.h"
+
+audio::ClockOffsetEstimator::ClockOffsetEstimator() :
+	m_samples(),
+	m_next(0),
+	m_sampleCount(0),
+	m_offsetMicros(0),
+	m_minDelayMicros(0)
+{
+}
+
+void audio::ClockOffsetEstimator::Reset()
+{
+	m_next = 0;
+	m_sampleCount = 0;
+	m_offsetMicros = 0;
+	m_minDelayMicros = 0;
+}
+
+void audio::ClockOffsetEstimator::Record(int64_t pingSentMicros, int64_t pingReceivedMicros, int64_t pongSentMicros, int64_t pongReceivedMicros)
+{
+	const int64_t delay = (pongReceivedMicros - pingSentMicros) - (pongSentMicros - pingReceivedMicros);
+	if (delay < 0) {
+		return;
+	}
+	m_samples[m_next] = { ((pingReceivedMicros - pingSentMicros) + (pongSentMicros - pongReceivedMicros)) / 2, delay };
+	m_next = (m_next + 1) % WindowSize;
+	m_sampleCount = min(m_sampleCount + 1, WindowSize);
+
+	std::array<Sample, WindowSize> quickest = m_samples;
+	const size_t count = max((size_t)1, m_sampleCount / 4);
+	auto byDelay = [](const Sample& a, const Sample& b) { return a.delayMicros < b.delayMicros; };
+	std::partial_sort(quickest.begin(), quickest.begin() + count, quickest.begin() + m_sampleCount, byDelay);
+	int64_t sum = 0;
+	for (size_t i = 0; i < count; i++) {
+		sum += quickest[i].offsetMicros;
+	}
+	m_offsetMicros = sum / (int64_t)count;
+	m_minDelayMicros = quickest[0].delayMicros;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+
+namespace audio {
+
+	// How far another peer's clock runs ahead of ours, measured as NTP does from ping round trips: we send at t0,
+	// they receive at t1 and reply at t2 by their clock, and the reply arrives at t3 by ours. Each round trip
+	// puts the offset at ((t1 - t0) + (t2 - t3)) / 2, out by at most half the time spent on the network, so the
+	// estimate averages the offsets of the quickest quarter of the last WindowSize round trips: those least
+	// delayed are the least skewed by jitter and queueing on one leg.
+	class ClockOffsetEstimator {
+	public:
+		static const size_t WindowSize = 32;
+
+		// Round trips needed before the estimate is trusted
+		static const size_t MinSampleCount = 4;
+
+		ClockOffsetEstimator();
+
+		void Reset();
+		void Record(int64_t pingSentMicros, int64_t pingReceivedMicros, int64_t pongSentMicros, int64_t pongReceivedMicros);
+
+		inline bool HasEstimate() const { return m_sampleCount >= MinSampleCount; }
+		inline int64_t GetOffsetMicros() const { return m_offsetMicros; }
+
+		// Network time of the quickest round trip in the window, less the time the other peer took to reply
+		inline int64_t GetMinDelayMicros() const { return m_minDelayMicros; }
+
+	private:
+		struct Sample {
+			int64_t offsetMicros;
+			int64_t delayMicros;
+		};
+
+		std::array<Sample, WindowSize> m_samples;
+		size_t m_next;
+		size_t m_sampleCount;
+		int64_t m_offsetMicros;
+		int64_t m_minDelayMicros;
+	};
+}
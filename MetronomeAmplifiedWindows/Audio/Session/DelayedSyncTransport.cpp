@@ -0,0 +1,58 @@
+#include "pch.h"
+#include "DelayedSyncTransport.h"
+
+audio::DelayedSyncTransport::DelayedSyncTransport(SyncTransport& inner, double latencySeconds, double jitterSeconds, double lossFraction, uint32_t seed) :
+	m_inner(inner),
+	m_clock(),
+	m_frequency(0),
+	m_latencySeconds(latencySeconds),
+	m_jitterSeconds(jitterSeconds),
+	m_lossFraction(lossFraction),
+	m_random(seed),
+	m_pending(),
+	m_lostDatagramCount(0)
+{
+	if (latencySeconds < 0.0 || jitterSeconds < 0.0) {
+		throw std::invalid_argument("Latency and jitter must not be negative");
+	}
+	if (lossFraction < 0.0 || lossFraction >= 1.0) {
+		throw std::invalid_argument("Loss fraction must be at least 0 and less than 1");
+	}
+	m_frequency = m_clock.GetFrequency();
+}
+
+void audio::DelayedSyncTransport::Send(const uint8_t* bytes, uint32_t length)
+{
+	m_inner.Send(bytes, length);
+}
+
+// Take in everything that has come, then hand over whichever datagram is due first
+bool audio::DelayedSyncTransport::TryReceive(uint8_t* bytes, uint32_t capacity, uint32_t& length)
+{
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	Datagram datagram;
+	while (m_inner.TryReceive(datagram.bytes.data(), MaxDatagramBytes, datagram.length)) {
+		if (unit(m_random) < m_lossFraction) {
+			m_lostDatagramCount++;
+			continue;
+		}
+		const double delaySeconds = m_latencySeconds + m_jitterSeconds * unit(m_random);
+		datagram.dueCounter = m_clock.GetCounter() + (uint64_t)(delaySeconds * m_frequency);
+		m_pending.push_back(datagram);
+	}
+
+	const uint64_t now = m_clock.GetCounter();
+	auto earliest = std::min_element(m_pending.begin(), m_pending.end(),
+		[](const Datagram& a, const Datagram& b) { return a.dueCounter < b.dueCounter; });
+	if (earliest == m_pending.end() || earliest->dueCounter > now) {
+		return false;
+	}
+	if (earliest->length > capacity) {
+		m_pending.erase(earliest);
+		return false;
+	}
+	memcpy(bytes, earliest->bytes.data(), earliest->length);
+	length = earliest->length;
+	m_pending.erase(earliest);
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "SyncTransport.h"
+#include "../../Common/ClockSource.h"
+
+#include <array>
+#include <random>
+
+namespace audio {
+
+	// Holds back what another transport receives, as a slow or congested network would: each datagram arrives
+	// the latency after it came in, plus a random jitter of up to the given amount, which can put datagrams out of
+	// order, and a fraction of them are lost altogether. For trying SessionSync with peers in one process.
+	class DelayedSyncTransport : public SyncTransport {
+	public:
+		// The inner transport must outlive this one. Throws std::invalid_argument for a negative delay or a loss
+		// fraction outside [0, 1).
+		DelayedSyncTransport(SyncTransport& inner, double latencySeconds, double jitterSeconds, double lossFraction, uint32_t seed);
+
+		virtual void Send(const uint8_t* bytes, uint32_t length) override;
+		virtual bool TryReceive(uint8_t* bytes, uint32_t capacity, uint32_t& length) override;
+
+		inline uint64_t GetLostDatagramCount() const { return m_lostDatagramCount; }
+
+	private:
+		struct Datagram {
+			uint64_t dueCounter;
+			std::array<uint8_t, MaxDatagramBytes> bytes;
+			uint32_t length;
+		};
+
+		SyncTransport& m_inner;
+		DX::DefaultClock m_clock;
+		uint64_t m_frequency;
+		double m_latencySeconds;
+		double m_jitterSeconds;
+		double m_lossFraction;
+		std::mt19937 m_random;
+		std::vector<Datagram> m_pending;
+		uint64_t m_lostDatagramCount;
+	};
+}
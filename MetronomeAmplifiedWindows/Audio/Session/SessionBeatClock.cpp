@@ -0,0 +1,55 @@
+#include "pch.h"
+#include "SessionBeatClock.h"
+
+audio::SessionBeatClock::SessionBeatClock(uint32_t sampleRate) :
+	m_sampleRate(sampleRate),
+	m_latencySeconds(0.0),
+	m_hasState(false),
+	m_state(),
+	m_hasMapping(false),
+	m_originFrame(0),
+	m_originMicros(0.0)
+{
+	if (sampleRate == 0) {
+		throw std::invalid_argument("Sample rate must be positive");
+	}
+}
+
+void audio::SessionBeatClock::SetLatency(uint32_t outputLatencyFrames, double deviceLatencySeconds)
+{
+	m_latencySeconds = (double)outputLatencyFrames / m_sampleRate + deviceLatencySeconds;
+}
+
+// Ease the mapping towards when this block will be heard, or jump straight to it after a dropout
+bool audio::SessionBeatClock::BeginBlock(const SessionSync& session, uint64_t hostCounter, uint64_t streamFrame, uint32_t frameCount)
+{
+	SessionState state;
+	if (session.TryGetState(state)) {
+		m_state = state;
+		m_hasState = true;
+	}
+	if (!m_hasState || !m_state.isEnabled) {
+		m_hasMapping = false;
+		return false;
+	}
+	const double microsPerFrame = 1.0e6 / m_sampleRate;
+	const double heardMicros = (double)CountsToMicros(hostCounter, m_state.frequency) + m_latencySeconds * 1.0e6;
+	const double expectedMicros = m_originMicros + (double)(int64_t)(streamFrame - m_originFrame) * microsPerFrame;
+	const double error = heardMicros - expectedMicros;
+	const bool isJump = !m_hasMapping || fabs(error) > SnapBlocks * frameCount * microsPerFrame;
+	m_originMicros = isJump ? heardMicros : expectedMicros + Smoothing * error;
+	m_originFrame = streamFrame;
+	m_hasMapping = true;
+	return true;
+}
+
+double audio::SessionBeatClock::GetBeatAtFrame(uint64_t streamFrame) const
+{
+	return m_state.timeline.GetBeatAt(m_originMicros + (double)(int64_t)(streamFrame - m_originFrame) * 1.0e6 / m_sampleRate);
+}
+
+uint64_t audio::SessionBeatClock::GetFrameOfBeat(double beat) const
+{
+	const double frames = (m_state.timeline.GetMicrosAt(beat) - m_originMicros) * m_sampleRate / 1.0e6;
+	return (uint64_t)max(0.0, round((double)m_originFrame + frames));
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "SessionSync.h"
+
+namespace audio {
+
+	// The audio thread's view of a session: which session beat is heard at each stream frame, and the frame each
+	// beat is heard at. Frames are mapped to host time as MidiOutput maps them, the output latency after the
+	// block was rendered and eased towards each new block, and the session's timeline turns host time into beats.
+	// The state is read once a block without waiting; if the network thread is updating it just then, the block
+	// goes on with the state the last one had.
+	class SessionBeatClock {
+	public:
+		// Fraction of each new block's timing error taken into the mapping
+		static constexpr double Smoothing = 0.125;
+
+		// Errors beyond this many blocks are a jump in the stream rather than jitter
+		static constexpr double SnapBlocks = 4.0;
+
+		explicit SessionBeatClock(uint32_t sampleRate);
+
+		// Before the sink starts. The sink's buffering and the further delay in the device, as for MidiOutput.
+		void SetLatency(uint32_t outputLatencyFrames, double deviceLatencySeconds);
+
+		// Audio thread, at the start of every block. Returns whether the session is to be followed, which needs
+		// it to be running. The host counter must come from the session's own clock.
+		bool BeginBlock(const SessionSync& session, uint64_t hostCounter, uint64_t streamFrame, uint32_t frameCount);
+
+		// Audio thread, after BeginBlock. A frame that would come before the stream started is frame zero.
+		double GetBeatAtFrame(uint64_t streamFrame) const;
+		uint64_t GetFrameOfBeat(double beat) const;
+		inline double GetTempoAtBeat(double beat) const { return m_state.timeline.GetTempoAt(beat); }
+
+	private:
+		uint32_t m_sampleRate;
+		double m_latencySeconds;
+		bool m_hasState;
+		SessionState m_state;
+
+		// Host microseconds at which the origin frame is heard
+		bool m_hasMapping;
+		uint64_t m_originFrame;
+		double m_originMicros;
+	};
+}
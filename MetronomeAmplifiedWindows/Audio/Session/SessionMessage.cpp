@@ -0,0 +1,144 @@
+#include "pch.h"
+#include "SessionMessage.h"
+
+namespace {
+
+	const uint32_t HeaderBytes = 14;
+
+	class Writer {
+	public:
+		explicit Writer(uint8_t* bytes) : m_bytes(bytes), m_length(0) {}
+
+		void Byte(uint8_t value) {
+			m_bytes[m_length++] = value;
+		}
+
+		void Word(uint64_t value, uint32_t byteCount) {
+			for (uint32_t i = 0; i < byteCount; i++) {
+				m_bytes[m_length++] = (uint8_t)(value >> (8 * i));
+			}
+		}
+
+		void Double(double value) {
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			Word(bits, 8);
+		}
+
+		inline uint32_t GetLength() const { return m_length; }
+
+	private:
+		uint8_t* m_bytes;
+		uint32_t m_length;
+	};
+
+	// Reading past the end yields zeros and marks the message as cut short
+	class Reader {
+	public:
+		Reader(const uint8_t* bytes, uint32_t length) : m_bytes(bytes), m_length(length), m_position(0), m_isShort(false) {}
+
+		uint8_t Byte() {
+			return (uint8_t)Word(1);
+		}
+
+		uint64_t Word(uint32_t byteCount) {
+			if (m_position + byteCount > m_length) {
+				m_isShort = true;
+				return 0;
+			}
+			uint64_t value = 0;
+			for (uint32_t i = 0; i < byteCount; i++) {
+				value |= (uint64_t)m_bytes[m_position++] << (8 * i);
+			}
+			return value;
+		}
+
+		double Double() {
+			const uint64_t bits = Word(8);
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		inline bool IsComplete() const { return !m_isShort && m_position == m_length; }
+
+	private:
+		const uint8_t* m_bytes;
+		uint32_t m_length;
+		uint32_t m_position;
+		bool m_isShort;
+	};
+
+	bool IsTempo(double beatsPerMinute)
+	{
+		return std::isfinite(beatsPerMinute) && beatsPerMinute > 0.0;
+	}
+}
+
+uint32_t audio::EncodeSessionMessage(const SessionMessage& message, uint8_t* bytes)
+{
+	Writer writer(bytes);
+	writer.Word(SessionMessageMagic, 4);
+	writer.Byte(SessionMessageVersion);
+	writer.Byte((uint8_t)message.type);
+	writer.Word(message.senderId, 8);
+	switch (message.type) {
+	case SessionMessageType::PING:
+		writer.Word((uint64_t)message.pingSentMicros, 8);
+		break;
+	case SessionMessageType::PONG:
+		writer.Word(message.targetId, 8);
+		writer.Word((uint64_t)message.pingSentMicros, 8);
+		writer.Word((uint64_t)message.pingReceivedMicros, 8);
+		writer.Word((uint64_t)message.pongSentMicros, 8);
+		break;
+	case SessionMessageType::STATE:
+		writer.Double(message.timeline.beatsPerMinute);
+		writer.Double(message.timeline.originBeat);
+		writer.Word((uint64_t)message.timeline.originMicros, 8);
+		writer.Double(message.timeline.nextBeatsPerMinute);
+		writer.Double(message.timeline.changeBeat);
+		writer.Word(message.timeline.version, 8);
+		writer.Word(message.timeline.originatorId, 8);
+		break;
+	}
+	return writer.GetLength();
+}
+
+bool audio::DecodeSessionMessage(const uint8_t* bytes, uint32_t length, SessionMessage& message)
+{
+	if (length < HeaderBytes) {
+		return false;
+	}
+	Reader reader(bytes, length);
+	if (reader.Word(4) != SessionMessageMagic || reader.Byte() != SessionMessageVersion) {
+		return false;
+	}
+	message = {};
+	message.type = (SessionMessageType)reader.Byte();
+	message.senderId = reader.Word(8);
+	switch (message.type) {
+	case SessionMessageType::PING:
+		message.pingSentMicros = (int64_t)reader.Word(8);
+		return reader.IsComplete();
+	case SessionMessageType::PONG:
+		message.targetId = reader.Word(8);
+		message.pingSentMicros = (int64_t)reader.Word(8);
+		message.pingReceivedMicros = (int64_t)reader.Word(8);
+		message.pongSentMicros = (int64_t)reader.Word(8);
+		return reader.IsComplete();
+	case SessionMessageType::STATE:
+		message.timeline.beatsPerMinute = reader.Double();
+		message.timeline.originBeat = reader.Double();
+		message.timeline.originMicros = (int64_t)reader.Word(8);
+		message.timeline.nextBeatsPerMinute = reader.Double();
+		message.timeline.changeBeat = reader.Double();
+		message.timeline.version = reader.Word(8);
+		message.timeline.originatorId = reader.Word(8);
+		// A change is either waiting at a finite beat after the origin, or there is none
+		return reader.IsComplete() && IsTempo(message.timeline.beatsPerMinute) && IsTempo(message.timeline.nextBeatsPerMinute) &&
+			std::isfinite(message.timeline.originBeat) && message.timeline.changeBeat >= message.timeline.originBeat;
+	default:
+		return false;
+	}
+}
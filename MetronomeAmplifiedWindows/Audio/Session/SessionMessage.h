@@ -0,0 +1,39 @@
+#pragma once
+
+#include "SessionTimeline.h"
+
+namespace audio {
+
+	enum class SessionMessageType : uint8_t {
+		PING = 1,
+		PONG = 2,
+		STATE = 3
+	};
+
+	// What peers say to each other. A ping carries when it was sent, and the pong answering it adds when it was
+	// received and answered, in the answering peer's clock; a state message carries the sender's timeline in its
+	// own clock. Every message goes to every peer, so a pong names the peer it answers.
+	struct SessionMessage {
+		SessionMessageType type;
+		uint64_t senderId;
+		uint64_t targetId;
+		int64_t pingSentMicros;
+		int64_t pingReceivedMicros;
+		int64_t pongSentMicros;
+		SessionTimeline timeline;
+	};
+
+	// Datagram layout: the magic "MASY", the format version and the message type, then the sender and the
+	// type's own fields. Integers are little-endian and doubles are sent as the bits of their IEEE value, so
+	// devices of either byte order understand each other.
+	const uint32_t SessionMessageMagic = 0x5953414d;
+	const uint8_t SessionMessageVersion = 1;
+	const uint32_t SessionMessageMaxBytes = 80;
+
+	// Returns the length written, which is at most SessionMessageMaxBytes
+	uint32_t EncodeSessionMessage(const SessionMessage& message, uint8_t* bytes);
+
+	// Returns false for anything that is not a whole, well-formed message of this version, such as a datagram
+	// from another application sharing the port
+	bool DecodeSessionMessage(const uint8_t* bytes, uint32_t length, SessionMessage& message);
+}
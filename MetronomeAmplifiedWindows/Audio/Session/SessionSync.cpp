@@ -0,0 +1,230 @@
+#include "pch.h"
+#include "SessionSync.h"
+
+#include <chrono>
+
+audio::SessionSync::SessionSync(SyncTransport& transport, uint64_t peerId, double beatsPerMinute) :
+	m_transport(transport),
+	m_peerId(peerId),
+	m_defaultHostClock(),
+	m_hostClock(nullptr),
+	m_readHostClock(nullptr),
+	m_frequency(0),
+	m_requestedBeatsPerMinute(beatsPerMinute),
+	m_tempoChanges(beatsPerMinute),
+	m_timeline(SessionTimeline::Start(beatsPerMinute, 0, peerId)),
+	m_peers(),
+	m_nextPingCounter(0),
+	m_nextAnnounceCounter(0),
+	m_publishedState(),
+	m_thread(),
+	m_isRunning(false),
+	m_rejectedMessageCount(0)
+{
+	if (!(beatsPerMinute > 0.0)) {
+		throw std::invalid_argument("Tempo must be positive");
+	}
+	SetHostClock(&m_defaultHostClock);
+	Publish(false);
+}
+
+audio::SessionSync::~SessionSync()
+{
+	Stop();
+}
+
+void audio::SessionSync::Start()
+{
+	Stop();
+	double beatsPerMinute;
+	m_tempoChanges.TryTake(beatsPerMinute);
+	const uint64_t counter = m_readHostClock(m_hostClock);
+	m_timeline = SessionTimeline::Start(m_requestedBeatsPerMinute, GetMicros(counter), m_peerId);
+	for (Peer& peer : m_peers) {
+		peer.isActive = false;
+	}
+	m_nextPingCounter = counter;
+	m_nextAnnounceCounter = counter;
+	Publish(true);
+	m_isRunning = true;
+	m_thread = std::thread(&SessionSync::Run, this);
+}
+
+void audio::SessionSync::Stop()
+{
+	m_isRunning = false;
+	if (m_thread.joinable()) {
+		m_thread.join();
+		Publish(false);
+	}
+}
+
+bool audio::SessionSync::SetTempo(double beatsPerMinute)
+{
+	if (!(beatsPerMinute > 0.0)) {
+		return false;
+	}
+	m_requestedBeatsPerMinute = beatsPerMinute;
+	m_tempoChanges.Set(beatsPerMinute);
+	return true;
+}
+
+int64_t audio::SessionSync::GetMicros(uint64_t counter) const
+{
+	return CountsToMicros(counter, m_frequency);
+}
+
+void audio::SessionSync::Run()
+{
+	const uint64_t pingCounts = (uint64_t)(PingSeconds * m_frequency);
+	const uint64_t timeoutCounts = (uint64_t)(PeerTimeoutSeconds * m_frequency);
+	std::array<uint8_t, SyncTransport::MaxDatagramBytes> bytes;
+	while (m_isRunning) {
+		uint32_t length;
+		while (m_transport.TryReceive(bytes.data(), (uint32_t)bytes.size(), length)) {
+			const uint64_t counter = m_readHostClock(m_hostClock);
+			SessionMessage message;
+			if (!DecodeSessionMessage(bytes.data(), length, message)) {
+				m_rejectedMessageCount.fetch_add(1, std::memory_order_relaxed);
+			} else if (message.senderId != m_peerId) {
+				Receive(message, counter);
+			}
+		}
+
+		const uint64_t counter = m_readHostClock(m_hostClock);
+		for (Peer& peer : m_peers) {
+			if (peer.isActive && counter - peer.lastHeardCounter > timeoutCounts) {
+				peer.isActive = false;
+			}
+		}
+		m_timeline = m_timeline.Settle(GetMicros(counter));
+		ApplyTempoChange(GetMicros(counter));
+		if (counter >= m_nextPingCounter) {
+			SessionMessage ping = {};
+			ping.type = SessionMessageType::PING;
+			ping.senderId = m_peerId;
+			ping.pingSentMicros = GetMicros(m_readHostClock(m_hostClock));
+			Send(ping);
+			m_nextPingCounter = counter + pingCounts;
+		}
+		if (counter >= m_nextAnnounceCounter) {
+			Announce();
+		}
+		Publish(true);
+		std::this_thread::sleep_for(std::chrono::duration<double>(PollSeconds));
+	}
+}
+
+// Pings are answered straight away, so that the time spent replying barely adds to the round trip
+void audio::SessionSync::Receive(const SessionMessage& message, uint64_t counter)
+{
+	Peer* peer = FindPeer(message.senderId, counter);
+	if (peer == nullptr) {
+		return;
+	}
+	switch (message.type) {
+	case SessionMessageType::PING: {
+		SessionMessage pong = {};
+		pong.type = SessionMessageType::PONG;
+		pong.senderId = m_peerId;
+		pong.targetId = message.senderId;
+		pong.pingSentMicros = message.pingSentMicros;
+		pong.pingReceivedMicros = GetMicros(counter);
+		pong.pongSentMicros = GetMicros(m_readHostClock(m_hostClock));
+		Send(pong);
+		break;
+	}
+	case SessionMessageType::PONG:
+		if (message.targetId == m_peerId) {
+			peer->offsets.Record(message.pingSentMicros, message.pingReceivedMicros, message.pongSentMicros, GetMicros(counter));
+		}
+		break;
+	case SessionMessageType::STATE:
+		// A timeline means nothing until we know how to move it into our clock
+		if (peer->offsets.HasEstimate()) {
+			AcceptTimeline(message, *peer);
+		}
+		break;
+	}
+}
+
+// The peer's slot, taking a free one for a peer not heard from before; null if the table is full
+audio::SessionSync::Peer* audio::SessionSync::FindPeer(uint64_t peerId, uint64_t counter)
+{
+	Peer* freePeer = nullptr;
+	for (Peer& peer : m_peers) {
+		if (peer.isActive && peer.id == peerId) {
+			peer.lastHeardCounter = counter;
+			return &peer;
+		}
+		if (!peer.isActive && freePeer == nullptr) {
+			freePeer = &peer;
+		}
+	}
+	if (freePeer != nullptr) {
+		freePeer->id = peerId;
+		freePeer->lastHeardCounter = counter;
+		freePeer->isActive = true;
+		freePeer->offsets.Reset();
+	}
+	return freePeer;
+}
+
+// Take on a timeline that supersedes ours, and keep following its originator's own copy of it as our estimate of
+// their clock improves. A session of our own that wins against another peer's becomes a shared one, which no
+// peer still on its own can then override.
+void audio::SessionSync::AcceptTimeline(const SessionMessage& message, const Peer& peer)
+{
+	const SessionTimeline timeline = message.timeline.Shift(-peer.offsets.GetOffsetMicros());
+	const bool isOriginal = timeline.version == m_timeline.version && timeline.originatorId == m_timeline.originatorId &&
+		message.senderId == timeline.originatorId;
+	if (timeline.Supersedes(m_timeline) || isOriginal) {
+		m_timeline = timeline;
+	} else if (m_timeline.version == 0) {
+		m_timeline.version = 1;
+		Announce();
+	}
+}
+
+// The latest tempo asked for lands on a whole beat far enough ahead for every peer to hear of it first, once no
+// other change is waiting
+void audio::SessionSync::ApplyTempoChange(int64_t micros)
+{
+	double beatsPerMinute;
+	if (std::isfinite(m_timeline.changeBeat) || !m_tempoChanges.TryTake(beatsPerMinute)) {
+		return;
+	}
+	if (beatsPerMinute == m_timeline.beatsPerMinute) {
+		return;
+	}
+	const double beat = ceil(m_timeline.GetBeatAt((double)micros) + ChangeLeadBeats);
+	m_timeline = m_timeline.ChangeTempo(beatsPerMinute, beat, m_peerId);
+	Announce();
+}
+
+void audio::SessionSync::Send(const SessionMessage& message)
+{
+	uint8_t bytes[SessionMessageMaxBytes];
+	m_transport.Send(bytes, EncodeSessionMessage(message, bytes));
+}
+
+void audio::SessionSync::Announce()
+{
+	SessionMessage state = {};
+	state.type = SessionMessageType::STATE;
+	state.senderId = m_peerId;
+	state.timeline = m_timeline;
+	Send(state);
+	m_nextAnnounceCounter = m_readHostClock(m_hostClock) + (uint64_t)(AnnounceSeconds * m_frequency);
+}
+
+void audio::SessionSync::Publish(bool isEnabled)
+{
+	uint32_t peerCount = 0;
+	for (const Peer& peer : m_peers) {
+		if (peer.isActive) {
+			peerCount++;
+		}
+	}
+	m_publishedState.Store({ m_timeline, m_frequency, peerCount, isEnabled });
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "ClockOffsetEstimator.h"
+#include "SessionMessage.h"
+#include "SyncTransport.h"
+#include "../CoalescedParameter.h"
+#include "../SeqLock.h"
+#include "../../Common/ClockSource.h"
+
+#include <array>
+#include <atomic>
+#include <thread>
+
+namespace audio {
+
+	// The session as one peer sees it: the shared timeline in microseconds of this peer's host clock, whose
+	// frequency is given, and how many other peers it is hearing from. Not enabled while the peer is stopped.
+	struct SessionState {
+		SessionTimeline timeline;
+		uint64_t frequency;
+		uint32_t peerCount;
+		bool isEnabled;
+	};
+
+	// Keeps one device's beat in step with the other devices on the network, in the manner of Ableton Link.
+	// Peers ping each other to measure how far each other's clocks are from their own, as NTP does, and keep
+	// announcing the timeline they play; each takes on any timeline that supersedes its own, moved into its own
+	// clock, so all of them converge on the same tempo and phase with no peer in charge. A new tempo takes effect
+	// on a whole beat at least ChangeLeadBeats ahead, so that every peer has heard of it by the time it lands.
+	// A peer on its own plays a session of its own, which the first peer to agree with it makes shared; a
+	// shared session is never overridden by one that is not, so a peer joining it falls into step with it.
+	// Everything happens on a network thread of its own; the audio thread reads the state without ever waiting.
+	class SessionSync {
+	public:
+		static const size_t MaxPeers = 8;
+		static constexpr double PingSeconds = 0.05;
+		static constexpr double AnnounceSeconds = 0.1;
+
+		// A peer not heard from for this long has left, and its clock offset is forgotten
+		static constexpr double PeerTimeoutSeconds = 1.0;
+
+		// Beats between asking for a tempo and the beat it changes on, at the least
+		static constexpr double ChangeLeadBeats = 1.0;
+
+		static constexpr double PollSeconds = 0.001;
+
+		// The transport must outlive the session. Peer ids must be unique on the network, and are best random.
+		// Throws std::invalid_argument for a tempo that is not positive.
+		SessionSync(SyncTransport& transport, uint64_t peerId, double beatsPerMinute);
+		~SessionSync();
+
+		// UI thread, before starting. The session's timeline is kept in this clock, which must be the one the
+		// engine following it uses, and must outlive the session; until set, it uses its own DX::DefaultClock.
+		template<typename TClock>
+		void SetHostClock(const TClock* clock) {
+			m_hostClock = clock;
+			m_readHostClock = [](const void* hostClock) { return ((const TClock*)hostClock)->GetCounter(); };
+			m_frequency = clock->GetFrequency();
+		}
+
+		// UI thread. Starting begins a session of our own, at the tempo last asked for, until others are heard.
+		void Start();
+		void Stop();
+
+		// UI thread. As often as the input changes; a change still waiting for its beat is never replaced, so
+		// the latest tempo asked for is taken once it has landed. Returns false for a tempo that is not positive.
+		bool SetTempo(double beatsPerMinute);
+
+		// Any thread. The audio thread uses TryGetState, which fails rather than wait if the state is being updated.
+		inline bool TryGetState(SessionState& state) const { return m_publishedState.TryLoad(state); }
+		inline SessionState GetState() const { return m_publishedState.Load(); }
+
+		inline uint64_t GetPeerId() const { return m_peerId; }
+
+		// Any thread. Messages that could not be read, such as another application's on the same port.
+		inline uint64_t GetRejectedMessageCount() const { return m_rejectedMessageCount.load(std::memory_order_relaxed); }
+
+	private:
+		struct Peer {
+			uint64_t id;
+			uint64_t lastHeardCounter;
+			bool isActive;
+			ClockOffsetEstimator offsets;
+		};
+
+		SyncTransport& m_transport;
+		uint64_t m_peerId;
+		DX::DefaultClock m_defaultHostClock;
+		const void* m_hostClock;
+		uint64_t (*m_readHostClock)(const void* hostClock);
+		uint64_t m_frequency;
+		double m_requestedBeatsPerMinute;
+		CoalescedParameter m_tempoChanges;
+
+		// Owned by the network thread while it runs
+		SessionTimeline m_timeline;
+		std::array<Peer, MaxPeers> m_peers;
+		uint64_t m_nextPingCounter;
+		uint64_t m_nextAnnounceCounter;
+
+		SeqLock<SessionState> m_publishedState;
+		std::thread m_thread;
+		std::atomic<bool> m_isRunning;
+		std::atomic<uint64_t> m_rejectedMessageCount;
+
+		int64_t GetMicros(uint64_t counter) const;
+		void Run();
+		void Receive(const SessionMessage& message, uint64_t counter);
+		Peer* FindPeer(uint64_t peerId, uint64_t counter);
+		void AcceptTimeline(const SessionMessage& message, const Peer& peer);
+		void ApplyTempoChange(int64_t micros);
+		void Send(const SessionMessage& message);
+		void Announce();
+		void Publish(bool isEnabled);
+	};
+}
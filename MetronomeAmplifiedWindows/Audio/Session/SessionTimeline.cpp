@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "SessionTimeline.h"
+
+#include <limits>
+
+namespace {
+
+	const double MicrosPerMinute = 60.0e6;
+}
+
+audio::SessionTimeline audio::SessionTimeline::Start(double beatsPerMinute, int64_t micros, uint64_t peerId)
+{
+	return { beatsPerMinute, 0.0, micros, beatsPerMinute, std::numeric_limits<double>::infinity(), 0, peerId };
+}
+
+double audio::SessionTimeline::GetBeatAt(double micros) const
+{
+	const double beat = originBeat + (micros - (double)originMicros) * beatsPerMinute / MicrosPerMinute;
+	if (beat < changeBeat) {
+		return beat;
+	}
+	return changeBeat + (micros - GetMicrosAt(changeBeat)) * nextBeatsPerMinute / MicrosPerMinute;
+}
+
+double audio::SessionTimeline::GetMicrosAt(double beat) const
+{
+	const double micros = (double)originMicros + (min(beat, changeBeat) - originBeat) * MicrosPerMinute / beatsPerMinute;
+	if (beat <= changeBeat) {
+		return micros;
+	}
+	return micros + (beat - changeBeat) * MicrosPerMinute / nextBeatsPerMinute;
+}
+
+double audio::SessionTimeline::GetTempoAt(double beat) const
+{
+	return beat < changeBeat ? beatsPerMinute : nextBeatsPerMinute;
+}
+
+audio::SessionTimeline audio::SessionTimeline::Settle(int64_t micros) const
+{
+	if (GetBeatAt((double)micros) < changeBeat) {
+		return *this;
+	}
+	SessionTimeline settled = *this;
+	settled.originMicros = llround(GetMicrosAt(changeBeat));
+	settled.originBeat = changeBeat;
+	settled.beatsPerMinute = nextBeatsPerMinute;
+	settled.changeBeat = std::numeric_limits<double>::infinity();
+	return settled;
+}
+
+audio::SessionTimeline audio::SessionTimeline::Shift(int64_t offsetMicros) const
+{
+	SessionTimeline shifted = *this;
+	shifted.originMicros += offsetMicros;
+	return shifted;
+}
+
+audio::SessionTimeline audio::SessionTimeline::ChangeTempo(double tempo, double beat, uint64_t peerId) const
+{
+	SessionTimeline changed = *this;
+	changed.nextBeatsPerMinute = tempo;
+	changed.changeBeat = beat;
+	changed.version = version + 1;
+	changed.originatorId = peerId;
+	return changed;
+}
+
+bool audio::SessionTimeline::Supersedes(const SessionTimeline& other) const
+{
+	return version > other.version || (version == other.version && originatorId < other.originatorId);
+}
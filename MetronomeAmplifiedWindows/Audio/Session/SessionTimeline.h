@@ -0,0 +1,47 @@
+#pragma once
+
+namespace audio {
+
+	// Microseconds of a host clock, without overflowing however long the machine has been up
+	inline int64_t CountsToMicros(uint64_t counter, uint64_t frequency) {
+		return (int64_t)(counter / frequency * 1000000 + counter % frequency * 1000000 / frequency);
+	}
+
+	// A session's shared beat: which beat it is at any moment, in microseconds of one peer's host clock, with at
+	// most one tempo change waiting to take over at a future beat. Every peer holds the same timeline shifted
+	// into its own clock, so the same beat falls at the same moment on all of them and a change agreed on lands
+	// on the same beat everywhere, however late each peer heard about it.
+	struct SessionTimeline {
+		double beatsPerMinute;
+		double originBeat;
+		int64_t originMicros;
+
+		// Tempo from changeBeat on, which is infinite while no change is waiting
+		double nextBeatsPerMinute;
+		double changeBeat;
+
+		// Which change to the session this is. A later version wins, and the lower originator id breaks ties.
+		uint64_t version;
+		uint64_t originatorId;
+
+		// Beat zero now, not yet shared with anyone
+		static SessionTimeline Start(double beatsPerMinute, int64_t micros, uint64_t peerId);
+
+		double GetBeatAt(double micros) const;
+		double GetMicrosAt(double beat) const;
+		double GetTempoAt(double beat) const;
+
+		// The same timeline with the change made part of it once the given time is past its beat, so that the
+		// origin stays near the present and precision does not wear away
+		SessionTimeline Settle(int64_t micros) const;
+
+		// The same beats in a clock running offsetMicros ahead of this one
+		SessionTimeline Shift(int64_t offsetMicros) const;
+
+		// A new version changing to the tempo at the given beat instead of any change still waiting, which the
+		// timeline cannot hold two of
+		SessionTimeline ChangeTempo(double beatsPerMinute, double beat, uint64_t peerId) const;
+
+		bool Supersedes(const SessionTimeline& other) const;
+	};
+}
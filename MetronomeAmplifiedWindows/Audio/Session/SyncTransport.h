@@ -0,0 +1,25 @@
+#pragma once
+
+namespace audio {
+
+	// An IPv4 address and port, both in host byte order
+	struct SyncEndpoint {
+		uint32_t address;
+		uint16_t port;
+
+		static SyncEndpoint Loopback(uint16_t port) { return { 0x7f000001, port }; }
+	};
+
+	// How SessionSync reaches the other peers: datagrams sent to all of them at once, and whatever any of them
+	// sent, which may arrive late, out of order or not at all. Used from SessionSync's network thread only.
+	class SyncTransport {
+	public:
+		static const uint32_t MaxDatagramBytes = 256;
+
+		virtual ~SyncTransport() {}
+		virtual void Send(const uint8_t* bytes, uint32_t length) = 0;
+
+		// Never blocks; false when nothing is waiting
+		virtual bool TryReceive(uint8_t* bytes, uint32_t capacity, uint32_t& length) = 0;
+	};
+}
@@ -0,0 +1,147 @@
+#include "pch.h"
+#include "UdpSyncTransport.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+	const SOCKET NoSocket = INVALID_SOCKET;
+
+	void CloseSocket(SOCKET socket)
+	{
+		closesocket(socket);
+	}
+
+	bool SetNonBlocking(SOCKET socket)
+	{
+		u_long isNonBlocking = 1;
+		return ioctlsocket(socket, FIONBIO, &isNonBlocking) == 0;
+	}
+#else
+	const int NoSocket = -1;
+
+	void CloseSocket(int socket)
+	{
+		close(socket);
+	}
+
+	bool SetNonBlocking(int socket)
+	{
+		const int flags = fcntl(socket, F_GETFL, 0);
+		return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+	}
+#endif
+
+	sockaddr_in ToSocketAddress(const audio::SyncEndpoint& endpoint)
+	{
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(endpoint.address);
+		address.sin_port = htons(endpoint.port);
+		return address;
+	}
+}
+
+audio::UdpSyncTransport::UdpSyncTransport(uint32_t bindAddress, uint16_t port) :
+	UdpSyncTransport(bindAddress, port, false)
+{
+}
+
+audio::UdpSyncTransport::UdpSyncTransport(uint32_t bindAddress, uint16_t port, bool isPortShared) :
+	m_socket(NoSocket),
+	m_port(port),
+	m_destinations()
+{
+#ifdef _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+		throw std::runtime_error("Could not start Winsock");
+	}
+#endif
+	m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (m_socket == NoSocket) {
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		throw std::runtime_error("Could not open a UDP socket");
+	}
+
+	// Every peer on a machine binds the group's port, each getting its own copy of what is sent to the group
+	if (isPortShared) {
+		const int isReused = 1;
+		setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&isReused, sizeof(isReused));
+	}
+	const sockaddr_in address = ToSocketAddress({ bindAddress, port });
+	sockaddr_in bound = {};
+	socklen_t boundLength = sizeof(bound);
+	if (bind(m_socket, (const sockaddr*)&address, sizeof(address)) != 0 || !SetNonBlocking(m_socket) ||
+		getsockname(m_socket, (sockaddr*)&bound, &boundLength) != 0) {
+		CloseSocket(m_socket);
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		throw std::runtime_error("Could not bind UDP port " + std::to_string(port));
+	}
+	m_port = ntohs(bound.sin_port);
+}
+
+audio::UdpSyncTransport::~UdpSyncTransport()
+{
+	CloseSocket(m_socket);
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+std::unique_ptr<audio::UdpSyncTransport> audio::UdpSyncTransport::OpenGroup(uint32_t groupAddress, uint16_t port)
+{
+	std::unique_ptr<UdpSyncTransport> transport(new UdpSyncTransport(INADDR_ANY, port, true));
+	transport->JoinMulticastGroup(groupAddress);
+	return transport;
+}
+
+void audio::UdpSyncTransport::AddDestination(const SyncEndpoint& destination)
+{
+	m_destinations.push_back(destination);
+}
+
+void audio::UdpSyncTransport::JoinMulticastGroup(uint32_t groupAddress)
+{
+	ip_mreq request = {};
+	request.imr_multiaddr.s_addr = htonl(groupAddress);
+	request.imr_interface.s_addr = htonl(INADDR_ANY);
+	if (setsockopt(m_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&request, sizeof(request)) != 0) {
+		throw std::runtime_error("Could not join the multicast group");
+	}
+
+	// Peers on this machine hear the group through the loopback copy
+	const int isLooped = 1;
+	setsockopt(m_socket, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&isLooped, sizeof(isLooped));
+	AddDestination({ groupAddress, m_port });
+}
+
+// A datagram that cannot be sent is as good as lost on the network, which the protocol already allows for
+void audio::UdpSyncTransport::Send(const uint8_t* bytes, uint32_t length)
+{
+	for (const SyncEndpoint& destination : m_destinations) {
+		const sockaddr_in address = ToSocketAddress(destination);
+		sendto(m_socket, (const char*)bytes, (int)length, 0, (const sockaddr*)&address, sizeof(address));
+	}
+}
+
+bool audio::UdpSyncTransport::TryReceive(uint8_t* bytes, uint32_t capacity, uint32_t& length)
+{
+	const auto received = recvfrom(m_socket, (char*)bytes, (int)capacity, 0, nullptr, nullptr);
+	if (received <= 0) {
+		return false;
+	}
+	length = (uint32_t)received;
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "SyncTransport.h"
+
+namespace audio {
+
+	// Transport over a non-blocking UDP socket. On a LAN every peer opens the same multicast group, so one
+	// datagram reaches them all, however many share a machine; peers can instead bind a port each and list each
+	// other as destinations. Only the group shares a port: the system hands every socket on the port a copy of
+	// a datagram sent to the group, but one sent straight to a shared port reaches just one of them.
+	class UdpSyncTransport : public SyncTransport {
+	public:
+		// An administratively scoped group, which routers do not forward beyond the site
+		static const uint32_t DefaultGroupAddress = 0xefff4d41;
+		static const uint16_t DefaultPort = 20809;
+
+		// Binds a port of its own; port 0 takes any free one. Throws std::runtime_error if the socket cannot be
+		// opened or bound, as when another socket has the port.
+		UdpSyncTransport(uint32_t bindAddress, uint16_t port);
+		virtual ~UdpSyncTransport();
+		UdpSyncTransport(const UdpSyncTransport&) = delete;
+		UdpSyncTransport& operator=(const UdpSyncTransport&) = delete;
+
+		// Binds the group's port alongside the other peers on the machine, joins the group and sends to it.
+		// Throws std::runtime_error if the socket cannot be opened, bound or joined to the group.
+		static std::unique_ptr<UdpSyncTransport> OpenGroup(uint32_t groupAddress = DefaultGroupAddress, uint16_t port = DefaultPort);
+
+		// Before the network thread starts. Each destination must be a peer with a port of its own.
+		void AddDestination(const SyncEndpoint& destination);
+
+		inline uint16_t GetPort() const { return m_port; }
+
+		virtual void Send(const uint8_t* bytes, uint32_t length) override;
+		virtual bool TryReceive(uint8_t* bytes, uint32_t capacity, uint32_t& length) override;
+
+	private:
+		UdpSyncTransport(uint32_t bindAddress, uint16_t port, bool isPortShared);
+		void JoinMulticastGroup(uint32_t groupAddress);
+
+#ifdef _WIN32
+		SOCKET m_socket;
+#else
+		int m_socket;
+#endif
+		uint16_t m_port;
+		std::vector<SyncEndpoint> m_destinations;
+	};
+}
@@ -0,0 +1,11 @@
+#include "pch.h"
+#include "BaseSink.h"
+
+audio::BaseSink::BaseSink(uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames) :
+	m_sampleRate(sampleRate), m_channelCount(channelCount), m_blockFrames(blockFrames), m_source(nullptr)
+{
+}
+
+audio::BaseSink::~BaseSink()
+{
+}
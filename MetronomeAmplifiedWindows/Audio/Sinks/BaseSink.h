@@ -0,0 +1,34 @@
+#pragma once
+
+namespace audio {
+
+	// Anything that can fill interleaved float output blocks; called on the audio thread.
+	class AudioSource {
+	public:
+		virtual void Render(float* output, uint32_t frameCount) = 0;
+	};
+
+	// Destination for rendered audio. A sink decides when, and on which thread, its source is rendered.
+	class BaseSink {
+	protected:
+		uint32_t m_sampleRate;
+		uint32_t m_channelCount;
+		uint32_t m_blockFrames;
+		AudioSource* m_source;
+
+		BaseSink(uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames);
+
+	public:
+		virtual ~BaseSink();
+		virtual void Start(AudioSource* source) = 0;
+		virtual void Stop() = 0;
+
+		inline uint32_t GetSampleRate() { return m_sampleRate; }
+		inline uint32_t GetChannelCount() { return m_channelCount; }
+		inline uint32_t GetBlockFrames() { return m_blockFrames; }
+
+		// Frames queued ahead of a block when it is rendered, so how long after rendering it starts to be heard,
+		// leaving out the device's own latency
+		virtual uint32_t GetOutputLatencyFrames() { return 0; }
+	};
+}
@@ -0,0 +1,31 @@
+#include "pch.h"
+#include "NullSink.h"
+
+audio::NullSink::NullSink(uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames) :
+	BaseSink(sampleRate, channelCount, blockFrames), m_block(blockFrames * channelCount), m_framesRendered(0)
+{
+}
+
+void audio::NullSink::Start(AudioSource* source)
+{
+	m_source = source;
+}
+
+void audio::NullSink::Stop()
+{
+	m_source = nullptr;
+}
+
+// Render the given number of frames in blocks of the configured size, discarding the output
+void audio::NullSink::Pump(uint64_t frameCount)
+{
+	if (m_source == nullptr) {
+		return;
+	}
+	while (frameCount > 0) {
+		const uint32_t frames = (uint32_t)min((uint64_t)m_blockFrames, frameCount);
+		m_source->Render(m_block.data(), frames);
+		m_framesRendered += frames;
+		frameCount -= frames;
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "BaseSink.h"
+
+namespace audio {
+
+	// Sink with no device behind it. Rendering only happens when Pump is called, on the caller's thread,
+	// which makes it suitable for headless runs that need to be deterministic.
+	class NullSink : public BaseSink {
+	private:
+		std::vector<float> m_block;
+		uint64_t m_framesRendered;
+
+	public:
+		NullSink(uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames);
+		virtual void Start(AudioSource* source) override;
+		virtual void Stop() override;
+		void Pump(uint64_t frameCount);
+
+		inline const std::vector<float>& GetLastBlock() { return m_block; }
+		inline uint64_t GetFramesRendered() { return m_framesRendered; }
+	};
+}
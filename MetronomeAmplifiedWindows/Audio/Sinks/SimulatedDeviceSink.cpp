@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "SimulatedDeviceSink.h"
+
+#include <chrono>
+
+audio::SimulatedDeviceSink::SimulatedDeviceSink(uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames) :
+	BaseSink(sampleRate, channelCount, blockFrames),
+	m_block((size_t)blockFrames * channelCount),
+	m_thread(),
+	m_isRunning(false),
+	m_blockCount(0),
+	m_lateBlockCount(0)
+{
+}
+
+audio::SimulatedDeviceSink::~SimulatedDeviceSink()
+{
+	Stop();
+}
+
+void audio::SimulatedDeviceSink::Start(AudioSource* source)
+{
+	Stop();
+	m_source = source;
+	m_isRunning = true;
+	m_thread = std::thread(&SimulatedDeviceSink::Run, this);
+}
+
+void audio::SimulatedDeviceSink::Stop()
+{
+	m_isRunning = false;
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+// Periods are counted from the start rather than added up, so that rounding them to clock ticks never drifts
+void audio::SimulatedDeviceSink::Run()
+{
+	typedef std::chrono::steady_clock Clock;
+	const std::chrono::duration<double> period((double)m_blockFrames / m_sampleRate);
+	const Clock::time_point start = Clock::now();
+	for (uint64_t block = 1; m_isRunning; block++) {
+		m_source->Render(m_block.data(), m_blockFrames);
+		const Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(period * (double)block);
+		if (Clock::now() > due) {
+			m_lateBlockCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		m_blockCount.fetch_add(1, std::memory_order_relaxed);
+		std::this_thread::sleep_until(due);
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "BaseSink.h"
+
+#include <atomic>
+#include <thread>
+
+namespace audio {
+
+	// Sink that renders on a thread of its own once every block period, as a device's callback would, with no
+	// device behind it. For running the engine under real-time conditions on machines without audio output.
+	// A block not finished by the time the next period starts would have underrun a device, and counts as late.
+	class SimulatedDeviceSink : public BaseSink {
+	public:
+		SimulatedDeviceSink(uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames);
+		virtual ~SimulatedDeviceSink();
+		virtual void Start(AudioSource* source) override;
+		virtual void Stop() override;
+
+		// Each block is rendered one period before it would play
+		virtual uint32_t GetOutputLatencyFrames() override { return m_blockFrames; }
+
+		inline uint64_t GetBlockCount() { return m_blockCount.load(std::memory_order_relaxed); }
+		inline uint64_t GetLateBlockCount() { return m_lateBlockCount.load(std::memory_order_relaxed); }
+
+	private:
+		std::vector<float> m_block;
+		std::thread m_thread;
+		std::atomic<bool> m_isRunning;
+		std::atomic<uint64_t> m_blockCount;
+		std::atomic<uint64_t> m_lateBlockCount;
+
+		void Run();
+	};
+}
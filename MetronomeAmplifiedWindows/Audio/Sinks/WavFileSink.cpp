@@ -0,0 +1,45 @@
+#include "pch.h"
+#include "WavFileSink.h"
+
+audio::WavFileSink::WavFileSink(const std::string& filePath, uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames) :
+	BaseSink(sampleRate, channelCount, blockFrames),
+	m_filePath(filePath),
+	m_writer(),
+	m_block(blockFrames * channelCount),
+	m_framesWritten(0)
+{
+}
+
+audio::WavFileSink::~WavFileSink()
+{
+	Stop();
+}
+
+void audio::WavFileSink::Start(AudioSource* source)
+{
+	m_writer.reset();
+	m_writer = std::make_unique<WavFileWriter>(m_filePath, m_sampleRate, m_channelCount);
+	m_framesWritten = 0;
+	m_source = source;
+}
+
+void audio::WavFileSink::Stop()
+{
+	m_source = nullptr;
+	m_writer.reset();
+}
+
+// Render the given number of frames in blocks of the configured size, appending them to the file
+void audio::WavFileSink::Pump(uint64_t frameCount)
+{
+	if (m_source == nullptr) {
+		return;
+	}
+	while (frameCount > 0) {
+		const uint32_t frames = (uint32_t)min((uint64_t)m_blockFrames, frameCount);
+		m_source->Render(m_block.data(), frames);
+		m_writer->Write(m_block.data(), frames);
+		m_framesWritten += frames;
+		frameCount -= frames;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "BaseSink.h"
+#include "../Export/WavFileWriter.h"
+
+#include <string>
+
+namespace audio {
+
+	// Sink that writes everything rendered to a 32-bit float WAV file. Like NullSink, it renders only when
+	// Pump is called. The header is completed when the sink is stopped.
+	class WavFileSink : public BaseSink {
+	private:
+		std::string m_filePath;
+		std::unique_ptr<WavFileWriter> m_writer;
+		std::vector<float> m_block;
+		uint64_t m_framesWritten;
+
+	public:
+		WavFileSink(const std::string& filePath, uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames);
+		virtual ~WavFileSink() override;
+		virtual void Start(AudioSource* source) override;
+		virtual void Stop() override;
+		void Pump(uint64_t frameCount);
+
+		inline uint64_t GetFramesWritten() { return m_framesWritten; }
+	};
+}
@@ -0,0 +1,103 @@
+#include "pch.h"
+#include "XAudio2Sink.h"
+
+#include "../Diagnostics/RealtimeGuard.h"
+
+#include <thread>
+
+audio::XAudio2Sink::XAudio2Sink(uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames) :
+	BaseSink(sampleRate, channelCount, blockFrames),
+	m_xAudio2(),
+	m_masteringVoice(nullptr),
+	m_sourceVoice(nullptr),
+	m_buffers(),
+	m_isRunning(false),
+	m_isInCallback(false)
+{
+	for (int i = 0; i < BufferCount; i++) {
+		m_buffers[i].resize((size_t)blockFrames * channelCount);
+	}
+
+	winrt::check_hresult(
+		XAudio2Create(m_xAudio2.put(), 0, XAUDIO2_DEFAULT_PROCESSOR));
+	winrt::check_hresult(
+		m_xAudio2->CreateMasteringVoice(&m_masteringVoice, channelCount, sampleRate));
+
+	WAVEFORMATEX format = { 0 };
+	format.wFormatTag = WAVE_FORMAT_IEEE_FLOAT;
+	format.nChannels = (WORD)channelCount;
+	format.nSamplesPerSec = sampleRate;
+	format.wBitsPerSample = 32;
+	format.nBlockAlign = (WORD)(channelCount * sizeof(float));
+	format.nAvgBytesPerSec = sampleRate * format.nBlockAlign;
+	winrt::check_hresult(
+		m_xAudio2->CreateSourceVoice(&m_sourceVoice, &format, 0, XAUDIO2_DEFAULT_FREQ_RATIO, this));
+}
+
+audio::XAudio2Sink::~XAudio2Sink()
+{
+	Stop();
+	if (m_sourceVoice != nullptr) {
+		m_sourceVoice->DestroyVoice();
+		m_sourceVoice = nullptr;
+	}
+	if (m_masteringVoice != nullptr) {
+		m_masteringVoice->DestroyVoice();
+		m_masteringVoice = nullptr;
+	}
+}
+
+void audio::XAudio2Sink::Start(AudioSource* source)
+{
+	Stop();
+	m_source = source;
+	m_isRunning = true;
+	for (int i = 0; i < BufferCount; i++) {
+		SubmitBuffer(i);
+	}
+	winrt::check_hresult(
+		m_sourceVoice->Start(0));
+}
+
+void audio::XAudio2Sink::Stop()
+{
+	if (!m_isRunning) {
+		return;
+	}
+	m_isRunning = false;
+	m_sourceVoice->Stop(0);
+	m_sourceVoice->FlushSourceBuffers();
+
+	// A callback that saw the sink running may still be rendering, and violations are only read once it is done
+	while (m_isInCallback) {
+		std::this_thread::yield();
+	}
+	LogRealtimeViolations();
+	ClearRealtimeViolations();
+}
+
+// Called on the XAudio2 thread; the finished buffer is refilled and queued again straight away.
+// The callback is flagged before the running check, so Stop either sees it or it sees Stop.
+void audio::XAudio2Sink::OnBufferEnd(void* bufferContext)
+{
+	m_isInCallback = true;
+	if (m_isRunning) {
+		SubmitBuffer((int)(intptr_t)bufferContext);
+	}
+	m_isInCallback = false;
+}
+
+void audio::XAudio2Sink::SubmitBuffer(int bufferIndex)
+{
+	std::vector<float>& buffer = m_buffers[bufferIndex];
+	{
+		RealtimeScope scope;
+		m_source->Render(buffer.data(), m_blockFrames);
+	}
+
+	XAUDIO2_BUFFER xAudioBuffer = { 0 };
+	xAudioBuffer.AudioBytes = (UINT32)(buffer.size() * sizeof(float));
+	xAudioBuffer.pAudioData = (const BYTE*)buffer.data();
+	xAudioBuffer.pContext = (void*)(intptr_t)bufferIndex;
+	m_sourceVoice->SubmitSourceBuffer(&xAudioBuffer);
+}
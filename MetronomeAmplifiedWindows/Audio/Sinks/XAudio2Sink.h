@@ -0,0 +1,43 @@
+#pragma once
+
+#include "BaseSink.h"
+
+#include <atomic>
+
+namespace audio {
+
+	// Sink that plays through the default output device. XAudio2 pulls blocks on its own thread via
+	// OnBufferEnd; a small ring of buffers is kept queued so rendering one never starves the device.
+	// The source renders inside a RealtimeScope, and Stop logs whatever violations that caught.
+	class XAudio2Sink : public BaseSink, public IXAudio2VoiceCallback {
+	public:
+		static const int BufferCount = 3;
+
+		XAudio2Sink(uint32_t sampleRate, uint32_t channelCount, uint32_t blockFrames);
+		virtual ~XAudio2Sink();
+		virtual void Start(AudioSource* source) override;
+		virtual void Stop() override;
+
+		// A block is rendered as the buffer before it finishes, behind the other buffers still queued
+		virtual uint32_t GetOutputLatencyFrames() override { return (BufferCount - 1) * m_blockFrames; }
+
+		// IXAudio2VoiceCallback
+		STDMETHOD_(void, OnVoiceProcessingPassStart)(UINT32 bytesRequired) override {}
+		STDMETHOD_(void, OnVoiceProcessingPassEnd)() override {}
+		STDMETHOD_(void, OnStreamEnd)() override {}
+		STDMETHOD_(void, OnBufferStart)(void* bufferContext) override {}
+		STDMETHOD_(void, OnBufferEnd)(void* bufferContext) override;
+		STDMETHOD_(void, OnLoopEnd)(void* bufferContext) override {}
+		STDMETHOD_(void, OnVoiceError)(void* bufferContext, HRESULT error) override {}
+
+	private:
+		winrt::com_ptr<IXAudio2> m_xAudio2;
+		IXAudio2MasteringVoice* m_masteringVoice;
+		IXAudio2SourceVoice* m_sourceVoice;
+		std::vector<float> m_buffers[BufferCount];
+		std::atomic<bool> m_isRunning;
+		std::atomic<bool> m_isInCallback;
+
+		void SubmitBuffer(int bufferIndex);
+	};
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace audio {
+
+	// One step of a bar's pattern. Values fit in two bits.
+	enum class PatternNote : uint8_t {
+		REST = 0,
+		GHOST = 1,
+		NORMAL = 2,
+		ACCENT = 3
+	};
+
+	// A run of identical bars in one time signature and tempo. The pattern holds one bar, stepsPerBeat steps to
+	// each beat, and repeats for barCount bars. The beat unit only affects how the time signature is shown;
+	// tempo counts beats of whatever unit that is.
+	struct SongSection {
+		std::string name;
+		int beatsPerBar;
+		int beatUnit;
+		int stepsPerBeat;
+		int barCount;
+		double beatsPerMinute;
+		std::vector<PatternNote> pattern;
+
+		inline int GetStepsPerBar() const { return beatsPerBar * stepsPerBeat; }
+	};
+
+	// Editable song model, owned by the UI thread. The audio engine plays a SongTimeline compiled from it.
+	struct Song {
+		std::string name;
+		std::vector<SongSection> sections;
+	};
+}
@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "SongFile.h"
+
+#include <fstream>
+
+namespace {
+
+	static_assert(sizeof(audio::SongFileHeader) == 96, "Song file header layout changed");
+	static_assert(sizeof(audio::SongFileSection) == 64, "Song file section layout changed");
+
+	size_t PatternBytes(int stepsPerBar) {
+		return ((size_t)stepsPerBar + 3) / 4;
+	}
+
+	void CopyName(char* field, size_t fieldLength, const std::string& name) {
+		memset(field, 0, fieldLength);
+		memcpy(field, name.data(), min(name.size(), fieldLength));
+	}
+}
+
+std::vector<byte> audio::EncodeSongFile(const Song& song)
+{
+	size_t patternBytes = 0;
+	for (const SongSection& section : song.sections) {
+		if (section.beatsPerBar <= 0 || section.beatsPerBar > UINT8_MAX || section.beatUnit <= 0 || section.beatUnit > UINT8_MAX ||
+			section.stepsPerBeat <= 0 || section.stepsPerBeat > UINT8_MAX || section.barCount < 0 || !(section.beatsPerMinute > 0.0)) {
+			throw std::runtime_error("Section " + section.name + " does not fit the song file format");
+		}
+		if (section.pattern.size() != (size_t)section.GetStepsPerBar()) {
+			throw std::runtime_error("Pattern does not fill one bar in section " + section.name);
+		}
+		patternBytes += PatternBytes(section.GetStepsPerBar());
+	}
+
+	const size_t sectionTableOffset = sizeof(SongFileHeader);
+	const size_t patternOffset = sectionTableOffset + song.sections.size() * sizeof(SongFileSection);
+	std::vector<byte> file(patternOffset + patternBytes, 0);
+
+	SongFileHeader* header = (SongFileHeader*)file.data();
+	header->magic = SongFileMagic;
+	header->version = SongFileVersion;
+	header->sectionCount = (uint32_t)song.sections.size();
+	header->patternBytes = (uint32_t)patternBytes;
+	CopyName(header->name, SongFileNameLength, song.name);
+
+	SongFileSection* sections = (SongFileSection*)(file.data() + sectionTableOffset);
+	byte* patterns = file.data() + patternOffset;
+	uint32_t sectionPatternOffset = 0;
+	for (size_t i = 0; i < song.sections.size(); i++) {
+		const SongSection& section = song.sections[i];
+		SongFileSection& fileSection = sections[i];
+		CopyName(fileSection.name, SongFileSectionNameLength, section.name);
+		fileSection.beatsPerMinute = section.beatsPerMinute;
+		fileSection.barCount = (uint32_t)section.barCount;
+		fileSection.patternOffset = sectionPatternOffset;
+		fileSection.stepsPerBar = (uint16_t)section.GetStepsPerBar();
+		fileSection.beatsPerBar = (uint8_t)section.beatsPerBar;
+		fileSection.beatUnit = (uint8_t)section.beatUnit;
+		fileSection.stepsPerBeat = (uint8_t)section.stepsPerBeat;
+		for (size_t step = 0; step < section.pattern.size(); step++) {
+			patterns[sectionPatternOffset + step / 4] |= (byte)((uint8_t)section.pattern[step] << (2 * (step % 4)));
+		}
+		sectionPatternOffset += (uint32_t)PatternBytes(section.GetStepsPerBar());
+
+		header->barCount += fileSection.barCount;
+		header->durationSeconds += (double)section.barCount * section.beatsPerBar * 60.0 / section.beatsPerMinute;
+	}
+	return file;
+}
+
+void audio::SaveSongFile(const std::string& filePath, const Song& song)
+{
+	const std::vector<byte> data = EncodeSongFile(song);
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Cannot open song file for writing");
+	}
+	file.write((const char*)data.data(), data.size());
+	if (!file) {
+		throw std::runtime_error("Failed writing song file");
+	}
+}
+
+bool audio::ReadSongFileHeader(const std::string& filePath, SongFileHeader& header)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	if (!file.read((char*)&header, sizeof(SongFileHeader))) {
+		return false;
+	}
+	return header.magic == SongFileMagic && header.version == SongFileVersion;
+}
+
+audio::SongFileView::SongFileView() :
+	m_header(nullptr),
+	m_sections(nullptr),
+	m_patterns(nullptr)
+{
+}
+
+bool audio::SongFileView::Open(const byte* data, size_t size)
+{
+	m_header = nullptr;
+	if (size < sizeof(SongFileHeader)) {
+		return false;
+	}
+	const SongFileHeader* header = (const SongFileHeader*)data;
+	if (header->magic != SongFileMagic || header->version != SongFileVersion) {
+		return false;
+	}
+	const uint64_t patternOffset = sizeof(SongFileHeader) + (uint64_t)header->sectionCount * sizeof(SongFileSection);
+	if ((uint64_t)size < patternOffset || (uint64_t)size - patternOffset < header->patternBytes) {
+		return false;
+	}
+	const SongFileSection* sections = (const SongFileSection*)(data + sizeof(SongFileHeader));
+	for (uint32_t i = 0; i < header->sectionCount; i++) {
+		const SongFileSection& section = sections[i];
+		if (section.stepsPerBar != section.beatsPerBar * section.stepsPerBeat || section.stepsPerBar == 0 ||
+			section.barCount > INT32_MAX || !(section.beatsPerMinute > 0.0) ||
+			(size_t)section.patternOffset + PatternBytes(section.stepsPerBar) > header->patternBytes) {
+			return false;
+		}
+	}
+	m_header = header;
+	m_sections = sections;
+	m_patterns = data + patternOffset;
+	return true;
+}
+
+std::string audio::SongFileView::GetName() const
+{
+	return std::string(m_header->name, strnlen(m_header->name, SongFileNameLength));
+}
+
+std::string audio::SongFileView::GetSectionName(uint32_t index) const
+{
+	return std::string(m_sections[index].name, strnlen(m_sections[index].name, SongFileSectionNameLength));
+}
+
+audio::Song audio::SongFileView::ToSong() const
+{
+	Song song;
+	song.name = GetName();
+	song.sections.resize(m_header->sectionCount);
+	for (uint32_t i = 0; i < m_header->sectionCount; i++) {
+		const SongFileSection& fileSection = m_sections[i];
+		SongSection& section = song.sections[i];
+		section.name = GetSectionName(i);
+		section.beatsPerBar = fileSection.beatsPerBar;
+		section.beatUnit = fileSection.beatUnit;
+		section.stepsPerBeat = fileSection.stepsPerBeat;
+		section.barCount = (int)fileSection.barCount;
+		section.beatsPerMinute = fileSection.beatsPerMinute;
+		section.pattern.resize(fileSection.stepsPerBar);
+		for (uint32_t step = 0; step < fileSection.stepsPerBar; step++) {
+			section.pattern[step] = GetPatternNote(i, step);
+		}
+	}
+	return song;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Song.h"
+
+namespace audio {
+
+	// Song file layout: header, section table, then each section's one-bar pattern packed four steps to a byte,
+	// low bits first, starting on a byte boundary. Everything is fixed-size and naturally aligned, so a mapped
+	// file is read in place; the header alone carries what a song list shows. Fields are in the machine's own
+	// byte order, as in the tone set cache.
+	const uint32_t SongFileMagic = 0x4753414d;
+	const uint32_t SongFileVersion = 1;
+	const size_t SongFileNameLength = 64;
+	const size_t SongFileSectionNameLength = 40;
+
+	struct SongFileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t sectionCount;
+		uint32_t patternBytes;
+		uint32_t barCount;
+		uint32_t reserved;
+		double durationSeconds;
+		char name[SongFileNameLength];
+	};
+
+	struct SongFileSection {
+		char name[SongFileSectionNameLength];
+		double beatsPerMinute;
+		uint32_t barCount;
+		uint32_t patternOffset;
+		uint16_t stepsPerBar;
+		uint8_t beatsPerBar;
+		uint8_t beatUnit;
+		uint8_t stepsPerBeat;
+		uint8_t reserved[3];
+	};
+
+	// Names are cut to the fixed field lengths. Throws if a section does not fit the format's field sizes.
+	std::vector<byte> EncodeSongFile(const Song& song);
+	void SaveSongFile(const std::string& filePath, const Song& song);
+
+	// Reads only the header; returns false if the file is missing or not a song file of this version
+	bool ReadSongFileHeader(const std::string& filePath, SongFileHeader& header);
+
+	// Reads a song file in place from memory the caller keeps alive, such as a MappedFile
+	class SongFileView {
+	public:
+		SongFileView();
+
+		// Checks the header and that the section table and every pattern lie within the data. Returns false,
+		// leaving the view closed, if not.
+		bool Open(const byte* data, size_t size);
+
+		inline const SongFileHeader& GetHeader() const { return *m_header; }
+		inline uint32_t GetSectionCount() const { return m_header->sectionCount; }
+		inline const SongFileSection& GetSection(uint32_t index) const { return m_sections[index]; }
+		std::string GetName() const;
+		std::string GetSectionName(uint32_t index) const;
+
+		inline PatternNote GetPatternNote(uint32_t sectionIndex, uint32_t step) const {
+			const byte packed = m_patterns[m_sections[sectionIndex].patternOffset + step / 4];
+			return (PatternNote)((packed >> (2 * (step % 4))) & 3);
+		}
+
+		Song ToSong() const;
+
+	private:
+		const SongFileHeader* m_header;
+		const SongFileSection* m_sections;
+		const byte* m_patterns;
+	};
+}
@@ -0,0 +1,328 @@
+#include "pch.h"
+#include "SongJson.h"
+
+#include <charconv>
+#include <cstdio>
+
+namespace {
+
+	const char PatternCharacters[] = { '.', 'g', 'x', 'X' };
+
+	void AppendString(std::string& out, const std::string& value)
+	{
+		out += '"';
+		for (char c : value) {
+			switch (c) {
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20) {
+					char escape[8];
+					snprintf(escape, sizeof(escape), "\\u%04x", (unsigned)c);
+					out += escape;
+				} else {
+					out += c;
+				}
+			}
+		}
+		out += '"';
+	}
+
+	// Shortest text that reads back as the same double
+	void AppendNumber(std::string& out, double value)
+	{
+		char buffer[32];
+		const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+		out.append(buffer, result.ptr);
+	}
+
+	void AppendUtf8(std::string& out, uint32_t codePoint)
+	{
+		if (codePoint < 0x80) {
+			out += (char)codePoint;
+		} else if (codePoint < 0x800) {
+			out += (char)(0xc0 | (codePoint >> 6));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		} else if (codePoint < 0x10000) {
+			out += (char)(0xe0 | (codePoint >> 12));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		} else {
+			out += (char)(0xf0 | (codePoint >> 18));
+			out += (char)(0x80 | ((codePoint >> 12) & 0x3f));
+			out += (char)(0x80 | ((codePoint >> 6) & 0x3f));
+			out += (char)(0x80 | (codePoint & 0x3f));
+		}
+	}
+
+	// Reads JSON text in one pass, straight into whatever the caller is filling in
+	class JsonReader {
+	public:
+		explicit JsonReader(const std::string& text) : m_text(text), m_position(0) {}
+
+		void Expect(char c) {
+			SkipWhitespace();
+			if (m_position >= m_text.size() || m_text[m_position] != c) {
+				Fail(std::string("expected '") + c + "'");
+			}
+			m_position++;
+		}
+
+		bool TryConsume(char c) {
+			SkipWhitespace();
+			if (m_position < m_text.size() && m_text[m_position] == c) {
+				m_position++;
+				return true;
+			}
+			return false;
+		}
+
+		// Calls readMember(key) for each member; it must read the member's value
+		template<typename ReadMember>
+		void ReadObject(ReadMember readMember) {
+			Expect('{');
+			if (TryConsume('}')) {
+				return;
+			}
+			do {
+				const std::string key = ReadString();
+				Expect(':');
+				readMember(key);
+			} while (TryConsume(','));
+			Expect('}');
+		}
+
+		// Calls readElement() for each element; it must read the element's value
+		template<typename ReadElement>
+		void ReadArray(ReadElement readElement) {
+			Expect('[');
+			if (TryConsume(']')) {
+				return;
+			}
+			do {
+				readElement();
+			} while (TryConsume(','));
+			Expect(']');
+		}
+
+		std::string ReadString() {
+			Expect('"');
+			std::string value;
+			while (true) {
+				if (m_position >= m_text.size()) {
+					Fail("unterminated string");
+				}
+				const char c = m_text[m_position++];
+				if (c == '"') {
+					return value;
+				}
+				if (c != '\\') {
+					value += c;
+					continue;
+				}
+				if (m_position >= m_text.size()) {
+					Fail("unterminated string");
+				}
+				const char escaped = m_text[m_position++];
+				switch (escaped) {
+				case '"': value += '"'; break;
+				case '\\': value += '\\'; break;
+				case '/': value += '/'; break;
+				case 'b': value += '\b'; break;
+				case 'f': value += '\f'; break;
+				case 'n': value += '\n'; break;
+				case 'r': value += '\r'; break;
+				case 't': value += '\t'; break;
+				case 'u': {
+					uint32_t codePoint = ReadHex4();
+					if (codePoint >= 0xd800 && codePoint < 0xdc00 && m_text.compare(m_position, 2, "\\u") == 0) {
+						m_position += 2;
+						const uint32_t low = ReadHex4();
+						if (low < 0xdc00 || low >= 0xe000) {
+							Fail("bad surrogate pair");
+						}
+						codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+					}
+					AppendUtf8(value, codePoint);
+					break;
+				}
+				default:
+					Fail("bad escape");
+				}
+			}
+		}
+
+		double ReadNumber() {
+			SkipWhitespace();
+			double value = 0.0;
+			const char* begin = m_text.data() + m_position;
+			const std::from_chars_result result = std::from_chars(begin, m_text.data() + m_text.size(), value);
+			if (result.ec != std::errc()) {
+				Fail("expected a number");
+			}
+			m_position += result.ptr - begin;
+			return value;
+		}
+
+		int ReadInteger() {
+			const double value = ReadNumber();
+			if (!(value >= (double)INT32_MIN && value <= (double)INT32_MAX) || value != floor(value)) {
+				Fail("expected an integer");
+			}
+			return (int)value;
+		}
+
+		void SkipValue() {
+			SkipWhitespace();
+			if (m_position >= m_text.size()) {
+				Fail("expected a value");
+			}
+			const char c = m_text[m_position];
+			if (c == '{') {
+				ReadObject([this](const std::string&) { SkipValue(); });
+			} else if (c == '[') {
+				ReadArray([this]() { SkipValue(); });
+			} else if (c == '"') {
+				ReadString();
+			} else if (m_text.compare(m_position, 4, "true") == 0 || m_text.compare(m_position, 4, "null") == 0) {
+				m_position += 4;
+			} else if (m_text.compare(m_position, 5, "false") == 0) {
+				m_position += 5;
+			} else {
+				ReadNumber();
+			}
+		}
+
+		void ExpectEnd() {
+			SkipWhitespace();
+			if (m_position != m_text.size()) {
+				Fail("unexpected text after the song");
+			}
+		}
+
+	private:
+		const std::string& m_text;
+		size_t m_position;
+
+		void SkipWhitespace() {
+			while (m_position < m_text.size() && (m_text[m_position] == ' ' || m_text[m_position] == '\t' ||
+				m_text[m_position] == '\n' || m_text[m_position] == '\r')) {
+				m_position++;
+			}
+		}
+
+		uint32_t ReadHex4() {
+			if (m_position + 4 > m_text.size()) {
+				Fail("bad escape");
+			}
+			uint32_t value = 0;
+			const std::from_chars_result result = std::from_chars(m_text.data() + m_position, m_text.data() + m_position + 4, value, 16);
+			if (result.ec != std::errc() || result.ptr != m_text.data() + m_position + 4) {
+				Fail("bad escape");
+			}
+			m_position += 4;
+			return value;
+		}
+
+		[[noreturn]] void Fail(const std::string& message) {
+			throw std::runtime_error("Song JSON: " + message + " at offset " + std::to_string(m_position));
+		}
+	};
+
+	audio::SongSection ReadSection(JsonReader& reader)
+	{
+		audio::SongSection section = { "", 4, 4, 1, 1, 120.0, {} };
+		std::string pattern;
+		bool hasPattern = false;
+		reader.ReadObject([&](const std::string& key) {
+			if (key == "name") {
+				section.name = reader.ReadString();
+			} else if (key == "beatsPerBar") {
+				section.beatsPerBar = reader.ReadInteger();
+			} else if (key == "beatUnit") {
+				section.beatUnit = reader.ReadInteger();
+			} else if (key == "stepsPerBeat") {
+				section.stepsPerBeat = reader.ReadInteger();
+			} else if (key == "barCount") {
+				section.barCount = reader.ReadInteger();
+			} else if (key == "beatsPerMinute") {
+				section.beatsPerMinute = reader.ReadNumber();
+			} else if (key == "pattern") {
+				pattern = reader.ReadString();
+				hasPattern = true;
+			} else {
+				reader.SkipValue();
+			}
+		});
+
+		if (section.beatsPerBar <= 0 || section.beatsPerBar > UINT8_MAX || section.stepsPerBeat <= 0 || section.stepsPerBeat > UINT8_MAX ||
+			section.barCount < 0 || !(section.beatsPerMinute > 0.0)) {
+			throw std::runtime_error("Song JSON: invalid time signature or tempo in section " + section.name);
+		}
+		const int stepsPerBar = section.GetStepsPerBar();
+		if (!hasPattern) {
+			// Accent the first beat and click the others
+			for (int step = 0; step < stepsPerBar; step++) {
+				pattern += step == 0 ? 'X' : step % section.stepsPerBeat == 0 ? 'x' : '.';
+			}
+		}
+		if (pattern.size() != (size_t)stepsPerBar) {
+			throw std::runtime_error("Song JSON: pattern does not fill one bar in section " + section.name);
+		}
+		for (char c : pattern) {
+			const char* found = std::find(std::begin(PatternCharacters), std::end(PatternCharacters), c);
+			if (found == std::end(PatternCharacters)) {
+				throw std::runtime_error(std::string("Song JSON: unknown pattern step '") + c + "' in section " + section.name);
+			}
+			section.pattern.push_back((audio::PatternNote)(found - std::begin(PatternCharacters)));
+		}
+		return section;
+	}
+}
+
+std::string audio::ExportSongJson(const Song& song)
+{
+	std::string json = "{\n  \"name\": ";
+	AppendString(json, song.name);
+	json += ",\n  \"sections\": [";
+	for (size_t i = 0; i < song.sections.size(); i++) {
+		const SongSection& section = song.sections[i];
+		json += i == 0 ? "\n    { \"name\": " : ",\n    { \"name\": ";
+		AppendString(json, section.name);
+		json += ", \"beatsPerBar\": " + std::to_string(section.beatsPerBar);
+		json += ", \"beatUnit\": " + std::to_string(section.beatUnit);
+		json += ", \"stepsPerBeat\": " + std::to_string(section.stepsPerBeat);
+		json += ", \"barCount\": " + std::to_string(section.barCount);
+		json += ", \"beatsPerMinute\": ";
+		AppendNumber(json, section.beatsPerMinute);
+		json += ", \"pattern\": \"";
+		for (PatternNote note : section.pattern) {
+			json += PatternCharacters[(int)note & 3];
+		}
+		json += "\" }";
+	}
+	json += song.sections.empty() ? "]\n}\n" : "\n  ]\n}\n";
+	return json;
+}
+
+audio::Song audio::ImportSongJson(const std::string& json)
+{
+	Song song;
+	JsonReader reader(json);
+	reader.ReadObject([&](const std::string& key) {
+		if (key == "name") {
+			song.name = reader.ReadString();
+		} else if (key == "sections") {
+			reader.ReadArray([&]() {
+				song.sections.push_back(ReadSection(reader));
+			});
+		} else {
+			reader.SkipValue();
+		}
+	});
+	reader.ExpectEnd();
+	return song;
+}
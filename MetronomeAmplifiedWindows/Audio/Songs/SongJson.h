@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Song.h"
+
+namespace audio {
+
+	// JSON interchange for songs, for sharing and hand editing:
+	//   { "name": "...", "sections": [ { "name": "...", "beatsPerBar": 4, "beatUnit": 4, "stepsPerBeat": 2,
+	//     "barCount": 8, "beatsPerMinute": 120, "pattern": "X.g.x.g.x.g.x.g." } ] }
+	// One pattern character per step: 'X' accent, 'x' normal, 'g' ghost, '.' rest. Unknown keys are ignored on
+	// import. Missing ones fall back to 4/4, one step per beat, one bar at 120 BPM, and a missing pattern accents
+	// the first beat and clicks the others.
+	std::string ExportSongJson(const Song& song);
+
+	// Throws if the text is not valid JSON or a pattern does not fill one bar
+	Song ImportSongJson(const std::string& json);
+}
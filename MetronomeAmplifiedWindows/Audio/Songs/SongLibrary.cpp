@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "SongLibrary.h"
+#include "../ToneSets/MappedFile.h"
+
+#include <filesystem>
+
+namespace {
+
+	audio::SongListing MakeListing(const std::string& filePath, const audio::SongFileHeader& header)
+	{
+		return { filePath, std::string(header.name, strnlen(header.name, audio::SongFileNameLength)),
+			header.sectionCount, header.barCount, header.durationSeconds };
+	}
+
+	bool IsListedBefore(const audio::SongListing& a, const audio::SongListing& b)
+	{
+		return a.name != b.name ? a.name < b.name : a.filePath < b.filePath;
+	}
+}
+
+const char* const audio::SongLibrary::FileExtension = ".masong";
+
+audio::SongLibrary::SongLibrary(const std::string& folderPath) :
+	m_folderPath(folderPath),
+	m_songs()
+{
+}
+
+void audio::SongLibrary::Scan()
+{
+	m_songs.clear();
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(m_folderPath, error)) {
+		if (!entry.is_regular_file(error) || entry.path().extension() != FileExtension) {
+			continue;
+		}
+		const std::string filePath = entry.path().string();
+		SongFileHeader header;
+		if (!ReadSongFileHeader(filePath, header)) {
+			continue;
+		}
+		m_songs.push_back(MakeListing(filePath, header));
+	}
+	std::sort(m_songs.begin(), m_songs.end(), IsListedBefore);
+}
+
+audio::Song audio::SongLibrary::LoadSong(size_t index) const
+{
+	MappedFile file;
+	SongFileView view;
+	if (!file.Open(m_songs.at(index).filePath) || !view.Open(file.GetData(), file.GetSize())) {
+		throw std::runtime_error("Cannot read song file " + m_songs[index].filePath);
+	}
+	return view.ToSong();
+}
+
+size_t audio::SongLibrary::SaveSong(const Song& song, const std::string& fileName)
+{
+	const std::string filePath = (std::filesystem::path(m_folderPath) / (fileName + FileExtension)).string();
+	SaveSongFile(filePath, song);
+
+	SongFileHeader header;
+	if (!ReadSongFileHeader(filePath, header)) {
+		throw std::runtime_error("Cannot read back song file " + filePath);
+	}
+	m_songs.erase(std::remove_if(m_songs.begin(), m_songs.end(), [&filePath](const SongListing& listing) {
+		return listing.filePath == filePath;
+	}), m_songs.end());
+	const SongListing listing = MakeListing(filePath, header);
+	const auto position = std::upper_bound(m_songs.begin(), m_songs.end(), listing, IsListedBefore);
+	return (size_t)(m_songs.insert(position, listing) - m_songs.begin());
+}
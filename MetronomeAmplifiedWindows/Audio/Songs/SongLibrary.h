@@ -0,0 +1,40 @@
+#pragma once
+
+#include "SongFile.h"
+
+namespace audio {
+
+	// What the song list shows for one song, taken from its file header
+	struct SongListing {
+		std::string filePath;
+		std::string name;
+		uint32_t sectionCount;
+		uint32_t barCount;
+		double durationSeconds;
+	};
+
+	// The song files in one folder. Scanning reads only each file's fixed-size header, so the list can be shown
+	// without loading any song; a song is mapped and read in full only when opened.
+	class SongLibrary {
+	public:
+		static const char* const FileExtension;
+
+		explicit SongLibrary(const std::string& folderPath);
+
+		// Files that are not song files of this version are left out. Sorted by name.
+		void Scan();
+
+		inline const std::vector<SongListing>& GetSongs() const { return m_songs; }
+
+		// Throws if the file has gone or is no longer a valid song file
+		Song LoadSong(size_t index) const;
+
+		// Writes the song into the folder as fileName plus the extension, replacing any file of that name, and
+		// returns its index in the updated list
+		size_t SaveSong(const Song& song, const std::string& fileName);
+
+	private:
+		std::string m_folderPath;
+		std::vector<SongListing> m_songs;
+	};
+}
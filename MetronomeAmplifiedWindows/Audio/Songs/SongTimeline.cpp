@@ -0,0 +1,217 @@
+#include "pch.h"
+#include "SongTimeline.h"
+
+audio::SongTimeline::SongTimeline(uint32_t sampleRate) :
+	m_sampleRate(sampleRate),
+	m_sectionStartSamples(),
+	m_sectionFirstEvents(),
+	m_sectionTimings(),
+	m_eventOffsets(),
+	m_eventVoices(),
+	m_eventAccents()
+{
+}
+
+std::unique_ptr<audio::SongTimeline> audio::SongTimeline::Compile(const Song& song, uint32_t sampleRate)
+{
+	std::unique_ptr<SongTimeline> timeline(new SongTimeline(sampleRate));
+	timeline->m_sectionStartSamples.reserve(song.sections.size() + 1);
+	timeline->m_sectionFirstEvents.reserve(song.sections.size() + 1);
+	timeline->m_sectionTimings.reserve(song.sections.size());
+	uint64_t startSample = 0;
+	for (const SongSection& section : song.sections) {
+		timeline->m_sectionStartSamples.push_back(startSample);
+		timeline->m_sectionFirstEvents.push_back((uint32_t)timeline->m_eventOffsets.size());
+		startSample += timeline->CompileSection(section, timeline->m_eventOffsets, timeline->m_eventVoices, timeline->m_eventAccents);
+		timeline->m_sectionTimings.push_back(timeline->GetSectionTiming(section));
+	}
+	timeline->m_sectionStartSamples.push_back(startSample);
+	timeline->m_sectionFirstEvents.push_back((uint32_t)timeline->m_eventOffsets.size());
+	return timeline;
+}
+
+void audio::SongTimeline::RecompileSection(const Song& song, size_t sectionIndex)
+{
+	if (song.sections.size() != GetSectionCount() || sectionIndex >= GetSectionCount()) {
+		throw std::runtime_error("Song sections no longer match the timeline");
+	}
+
+	std::vector<uint32_t> offsets;
+	std::vector<ToneVoice> voices;
+	std::vector<PatternNote> accents;
+	const uint64_t length = CompileSection(song.sections[sectionIndex], offsets, voices, accents);
+	m_sectionTimings[sectionIndex] = GetSectionTiming(song.sections[sectionIndex]);
+
+	// Splice the new events over the old ones, then shift the sections after it in events and in samples
+	const size_t first = m_sectionFirstEvents[sectionIndex];
+	const size_t last = m_sectionFirstEvents[sectionIndex + 1];
+	m_eventOffsets.erase(m_eventOffsets.begin() + first, m_eventOffsets.begin() + last);
+	m_eventOffsets.insert(m_eventOffsets.begin() + first, offsets.begin(), offsets.end());
+	m_eventVoices.erase(m_eventVoices.begin() + first, m_eventVoices.begin() + last);
+	m_eventVoices.insert(m_eventVoices.begin() + first, voices.begin(), voices.end());
+	m_eventAccents.erase(m_eventAccents.begin() + first, m_eventAccents.begin() + last);
+	m_eventAccents.insert(m_eventAccents.begin() + first, accents.begin(), accents.end());
+
+	const int64_t eventShift = (int64_t)offsets.size() - (int64_t)(last - first);
+	const int64_t sampleShift = (int64_t)length - (int64_t)(m_sectionStartSamples[sectionIndex + 1] - m_sectionStartSamples[sectionIndex]);
+	for (size_t i = sectionIndex + 1; i < m_sectionStartSamples.size(); i++) {
+		m_sectionFirstEvents[i] = (uint32_t)((int64_t)m_sectionFirstEvents[i] + eventShift);
+		m_sectionStartSamples[i] = (uint64_t)((int64_t)m_sectionStartSamples[i] + sampleShift);
+	}
+}
+
+// Index of the section playing at the given sample, or the section count if it is past the end of the song
+size_t audio::SongTimeline::FindSection(uint64_t sample) const
+{
+	const auto next = std::upper_bound(m_sectionStartSamples.begin(), m_sectionStartSamples.end(), sample);
+	return next == m_sectionStartSamples.begin() ? 0 : (size_t)(next - m_sectionStartSamples.begin()) - 1;
+}
+
+// Index of the first event at or after the given sample, or the event count if there are none
+size_t audio::SongTimeline::FindEvent(uint64_t sample) const
+{
+	const size_t section = FindSection(sample);
+	if (section >= GetSectionCount()) {
+		return m_eventOffsets.size();
+	}
+	const auto first = m_eventOffsets.begin() + m_sectionFirstEvents[section];
+	const auto last = m_eventOffsets.begin() + m_sectionFirstEvents[section + 1];
+	const uint64_t offset = sample - m_sectionStartSamples[section];
+	if (offset > UINT32_MAX) {
+		return (size_t)(last - m_eventOffsets.begin());
+	}
+	return (size_t)(std::lower_bound(first, last, (uint32_t)offset) - m_eventOffsets.begin());
+}
+
+// Empty sections share their first event with the next, so the last section starting at or before it holds it
+uint64_t audio::SongTimeline::GetEventSample(size_t event) const
+{
+	const auto next = std::upper_bound(m_sectionFirstEvents.begin(), m_sectionFirstEvents.end(), (uint32_t)event);
+	const size_t section = (size_t)(next - m_sectionFirstEvents.begin()) - 1;
+	return m_sectionStartSamples[section] + m_eventOffsets[event];
+}
+
+uint64_t audio::SongTimeline::FindNextBarLine(uint64_t sample) const
+{
+	const size_t section = FindSection(sample);
+	if (section >= GetSectionCount()) {
+		return GetLengthSamples();
+	}
+	const uint64_t start = m_sectionStartSamples[section];
+	const uint64_t end = m_sectionStartSamples[section + 1];
+	const SectionTiming& timing = m_sectionTimings[section];
+	const uint64_t bar = (timing.stepScale.FirstTickAtOrAfter(sample - start) + timing.stepsPerBar - 1) / timing.stepsPerBar;
+	return min(end, start + timing.stepScale.ToSample(bar * timing.stepsPerBar));
+}
+
+uint64_t audio::SongTimeline::FindNextBeat(uint64_t sample) const
+{
+	const size_t section = FindSection(sample);
+	if (section >= GetSectionCount()) {
+		return GetLengthSamples();
+	}
+	const uint64_t start = m_sectionStartSamples[section];
+	const uint64_t end = m_sectionStartSamples[section + 1];
+	const SectionTiming& timing = m_sectionTimings[section];
+	const uint64_t beat = (timing.stepScale.FirstTickAtOrAfter(sample - start) + timing.stepsPerBeat - 1) / timing.stepsPerBeat;
+	return min(end, start + timing.stepScale.ToSample(beat * timing.stepsPerBeat));
+}
+
+audio::SongPosition audio::SongTimeline::GetPosition(uint64_t sample) const
+{
+	if (GetSectionCount() == 0) {
+		return { 0, 0, 0, 0, 0.0 };
+	}
+	const size_t section = min(FindSection(sample), GetSectionCount() - 1);
+	const SectionTiming& timing = m_sectionTimings[section];
+
+	// Steps starting up to and including this sample, less one, holding at the last step once the song has ended
+	const uint64_t offset = min(sample, m_sectionStartSamples[section + 1] - 1) - m_sectionStartSamples[section];
+	const uint64_t stepsStarted = timing.stepScale.FirstTickAtOrAfter(offset + 1);
+	const uint64_t step = stepsStarted > 0 ? stepsStarted - 1 : 0;
+	return { (uint32_t)section, (uint32_t)(step / timing.stepsPerBar), (uint32_t)(step % timing.stepsPerBar / timing.stepsPerBeat),
+		timing.stepsPerBar / timing.stepsPerBeat, timing.beatsPerMinute };
+}
+
+// One tick per step
+audio::SongTimeline::SectionTiming audio::SongTimeline::GetSectionTiming(const SongSection& section) const
+{
+	const TickScale scale(m_sampleRate, section.beatsPerMinute, (uint64_t)section.stepsPerBeat);
+	if (!scale.IsValid()) {
+		throw std::runtime_error("Tempo out of range in section " + section.name);
+	}
+	return { (uint32_t)section.GetStepsPerBar(), (uint32_t)section.stepsPerBeat, section.beatsPerMinute, scale };
+}
+
+// Steps land at their exact position rounded to the nearest sample, counted from the start of the section in
+// integer arithmetic, so that rounding never accumulates. Returns the section's length in samples.
+uint64_t audio::SongTimeline::CompileSection(const SongSection& section, std::vector<uint32_t>& offsets, std::vector<ToneVoice>& voices, std::vector<PatternNote>& accents) const
+{
+	const int stepsPerBar = section.GetStepsPerBar();
+	if (section.beatsPerBar <= 0 || section.stepsPerBeat <= 0 || section.barCount < 0 || !(section.beatsPerMinute > 0.0)) {
+		throw std::runtime_error("Invalid time signature or tempo in section " + section.name);
+	}
+	if (section.pattern.size() != (size_t)stepsPerBar) {
+		throw std::runtime_error("Pattern does not fill one bar in section " + section.name);
+	}
+
+	const TickScale scale = GetSectionTiming(section).stepScale;
+	const uint64_t stepCount = (uint64_t)stepsPerBar * section.barCount;
+	const uint64_t length = scale.ToSample(stepCount);
+	if (length > UINT32_MAX) {
+		throw std::runtime_error("Section " + section.name + " is too long");
+	}
+
+	for (uint64_t step = 0; step < stepCount; step++) {
+		const PatternNote note = section.pattern[step % stepsPerBar];
+		if (note == PatternNote::REST) {
+			continue;
+		}
+		offsets.push_back((uint32_t)scale.ToSample(step));
+		voices.push_back(note == PatternNote::ACCENT ? ToneVoice::ACCENT : ToneVoice::NORMAL);
+		accents.push_back(note);
+	}
+	return length;
+}
+
+audio::SongCursor::SongCursor() :
+	m_offsets(nullptr),
+	m_voices(nullptr),
+	m_accents(nullptr),
+	m_sectionStartSamples(nullptr),
+	m_sectionFirstEvents(nullptr),
+	m_sectionCount(0),
+	m_eventCount(0),
+	m_event(0),
+	m_section(0),
+	m_sectionStartSample(0),
+	m_sectionEndEvent(0),
+	m_nextEventSample(EndOfSong)
+{
+}
+
+void audio::SongCursor::Seek(const SongTimeline* timeline, uint64_t sample)
+{
+	if (timeline == nullptr || timeline->GetSectionCount() == 0) {
+		m_sectionCount = 0;
+		m_eventCount = 0;
+		m_event = 0;
+		m_section = 0;
+		m_sectionEndEvent = 0;
+		m_nextEventSample = EndOfSong;
+		return;
+	}
+	m_offsets = timeline->GetEventOffsets().data();
+	m_voices = timeline->GetEventVoices().data();
+	m_accents = timeline->GetEventAccents().data();
+	m_sectionStartSamples = timeline->GetSectionStartSamples().data();
+	m_sectionFirstEvents = timeline->GetSectionFirstEvents().data();
+	m_sectionCount = timeline->GetSectionCount();
+	m_eventCount = timeline->GetEventCount();
+
+	m_section = min(timeline->FindSection(sample), m_sectionCount - 1);
+	m_sectionStartSample = m_sectionStartSamples[m_section];
+	m_sectionEndEvent = m_sectionFirstEvents[m_section + 1];
+	m_event = timeline->FindEvent(sample);
+	UpdateNextEvent();
+}
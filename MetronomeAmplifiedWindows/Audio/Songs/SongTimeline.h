@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Song.h"
+#include "../TickScale.h"
+
+namespace audio {
+
+	// Which of the tone set's clicks an event plays
+	enum class ToneVoice : uint8_t {
+		NORMAL = 0,
+		ACCENT = 1
+	};
+
+	// Gain for a note of the pattern; ghost notes play at half level
+	inline float GetNoteGain(PatternNote note) {
+		return note == PatternNote::GHOST ? 0.5f : 1.0f;
+	}
+
+	// Where in a song a sample is: the section, the bar within it and the beat within that, counted from zero,
+	// of the last step at or before it, with the section's metre and tempo
+	struct SongPosition {
+		uint32_t section;
+		uint32_t bar;
+		uint32_t beat;
+		uint32_t beatsPerBar;
+		double beatsPerMinute;
+	};
+
+	// A song flattened into every click it plays, as parallel arrays of event offset, voice and accent, plus a
+	// table of where each section starts in samples and in events. Each step is a whole tick of its section's
+	// TickScale, so triplets, quintuplets and any other division of the beat land on exact samples. Offsets count from the start of the event's
+	// section, so an edit to one section recompiles only that section's events and shifts the start of those
+	// after it. Compiled and edited on the UI thread; the audio thread only reads a published copy.
+	class SongTimeline {
+	public:
+		static std::unique_ptr<SongTimeline> Compile(const Song& song, uint32_t sampleRate);
+
+		// After an edit to one section's pattern, tempo, time signature or length. Adding or removing sections
+		// needs a full Compile.
+		void RecompileSection(const Song& song, size_t sectionIndex);
+
+		// Binary searches of the section table, then of the section's events
+		size_t FindSection(uint64_t sample) const;
+		size_t FindEvent(uint64_t sample) const;
+
+		// Where an event lands, from the start of the song; O(log n) in the number of sections
+		uint64_t GetEventSample(size_t event) const;
+
+		// Start of the first bar at or after the given sample, or the end of the song if there is none. Bar lines
+		// land on the same samples as their first steps.
+		uint64_t FindNextBarLine(uint64_t sample) const;
+
+		// Start of the first beat at or after the given sample, or the end of the song if there is none
+		uint64_t FindNextBeat(uint64_t sample) const;
+
+		// O(log n) in the number of sections and never allocates, so the audio thread can call it once a block.
+		// Before the first step, the position is the start of the song.
+		SongPosition GetPosition(uint64_t sample) const;
+
+		inline uint32_t GetSampleRate() const { return m_sampleRate; }
+		inline size_t GetSectionCount() const { return m_sectionStartSamples.size() - 1; }
+		inline size_t GetEventCount() const { return m_eventOffsets.size(); }
+		inline uint64_t GetLengthSamples() const { return m_sectionStartSamples.back(); }
+
+		// One entry per section plus a final one marking the end of the song
+		inline const std::vector<uint64_t>& GetSectionStartSamples() const { return m_sectionStartSamples; }
+		inline const std::vector<uint32_t>& GetSectionFirstEvents() const { return m_sectionFirstEvents; }
+
+		inline const std::vector<uint32_t>& GetEventOffsets() const { return m_eventOffsets; }
+		inline const std::vector<ToneVoice>& GetEventVoices() const { return m_eventVoices; }
+		inline const std::vector<PatternNote>& GetEventAccents() const { return m_eventAccents; }
+
+	private:
+		// What each section's steps are, for finding bar lines and positions
+		struct SectionTiming {
+			uint32_t stepsPerBar;
+			uint32_t stepsPerBeat;
+			double beatsPerMinute;
+			TickScale stepScale;
+		};
+
+		uint32_t m_sampleRate;
+		std::vector<uint64_t> m_sectionStartSamples;
+		std::vector<uint32_t> m_sectionFirstEvents;
+		std::vector<SectionTiming> m_sectionTimings;
+		std::vector<uint32_t> m_eventOffsets;
+		std::vector<ToneVoice> m_eventVoices;
+		std::vector<PatternNote> m_eventAccents;
+
+		explicit SongTimeline(uint32_t sampleRate);
+		SectionTiming GetSectionTiming(const SongSection& section) const;
+		uint64_t CompileSection(const SongSection& section, std::vector<uint32_t>& offsets, std::vector<ToneVoice>& voices, std::vector<PatternNote>& accents) const;
+	};
+
+	// Read position in a timeline for the audio thread. Walks the flat arrays by index, carrying the current
+	// section's start and end along, so stepping to the next event never follows a pointer into the song.
+	class SongCursor {
+	public:
+		static const uint64_t EndOfSong = UINT64_MAX;
+
+		SongCursor();
+
+		// O(log n) in the number of sections and events; a null timeline leaves the cursor at the end
+		void Seek(const SongTimeline* timeline, uint64_t sample);
+
+		// Sample position of the next event, or EndOfSong
+		inline uint64_t GetNextEventSample() const { return m_nextEventSample; }
+		inline ToneVoice GetVoice() const { return m_voices[m_event]; }
+		inline PatternNote GetAccent() const { return m_accents[m_event]; }
+		inline size_t GetSection() const { return m_section; }
+
+		inline void Advance() {
+			m_event++;
+			UpdateNextEvent();
+		}
+
+	private:
+		const uint32_t* m_offsets;
+		const ToneVoice* m_voices;
+		const PatternNote* m_accents;
+		const uint64_t* m_sectionStartSamples;
+		const uint32_t* m_sectionFirstEvents;
+		size_t m_sectionCount;
+		size_t m_eventCount;
+
+		size_t m_event;
+		size_t m_section;
+		uint64_t m_sectionStartSample;
+		size_t m_sectionEndEvent;
+		uint64_t m_nextEventSample;
+
+		// Moves on past sections with no events left, then works out where the current event lands
+		inline void UpdateNextEvent() {
+			while (m_event == m_sectionEndEvent && m_section + 1 < m_sectionCount) {
+				m_section++;
+				m_sectionStartSample = m_sectionStartSamples[m_section];
+				m_sectionEndEvent = m_sectionFirstEvents[m_section + 1];
+			}
+			m_nextEventSample = m_event < m_eventCount ? m_sectionStartSample + m_offsets[m_event] : EndOfSong;
+		}
+	};
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace audio {
+
+	// Wait-free single-producer, single-consumer ring buffer with a fixed, power-of-two capacity.
+	// One thread may call TryPush and one other thread may call TryPop; neither ever blocks or allocates.
+	template<typename T, size_t Capacity>
+	class SpscQueue {
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	private:
+		std::array<T, Capacity> m_items;
+		alignas(64) std::atomic<size_t> m_head;
+		alignas(64) std::atomic<size_t> m_tail;
+
+	public:
+		SpscQueue() : m_items(), m_head(0), m_tail(0) {}
+
+		// Producer side. Returns false if the queue is full.
+		bool TryPush(const T& item) {
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+			const size_t head = m_head.load(std::memory_order_acquire);
+			if (tail - head == Capacity) {
+				return false;
+			}
+			m_items[tail & (Capacity - 1)] = item;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Producer side. Once true, stays true until the producer pushes, since popping only makes room.
+		bool CanPush() const {
+			return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire) < Capacity;
+		}
+
+		// Consumer side. Returns false if the queue is empty.
+		bool TryPop(T& item) {
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			const size_t tail = m_tail.load(std::memory_order_acquire);
+			if (head == tail) {
+				return false;
+			}
+			item = m_items[head & (Capacity - 1)];
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		size_t GetCapacity() const { return Capacity; }
+	};
+}
@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "TapTempo.h"
+
+namespace {
+
+	const double MinSecondsPerBeat = 60.0 / audio::TapTempoEstimator::MaxBeatsPerMinute;
+	const double MaxSecondsPerBeat = 60.0 / audio::TapTempoEstimator::MinBeatsPerMinute;
+}
+
+audio::TapTempoEstimator::TapTempoEstimator() :
+	m_taps(),
+	m_count(0),
+	m_lastStep(0),
+	m_hasPendingTap(false),
+	m_pendingSeconds(0.0),
+	m_lastSeconds(0.0),
+	m_rejectedTapCount(0),
+	m_originSeconds(0.0),
+	m_secondsPerBeat(0.5)
+{
+}
+
+void audio::TapTempoEstimator::Reset()
+{
+	m_count = 0;
+	m_lastStep = 0;
+	m_hasPendingTap = false;
+	m_rejectedTapCount = 0;
+}
+
+double audio::TapTempoEstimator::GetBeatsPerMinute() const
+{
+	return std::clamp(60.0 / m_secondsPerBeat, MinBeatsPerMinute, MaxBeatsPerMinute);
+}
+
+audio::TempoRamp audio::TapTempoEstimator::GetTempoChange(double fromBeatsPerMinute) const
+{
+	return TempoRamp::Linear(fromBeatsPerMinute, GetBeatsPerMinute(), GlideBeats);
+}
+
+bool audio::TapTempoEstimator::AddTap(double seconds)
+{
+	// A pause longer than the slowest beat starts again, unless it lands on the beat after a missed one, which at
+	// slow tempos is longer than the slowest beat
+	const double interval = seconds - m_lastSeconds;
+	int64_t beat = 0;
+	if (m_count == 0 || interval < 0.0 || (interval > MaxSecondsPerBeat && !(HasEstimate() && IsOnBeat(seconds, beat)))) {
+		Restart(seconds);
+		return false;
+	}
+	if (interval < BounceSeconds) {
+		m_rejectedTapCount++;
+		return false;
+	}
+	m_lastSeconds = seconds;
+
+	// The second tap gives the first estimate, if the two are not too close together for a beat
+	if (m_count == 1) {
+		if (interval < MinSecondsPerBeat) {
+			Restart(seconds);
+			return false;
+		}
+		Accept(seconds, m_taps[0].beat + 1);
+		return true;
+	}
+
+	if (IsOnBeat(seconds, beat)) {
+		Accept(seconds, beat);
+		return true;
+	}
+
+	// Two taps in a row off the fit but a beat apart from each other: the tempo has changed
+	m_rejectedTapCount++;
+	const double pendingInterval = seconds - m_pendingSeconds;
+	if (m_hasPendingTap && pendingInterval >= MinSecondsPerBeat && pendingInterval <= MaxSecondsPerBeat) {
+		Restart(m_pendingSeconds);
+		Accept(seconds, 1);
+		return true;
+	}
+	m_hasPendingTap = true;
+	m_pendingSeconds = seconds;
+	return false;
+}
+
+// True if the tap is within tolerance of the next beat the fit expects, or of the one after if a tap was
+// missed, but never two misses running, as that is more likely a tap at half the tempo. Gives the beat either way.
+bool audio::TapTempoEstimator::IsOnBeat(double seconds, int64_t& beat) const
+{
+	beat = llround((seconds - m_originSeconds) / m_secondsPerBeat);
+	const int64_t step = beat - m_taps[m_count - 1].beat;
+	return fabs(seconds - (m_originSeconds + (double)beat * m_secondsPerBeat)) <= GetToleranceSeconds() &&
+		(step == 1 || (step == 2 && m_lastStep == 1));
+}
+
+// Start counting again from a single tap
+void audio::TapTempoEstimator::Restart(double seconds)
+{
+	m_taps[0] = { seconds, 0 };
+	m_count = 1;
+	m_lastStep = 0;
+	m_hasPendingTap = false;
+	m_lastSeconds = seconds;
+}
+
+// Add a tap to the window, dropping the oldest if it is full, then refit. Once there are enough taps to tell,
+// one that no longer fits, such as a hesitant first tap, is dropped.
+void audio::TapTempoEstimator::Accept(double seconds, int64_t beat)
+{
+	if (m_count == WindowTaps) {
+		std::copy(m_taps.begin() + 1, m_taps.end(), m_taps.begin());
+		m_count--;
+	}
+	m_lastStep = beat - m_taps[m_count - 1].beat;
+	m_taps[m_count++] = { seconds, beat };
+	m_hasPendingTap = false;
+	Fit();
+	if (m_count >= 4 && RemoveWorstTap()) {
+		Fit();
+	}
+}
+
+// Least squares line through the taps' times against their beat numbers, centred for accuracy
+void audio::TapTempoEstimator::Fit()
+{
+	double meanBeat = 0.0;
+	double meanSeconds = 0.0;
+	for (int i = 0; i < m_count; i++) {
+		meanBeat += (double)(m_taps[i].beat - m_taps[0].beat);
+		meanSeconds += m_taps[i].seconds - m_taps[0].seconds;
+	}
+	meanBeat /= (double)m_count;
+	meanSeconds /= (double)m_count;
+
+	double covariance = 0.0;
+	double variance = 0.0;
+	for (int i = 0; i < m_count; i++) {
+		const double beat = (double)(m_taps[i].beat - m_taps[0].beat) - meanBeat;
+		covariance += beat * (m_taps[i].seconds - m_taps[0].seconds - meanSeconds);
+		variance += beat * beat;
+	}
+	m_secondsPerBeat = std::clamp(covariance / variance, MinSecondsPerBeat, MaxSecondsPerBeat);
+	m_originSeconds = m_taps[0].seconds + meanSeconds - (meanBeat + (double)m_taps[0].beat) * m_secondsPerBeat;
+}
+
+// Drops the tap furthest from the fit if it is out of tolerance, keeping the newest, which has just been checked
+bool audio::TapTempoEstimator::RemoveWorstTap()
+{
+	int worst = -1;
+	double worstError = GetToleranceSeconds();
+	for (int i = 0; i < m_count - 1; i++) {
+		const double error = fabs(m_taps[i].seconds - (m_originSeconds + (double)m_taps[i].beat * m_secondsPerBeat));
+		if (error > worstError) {
+			worst = i;
+			worstError = error;
+		}
+	}
+	if (worst < 0) {
+		return false;
+	}
+	std::copy(m_taps.begin() + worst + 1, m_taps.begin() + m_count, m_taps.begin() + worst);
+	m_count--;
+	m_rejectedTapCount++;
+	return true;
+}
+
+// A fit from only two taps has all of both taps' jitter in its one interval, so the third tap only needs to be
+// nearer the next beat than any other. Never so loose that a tap could be on either of two beats.
+double audio::TapTempoEstimator::GetToleranceSeconds() const
+{
+	const double maxTolerance = MaxToleranceBeats * m_secondsPerBeat;
+	return m_count == 2 ? maxTolerance : min(max(ToleranceBeats * m_secondsPerBeat, ToleranceSeconds), maxTolerance);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "TempoRamp.h"
+
+#include <array>
+
+namespace audio {
+
+	// Estimates tempo from taps, timed by when the input happened rather than by when a frame got round to
+	// handling it, as frame times would add up to a frame of jitter to every tap. Tap times are fitted against
+	// beat numbers by least squares over a sliding window of the latest taps, so jitter averages out, and the
+	// estimate is usable from the second tap and settles within three or four. A tap too far from where the fit
+	// expects the next beat is left out: a stray or bounced tap is dropped, a missed beat is allowed for, and two
+	// taps in a row that both disagree with the fit but agree with each other start a new estimate, as the tempo
+	// has changed. A pause longer than the slowest beat starts again from scratch, unless it is a missed beat at
+	// a slow tempo. Never allocates.
+	class TapTempoEstimator {
+	public:
+		static const int WindowTaps = 8;
+		static constexpr double MinBeatsPerMinute = 30.0;
+		static constexpr double MaxBeatsPerMinute = 300.0;
+
+		// How far a tap may be from the fit's beat and still count: this fraction of a beat, or this many
+		// seconds at fast tempos, where a beat leaves little room for the hand's own jitter
+		static constexpr double ToleranceBeats = 0.25;
+		static constexpr double ToleranceSeconds = 0.06;
+		static constexpr double MaxToleranceBeats = 0.45;
+
+		// Taps closer together than this are one tap bounced
+		static constexpr double BounceSeconds = 0.1;
+
+		// Beats over which the engine glides to a new estimate
+		static constexpr double GlideBeats = 2.0;
+
+		TapTempoEstimator();
+
+		// Returns true if the tap changed the estimate. Times are in seconds on any monotonic clock.
+		bool AddTap(double seconds);
+		void Reset();
+
+		inline bool HasEstimate() const { return m_count >= 2; }
+		inline int GetTapCount() const { return m_count; }
+		inline uint64_t GetRejectedTapCount() const { return m_rejectedTapCount; }
+
+		// Clamped to the range allowed; meaningless without an estimate
+		double GetBeatsPerMinute() const;
+
+		// Smooth change from the tempo playing to the estimate, for AudioEngine::SetTempoRamp
+		TempoRamp GetTempoChange(double fromBeatsPerMinute) const;
+
+	private:
+		struct Tap {
+			double seconds;
+			int64_t beat;
+		};
+
+		// Taps in the window, oldest first
+		std::array<Tap, WindowTaps> m_taps;
+		int m_count;
+		int64_t m_lastStep;
+
+		// Latest tap that did not fit, kept in case the next one agrees with it
+		bool m_hasPendingTap;
+		double m_pendingSeconds;
+		double m_lastSeconds;
+		uint64_t m_rejectedTapCount;
+
+		// The fit: beat b is expected at m_originSeconds + b * m_secondsPerBeat
+		double m_originSeconds;
+		double m_secondsPerBeat;
+
+		void Restart(double seconds);
+		bool IsOnBeat(double seconds, int64_t& beat) const;
+		void Accept(double seconds, int64_t beat);
+		void Fit();
+		bool RemoveWorstTap();
+		double GetToleranceSeconds() const;
+	};
+}
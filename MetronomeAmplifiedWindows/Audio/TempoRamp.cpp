@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "TempoRamp.h"
+
+namespace {
+
+	// Below this many steps the harmonic sum is added up directly
+	const int64_t DirectSumSteps = 16;
+
+	// Digamma function: recurrence up to x >= 10, then the asymptotic series, which is accurate there to well
+	// under 1e-15 relative
+	double Digamma(double x)
+	{
+		double result = 0.0;
+		while (x < 10.0) {
+			result -= 1.0 / x;
+			x += 1.0;
+		}
+		const double inverseSquared = 1.0 / (x * x);
+		const double series = inverseSquared * (1.0 / 12.0 - inverseSquared * (1.0 / 120.0 - inverseSquared * (1.0 / 252.0 -
+			inverseSquared * (1.0 / 240.0 - inverseSquared * (1.0 / 132.0)))));
+		return result + log(x) - 0.5 / x - series;
+	}
+
+	// Sum of 1 / (first + j * increment) for j in [0, count), for positive terms, in O(1)
+	double HarmonicSum(double first, double increment, int64_t count)
+	{
+		if (count <= DirectSumSteps || increment == 0.0) {
+			if (increment == 0.0) {
+				return (double)count / first;
+			}
+			double sum = 0.0;
+			for (int64_t j = 0; j < count; j++) {
+				sum += 1.0 / (first + (double)j * increment);
+			}
+			return sum;
+		}
+
+		// A falling series is the same sum taken from its smallest term upwards
+		if (increment < 0.0) {
+			first += (double)(count - 1) * increment;
+			increment = -increment;
+		}
+		const double x = first / increment;
+		return (Digamma(x + (double)count) - Digamma(x)) / increment;
+	}
+}
+
+audio::TempoRamp::TempoRamp() :
+	TempoRamp(RampShape::CONSTANT, 120.0, 120.0, 0.0, 0, 0)
+{
+}
+
+audio::TempoRamp::TempoRamp(RampShape shape, double startBeatsPerMinute, double endBeatsPerMinute, double lengthBeats, int stepBeats, int stepCount) :
+	m_shape(shape),
+	m_startBeatsPerMinute(startBeatsPerMinute),
+	m_endBeatsPerMinute(endBeatsPerMinute),
+	m_lengthBeats(lengthBeats),
+	m_rate(0.0),
+	m_stepBeats(stepBeats),
+	m_stepCount(stepCount),
+	m_endMinutes(0.0)
+{
+	if (!(startBeatsPerMinute > 0.0) || !(endBeatsPerMinute > 0.0)) {
+		throw std::runtime_error("Tempo ramp needs positive tempos");
+	}
+	switch (shape) {
+	case RampShape::CONSTANT:
+		break;
+	case RampShape::LINEAR:
+		m_rate = (endBeatsPerMinute - startBeatsPerMinute) / lengthBeats;
+		break;
+	case RampShape::EXPONENTIAL:
+		m_rate = log(endBeatsPerMinute / startBeatsPerMinute) / lengthBeats;
+		break;
+	case RampShape::STEPPED:
+		m_rate = (endBeatsPerMinute - startBeatsPerMinute) / (double)stepCount;
+		break;
+	}
+	m_endMinutes = GetMinutesWithinRamp(lengthBeats);
+}
+
+audio::TempoRamp audio::TempoRamp::Constant(double beatsPerMinute)
+{
+	return TempoRamp(RampShape::CONSTANT, beatsPerMinute, beatsPerMinute, 0.0, 0, 0);
+}
+
+audio::TempoRamp audio::TempoRamp::Linear(double startBeatsPerMinute, double endBeatsPerMinute, double lengthBeats)
+{
+	if (lengthBeats <= 0.0 || startBeatsPerMinute == endBeatsPerMinute) {
+		return Constant(endBeatsPerMinute);
+	}
+	return TempoRamp(RampShape::LINEAR, startBeatsPerMinute, endBeatsPerMinute, lengthBeats, 0, 0);
+}
+
+audio::TempoRamp audio::TempoRamp::Exponential(double startBeatsPerMinute, double endBeatsPerMinute, double lengthBeats)
+{
+	if (lengthBeats <= 0.0 || startBeatsPerMinute == endBeatsPerMinute) {
+		return Constant(endBeatsPerMinute);
+	}
+	return TempoRamp(RampShape::EXPONENTIAL, startBeatsPerMinute, endBeatsPerMinute, lengthBeats, 0, 0);
+}
+
+audio::TempoRamp audio::TempoRamp::Stepped(double startBeatsPerMinute, double endBeatsPerMinute, int stepBeats, int stepCount)
+{
+	if (stepBeats <= 0 || stepCount <= 0 || startBeatsPerMinute == endBeatsPerMinute) {
+		return Constant(endBeatsPerMinute);
+	}
+	return TempoRamp(RampShape::STEPPED, startBeatsPerMinute, endBeatsPerMinute, (double)stepBeats * stepCount, stepBeats, stepCount);
+}
+
+double audio::TempoRamp::GetTempoAt(double beats) const
+{
+	if (beats >= m_lengthBeats) {
+		return m_endBeatsPerMinute;
+	}
+	switch (m_shape) {
+	case RampShape::LINEAR:
+		return m_startBeatsPerMinute + m_rate * beats;
+	case RampShape::EXPONENTIAL:
+		return m_startBeatsPerMinute * exp(m_rate * beats);
+	case RampShape::STEPPED:
+		return m_startBeatsPerMinute + m_rate * floor(beats / m_stepBeats);
+	default:
+		return m_startBeatsPerMinute;
+	}
+}
+
+// Constant stretches multiply by samples per beat, exactly as a fixed tempo always has, so that bar cache
+// variants still line up with the beats played at a steady tempo
+double audio::TempoRamp::GetSampleOffset(double beats, double samplesPerMinute) const
+{
+	if (m_shape == RampShape::CONSTANT) {
+		return beats * (samplesPerMinute / m_startBeatsPerMinute);
+	}
+	if (beats >= m_lengthBeats) {
+		return m_endMinutes * samplesPerMinute + (beats - m_lengthBeats) * (samplesPerMinute / m_endBeatsPerMinute);
+	}
+	return GetMinutesWithinRamp(beats) * samplesPerMinute;
+}
+
+double audio::TempoRamp::GetMinutesWithinRamp(double beats) const
+{
+	switch (m_shape) {
+	case RampShape::LINEAR:
+		// Integral of 1 / (start + rate * b)
+		return log1p(m_rate * beats / m_startBeatsPerMinute) / m_rate;
+	case RampShape::EXPONENTIAL:
+		// Integral of exp(-rate * b) / start
+		return -expm1(-m_rate * beats) / (m_startBeatsPerMinute * m_rate);
+	case RampShape::STEPPED: {
+		const int64_t step = (int64_t)floor(beats / m_stepBeats);
+		const double beatsIntoStep = beats - (double)step * m_stepBeats;
+		return GetMinutesToStep(step) + beatsIntoStep / (m_startBeatsPerMinute + m_rate * (double)step);
+	}
+	default:
+		return beats / m_startBeatsPerMinute;
+	}
+}
+
+double audio::TempoRamp::GetMinutesToStep(int64_t step) const
+{
+	return m_stepBeats * HarmonicSum(m_startBeatsPerMinute, m_rate, step);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+namespace audio {
+
+	enum class RampShape {
+		CONSTANT,
+		LINEAR,
+		EXPONENTIAL,
+		STEPPED
+	};
+
+	// Tempo as a function of beats counted from the start of a ramp, holding at the end tempo once the ramp is over.
+	// The time to any beat is the integral of minutes-per-beat up to it, evaluated in closed form, so beat positions
+	// are computed afresh for each beat rather than accumulated and never drift however long the ramp runs.
+	// Plain value with no allocations, cheap to copy through a queue to the audio thread.
+	class TempoRamp {
+	public:
+		TempoRamp();
+
+		static TempoRamp Constant(double beatsPerMinute);
+
+		// Tempo changes by the same amount every beat
+		static TempoRamp Linear(double startBeatsPerMinute, double endBeatsPerMinute, double lengthBeats);
+
+		// Tempo changes by the same ratio every beat
+		static TempoRamp Exponential(double startBeatsPerMinute, double endBeatsPerMinute, double lengthBeats);
+
+		// Tempo jumps by an equal amount every stepBeats beats, reaching the end tempo after stepCount jumps
+		static TempoRamp Stepped(double startBeatsPerMinute, double endBeatsPerMinute, int stepBeats, int stepCount);
+
+		// Tempo for the beat starting at the given position
+		double GetTempoAt(double beats) const;
+
+		// Distance in samples from the start of the ramp to the given beat
+		double GetSampleOffset(double beats, double samplesPerMinute) const;
+
+		inline RampShape GetShape() const { return m_shape; }
+		inline bool IsConstant() const { return m_shape == RampShape::CONSTANT; }
+		inline double GetStartTempo() const { return m_startBeatsPerMinute; }
+		inline double GetEndTempo() const { return m_endBeatsPerMinute; }
+		inline double GetLengthBeats() const { return m_lengthBeats; }
+
+	private:
+		RampShape m_shape;
+		double m_startBeatsPerMinute;
+		double m_endBeatsPerMinute;
+		double m_lengthBeats;
+		double m_rate;
+		int m_stepBeats;
+		int m_stepCount;
+		double m_endMinutes;
+
+		TempoRamp(RampShape shape, double startBeatsPerMinute, double endBeatsPerMinute, double lengthBeats, int stepBeats, int stepCount);
+		double GetMinutesWithinRamp(double beats) const;
+		double GetMinutesToStep(int64_t step) const;
+	};
+}
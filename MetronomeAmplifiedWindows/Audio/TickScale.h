@@ -0,0 +1,74 @@
+#pragma once
+
+#include <numeric>
+
+namespace audio {
+
+	// Exact conversion between musical positions, counted in whole ticks of a beat, and sample positions at a
+	// constant tempo. Samples per tick is held as a fraction of integers in lowest terms, with the tempo taken to
+	// the nearest TempoResolution of a beat per minute, so tick n lands on n times that fraction rounded to the
+	// nearest sample however far it is from the start: nothing is accumulated and no floating-point rounding can
+	// drift. Dividing the beat into as many ticks as a tuplet has notes, or a multiple of that, puts every note
+	// of the tuplet on a whole tick. Only 64-bit integer arithmetic is used, with no allocations, so the audio
+	// thread converts positions as it renders.
+	class TickScale {
+	public:
+		static const uint64_t TempoResolution = 1000;
+
+		TickScale() :
+			m_samples(0),
+			m_ticks(1)
+		{
+		}
+
+		// Invalid if the tempo rounds to zero, or if the fraction is too big to convert exactly in 64 bits
+		TickScale(uint32_t sampleRate, double beatsPerMinute, uint64_t ticksPerBeat) :
+			TickScale()
+		{
+			const double tempo = beatsPerMinute * (double)TempoResolution;
+			if (!(tempo >= 0.5 && tempo < 1.0e15) || sampleRate == 0 || ticksPerBeat == 0) {
+				return;
+			}
+			uint64_t samples = 60 * TempoResolution * sampleRate;
+			uint64_t ticks = (uint64_t)llround(tempo);
+			if (ticks > UINT64_MAX / ticksPerBeat) {
+				return;
+			}
+			ticks *= ticksPerBeat;
+			const uint64_t divisor = std::gcd(samples, ticks);
+			samples /= divisor;
+			ticks /= divisor;
+			if (samples > (UINT64_MAX - ticks) / ticks) {
+				return;
+			}
+			m_samples = samples;
+			m_ticks = ticks;
+		}
+
+		inline bool IsValid() const { return m_samples != 0; }
+
+		// Nearest sample to the tick, with halves rounded up. Whole multiples of the fraction's denominator are
+		// split off first, so the product left over always fits.
+		inline uint64_t ToSample(uint64_t tick) const {
+			return tick / m_ticks * m_samples + (tick % m_ticks * m_samples + m_ticks / 2) / m_ticks;
+		}
+
+		// First tick landing at or after the sample, the inverse of ToSample for finding the next bar line
+		inline uint64_t FirstTickAtOrAfter(uint64_t sample) const {
+			// ToSample(t) >= s exactly when t * m_samples >= s * m_ticks - m_ticks / 2
+			const uint64_t whole = sample / m_samples * m_ticks;
+			const uint64_t remainder = sample % m_samples * m_ticks;
+			const uint64_t half = m_ticks / 2;
+			if (remainder >= half) {
+				return whole + (remainder - half + m_samples - 1) / m_samples;
+			}
+			const uint64_t back = (half - remainder) / m_samples;
+			return whole > back ? whole - back : 0;
+		}
+
+	private:
+		// Samples per tick is m_samples / m_ticks
+		uint64_t m_samples;
+		uint64_t m_ticks;
+	};
+}
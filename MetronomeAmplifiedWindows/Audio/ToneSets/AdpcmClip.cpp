@@ -0,0 +1,177 @@
+#include "pch.h"
+#include "AdpcmClip.h"
+
+namespace {
+
+	const int32_t StepSizes[89] = {
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+		107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+		876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428,
+		4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+		22385, 24623, 27086, 29794, 32767
+	};
+	const int32_t MaxStepIndex = 88;
+	const int32_t StepIndexAdjustments[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+	// What each nibble adds to the predictor and where it moves the step index, for every step index, worked
+	// out at compile time so that decoding a sample is two lookups rather than a chain of branches
+	struct NibbleTables {
+		int32_t differences[(MaxStepIndex + 1) * 16];
+		uint8_t nextStepIndices[(MaxStepIndex + 1) * 16];
+	};
+
+	constexpr NibbleTables MakeNibbleTables()
+	{
+		NibbleTables tables = {};
+		for (int32_t stepIndex = 0; stepIndex <= MaxStepIndex; stepIndex++) {
+			for (int32_t nibble = 0; nibble < 16; nibble++) {
+				const int32_t step = StepSizes[stepIndex];
+				int32_t difference = step >> 3;
+				if ((nibble & 4) != 0) {
+					difference += step;
+				}
+				if ((nibble & 2) != 0) {
+					difference += step >> 1;
+				}
+				if ((nibble & 1) != 0) {
+					difference += step >> 2;
+				}
+				const int32_t nextStepIndex = stepIndex + StepIndexAdjustments[nibble & 7];
+				tables.differences[stepIndex * 16 + nibble] = (nibble & 8) != 0 ? -difference : difference;
+				tables.nextStepIndices[stepIndex * 16 + nibble] = (uint8_t)(nextStepIndex < 0 ? 0 : nextStepIndex > MaxStepIndex ? MaxStepIndex : nextStepIndex);
+			}
+		}
+		return tables;
+	}
+
+	constexpr NibbleTables Tables = MakeNibbleTables();
+
+	// One step of the IMA decoder, which the encoder runs too so that it predicts from what will be decoded
+	// rather than from the original samples
+	inline void ApplyNibble(int32_t nibble, int32_t& predictor, int32_t& stepIndex)
+	{
+		const int32_t entry = stepIndex * 16 + nibble;
+		predictor = max(-32768, min(32767, predictor + Tables.differences[entry]));
+		stepIndex = Tables.nextStepIndices[entry];
+	}
+
+	// The standard IMA choice: the sign, then each magnitude bit taken greedily from the top
+	inline int32_t ChooseNibble(int32_t target, int32_t predictor, int32_t stepIndex)
+	{
+		int32_t step = StepSizes[stepIndex];
+		int32_t difference = target - predictor;
+		int32_t nibble = 0;
+		if (difference < 0) {
+			nibble = 8;
+			difference = -difference;
+		}
+		for (int32_t bit = 4; bit > 0; bit >>= 1) {
+			if (difference >= step) {
+				nibble |= bit;
+				difference -= step;
+			}
+			step >>= 1;
+		}
+		return nibble;
+	}
+
+	// Encodes one block from the given step index into 'block', returning the squared error and leaving
+	// stepIndex where the block ends
+	int64_t EncodeBlock(const int32_t* samples, uint32_t count, int32_t& stepIndex, byte* block)
+	{
+		memset(block, 0, audio::AdpcmClip::BlockBytes);
+		int32_t predictor = samples[0];
+		block[0] = (byte)(predictor & 0xff);
+		block[1] = (byte)((predictor >> 8) & 0xff);
+		block[2] = (byte)stepIndex;
+		int64_t squaredError = 0;
+		for (uint32_t i = 1; i < count; i++) {
+			const int32_t nibble = ChooseNibble(samples[i], predictor, stepIndex);
+			ApplyNibble(nibble, predictor, stepIndex);
+			block[4 + (i - 1) / 2] |= (byte)(nibble << (4 * ((i - 1) % 2)));
+			squaredError += (int64_t)(predictor - samples[i]) * (predictor - samples[i]);
+		}
+		return squaredError;
+	}
+
+	// Decodes the sample at the cursor and moves it on. The first sample of each block is taken from its header,
+	// so decoding never carries anything across a block boundary.
+	inline int32_t DecodeNext(const byte* blocks, audio::AdpcmCursor& cursor)
+	{
+		const uint32_t offset = cursor.position % audio::AdpcmClip::BlockFrames;
+		const byte* block = blocks + (size_t)(cursor.position / audio::AdpcmClip::BlockFrames) * audio::AdpcmClip::BlockBytes;
+		if (offset == 0) {
+			cursor.predictor = (int16_t)(block[0] | (block[1] << 8));
+			cursor.stepIndex = min((int32_t)block[2], MaxStepIndex);
+		} else {
+			const uint32_t nibbleIndex = offset - 1;
+			ApplyNibble((block[4 + nibbleIndex / 2] >> (4 * (nibbleIndex % 2))) & 15, cursor.predictor, cursor.stepIndex);
+		}
+		cursor.position++;
+		return cursor.predictor;
+	}
+}
+
+audio::AdpcmClip::AdpcmClip(const float* samples, uint32_t length) :
+	m_ownedBlocks(),
+	m_blocks(nullptr),
+	m_length(length),
+	m_scale(1.0f / 32767.0f)
+{
+	float peak = 0.0f;
+	for (uint32_t i = 0; i < length; i++) {
+		peak = max(peak, fabsf(samples[i]));
+	}
+	if (peak > 0.0f) {
+		m_scale = peak / 32767.0f;
+	}
+	const float inverseScale = 1.0f / m_scale;
+	std::vector<int32_t> quantised(length);
+	for (uint32_t i = 0; i < length; i++) {
+		quantised[i] = max(-32768, min(32767, (int32_t)lrintf(samples[i] * inverseScale)));
+	}
+
+	// A click is loudest at its start, where the step size has had nothing to adapt to, so the first block's
+	// step index is the one of all that encodes it best. The step index then runs on from one block to the
+	// next, so each block starts already adapted to the level.
+	m_ownedBlocks.resize(GetEncodedBytes(), 0);
+	int32_t stepIndex = 0;
+	if (length > 0) {
+		byte trial[BlockBytes];
+		int64_t bestError = INT64_MAX;
+		for (int32_t startIndex = 0; startIndex <= MaxStepIndex; startIndex++) {
+			int32_t endIndex = startIndex;
+			const int64_t error = EncodeBlock(quantised.data(), min(length, BlockFrames), endIndex, trial);
+			if (error < bestError) {
+				bestError = error;
+				stepIndex = startIndex;
+			}
+		}
+	}
+	for (size_t blockIndex = 0; blockIndex < GetBlockCount(); blockIndex++) {
+		const uint32_t start = (uint32_t)blockIndex * BlockFrames;
+		EncodeBlock(quantised.data() + start, min(length - start, BlockFrames), stepIndex, m_ownedBlocks.data() + blockIndex * BlockBytes);
+	}
+	m_blocks = m_ownedBlocks.data();
+}
+
+audio::AdpcmClip::AdpcmClip(const byte* blocks, uint32_t length, float scale) :
+	m_ownedBlocks(),
+	m_blocks(blocks),
+	m_length(length),
+	m_scale(scale)
+{
+}
+
+void audio::AdpcmClip::Decode(AdpcmCursor& cursor, uint32_t position, uint32_t frameCount, float* output) const
+{
+	if (cursor.position != position) {
+		cursor.position = position - position % BlockFrames;
+		while (cursor.position < position) {
+			DecodeNext(m_blocks, cursor);
+		}
+	}
+	for (uint32_t i = 0; i < frameCount; i++) {
+		output[i] = (float)DecodeNext(m_blocks, cursor) * m_scale;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+namespace audio {
+
+	// Where a voice is in an AdpcmClip: the next sample to decode and the decoder's state just before it. Decoding
+	// on from here is what makes playing a clip cheap; any other position is found by seeking.
+	struct AdpcmCursor {
+		uint32_t position;
+		int32_t predictor;
+		int32_t stepIndex;
+	};
+
+	// A mono click held as IMA-ADPCM, at four bits a sample rather than 32. Samples are scaled so the clip's
+	// peak is full scale, then cut into blocks of BlockFrames, each starting with its first sample and step
+	// index so it decodes without the ones before it. A voice can therefore start anywhere by decoding from the
+	// start of one block, then carries its decoder state in an AdpcmCursor from one mixed block to the next.
+	// Decoding is integer arithmetic, so the same sample decodes to the same value however it is reached.
+	class AdpcmClip {
+	public:
+		static const uint32_t BlockFrames = 256;
+
+		// A 4-byte header and a nibble for every sample after the first, padded to a whole number of 32-bit
+		// words so that blocks can share a cache file with float samples
+		static const size_t BlockBytes = 4 + BlockFrames / 2;
+
+		// Encodes the samples into blocks the clip owns
+		AdpcmClip(const float* samples, uint32_t length);
+
+		// Borrows blocks encoded earlier, such as ones mapped from a cache file, which must outlive the clip
+		AdpcmClip(const byte* blocks, uint32_t length, float scale);
+
+		AdpcmClip(const AdpcmClip&) = delete;
+		AdpcmClip& operator=(const AdpcmClip&) = delete;
+
+		// Writes frameCount samples from the given position, which must lie within the clip, decoding on from
+		// the cursor if it is already there. Never allocates.
+		void Decode(AdpcmCursor& cursor, uint32_t position, uint32_t frameCount, float* output) const;
+
+		inline uint32_t GetLength() const { return m_length; }
+		inline float GetScale() const { return m_scale; }
+		inline const byte* GetBlocks() const { return m_blocks; }
+		inline size_t GetBlockCount() const { return (m_length + BlockFrames - 1) / BlockFrames; }
+		inline size_t GetEncodedBytes() const { return GetBlockCount() * BlockBytes; }
+
+		// Heap memory held, which is nothing for borrowed blocks
+		inline size_t GetMemoryBytes() const { return m_ownedBlocks.size(); }
+
+	private:
+		std::vector<byte> m_ownedBlocks;
+		const byte* m_blocks;
+		uint32_t m_length;
+
+		// Value of one step of the 16-bit samples
+		float m_scale;
+	};
+}
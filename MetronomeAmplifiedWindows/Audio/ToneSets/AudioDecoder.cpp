@@ -0,0 +1,179 @@
+#include "pch.h"
+#include "AudioDecoder.h"
+
+namespace {
+	const uint16_t WAVE_FORMAT_PCM_TAG = 1;
+	const uint16_t WAVE_FORMAT_FLOAT_TAG = 3;
+	const uint16_t WAVE_FORMAT_EXTENSIBLE_TAG = 0xfffe;
+
+	uint16_t ReadUint16(const byte* data) {
+		return (uint16_t)(data[0] | (data[1] << 8));
+	}
+
+	uint32_t ReadUint32(const byte* data) {
+		return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+	}
+
+	float ReadWavSample(const byte* data, uint16_t formatTag, uint16_t bitsPerSample) {
+		if (formatTag == WAVE_FORMAT_FLOAT_TAG) {
+			if (bitsPerSample == 64) {
+				double value;
+				memcpy(&value, data, sizeof(double));
+				return (float)value;
+			}
+			float value;
+			memcpy(&value, data, sizeof(float));
+			return value;
+		}
+		switch (bitsPerSample) {
+		case 8:
+			return ((float)data[0] - 128.0f) / 128.0f;
+		case 16:
+			return (float)(int16_t)ReadUint16(data) / 32768.0f;
+		case 24:
+			return (float)((int32_t)(((uint32_t)data[0] << 8) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 24)) >> 8) / 8388608.0f;
+		default:
+			return (float)((double)(int32_t)ReadUint32(data) / 2147483648.0);
+		}
+	}
+}
+
+std::vector<float> audio::DecodedAudio::MixToMono() const
+{
+	if (channelCount == 1) {
+		return samples;
+	}
+	const size_t frameCount = GetFrameCount();
+	std::vector<float> mono(frameCount);
+	const float scale = 1.0f / (float)channelCount;
+	for (size_t frame = 0; frame < frameCount; frame++) {
+		float sum = 0.0f;
+		for (uint32_t channel = 0; channel < channelCount; channel++) {
+			sum += samples[frame * channelCount + channel];
+		}
+		mono[frame] = sum * scale;
+	}
+	return mono;
+}
+
+audio::DecodedAudio audio::DecodeAudioFile(const std::vector<byte>& fileData)
+{
+	if (fileData.size() >= 12 && memcmp(fileData.data(), "RIFF", 4) == 0 && memcmp(fileData.data() + 8, "WAVE", 4) == 0) {
+		return DecodeWav(fileData.data(), fileData.size());
+	}
+	if (fileData.size() >= 4 && memcmp(fileData.data(), "fLaC", 4) == 0) {
+		return DecodeFlac(fileData.data(), fileData.size());
+	}
+	throw std::runtime_error("Audio file is neither WAV nor FLAC");
+}
+
+audio::DecodedAudio audio::DecodeWav(const byte* data, size_t size)
+{
+	if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+		throw std::runtime_error("Not a WAV file");
+	}
+	StreamingDecoder decoder(data, size);
+	DecodedAudio decoded = { decoder.GetSampleRate(), decoder.GetChannelCount(), {} };
+	decoded.samples.reserve((size_t)decoder.GetFrameCount() * decoder.GetChannelCount());
+	while (decoder.ReadBlock(decoded.samples)) {
+	}
+	return decoded;
+}
+
+audio::StreamingDecoder::StreamingDecoder(const byte* data, size_t size) :
+	m_data(data),
+	m_size(size),
+	m_isFlac(false),
+	m_sampleRate(0),
+	m_channelCount(0),
+	m_bitsPerSample(0),
+	m_frameCount(0),
+	m_framesRead(0),
+	m_offset(0),
+	m_formatTag(0),
+	m_blockAlign(0),
+	m_channelSamples(),
+	m_residual()
+{
+	if (size >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVE", 4) == 0) {
+		OpenWav();
+	} else if (size >= 4 && memcmp(data, "fLaC", 4) == 0) {
+		m_isFlac = true;
+		OpenFlac();
+	} else {
+		throw std::runtime_error("Audio file is neither WAV nor FLAC");
+	}
+}
+
+bool audio::StreamingDecoder::ReadBlock(std::vector<float>& samples)
+{
+	return m_isFlac ? ReadFlacBlock(samples) : ReadWavBlock(samples);
+}
+
+void audio::StreamingDecoder::OpenWav()
+{
+	uint16_t formatTag = 0;
+	uint16_t channelCount = 0;
+	uint32_t sampleRate = 0;
+	uint16_t bitsPerSample = 0;
+	uint16_t blockAlign = 0;
+	size_t sampleDataOffset = 0;
+	size_t sampleDataSize = 0;
+
+	// Walk the chunk list; chunks are padded to an even size
+	size_t offset = 12;
+	while (offset + 8 <= m_size) {
+		const byte* chunk = m_data + offset;
+		const size_t chunkSize = min((size_t)ReadUint32(chunk + 4), m_size - offset - 8);
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16) {
+			formatTag = ReadUint16(chunk + 8);
+			channelCount = ReadUint16(chunk + 10);
+			sampleRate = ReadUint32(chunk + 12);
+			blockAlign = ReadUint16(chunk + 20);
+			bitsPerSample = ReadUint16(chunk + 22);
+			if (formatTag == WAVE_FORMAT_EXTENSIBLE_TAG && chunkSize >= 26) {
+				formatTag = ReadUint16(chunk + 32);
+			}
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			sampleDataOffset = offset + 8;
+			sampleDataSize = chunkSize;
+		}
+		offset += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	const bool isPcm = formatTag == WAVE_FORMAT_PCM_TAG && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+	const bool isFloat = formatTag == WAVE_FORMAT_FLOAT_TAG && (bitsPerSample == 32 || bitsPerSample == 64);
+	if (sampleDataOffset == 0 || channelCount == 0 || sampleRate == 0 || !(isPcm || isFloat)) {
+		throw std::runtime_error("Unsupported WAV format");
+	}
+
+	const uint32_t bytesPerSample = bitsPerSample / 8;
+	m_formatTag = formatTag;
+	m_channelCount = channelCount;
+	m_sampleRate = sampleRate;
+	m_bitsPerSample = bitsPerSample;
+	m_blockAlign = max((uint32_t)blockAlign, bytesPerSample * channelCount);
+	m_frameCount = sampleDataSize / m_blockAlign;
+	m_offset = sampleDataOffset;
+}
+
+bool audio::StreamingDecoder::ReadWavBlock(std::vector<float>& samples)
+{
+	const uint64_t frameCount = min((uint64_t)WavBlockFrames, m_frameCount - m_framesRead);
+	if (frameCount == 0) {
+		return false;
+	}
+	const uint32_t bytesPerSample = m_bitsPerSample / 8;
+	const size_t outputStart = samples.size();
+	samples.resize(outputStart + (size_t)frameCount * m_channelCount);
+	float* output = samples.data() + outputStart;
+	for (uint64_t frame = 0; frame < frameCount; frame++) {
+		const byte* frameData = m_data + m_offset + frame * m_blockAlign;
+		for (uint32_t channel = 0; channel < m_channelCount; channel++) {
+			*output++ = ReadWavSample(frameData + channel * bytesPerSample, m_formatTag, (uint16_t)m_bitsPerSample);
+		}
+	}
+	m_offset += (size_t)frameCount * m_blockAlign;
+	m_framesRead += frameCount;
+	return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+namespace audio {
+
+	// PCM decoded from a file, as interleaved floats in [-1, 1] at the file's own sample rate
+	struct DecodedAudio {
+		uint32_t sampleRate;
+		uint32_t channelCount;
+		std::vector<float> samples;
+
+		inline size_t GetFrameCount() const { return channelCount == 0 ? 0 : samples.size() / channelCount; }
+		std::vector<float> MixToMono() const;
+	};
+
+	// Decodes a WAV or FLAC file held in memory, picking the format from its signature.
+	// Throws std::runtime_error if the data is not a supported file.
+	DecodedAudio DecodeAudioFile(const std::vector<byte>& fileData);
+
+	// Integer PCM of 8 to 32 bits, and 32- or 64-bit float, in plain or extensible format
+	DecodedAudio DecodeWav(const byte* data, size_t size);
+
+	// Any FLAC stream with up to 8 channels; frame CRCs are not checked
+	DecodedAudio DecodeFlac(const byte* data, size_t size);
+
+	// Decodes a WAV or FLAC file held in memory a block at a time, so that a long file opened as a MappedFile
+	// never has to be decoded whole. The whole-file decoders above are built on it. The data must stay valid
+	// and unchanged while the decoder is used.
+	class StreamingDecoder {
+	public:
+		static const uint32_t WavBlockFrames = 4096;
+
+		// Throws std::runtime_error if the data is not a supported file
+		StreamingDecoder(const byte* data, size_t size);
+
+		// Appends the next block of interleaved frames to the samples: up to WavBlockFrames of a WAV file, or
+		// one frame of a FLAC stream. Returns false once there are none left. Throws std::runtime_error if the
+		// data is corrupt.
+		bool ReadBlock(std::vector<float>& samples);
+
+		inline uint32_t GetSampleRate() const { return m_sampleRate; }
+		inline uint32_t GetChannelCount() const { return m_channelCount; }
+
+		// Zero for a FLAC stream that does not say
+		inline uint64_t GetFrameCount() const { return m_frameCount; }
+		inline uint64_t GetFramesRead() const { return m_framesRead; }
+
+	private:
+		const byte* m_data;
+		size_t m_size;
+		bool m_isFlac;
+		uint32_t m_sampleRate;
+		uint32_t m_channelCount;
+		uint32_t m_bitsPerSample;
+		uint64_t m_frameCount;
+		uint64_t m_framesRead;
+
+		// Where the next block starts in the data
+		size_t m_offset;
+
+		// WAV sample data layout
+		uint16_t m_formatTag;
+		uint32_t m_blockAlign;
+
+		// FLAC working buffers, kept between frames
+		std::vector<int64_t> m_channelSamples;
+		std::vector<int32_t> m_residual;
+
+		void OpenWav();
+		bool ReadWavBlock(std::vector<float>& samples);
+		void OpenFlac();
+		bool ReadFlacBlock(std::vector<float>& samples);
+	};
+}
@@ -0,0 +1,276 @@
+#include "pch.h"
+#include "ClickSynth.h"
+
+#include <array>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CLICK_USE_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLICK_USE_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CLICK_USE_NEON
+#endif
+
+namespace {
+
+	const double Pi = 3.14159265358979323846;
+	const float TwoPi = 6.28318530717958647692f;
+
+	// Lowest frequency a patch may use, and largest index, past which a bell is only noise
+	const float MinFrequencyHz = 20.0f;
+	const float MaxModulationIndex = 50.0f;
+
+	// Attack times of the presets, just long enough that the clicks start without a crack
+	const float NoiseAttackSeconds = 0.0005f;
+	const float SineAttackSeconds = 0.001f;
+	const float BellAttackSeconds = 0.002f;
+
+	// Presets run until the decay is 60dB down
+	const float DecayTimeConstants = 6.9f;
+
+	// White noise read with linear interpolation at twice the band's width, which leaves it band-limited to
+	// about that width, and then moved up to the band's centre by a carrier. The table repeats far more slowly
+	// than any click lasts.
+	const uint32_t NoiseTableSize = 4096;
+
+	const std::array<float, NoiseTableSize>& GetNoiseTable()
+	{
+		static const std::array<float, NoiseTableSize> table = []() {
+			std::array<float, NoiseTableSize> values;
+			uint32_t state = 0x9e3779b9u;
+			for (float& value : values) {
+				state = state * 1664525u + 1013904223u;
+				value = (float)(state >> 8) / (float)(1u << 23) - 1.0f;
+			}
+			return values;
+		}();
+		return table;
+	}
+
+	// The kernels are written once against these lane operations, as sine and phase wrapping would otherwise be
+	// spelled out for every instruction set
+#if defined(CLICK_USE_AVX)
+	typedef __m256 Lanes;
+	const uint32_t LaneCount = 8;
+	inline Lanes Set(float value) { return _mm256_set1_ps(value); }
+	inline Lanes Load(const float* values) { return _mm256_loadu_ps(values); }
+	inline void Store(float* values, Lanes lanes) { _mm256_storeu_ps(values, lanes); }
+	inline Lanes Add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+	inline Lanes Subtract(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+	inline Lanes Multiply(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+	inline Lanes Minimum(Lanes a, Lanes b) { return _mm256_min_ps(a, b); }
+	inline Lanes Truncate(Lanes a) { return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(a)); }
+#elif defined(CLICK_USE_SSE)
+	typedef __m128 Lanes;
+	const uint32_t LaneCount = 4;
+	inline Lanes Set(float value) { return _mm_set1_ps(value); }
+	inline Lanes Load(const float* values) { return _mm_loadu_ps(values); }
+	inline void Store(float* values, Lanes lanes) { _mm_storeu_ps(values, lanes); }
+	inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+	inline Lanes Subtract(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+	inline Lanes Multiply(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+	inline Lanes Minimum(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+	inline Lanes Truncate(Lanes a) { return _mm_cvtepi32_ps(_mm_cvttps_epi32(a)); }
+#elif defined(CLICK_USE_NEON)
+	typedef float32x4_t Lanes;
+	const uint32_t LaneCount = 4;
+	inline Lanes Set(float value) { return vdupq_n_f32(value); }
+	inline Lanes Load(const float* values) { return vld1q_f32(values); }
+	inline void Store(float* values, Lanes lanes) { vst1q_f32(values, lanes); }
+	inline Lanes Add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+	inline Lanes Subtract(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+	inline Lanes Multiply(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+	inline Lanes Minimum(Lanes a, Lanes b) { return vminq_f32(a, b); }
+	inline Lanes Truncate(Lanes a) { return vcvtq_f32_s32(vcvtq_s32_f32(a)); }
+#else
+	typedef float Lanes;
+	const uint32_t LaneCount = 1;
+	inline Lanes Set(float value) { return value; }
+	inline Lanes Load(const float* values) { return *values; }
+	inline void Store(float* values, Lanes lanes) { *values = lanes; }
+	inline Lanes Add(Lanes a, Lanes b) { return a + b; }
+	inline Lanes Subtract(Lanes a, Lanes b) { return a - b; }
+	inline Lanes Multiply(Lanes a, Lanes b) { return a * b; }
+	inline Lanes Minimum(Lanes a, Lanes b) { return min(a, b); }
+	inline Lanes Truncate(Lanes a) { return (float)(int32_t)a; }
+#endif
+	static_assert(audio::ClickSynth::TileFrames % LaneCount == 0, "Tiles must be whole groups of lanes");
+
+	// Brings a phase of at least -pi into [-pi, pi] by taking off whole turns; truncation rounds down as the
+	// value it is given is never negative
+	inline Lanes WrapPhase(Lanes phase)
+	{
+		const Lanes turns = Truncate(Add(Multiply(phase, Set(1.0f / TwoPi)), Set(0.5f)));
+		return Subtract(phase, Multiply(turns, Set(TwoPi)));
+	}
+
+	// sin(x) for x in [-pi, pi] from its Taylor series to x^15, within 1e-6
+	inline Lanes Sine(Lanes x)
+	{
+		const Lanes squared = Multiply(x, x);
+		Lanes series = Set(-1.0f / 1307674368000.0f);
+		series = Add(Multiply(series, squared), Set(1.0f / 6227020800.0f));
+		series = Add(Multiply(series, squared), Set(-1.0f / 39916800.0f));
+		series = Add(Multiply(series, squared), Set(1.0f / 362880.0f));
+		series = Add(Multiply(series, squared), Set(-1.0f / 5040.0f));
+		series = Add(Multiply(series, squared), Set(1.0f / 120.0f));
+		series = Add(Multiply(series, squared), Set(-1.0f / 6.0f));
+		return Add(x, Multiply(Multiply(series, squared), x));
+	}
+
+	// Values for the lanes of the first group of a tile: a start plus a step per lane, or a start times a ratio
+	// per lane
+	inline Lanes Ramp(double start, double step)
+	{
+		float values[LaneCount];
+		for (uint32_t lane = 0; lane < LaneCount; lane++) {
+			values[lane] = (float)(start + step * lane);
+		}
+		return Load(values);
+	}
+
+	inline Lanes Geometric(double start, double logRatio)
+	{
+		float values[LaneCount];
+		for (uint32_t lane = 0; lane < LaneCount; lane++) {
+			values[lane] = (float)(start * exp(logRatio * lane));
+		}
+		return Load(values);
+	}
+}
+
+audio::ClickPatch audio::ClickPatch::NoiseBurst(float centreHz, float bandwidthHz, float decaySeconds, float level)
+{
+	return { ClickShape::NOISE_BURST, centreHz, bandwidthHz, 0.0f, 0.0f, 0.0f, NoiseAttackSeconds, decaySeconds, min(ClickSynth::MaxLengthSeconds, DecayTimeConstants * decaySeconds), level };
+}
+
+audio::ClickPatch audio::ClickPatch::FilteredSine(float frequencyHz, float harmonic, float decaySeconds, float level)
+{
+	return { ClickShape::FILTERED_SINE, frequencyHz, 0.0f, harmonic, 0.0f, 0.0f, SineAttackSeconds, decaySeconds, min(ClickSynth::MaxLengthSeconds, DecayTimeConstants * decaySeconds), level };
+}
+
+audio::ClickPatch audio::ClickPatch::FmBell(float carrierHz, float modulatorRatio, float modulationIndex, float decaySeconds, float level)
+{
+	return { ClickShape::FM_BELL, carrierHz, 0.0f, 0.0f, modulatorRatio, modulationIndex, BellAttackSeconds, decaySeconds, min(ClickSynth::MaxLengthSeconds, DecayTimeConstants * decaySeconds), level };
+}
+
+audio::ClickSynth::ClickSynth(const ClickPatch& patch, uint32_t sampleRate) :
+	m_patch(patch),
+	m_length((uint32_t)ceil((double)patch.lengthSeconds * sampleRate)),
+	m_carrierStep(2.0 * Pi * patch.frequency / sampleRate),
+	m_modulatorStep(2.0 * Pi * patch.frequency * patch.modulatorRatio / sampleRate),
+	m_noiseStep(min(1.0, 2.0 * patch.bandwidth / sampleRate)),
+	m_attackStep(1.0f / max(1.0f, patch.attackSeconds * sampleRate)),
+	m_amplitudeDecay(-1.0 / ((double)patch.decaySeconds * sampleRate)),
+	m_harmonicDecay(-4.0 / ((double)patch.decaySeconds * sampleRate)),
+	m_indexDecay(-2.0 / ((double)patch.decaySeconds * sampleRate))
+{
+	const float nyquist = 0.5f * sampleRate;
+	if (!(patch.frequency >= MinFrequencyHz && patch.frequency < nyquist) ||
+		(patch.shape == ClickShape::FILTERED_SINE && !(patch.harmonic >= 0.0f && 2.0f * patch.frequency < nyquist)) ||
+		(patch.shape == ClickShape::NOISE_BURST && !(patch.bandwidth > 0.0f && patch.bandwidth < nyquist)) ||
+		(patch.shape == ClickShape::FM_BELL && !(patch.modulatorRatio >= 0.0f && patch.modulationIndex >= 0.0f && patch.modulationIndex <= MaxModulationIndex))) {
+		throw std::invalid_argument("Click patch frequencies must lie between 20Hz and Nyquist, with the shape's other settings in range");
+	}
+	if (!(patch.attackSeconds >= 0.0f && patch.decaySeconds > 0.0f && patch.lengthSeconds > 0.0f && patch.lengthSeconds <= MaxLengthSeconds)) {
+		throw std::invalid_argument("Click patch times must be positive and no longer than the longest click");
+	}
+	if (patch.shape != ClickShape::NOISE_BURST && patch.shape != ClickShape::FILTERED_SINE && patch.shape != ClickShape::FM_BELL) {
+		throw std::invalid_argument("Unknown click shape");
+	}
+
+	// Built here so the audio thread never does it
+	GetNoiseTable();
+}
+
+void audio::ClickSynth::Render(uint32_t position, uint32_t frameCount, float* output) const
+{
+	float tile[TileFrames];
+	uint32_t done = 0;
+	while (done < frameCount) {
+		const uint32_t at = position + done;
+		const uint32_t offset = at % TileFrames;
+		const uint32_t frames = min(TileFrames - offset, frameCount - done);
+		if (frames == TileFrames) {
+			RenderTile(at, output + done);
+		} else {
+			RenderTile(at - offset, tile);
+			std::copy(tile + offset, tile + offset + frames, output + done);
+		}
+		done += frames;
+	}
+}
+
+// Phases are taken modulo a turn in double precision at the tile's start, so that they stay small enough for
+// float lanes to carry through the tile without losing accuracy however far into the click it is
+void audio::ClickSynth::RenderTile(uint32_t tileStart, float* output) const
+{
+	const double start = (double)tileStart;
+	const Lanes one = Set(1.0f);
+	const Lanes attackGroupStep = Set(m_attackStep * LaneCount);
+	Lanes attack = Ramp((start + 1.0) * m_attackStep, m_attackStep);
+	const Lanes amplitudeGroupRatio = Set((float)exp(m_amplitudeDecay * LaneCount));
+	Lanes amplitude = Geometric(m_patch.level * exp(m_amplitudeDecay * start), m_amplitudeDecay);
+	const Lanes carrierGroupStep = Set((float)(m_carrierStep * LaneCount));
+	Lanes carrier = Ramp(fmod(m_carrierStep * start, 2.0 * Pi), m_carrierStep);
+
+	switch (m_patch.shape) {
+	case ClickShape::NOISE_BURST: {
+		const std::array<float, NoiseTableSize>& table = GetNoiseTable();
+		for (uint32_t group = 0; group < TileFrames; group += LaneCount) {
+			float noise[LaneCount];
+			for (uint32_t lane = 0; lane < LaneCount; lane++) {
+				const double position = (start + group + lane) * m_noiseStep;
+				const uint32_t index = (uint32_t)position;
+				const float fraction = (float)(position - index);
+				const float first = table[index % NoiseTableSize];
+				noise[lane] = first + (table[(index + 1) % NoiseTableSize] - first) * fraction;
+			}
+			const Lanes envelope = Multiply(Minimum(attack, one), amplitude);
+			Store(output + group, Multiply(Multiply(Load(noise), Sine(WrapPhase(carrier))), envelope));
+			attack = Add(attack, attackGroupStep);
+			amplitude = Multiply(amplitude, amplitudeGroupRatio);
+			carrier = Add(carrier, carrierGroupStep);
+		}
+		break;
+	}
+	case ClickShape::FILTERED_SINE: {
+		const Lanes harmonicGroupRatio = Set((float)exp(m_harmonicDecay * LaneCount));
+		Lanes harmonic = Geometric(m_patch.harmonic * exp(m_harmonicDecay * start), m_harmonicDecay);
+		for (uint32_t group = 0; group < TileFrames; group += LaneCount) {
+			const Lanes fundamental = Sine(WrapPhase(carrier));
+			const Lanes second = Multiply(Sine(WrapPhase(Add(carrier, carrier))), harmonic);
+			const Lanes envelope = Multiply(Minimum(attack, one), amplitude);
+			Store(output + group, Multiply(Add(fundamental, second), envelope));
+			attack = Add(attack, attackGroupStep);
+			amplitude = Multiply(amplitude, amplitudeGroupRatio);
+			harmonic = Multiply(harmonic, harmonicGroupRatio);
+			carrier = Add(carrier, carrierGroupStep);
+		}
+		break;
+	}
+	case ClickShape::FM_BELL: {
+		// Whole turns added ahead of the modulation keep the carrier's phase from going below -pi
+		const Lanes indexTurns = Set(TwoPi * ceilf(m_patch.modulationIndex / TwoPi));
+		const Lanes modulatorGroupStep = Set((float)(m_modulatorStep * LaneCount));
+		Lanes modulator = Ramp(fmod(m_modulatorStep * start, 2.0 * Pi), m_modulatorStep);
+		const Lanes indexGroupRatio = Set((float)exp(m_indexDecay * LaneCount));
+		Lanes index = Geometric(m_patch.modulationIndex * exp(m_indexDecay * start), m_indexDecay);
+		for (uint32_t group = 0; group < TileFrames; group += LaneCount) {
+			const Lanes modulation = Multiply(Sine(WrapPhase(modulator)), index);
+			const Lanes tone = Sine(WrapPhase(Add(Add(carrier, indexTurns), modulation)));
+			const Lanes envelope = Multiply(Minimum(attack, one), amplitude);
+			Store(output + group, Multiply(tone, envelope));
+			attack = Add(attack, attackGroupStep);
+			amplitude = Multiply(amplitude, amplitudeGroupRatio);
+			index = Multiply(index, indexGroupRatio);
+			carrier = Add(carrier, carrierGroupStep);
+			modulator = Add(modulator, modulatorGroupStep);
+		}
+		break;
+	}
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+namespace audio {
+
+	enum class ClickShape : uint32_t {
+		NOISE_BURST,
+		FILTERED_SINE,
+		FM_BELL
+	};
+
+	// A synthesised click as stored in a tone set, in place of samples. Times are in seconds and frequencies in
+	// hertz, so the same patch renders alike at any device rate. Fields a shape does not use are ignored.
+	struct ClickPatch {
+		ClickShape shape;
+
+		// The noise band's centre, the sine's pitch or the bell's carrier
+		float frequency;
+
+		// Noise burst: how far the band reaches either side of its centre
+		float bandwidth;
+
+		// Filtered sine: level of the second harmonic, which dies away four times as fast as the fundamental,
+		// as if a lowpass were closing over it
+		float harmonic;
+
+		// FM bell: the modulator's frequency as a ratio of the carrier's, and its peak index, which falls twice
+		// as fast as the amplitude so the bell mellows as it rings
+		float modulatorRatio;
+		float modulationIndex;
+
+		float attackSeconds;
+
+		// Time constant of the exponential decay after the attack
+		float decaySeconds;
+		float lengthSeconds;
+		float level;
+
+		static ClickPatch NoiseBurst(float centreHz, float bandwidthHz, float decaySeconds, float level);
+		static ClickPatch FilteredSine(float frequencyHz, float harmonic, float decaySeconds, float level);
+		static ClickPatch FmBell(float carrierHz, float modulatorRatio, float modulationIndex, float decaySeconds, float level);
+	};
+
+	// A click patch prepared for one device rate, rendered on the audio thread as voices play rather than held as
+	// samples. Every sample depends only on its position: each tile of TileFrames is started from oscillator
+	// phases and envelope levels computed afresh for the tile's first sample, and run on from there in SIMD
+	// lanes. A click therefore renders the same whether it is mixed in one block or many, from the start or from
+	// part way through, as the bar cache and song export rely on. Never allocates after construction.
+	class ClickSynth {
+	public:
+		static const uint32_t TileFrames = 64;
+		static constexpr float MaxLengthSeconds = 4.0f;
+
+		// Throws std::invalid_argument for a patch with a frequency outside the audible band below Nyquist, a
+		// negative harmonic or modulation, a time that is not positive, or a length above MaxLengthSeconds
+		ClickSynth(const ClickPatch& patch, uint32_t sampleRate);
+
+		// Writes frameCount samples from the given position, which must lie within the click's length
+		void Render(uint32_t position, uint32_t frameCount, float* output) const;
+
+		inline const ClickPatch& GetPatch() const { return m_patch; }
+		inline uint32_t GetLength() const { return m_length; }
+
+	private:
+		ClickPatch m_patch;
+		uint32_t m_length;
+
+		// Per sample: radians the carrier and modulator advance, the noise table positions passed, the attack's
+		// rise, and the natural logs of the decays of the amplitude, the harmonic and the modulation index
+		double m_carrierStep;
+		double m_modulatorStep;
+		double m_noiseStep;
+		float m_attackStep;
+		double m_amplitudeDecay;
+		double m_harmonicDecay;
+		double m_indexDecay;
+
+		void RenderTile(uint32_t tileStart, float* output) const;
+	};
+}
@@ -0,0 +1,400 @@
+#include "pch.h"
+#include "AudioDecoder.h"
+
+namespace {
+
+	// Reads big-endian bit fields, as used throughout FLAC frames
+	class BitReader {
+	private:
+		const byte* m_data;
+		size_t m_size;
+		size_t m_bitPosition;
+
+	public:
+		BitReader(const byte* data, size_t size) : m_data(data), m_size(size), m_bitPosition(0) {}
+
+		uint32_t ReadBits(int count) {
+			if (m_bitPosition + count > m_size * 8) {
+				throw std::runtime_error("FLAC stream is truncated");
+			}
+			uint32_t value = 0;
+			while (count > 0) {
+				const size_t byteIndex = m_bitPosition >> 3;
+				const int bitOffset = (int)(m_bitPosition & 7);
+				const int bitsAvailable = 8 - bitOffset;
+				const int bitsTaken = min(count, bitsAvailable);
+				const uint32_t bits = (m_data[byteIndex] >> (bitsAvailable - bitsTaken)) & ((1u << bitsTaken) - 1);
+				value = (value << bitsTaken) | bits;
+				m_bitPosition += bitsTaken;
+				count -= bitsTaken;
+			}
+			return value;
+		}
+
+		int32_t ReadSignedBits(int count) {
+			if (count == 0) {
+				return 0;
+			}
+			const uint32_t value = ReadBits(count);
+			const uint32_t signBit = 1u << (count - 1);
+			return (int32_t)((value ^ signBit) - signBit);
+		}
+
+		int64_t ReadSignedBits64(int count) {
+			if (count <= 32) {
+				return ReadSignedBits(count);
+			}
+			const uint64_t high = ReadBits(count - 32);
+			const uint64_t value = (high << 32) | ReadBits(32);
+			const uint64_t signBit = 1ull << (count - 1);
+			return (int64_t)((value ^ signBit) - signBit);
+		}
+
+		// Counts zero bits up to the next one bit, skipping whole bytes of zeros at a time
+		uint32_t ReadUnary() {
+			uint32_t zeros = 0;
+			while (true) {
+				if (m_bitPosition >= m_size * 8) {
+					throw std::runtime_error("FLAC stream is truncated");
+				}
+				const int bitOffset = (int)(m_bitPosition & 7);
+				uint32_t bits = (uint32_t)(byte)(m_data[m_bitPosition >> 3] << bitOffset);
+				if (bits == 0) {
+					zeros += 8 - bitOffset;
+					m_bitPosition += 8 - bitOffset;
+					continue;
+				}
+				while ((bits & 0x80) == 0) {
+					bits <<= 1;
+					zeros++;
+					m_bitPosition++;
+				}
+				m_bitPosition++;
+				return zeros;
+			}
+		}
+
+		// Rice-coded residual: unary quotient, fixed-width remainder, then zig-zag folded sign
+		int32_t ReadRice(int parameter) {
+			const uint32_t quotient = ReadUnary();
+			const uint32_t folded = (quotient << parameter) | ReadBits(parameter);
+			return (int32_t)(folded >> 1) ^ -(int32_t)(folded & 1);
+		}
+
+		// Frame and sample numbers use the UTF-8 style variable-length coding
+		uint64_t ReadUtf8Number() {
+			const uint32_t first = ReadBits(8);
+			int extraBytes = 0;
+			uint64_t value = first;
+			if ((first & 0x80) != 0) {
+				uint32_t mask = 0x40;
+				while ((first & mask) != 0 && extraBytes < 6) {
+					extraBytes++;
+					mask >>= 1;
+				}
+				value = first & (mask - 1);
+			}
+			for (int i = 0; i < extraBytes; i++) {
+				value = (value << 6) | (ReadBits(8) & 0x3f);
+			}
+			return value;
+		}
+
+		void AlignToByte() {
+			m_bitPosition = (m_bitPosition + 7) & ~(size_t)7;
+		}
+
+		inline size_t GetBytePosition() { return m_bitPosition >> 3; }
+		inline bool IsAtEnd() { return m_bitPosition + 16 > m_size * 8; }
+	};
+
+	struct StreamInfo {
+		uint32_t sampleRate;
+		uint32_t channelCount;
+		uint32_t bitsPerSample;
+		uint64_t totalSamples;
+	};
+
+	enum class ChannelAssignment {
+		INDEPENDENT,
+		LEFT_SIDE,
+		SIDE_RIGHT,
+		MID_SIDE
+	};
+
+	void ReadResidual(BitReader& reader, uint32_t blockSize, int predictorOrder, int32_t* residual)
+	{
+		const uint32_t codingMethod = reader.ReadBits(2);
+		if (codingMethod > 1) {
+			throw std::runtime_error("Unsupported FLAC residual coding");
+		}
+		const int parameterBits = codingMethod == 0 ? 4 : 5;
+		const uint32_t escapeParameter = codingMethod == 0 ? 15 : 31;
+		const int partitionOrder = (int)reader.ReadBits(4);
+		const uint32_t partitionCount = 1u << partitionOrder;
+		if ((blockSize >> partitionOrder) < (uint32_t)predictorOrder) {
+			throw std::runtime_error("Invalid FLAC residual partition");
+		}
+
+		uint32_t sampleIndex = 0;
+		for (uint32_t partition = 0; partition < partitionCount; partition++) {
+			const uint32_t sampleCount = (blockSize >> partitionOrder) - (partition == 0 ? predictorOrder : 0);
+			const uint32_t parameter = reader.ReadBits(parameterBits);
+			if (parameter == escapeParameter) {
+				const int rawBits = (int)reader.ReadBits(5);
+				for (uint32_t i = 0; i < sampleCount; i++) {
+					residual[sampleIndex++] = reader.ReadSignedBits(rawBits);
+				}
+			} else {
+				for (uint32_t i = 0; i < sampleCount; i++) {
+					residual[sampleIndex++] = reader.ReadRice((int)parameter);
+				}
+			}
+		}
+	}
+
+	void ReadSubframe(BitReader& reader, uint32_t blockSize, int bitsPerSample, int64_t* samples, std::vector<int32_t>& residual)
+	{
+		if (reader.ReadBits(1) != 0) {
+			throw std::runtime_error("Invalid FLAC subframe header");
+		}
+		const uint32_t type = reader.ReadBits(6);
+		int wastedBits = 0;
+		if (reader.ReadBits(1) != 0) {
+			wastedBits = (int)reader.ReadUnary() + 1;
+			bitsPerSample -= wastedBits;
+		}
+
+		if (type == 0) {
+			const int64_t value = reader.ReadSignedBits64(bitsPerSample);
+			for (uint32_t i = 0; i < blockSize; i++) {
+				samples[i] = value;
+			}
+		} else if (type == 1) {
+			for (uint32_t i = 0; i < blockSize; i++) {
+				samples[i] = reader.ReadSignedBits64(bitsPerSample);
+			}
+		} else if (type >= 8 && type <= 12) {
+			const int order = (int)(type & 7);
+			for (int i = 0; i < order; i++) {
+				samples[i] = reader.ReadSignedBits64(bitsPerSample);
+			}
+			ReadResidual(reader, blockSize, order, residual.data());
+			for (uint32_t i = order; i < blockSize; i++) {
+				int64_t prediction = 0;
+				switch (order) {
+				case 1: prediction = samples[i - 1]; break;
+				case 2: prediction = 2 * samples[i - 1] - samples[i - 2]; break;
+				case 3: prediction = 3 * samples[i - 1] - 3 * samples[i - 2] + samples[i - 3]; break;
+				case 4: prediction = 4 * samples[i - 1] - 6 * samples[i - 2] + 4 * samples[i - 3] - samples[i - 4]; break;
+				}
+				samples[i] = prediction + residual[i - order];
+			}
+		} else if (type >= 32) {
+			const int order = (int)(type & 31) + 1;
+			for (int i = 0; i < order; i++) {
+				samples[i] = reader.ReadSignedBits64(bitsPerSample);
+			}
+			const int precision = (int)reader.ReadBits(4) + 1;
+			if (precision == 16) {
+				throw std::runtime_error("Invalid FLAC LPC precision");
+			}
+			const int shift = reader.ReadSignedBits(5);
+			int32_t coefficients[32];
+			for (int i = 0; i < order; i++) {
+				coefficients[i] = reader.ReadSignedBits(precision);
+			}
+			ReadResidual(reader, blockSize, order, residual.data());
+			for (uint32_t i = order; i < blockSize; i++) {
+				int64_t sum = 0;
+				for (int j = 0; j < order; j++) {
+					sum += (int64_t)coefficients[j] * samples[i - 1 - j];
+				}
+				samples[i] = (sum >> max(shift, 0)) + residual[i - order];
+			}
+		} else {
+			throw std::runtime_error("Reserved FLAC subframe type");
+		}
+
+		if (wastedBits > 0) {
+			for (uint32_t i = 0; i < blockSize; i++) {
+				samples[i] <<= wastedBits;
+			}
+		}
+	}
+
+	// Decodes one frame, appending interleaved samples to the output; returns false once the data runs out
+	bool ReadFrame(BitReader& reader, const StreamInfo& info, std::vector<int64_t>& channelSamples, std::vector<int32_t>& residual, std::vector<float>& output)
+	{
+		if (reader.IsAtEnd()) {
+			return false;
+		}
+		const uint32_t sync = reader.ReadBits(14);
+		if (sync != 0x3ffe) {
+			throw std::runtime_error("Lost FLAC frame sync");
+		}
+		reader.ReadBits(2);
+		const uint32_t blockSizeCode = reader.ReadBits(4);
+		const uint32_t sampleRateCode = reader.ReadBits(4);
+		const uint32_t channelCode = reader.ReadBits(4);
+		const uint32_t sampleSizeCode = reader.ReadBits(3);
+		reader.ReadBits(1);
+		reader.ReadUtf8Number();
+
+		uint32_t blockSize = 0;
+		if (blockSizeCode == 1) {
+			blockSize = 192;
+		} else if (blockSizeCode >= 2 && blockSizeCode <= 5) {
+			blockSize = 576u << (blockSizeCode - 2);
+		} else if (blockSizeCode == 6) {
+			blockSize = reader.ReadBits(8) + 1;
+		} else if (blockSizeCode == 7) {
+			blockSize = reader.ReadBits(16) + 1;
+		} else if (blockSizeCode >= 8) {
+			blockSize = 256u << (blockSizeCode - 8);
+		} else {
+			throw std::runtime_error("Reserved FLAC block size");
+		}
+
+		if (sampleRateCode == 12) {
+			reader.ReadBits(8);
+		} else if (sampleRateCode == 13 || sampleRateCode == 14) {
+			reader.ReadBits(16);
+		}
+
+		static const int sampleSizes[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+		const int bitsPerSample = sampleSizeCode == 0 ? (int)info.bitsPerSample : sampleSizes[sampleSizeCode];
+		if (bitsPerSample == 0) {
+			throw std::runtime_error("Reserved FLAC sample size");
+		}
+
+		uint32_t channelCount;
+		ChannelAssignment assignment = ChannelAssignment::INDEPENDENT;
+		if (channelCode < 8) {
+			channelCount = channelCode + 1;
+		} else if (channelCode <= 10) {
+			channelCount = 2;
+			assignment = channelCode == 8 ? ChannelAssignment::LEFT_SIDE : channelCode == 9 ? ChannelAssignment::SIDE_RIGHT : ChannelAssignment::MID_SIDE;
+		} else {
+			throw std::runtime_error("Reserved FLAC channel assignment");
+		}
+		if (channelCount != info.channelCount) {
+			throw std::runtime_error("FLAC frame channel count differs from stream");
+		}
+
+		// CRC-8 of the header
+		reader.ReadBits(8);
+
+		channelSamples.resize((size_t)blockSize * channelCount);
+		residual.resize(blockSize);
+		for (uint32_t channel = 0; channel < channelCount; channel++) {
+			// The side channel carries one extra bit
+			const bool isSide = (assignment == ChannelAssignment::LEFT_SIDE && channel == 1) ||
+				(assignment == ChannelAssignment::SIDE_RIGHT && channel == 0) ||
+				(assignment == ChannelAssignment::MID_SIDE && channel == 1);
+			ReadSubframe(reader, blockSize, bitsPerSample + (isSide ? 1 : 0), channelSamples.data() + (size_t)channel * blockSize, residual);
+		}
+		reader.AlignToByte();
+
+		// CRC-16 of the frame
+		reader.ReadBits(16);
+
+		int64_t* left = channelSamples.data();
+		int64_t* right = channelSamples.data() + blockSize;
+		for (uint32_t i = 0; i < blockSize && channelCount == 2; i++) {
+			switch (assignment) {
+			case ChannelAssignment::LEFT_SIDE:
+				right[i] = left[i] - right[i];
+				break;
+			case ChannelAssignment::SIDE_RIGHT:
+				left[i] = left[i] + right[i];
+				break;
+			case ChannelAssignment::MID_SIDE: {
+				const int64_t side = right[i];
+				const int64_t mid = (left[i] << 1) | (side & 1);
+				left[i] = (mid + side) >> 1;
+				right[i] = (mid - side) >> 1;
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		const double scale = 1.0 / (double)(1ull << (bitsPerSample - 1));
+		const size_t outputStart = output.size();
+		output.resize(outputStart + (size_t)blockSize * channelCount);
+		for (uint32_t i = 0; i < blockSize; i++) {
+			for (uint32_t channel = 0; channel < channelCount; channel++) {
+				output[outputStart + (size_t)i * channelCount + channel] = (float)((double)channelSamples[(size_t)channel * blockSize + i] * scale);
+			}
+		}
+		return true;
+	}
+}
+
+audio::DecodedAudio audio::DecodeFlac(const byte* data, size_t size)
+{
+	if (size < 4 || memcmp(data, "fLaC", 4) != 0) {
+		throw std::runtime_error("Not a FLAC file");
+	}
+	StreamingDecoder decoder(data, size);
+	DecodedAudio decoded = { decoder.GetSampleRate(), decoder.GetChannelCount(), {} };
+	decoded.samples.reserve((size_t)decoder.GetFrameCount() * decoder.GetChannelCount());
+	while (decoder.ReadBlock(decoded.samples)) {
+	}
+	return decoded;
+}
+
+// Metadata blocks; only STREAMINFO matters here
+void audio::StreamingDecoder::OpenFlac()
+{
+	size_t offset = 4;
+	bool isLastBlock = false;
+	while (!isLastBlock) {
+		if (offset + 4 > m_size) {
+			throw std::runtime_error("FLAC metadata is truncated");
+		}
+		isLastBlock = (m_data[offset] & 0x80) != 0;
+		const uint32_t blockType = m_data[offset] & 0x7f;
+		const size_t blockLength = ((size_t)m_data[offset + 1] << 16) | ((size_t)m_data[offset + 2] << 8) | m_data[offset + 3];
+		offset += 4;
+		if (offset + blockLength > m_size) {
+			throw std::runtime_error("FLAC metadata is truncated");
+		}
+		if (blockType == 0 && blockLength >= 34) {
+			BitReader reader(m_data + offset + 10, 8);
+			m_sampleRate = reader.ReadBits(20);
+			m_channelCount = reader.ReadBits(3) + 1;
+			m_bitsPerSample = reader.ReadBits(5) + 1;
+			m_frameCount = ((uint64_t)reader.ReadBits(4) << 32) | reader.ReadBits(32);
+		}
+		offset += blockLength;
+	}
+	if (m_sampleRate == 0) {
+		throw std::runtime_error("FLAC stream has no STREAMINFO");
+	}
+	m_offset = offset;
+}
+
+// Frames past the total STREAMINFO gives, if it gives one, are dropped
+bool audio::StreamingDecoder::ReadFlacBlock(std::vector<float>& samples)
+{
+	if (m_frameCount != 0 && m_framesRead >= m_frameCount) {
+		return false;
+	}
+	const StreamInfo info = { m_sampleRate, m_channelCount, m_bitsPerSample, m_frameCount };
+	BitReader reader(m_data + m_offset, m_size - m_offset);
+	const size_t outputStart = samples.size();
+	if (!ReadFrame(reader, info, m_channelSamples, m_residual, samples)) {
+		return false;
+	}
+	m_offset += reader.GetBytePosition();
+	uint64_t frameCount = (samples.size() - outputStart) / m_channelCount;
+	if (m_frameCount != 0 && m_framesRead + frameCount > m_frameCount) {
+		frameCount = m_frameCount - m_framesRead;
+		samples.resize(outputStart + (size_t)frameCount * m_channelCount);
+	}
+	m_framesRead += frameCount;
+	return true;
+}
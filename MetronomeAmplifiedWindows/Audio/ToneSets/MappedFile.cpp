@@ -0,0 +1,119 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+audio::MappedFile::MappedFile() :
+	m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+{
+}
+
+bool audio::MappedFile::Open(const std::string& filePath)
+{
+	Close();
+	const std::wstring widePath(winrt::to_hstring(filePath));
+	m_file = CreateFile2(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	m_mapping = CreateFileMappingFromApp(m_file, nullptr, PAGE_READONLY, 0, nullptr);
+	if (m_mapping == nullptr) {
+		Close();
+		return false;
+	}
+	m_data = (const byte*)MapViewOfFileFromApp(m_mapping, FILE_MAP_READ, 0, 0);
+	if (m_data == nullptr) {
+		Close();
+		return false;
+	}
+	m_size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void audio::MappedFile::Close()
+{
+	if (m_data != nullptr) {
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+	if (m_mapping != nullptr) {
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+}
+
+#else
+
+audio::MappedFile::MappedFile() :
+	m_data(nullptr), m_size(0), m_file(-1)
+{
+}
+
+bool audio::MappedFile::Open(const std::string& filePath)
+{
+	Close();
+	m_file = open(filePath.c_str(), O_RDONLY);
+	if (m_file < 0) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(m_file, &status) != 0 || status.st_size == 0) {
+		Close();
+		return false;
+	}
+	void* data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, m_file, 0);
+	if (data == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	m_data = (const byte*)data;
+	m_size = (size_t)status.st_size;
+	return true;
+}
+
+void audio::MappedFile::Close()
+{
+	if (m_data != nullptr) {
+		munmap((void*)m_data, m_size);
+		m_data = nullptr;
+	}
+	if (m_file >= 0) {
+		close(m_file);
+		m_file = -1;
+	}
+	m_size = 0;
+}
+
+#endif
+
+audio::MappedFile::~MappedFile()
+{
+	Close();
+}
+
+void audio::MappedFile::Swap(MappedFile& other)
+{
+	std::swap(m_data, other.m_data);
+	std::swap(m_size, other.m_size);
+	std::swap(m_file, other.m_file);
+#ifdef _WIN32
+	std::swap(m_mapping, other.m_mapping);
+#endif
+}
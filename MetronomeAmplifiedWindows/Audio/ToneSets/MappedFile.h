@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+namespace audio {
+
+	// Read-only memory mapping of a whole file. Pages are loaded by the OS on first touch, so opening even a
+	// large file is cheap, and the mapping is shared with any other process reading the same file.
+	class MappedFile {
+	public:
+		MappedFile();
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// Returns false if the file does not exist or cannot be mapped
+		bool Open(const std::string& filePath);
+		void Close();
+		void Swap(MappedFile& other);
+
+		inline const byte* GetData() const { return m_data; }
+		inline size_t GetSize() const { return m_size; }
+		inline bool IsOpen() const { return m_data != nullptr; }
+
+	private:
+		const byte* m_data;
+		size_t m_size;
+#ifdef _WIN32
+		HANDLE m_file;
+		HANDLE m_mapping;
+#else
+		int m_file;
+#endif
+	};
+}
@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "PolyphaseResampler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESAMPLER_USE_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RESAMPLER_USE_NEON
+#endif
+
+namespace {
+
+	const double Pi = 3.14159265358979323846;
+
+	// Kaiser window shape parameter giving about 80dB of stop-band attenuation
+	const double KaiserBeta = 7.857;
+
+	// Zeroth-order modified Bessel function of the first kind, by its power series
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 50; k++) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12) {
+				break;
+			}
+		}
+		return sum;
+	}
+
+	uint32_t GreatestCommonDivisor(uint32_t a, uint32_t b)
+	{
+		while (b != 0) {
+			const uint32_t remainder = a % b;
+			a = b;
+			b = remainder;
+		}
+		return a;
+	}
+
+	// Length is a multiple of four
+	float DotProduct(const float* a, const float* b, uint32_t length)
+	{
+#if defined(RESAMPLER_USE_SSE)
+		__m128 sum = _mm_setzero_ps();
+		for (uint32_t i = 0; i < length; i += 4) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		}
+		__m128 shuffled = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1));
+		sum = _mm_add_ps(sum, shuffled);
+		shuffled = _mm_movehl_ps(shuffled, sum);
+		sum = _mm_add_ss(sum, shuffled);
+		return _mm_cvtss_f32(sum);
+#elif defined(RESAMPLER_USE_NEON)
+		float32x4_t sum = vdupq_n_f32(0.0f);
+		for (uint32_t i = 0; i < length; i += 4) {
+			sum = vmlaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+		}
+		const float32x2_t pairs = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+		return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+#else
+		float sum = 0.0f;
+		for (uint32_t i = 0; i < length; i++) {
+			sum += a[i] * b[i];
+		}
+		return sum;
+#endif
+	}
+}
+
+audio::PolyphaseResampler::PolyphaseResampler(uint32_t inputRate, uint32_t outputRate, uint32_t tapsPerPhase) :
+	m_interpolation(0),
+	m_decimation(0),
+	m_tapsPerPhase(0),
+	m_delay(0),
+	m_phaseFilters()
+{
+	const uint32_t divisor = GreatestCommonDivisor(inputRate, outputRate);
+	m_interpolation = outputRate / divisor;
+	m_decimation = inputRate / divisor;
+	if (m_interpolation > MaxPhases) {
+		throw std::invalid_argument("Resampling ratio needs too many filter phases");
+	}
+
+	// When decimating, the cutoff drops below the input Nyquist frequency; widen the filter to keep the same
+	// transition band relative to it
+	const double ratio = (double)m_decimation / (double)m_interpolation;
+	m_tapsPerPhase = (uint32_t)ceil((double)tapsPerPhase * max(1.0, ratio));
+	m_tapsPerPhase = (m_tapsPerPhase + 3) & ~3u;
+
+	// Cutoff in cycles per sample at the interpolated rate, just under the lower of the two Nyquist frequencies
+	const double cutoff = 0.5 * 0.92 / (double)max(m_interpolation, m_decimation);
+	const uint64_t prototypeLength = (uint64_t)m_tapsPerPhase * m_interpolation;
+	// An integer centre keeps the delay compensation exact; for even lengths the last tap is simply zero
+	m_delay = (prototypeLength - 1) / 2;
+	const double centre = (double)m_delay;
+
+	m_phaseFilters.resize(prototypeLength);
+	const double windowNormaliser = 1.0 / BesselI0(KaiserBeta);
+	for (uint64_t n = 0; n < prototypeLength; n++) {
+		const double x = (double)n - centre;
+		const double sinc = fabs(x) < 1e-9 ? 1.0 : sin(2.0 * Pi * cutoff * x) / (Pi * x * 2.0 * cutoff);
+		const double windowPosition = x / (double)(m_delay + 1);
+		const double window = BesselI0(KaiserBeta * sqrt(max(0.0, 1.0 - windowPosition * windowPosition))) * windowNormaliser;
+		const double coefficient = 2.0 * cutoff * sinc * window * (double)m_interpolation;
+
+		// Prototype tap n belongs to phase n % L as its (n / L)th tap; store it reversed within the phase
+		const uint64_t phase = n % m_interpolation;
+		const uint64_t tap = n / m_interpolation;
+		m_phaseFilters[phase * m_tapsPerPhase + (m_tapsPerPhase - 1 - tap)] = (float)coefficient;
+	}
+}
+
+size_t audio::PolyphaseResampler::GetOutputLength(size_t inputLength) const
+{
+	return (size_t)(((uint64_t)inputLength * m_interpolation + m_decimation - 1) / m_decimation);
+}
+
+std::vector<float> audio::PolyphaseResampler::Process(const float* input, size_t inputLength) const
+{
+	// Zero padding on both sides lets every output sample use the full filter without bounds checks
+	const size_t padding = m_tapsPerPhase;
+	std::vector<float> padded(inputLength + 2 * padding + m_tapsPerPhase, 0.0f);
+	std::copy(input, input + inputLength, padded.begin() + padding);
+
+	const size_t outputLength = GetOutputLength(inputLength);
+	std::vector<float> output(outputLength);
+	for (size_t m = 0; m < outputLength; m++) {
+		// Position in the interpolated signal, shifted by the filter's delay; y[m] = sum over k of h[phase + kL] * x[base - k]
+		const uint64_t position = (uint64_t)m * m_decimation + m_delay;
+		const uint64_t base = position / m_interpolation;
+		const uint32_t phase = (uint32_t)(position % m_interpolation);
+		const float* window = padded.data() + padding + base - (m_tapsPerPhase - 1);
+		output[m] = DotProduct(m_phaseFilters.data() + (size_t)phase * m_tapsPerPhase, window, m_tapsPerPhase);
+	}
+	return output;
+}
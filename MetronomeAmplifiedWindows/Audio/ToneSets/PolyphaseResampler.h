@@ -0,0 +1,33 @@
+#pragma once
+
+namespace audio {
+
+	// Band-limited sample rate converter for a fixed rational ratio. A Kaiser-windowed sinc low-pass filter is
+	// designed once and split into one short filter per output phase, so each output sample costs a single
+	// dot product over contiguous input, done four lanes at a time with SSE or NEON where available.
+	class PolyphaseResampler {
+	public:
+		static const uint32_t MaxPhases = 4096;
+
+		// Throws std::invalid_argument if the reduced ratio needs more than MaxPhases phases
+		PolyphaseResampler(uint32_t inputRate, uint32_t outputRate, uint32_t tapsPerPhase = 32);
+
+		// Resamples a whole mono signal, compensating for the filter delay so output sample 0 lines up with input
+		// sample 0
+		std::vector<float> Process(const float* input, size_t inputLength) const;
+		size_t GetOutputLength(size_t inputLength) const;
+
+		inline uint32_t GetInterpolation() const { return m_interpolation; }
+		inline uint32_t GetDecimation() const { return m_decimation; }
+		inline uint32_t GetTapsPerPhase() const { return m_tapsPerPhase; }
+
+	private:
+		uint32_t m_interpolation;
+		uint32_t m_decimation;
+		uint32_t m_tapsPerPhase;
+		uint64_t m_delay;
+
+		// Phase p's taps are stored reversed, m_tapsPerPhase apart, so they line up with ascending input
+		std::vector<float> m_phaseFilters;
+	};
+}
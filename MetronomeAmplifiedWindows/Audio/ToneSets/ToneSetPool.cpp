@@ -0,0 +1,280 @@
+#include "pch.h"
+#include "ToneSetPool.h"
+#include "AudioDecoder.h"
+#include "PolyphaseResampler.h"
+
+#include <fstream>
+
+namespace {
+
+	// Cache file layout: header, entry table, then every click's data starting 64-byte aligned, in 32-bit words:
+	// samples as floats, or the blocks of compressed clicks, which are a whole number of words each. Synthesised
+	// clicks keep their patch in the entry and have no data. Fields are written in the machine's own byte order;
+	// a file from another machine fails the magic check.
+	const uint32_t CacheMagic = 0x5354414d;
+	const size_t CacheNameLength = 48;
+	const size_t CacheDataAlignment = 64;
+
+	struct CacheHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t sampleRate;
+		uint32_t toneSetCount;
+		uint64_t sourceFingerprint;
+		uint64_t wordCount;
+	};
+
+	// Offsets are in words and lengths in samples
+	struct CacheEntry {
+		char name[CacheNameLength];
+		uint64_t accentOffset;
+		uint64_t normalOffset;
+		uint32_t accentLength;
+		uint32_t normalLength;
+		audio::ClickPatch accentPatch;
+		audio::ClickPatch normalPatch;
+		float accentScale;
+		float normalScale;
+
+		// Bit 0 set if the accent is synthesised or compressed, bit 1 the normal click
+		uint32_t synthesisedClicks;
+		uint32_t compressedClicks;
+	};
+
+	static_assert(audio::AdpcmClip::BlockBytes % sizeof(float) == 0, "Compressed blocks must be whole words");
+
+	// Words of data a click keeps in the cache file
+	uint64_t StoredWords(uint32_t length, bool isSynthesised, bool isCompressed)
+	{
+		if (isSynthesised) {
+			return 0;
+		}
+		if (isCompressed) {
+			const uint64_t blockCount = (length + audio::AdpcmClip::BlockFrames - 1) / audio::AdpcmClip::BlockFrames;
+			return blockCount * audio::AdpcmClip::BlockBytes / sizeof(float);
+		}
+		return length;
+	}
+
+	uint64_t StoredWords(const audio::SampleView& click)
+	{
+		return StoredWords(click.length, click.synth != nullptr, click.compressed != nullptr);
+	}
+
+	size_t DataOffset(size_t toneSetCount) {
+		const size_t tableEnd = sizeof(CacheHeader) + toneSetCount * sizeof(CacheEntry);
+		return (tableEnd + CacheDataAlignment - 1) & ~(CacheDataAlignment - 1);
+	}
+}
+
+audio::ToneSetPool::ToneSetPool(uint32_t deviceSampleRate) :
+	m_deviceSampleRate(deviceSampleRate),
+	m_toneSets(),
+	m_decodedBlocks(),
+	m_decodedSampleCount(0),
+	m_synths(),
+	m_clips(),
+	m_isCompressionEnabled(false),
+	m_cacheFile()
+{
+}
+
+void audio::ToneSetPool::SetCompressionEnabled(bool isEnabled)
+{
+	m_isCompressionEnabled = isEnabled;
+}
+
+size_t audio::ToneSetPool::AddToneSet(const std::string& name, const std::vector<byte>& accentFile, const std::vector<byte>& normalFile)
+{
+	const std::vector<float> accent = DecodeClick(accentFile);
+	const std::vector<float> normal = DecodeClick(normalFile);
+
+	if (m_isCompressionEnabled) {
+		std::unique_ptr<AdpcmClip> accentClip(new AdpcmClip(accent.data(), (uint32_t)accent.size()));
+		std::unique_ptr<AdpcmClip> normalClip(new AdpcmClip(normal.data(), (uint32_t)normal.size()));
+		Entry entry = { name, {
+			SampleView::Compressed(*accentClip),
+			SampleView::Compressed(*normalClip)
+		} };
+		m_clips.push_back(std::move(accentClip));
+		m_clips.push_back(std::move(normalClip));
+		m_toneSets.push_back(entry);
+		return m_toneSets.size() - 1;
+	}
+
+	std::unique_ptr<float[]> block(new float[accent.size() + normal.size()]);
+	std::copy(accent.begin(), accent.end(), block.get());
+	std::copy(normal.begin(), normal.end(), block.get() + accent.size());
+
+	Entry entry = { name, {
+		{ block.get(), (uint32_t)accent.size() },
+		{ block.get() + accent.size(), (uint32_t)normal.size() }
+	} };
+	m_decodedBlocks.push_back(std::move(block));
+	m_decodedSampleCount += accent.size() + normal.size();
+	m_toneSets.push_back(entry);
+	return m_toneSets.size() - 1;
+}
+
+size_t audio::ToneSetPool::AddSynthesisedToneSet(const std::string& name, const ClickPatch& accent, const ClickPatch& normal)
+{
+	std::unique_ptr<ClickSynth> accentSynth(new ClickSynth(accent, m_deviceSampleRate));
+	std::unique_ptr<ClickSynth> normalSynth(new ClickSynth(normal, m_deviceSampleRate));
+
+	Entry entry = { name, {
+		SampleView::Synthesised(*accentSynth),
+		SampleView::Synthesised(*normalSynth)
+	} };
+	m_synths.push_back(std::move(accentSynth));
+	m_synths.push_back(std::move(normalSynth));
+	m_toneSets.push_back(entry);
+	return m_toneSets.size() - 1;
+}
+
+std::vector<float> audio::ToneSetPool::DecodeClick(const std::vector<byte>& fileData)
+{
+	const DecodedAudio decoded = DecodeAudioFile(fileData);
+	const std::vector<float> mono = decoded.MixToMono();
+	if (decoded.sampleRate == m_deviceSampleRate) {
+		return mono;
+	}
+	const PolyphaseResampler resampler(decoded.sampleRate, m_deviceSampleRate);
+	return resampler.Process(mono.data(), mono.size());
+}
+
+bool audio::ToneSetPool::LoadCache(const std::string& filePath, uint64_t sourceFingerprint)
+{
+	MappedFile file;
+	if (!file.Open(filePath) || file.GetSize() < sizeof(CacheHeader)) {
+		return false;
+	}
+	const CacheHeader* header = (const CacheHeader*)file.GetData();
+	if (header->magic != CacheMagic || header->version != CacheFileVersion ||
+		header->sampleRate != m_deviceSampleRate || header->sourceFingerprint != sourceFingerprint) {
+		return false;
+	}
+	const size_t dataOffset = DataOffset(header->toneSetCount);
+	if (file.GetSize() < dataOffset + header->wordCount * sizeof(float)) {
+		return false;
+	}
+
+	const CacheEntry* entries = (const CacheEntry*)(file.GetData() + sizeof(CacheHeader));
+	const float* words = (const float*)(file.GetData() + dataOffset);
+	std::vector<Entry> toneSets;
+	std::vector<std::unique_ptr<ClickSynth>> synths;
+	std::vector<std::unique_ptr<AdpcmClip>> clips;
+	for (uint32_t i = 0; i < header->toneSetCount; i++) {
+		const CacheEntry& cacheEntry = entries[i];
+		const uint64_t offsets[2] = { cacheEntry.accentOffset, cacheEntry.normalOffset };
+		const uint32_t lengths[2] = { cacheEntry.accentLength, cacheEntry.normalLength };
+		for (int click = 0; click < 2; click++) {
+			const bool isSynthesised = (cacheEntry.synthesisedClicks & (1u << click)) != 0;
+			const bool isCompressed = (cacheEntry.compressedClicks & (1u << click)) != 0;
+			const uint64_t storedWords = StoredWords(lengths[click], isSynthesised, isCompressed);
+			if (offsets[click] > header->wordCount || storedWords > header->wordCount - offsets[click]) {
+				return false;
+			}
+		}
+		const std::string name(cacheEntry.name, strnlen(cacheEntry.name, CacheNameLength));
+		Entry entry = { name, {
+			{ words + cacheEntry.accentOffset, cacheEntry.accentLength },
+			{ words + cacheEntry.normalOffset, cacheEntry.normalLength }
+		} };
+		const ClickPatch* patches[2] = { &cacheEntry.accentPatch, &cacheEntry.normalPatch };
+		const float scales[2] = { cacheEntry.accentScale, cacheEntry.normalScale };
+		SampleView* clicks[2] = { &entry.view.accent, &entry.view.normal };
+		for (int click = 0; click < 2; click++) {
+			if ((cacheEntry.synthesisedClicks & (1u << click)) != 0) {
+				try {
+					synths.emplace_back(new ClickSynth(*patches[click], m_deviceSampleRate));
+				}
+				catch (const std::invalid_argument&) {
+					return false;
+				}
+				*clicks[click] = SampleView::Synthesised(*synths.back());
+			} else if ((cacheEntry.compressedClicks & (1u << click)) != 0) {
+				clips.emplace_back(new AdpcmClip((const byte*)(words + offsets[click]), lengths[click], scales[click]));
+				*clicks[click] = SampleView::Compressed(*clips.back());
+			}
+		}
+		toneSets.push_back(entry);
+	}
+
+	m_toneSets = std::move(toneSets);
+	m_decodedBlocks.clear();
+	m_decodedSampleCount = 0;
+	m_synths = std::move(synths);
+	m_clips = std::move(clips);
+	m_cacheFile.Swap(file);
+	return true;
+}
+
+void audio::ToneSetPool::SaveCache(const std::string& filePath, uint64_t sourceFingerprint) const
+{
+	std::vector<CacheEntry> entries(m_toneSets.size());
+	uint64_t wordCount = 0;
+	for (size_t i = 0; i < m_toneSets.size(); i++) {
+		const Entry& toneSet = m_toneSets[i];
+		CacheEntry& cacheEntry = entries[i];
+		memset(&cacheEntry, 0, sizeof(CacheEntry));
+		memcpy(cacheEntry.name, toneSet.name.data(), min(toneSet.name.size(), CacheNameLength));
+		const SampleView* clicks[2] = { &toneSet.view.accent, &toneSet.view.normal };
+		uint64_t* offsets[2] = { &cacheEntry.accentOffset, &cacheEntry.normalOffset };
+		uint32_t* lengths[2] = { &cacheEntry.accentLength, &cacheEntry.normalLength };
+		ClickPatch* patches[2] = { &cacheEntry.accentPatch, &cacheEntry.normalPatch };
+		float* scales[2] = { &cacheEntry.accentScale, &cacheEntry.normalScale };
+		for (int click = 0; click < 2; click++) {
+			*offsets[click] = wordCount;
+			if (clicks[click]->synth != nullptr) {
+				*patches[click] = clicks[click]->synth->GetPatch();
+				cacheEntry.synthesisedClicks |= 1u << click;
+			} else {
+				*lengths[click] = clicks[click]->length;
+				if (clicks[click]->compressed != nullptr) {
+					*scales[click] = clicks[click]->compressed->GetScale();
+					cacheEntry.compressedClicks |= 1u << click;
+				}
+			}
+			wordCount += StoredWords(*clicks[click]);
+		}
+	}
+
+	const CacheHeader header = { CacheMagic, CacheFileVersion, m_deviceSampleRate, (uint32_t)m_toneSets.size(), sourceFingerprint, wordCount };
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		throw std::runtime_error("Cannot open tone set cache for writing");
+	}
+	file.write((const char*)&header, sizeof(CacheHeader));
+	file.write((const char*)entries.data(), entries.size() * sizeof(CacheEntry));
+	const size_t paddingLength = DataOffset(m_toneSets.size()) - sizeof(CacheHeader) - entries.size() * sizeof(CacheEntry);
+	const char padding[CacheDataAlignment] = { 0 };
+	file.write(padding, paddingLength);
+	for (const Entry& toneSet : m_toneSets) {
+		for (const SampleView& click : { toneSet.view.accent, toneSet.view.normal }) {
+			const char* data = click.compressed != nullptr ? (const char*)click.compressed->GetBlocks() : (const char*)click.samples;
+			file.write(data, StoredWords(click) * sizeof(float));
+		}
+	}
+	if (!file) {
+		throw std::runtime_error("Failed writing tone set cache");
+	}
+}
+
+uint64_t audio::ToneSetPool::Fingerprint(const std::vector<byte>& fileData, uint64_t fingerprint)
+{
+	for (byte value : fileData) {
+		fingerprint = (fingerprint ^ value) * 0x100000001b3ull;
+	}
+	return fingerprint;
+}
+
+// Heap memory held by decoded, compressed and synthesised tone sets; mapped cache pages are counted by the OS as
+// file cache instead
+size_t audio::ToneSetPool::GetMemoryBytes() const
+{
+	size_t memoryBytes = m_decodedSampleCount * sizeof(float) + m_synths.size() * sizeof(ClickSynth);
+	for (const std::unique_ptr<AdpcmClip>& clip : m_clips) {
+		memoryBytes += sizeof(AdpcmClip) + clip->GetMemoryBytes();
+	}
+	return memoryBytes;
+}
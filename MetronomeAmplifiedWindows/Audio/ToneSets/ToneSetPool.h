@@ -0,0 +1,64 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "ToneSetView.h"
+
+namespace audio {
+
+	// Owns the clicks of every loaded tone set, decoded, mixed to mono and resampled to the device rate, and
+	// optionally compressed, or synthesised from patches as they play. The samples and patches of all tone sets
+	// can be saved to one cache file and memory-mapped on the next launch, skipping decoding and resampling
+	// entirely. Views handed out stay valid and unchanged for the life of the
+	// pool, so the audio engine can keep playing from an old tone set while switching to a new one.
+	class ToneSetPool {
+	public:
+		static const uint32_t CacheFileVersion = 3;
+		static const uint64_t EmptyFingerprint = 0xcbf29ce484222325ull;
+
+		explicit ToneSetPool(uint32_t deviceSampleRate);
+
+		// Tone sets added after this hold their samples as IMA-ADPCM, in about an eighth of the memory, and are
+		// decoded as they play. Off by default.
+		void SetCompressionEnabled(bool isEnabled);
+
+		// Decodes a pair of WAV or FLAC files into a new tone set, returning its index
+		size_t AddToneSet(const std::string& name, const std::vector<byte>& accentFile, const std::vector<byte>& normalFile);
+
+		// Adds a tone set whose clicks are synthesised, returning its index. Holds no samples, so costs a few
+		// hundred bytes and nothing to decode. Throws std::invalid_argument for a patch ClickSynth rejects.
+		size_t AddSynthesisedToneSet(const std::string& name, const ClickPatch& accent, const ClickPatch& normal);
+
+		// Replaces the pool's contents with a cache file written for the same device rate and source files.
+		// Returns false, leaving the pool unchanged, if the file is missing or stale. Must be called before any
+		// views are handed out.
+		bool LoadCache(const std::string& filePath, uint64_t sourceFingerprint);
+		void SaveCache(const std::string& filePath, uint64_t sourceFingerprint) const;
+
+		// FNV-1a hash of source file contents, chained through 'fingerprint' to cover several files
+		static uint64_t Fingerprint(const std::vector<byte>& fileData, uint64_t fingerprint = EmptyFingerprint);
+
+		inline size_t GetToneSetCount() const { return m_toneSets.size(); }
+		inline const std::string& GetToneSetName(size_t index) const { return m_toneSets[index].name; }
+		inline ToneSetView GetToneSet(size_t index) const { return m_toneSets[index].view; }
+		size_t GetMemoryBytes() const;
+
+	private:
+		struct Entry {
+			std::string name;
+			ToneSetView view;
+		};
+
+		uint32_t m_deviceSampleRate;
+		std::vector<Entry> m_toneSets;
+
+		// Decoded samples live in one block per tone set, so adding another never moves existing ones
+		std::vector<std::unique_ptr<float[]>> m_decodedBlocks;
+		size_t m_decodedSampleCount;
+		std::vector<std::unique_ptr<ClickSynth>> m_synths;
+		std::vector<std::unique_ptr<AdpcmClip>> m_clips;
+		bool m_isCompressionEnabled;
+		MappedFile m_cacheFile;
+
+		std::vector<float> DecodeClick(const std::vector<byte>& fileData);
+	};
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "AdpcmClip.h"
+#include "ClickSynth.h"
+
+namespace audio {
+
+	// Borrowed pointer to a mono sample at the device rate, or to a synth that renders one or a compressed clip
+	// that decodes one as it plays, in which case samples is null. The owner keeps each alive and unchanged.
+	// Sampled clicks are written { samples, length }; the others come from the named constructors.
+	struct SampleView {
+		const float* samples = nullptr;
+		uint32_t length = 0;
+		const ClickSynth* synth = nullptr;
+		const AdpcmClip* compressed = nullptr;
+
+		static inline SampleView Synthesised(const ClickSynth& synth) {
+			return { nullptr, synth.GetLength(), &synth, nullptr };
+		}
+		static inline SampleView Compressed(const AdpcmClip& clip) {
+			return { nullptr, clip.GetLength(), nullptr, &clip };
+		}
+
+		inline bool operator==(const SampleView& other) const {
+			return samples == other.samples && length == other.length && synth == other.synth && compressed == other.compressed;
+		}
+	};
+
+	// The clicks the audio engine plays for one tone set
+	struct ToneSetView {
+		SampleView accent;
+		SampleView normal;
+
+		inline bool operator==(const ToneSetView& other) const {
+			return accent == other.accent && normal == other.normal;
+		}
+		inline bool operator!=(const ToneSetView& other) const {
+			return !(*this == other);
+		}
+	};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+namespace audio {
+
+	// Hands the latest value from one writer thread to one reader thread, both wait-free. The writer fills a back
+	// buffer and swaps it with the middle one; the reader swaps the middle buffer for its front one whenever a new
+	// value is waiting there. Each side only ever touches the buffer it holds, so every value read is one the writer
+	// stored whole, and values are never seen out of order, though the reader skips any it was too slow for.
+	template<typename T>
+	class TripleBuffer {
+	private:
+		// The middle buffer's index, flagged while it holds a value the reader has not taken
+		static const uint8_t IndexMask = 3;
+		static const uint8_t NewFlag = 4;
+
+		std::array<T, 3> m_buffers;
+		alignas(64) std::atomic<uint8_t> m_middle;
+		alignas(64) uint8_t m_back;
+		alignas(64) uint8_t m_front;
+
+	public:
+		TripleBuffer() : m_buffers(), m_middle(1), m_back(0), m_front(2) {}
+
+		// Writer thread only
+		void Store(const T& value) {
+			m_buffers[m_back] = value;
+			m_back = m_middle.exchange(m_back | NewFlag, std::memory_order_acq_rel) & IndexMask;
+		}
+
+		// Reader thread only. The value stays put until the reader's next call.
+		const T& Read() {
+			if ((m_middle.load(std::memory_order_relaxed) & NewFlag) != 0) {
+				m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & IndexMask;
+			}
+			return m_buffers[m_front];
+		}
+
+		// Reader thread only. Whether Read would return a newer value than it last did.
+		bool HasNewValue() const {
+			return (m_middle.load(std::memory_order_relaxed) & NewFlag) != 0;
+		}
+	};
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "PlaybackSnapshot.h"
+#include "../Common/ClockSource.h"
+
+#include <array>
+
+namespace audio {
+
+	// Offsets between beat flashes being shown and their clicks being heard, in seconds, positive when the flash
+	// is late. The mean and spread cover every offset since the last reset; percentiles of the offsets' sizes
+	// cover the most recent WindowSize. Recording never allocates.
+	class SyncOffsetStatistics {
+	public:
+		static const size_t WindowSize = 256;
+
+		struct Summary {
+			uint64_t count;
+			double mean;
+			double standardDeviation;
+			double minimum;
+			double maximum;
+			double p50Magnitude;
+			double p95Magnitude;
+		};
+
+		SyncOffsetStatistics() :
+			m_recent(),
+			m_next(0),
+			m_recentCount(0),
+			m_count(0),
+			m_mean(0.0),
+			m_sumSquares(0.0),
+			m_minimum(0.0),
+			m_maximum(0.0)
+		{
+		}
+
+		void Record(double offsetSeconds) {
+			m_recent[m_next] = offsetSeconds;
+			m_next = (m_next + 1) % WindowSize;
+			if (m_recentCount < WindowSize) {
+				m_recentCount++;
+			}
+
+			// Welford's update, which stays accurate over long sessions
+			m_count++;
+			const double delta = offsetSeconds - m_mean;
+			m_mean += delta / (double)m_count;
+			m_sumSquares += delta * (offsetSeconds - m_mean);
+			m_minimum = m_count == 1 ? offsetSeconds : min(m_minimum, offsetSeconds);
+			m_maximum = m_count == 1 ? offsetSeconds : max(m_maximum, offsetSeconds);
+		}
+
+		void Reset() {
+			m_next = 0;
+			m_recentCount = 0;
+			m_count = 0;
+			m_mean = 0.0;
+			m_sumSquares = 0.0;
+			m_minimum = 0.0;
+			m_maximum = 0.0;
+		}
+
+		// All zero if nothing has been recorded
+		Summary GetSummary() const {
+			Summary summary = { m_count, m_mean, m_count > 1 ? sqrt(m_sumSquares / (double)(m_count - 1)) : 0.0, m_minimum, m_maximum, 0.0, 0.0 };
+			if (m_recentCount == 0) {
+				return summary;
+			}
+			std::array<double, WindowSize> magnitudes;
+			for (size_t i = 0; i < m_recentCount; i++) {
+				magnitudes[i] = fabs(m_recent[i]);
+			}
+			auto end = magnitudes.begin() + m_recentCount;
+			summary.p50Magnitude = SelectRank(magnitudes.begin(), end, 50);
+			summary.p95Magnitude = SelectRank(magnitudes.begin(), end, 95);
+			return summary;
+		}
+
+	private:
+		std::array<double, WindowSize> m_recent;
+		size_t m_next;
+		size_t m_recentCount;
+		uint64_t m_count;
+		double m_mean;
+		double m_sumSquares;
+		double m_minimum;
+		double m_maximum;
+
+		template<typename TIterator>
+		static double SelectRank(TIterator begin, TIterator end, size_t percentile) {
+			const size_t count = (size_t)(end - begin);
+			const size_t rank = (percentile * count + 99) / 100;
+			auto nth = begin + (rank > 0 ? rank - 1 : 0);
+			std::nth_element(begin, nth, end);
+			return *nth;
+		}
+	};
+
+	// Times beat flashes by the audio engine's sample clock instead of frame times, which drift against the audio
+	// device. Once a frame, before the scene updates, it takes the engine's latest PlaybackSnapshot and maps
+	// playhead samples to host clock counts: the block's first sample is heard the output latency after the block
+	// was rendered. The mapping is eased towards each new block so that audio callback jitter does not show, and
+	// jumps straight to it after a seek, a pause or a dropout. Each click's flash starts on the frame whose
+	// display time is nearest to when the click is heard, and the offset between the two is recorded.
+	template<typename TClock>
+	class BasicVisualBeatSync {
+	public:
+		// Fraction of each new block's timing error taken into the mapping
+		static constexpr double Smoothing = 0.125;
+
+		// Errors beyond this many blocks are a jump in the playhead rather than jitter
+		static constexpr double SnapBlocks = 4.0;
+
+		explicit BasicVisualBeatSync(TClock clock = TClock()) :
+			m_clock(clock),
+			m_outputLatencyFrames(0),
+			m_deviceLatencySeconds(0.0),
+			m_displayLatencySeconds(1.0 / 60.0),
+			m_flashDecaySeconds(0.1),
+			m_hasMapping(false),
+			m_wasPlaying(false),
+			m_lastStreamFrame(0),
+			m_seekOnsetCount(0),
+			m_originSample(0),
+			m_originCounter(0.0),
+			m_presentSample(0.0),
+			m_nextOnset(0),
+			m_flashCount(0),
+			m_flashOnset(),
+			m_flashCounter(0.0),
+			m_flashIntensity(0.0f),
+			m_offsets()
+		{
+			m_frequency = m_clock.GetFrequency();
+			m_lastUpdateCounter = m_clock.GetCounter();
+		}
+
+		// Access the clock source, e.g. to hand to AudioEngine::SetHostClock or to advance a FakeClock.
+		TClock& GetClock()										{ return m_clock; }
+
+		// The sink's buffering, from BaseSink::GetOutputLatencyFrames.
+		void SetOutputLatencyFrames(uint32_t frames)			{ m_outputLatencyFrames = frames; }
+
+		// Further delay in the device, which the sink cannot see; comes from the user's calibration.
+		void SetDeviceLatencySeconds(double seconds)			{ m_deviceLatencySeconds = seconds; }
+
+		// Time from Update to the frame it prepares being shown, usually one refresh interval.
+		void SetDisplayLatencySeconds(double seconds)			{ m_displayLatencySeconds = seconds; }
+
+		// Time for a flash to fade to about a third of its starting brightness.
+		void SetFlashDecaySeconds(double seconds)				{ m_flashDecaySeconds = seconds; }
+
+		// Brightness of the beat flash in the frame being prepared, from the click's gain down to zero.
+		float GetFlashIntensity() const							{ return m_flashIntensity; }
+
+		// The click the current flash is for, and how many clicks have flashed. Meaningless until one has.
+		const OnsetRecord& GetFlashOnset() const				{ return m_flashOnset; }
+		uint64_t GetFlashCount() const							{ return m_flashCount; }
+
+		// Playhead position heard as the frame being prepared is shown.
+		double GetPresentSample() const							{ return m_presentSample; }
+
+		const SyncOffsetStatistics& GetOffsetStatistics() const	{ return m_offsets; }
+		void ResetOffsetStatistics()							{ m_offsets.Reset(); }
+
+		void Update(const PlaybackSnapshot& snapshot)
+		{
+			const uint64_t now = m_clock.GetCounter();
+			const double frameCounts = (double)min(now - m_lastUpdateCounter, m_frequency / 10);
+			m_lastUpdateCounter = now;
+			const double presentCounter = (double)now + m_displayLatencySeconds * m_frequency;
+
+			// Nothing has been rendered yet
+			if (snapshot.sampleRate == 0) {
+				return;
+			}
+			const double countsPerSample = (double)m_frequency / snapshot.sampleRate;
+			const double latencySeconds = (double)m_outputLatencyFrames / snapshot.sampleRate + m_deviceLatencySeconds;
+			const double heardCounter = (double)snapshot.hostCounter + latencySeconds * m_frequency;
+
+			const bool hasSeeked = snapshot.seekOnsetCount != m_seekOnsetCount;
+			if (snapshot.streamFrame != m_lastStreamFrame || !m_hasMapping) {
+				if (snapshot.isPlaying) {
+					const double expectedCounter = SampleToCounter(snapshot.playheadSample, countsPerSample);
+					const double error = heardCounter - expectedCounter;
+					const bool isJump = !m_hasMapping || !m_wasPlaying || hasSeeked ||
+						fabs(error) > SnapBlocks * snapshot.blockFrames * countsPerSample;
+					m_originCounter = isJump ? heardCounter : expectedCounter + Smoothing * error;
+					m_originSample = snapshot.playheadSample;
+					m_hasMapping = true;
+				}
+				m_wasPlaying = snapshot.isPlaying;
+				m_seekOnsetCount = snapshot.seekOnsetCount;
+				m_lastStreamFrame = snapshot.streamFrame;
+			}
+			m_presentSample = snapshot.isPlaying && m_hasMapping ?
+				max(0.0, (double)m_originSample + (presentCounter - m_originCounter) / countsPerSample) :
+				(double)snapshot.playheadSample;
+
+			// Skip clicks from before a seek, and any that have already left the snapshot's history. The click due
+			// next may be shown before it is rendered, since the output latency can be shorter than the display's.
+			if (!m_hasMapping || hasSeeked || m_nextOnset < snapshot.seekOnsetCount) {
+				m_nextOnset = m_hasMapping ? snapshot.seekOnsetCount : snapshot.onsetCount;
+			}
+			if (snapshot.onsetCount > m_nextOnset + PlaybackSnapshot::OnsetCapacity) {
+				m_nextOnset = snapshot.onsetCount - PlaybackSnapshot::OnsetCapacity;
+			}
+			const double lastCounter = presentCounter + 0.5 * frameCounts;
+			while (m_hasMapping && m_nextOnset <= snapshot.onsetCount) {
+				if (m_nextOnset == snapshot.onsetCount && !snapshot.hasNextOnset) {
+					break;
+				}
+				const OnsetRecord& onset = m_nextOnset < snapshot.onsetCount ? snapshot.GetOnset(m_nextOnset) : snapshot.nextOnset;
+				const double onsetCounter = SampleToCounter(onset.sample, countsPerSample);
+				if (onsetCounter > lastCounter) {
+					break;
+				}
+				m_flashOnset = onset;
+				m_flashCounter = onsetCounter;
+				m_flashCount++;
+				m_nextOnset++;
+
+				// Measured against this snapshot alone, so that the statistics show what smoothing hides
+				const double measuredCounter = heardCounter + (double)(int64_t)(onset.sample - snapshot.playheadSample) * countsPerSample;
+				m_offsets.Record((presentCounter - measuredCounter) / m_frequency);
+			}
+
+			m_flashIntensity = 0.0f;
+			if (m_flashCount > 0) {
+				const double age = max(0.0, presentCounter - m_flashCounter) / m_frequency;
+				const float intensity = m_flashOnset.gain * (float)exp(-age / m_flashDecaySeconds);
+				m_flashIntensity = intensity >= 1.0f / 256.0f ? intensity : 0.0f;
+			}
+		}
+
+	private:
+		TClock m_clock;
+		uint64_t m_frequency;
+		uint64_t m_lastUpdateCounter;
+		uint32_t m_outputLatencyFrames;
+		double m_deviceLatencySeconds;
+		double m_displayLatencySeconds;
+		double m_flashDecaySeconds;
+
+		// Host time at which the origin sample is heard, moving at the nominal sample rate
+		bool m_hasMapping;
+		bool m_wasPlaying;
+		uint64_t m_lastStreamFrame;
+		uint64_t m_seekOnsetCount;
+		uint64_t m_originSample;
+		double m_originCounter;
+		double m_presentSample;
+
+		uint64_t m_nextOnset;
+		uint64_t m_flashCount;
+		OnsetRecord m_flashOnset;
+		double m_flashCounter;
+		float m_flashIntensity;
+		SyncOffsetStatistics m_offsets;
+
+		double SampleToCounter(uint64_t sample, double countsPerSample) const {
+			return m_originCounter + (double)(int64_t)(sample - m_originSample) * countsPerSample;
+		}
+	};
+
+	typedef BasicVisualBeatSync<DX::DefaultClock> VisualBeatSync;
+}
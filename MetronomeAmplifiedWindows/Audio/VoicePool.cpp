@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "VoicePool.h"
+
+audio::VoicePool::VoicePool() :
+	m_voices(),
+	m_activeCount(0),
+	m_polyphonyLimit(Capacity),
+	m_nextStartOrder(0),
+	m_stolenCount(0)
+{
+}
+
+void audio::VoicePool::SetPolyphonyLimit(int limit)
+{
+	m_polyphonyLimit = max(1, min(Capacity, limit));
+}
+
+audio::Voice& audio::VoicePool::Start(const float* samples, const BarCacheVariant* cachedBar, uint32_t length, uint32_t position, float gain, float pan)
+{
+	if (m_activeCount >= m_polyphonyLimit) {
+		// Oldest click first; only steal a cached bar if nothing else is playing
+		int voiceIndex = 0;
+		for (int i = 1; i < m_activeCount; i++) {
+			const Voice& candidate = m_voices[i];
+			const Voice& oldest = m_voices[voiceIndex];
+			const bool isCandidateBar = candidate.cachedBar != nullptr;
+			const bool isOldestBar = oldest.cachedBar != nullptr;
+			if (isCandidateBar != isOldestBar ? !isCandidateBar : candidate.startOrder < oldest.startOrder) {
+				voiceIndex = i;
+			}
+		}
+		Remove(voiceIndex);
+		m_stolenCount++;
+	}
+
+	pan = max(-1.0f, min(1.0f, pan));
+	Voice& voice = m_voices[m_activeCount++];
+	voice.samples = samples;
+	voice.synth = nullptr;
+	voice.compressed = nullptr;
+	voice.cursor = { 0, 0, 0 };
+	voice.cachedBar = cachedBar;
+	voice.length = length;
+	voice.position = position;
+	voice.leftGain = gain * min(1.0f, 1.0f - pan);
+	voice.rightGain = gain * min(1.0f, 1.0f + pan);
+	voice.startOrder = m_nextStartOrder++;
+	return voice;
+}
+
+audio::Voice& audio::VoicePool::Start(const SampleView& click, uint32_t position, float gain, float pan)
+{
+	Voice& voice = Start(click.samples, nullptr, click.length, position, gain, pan);
+	voice.synth = click.synth;
+	voice.compressed = click.compressed;
+	return voice;
+}
+
+// Shifts the later voices down rather than moving the last into the gap, to keep them in start order
+void audio::VoicePool::Remove(int index)
+{
+	std::copy(m_voices + index + 1, m_voices + m_activeCount, m_voices + index);
+	m_activeCount--;
+}
+
+void audio::VoicePool::Clear()
+{
+	m_activeCount = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "BarCache.h"
+
+namespace audio {
+
+	// A sample being played into the output: a single click, rendered by synth or decoded from compressed as it
+	// plays when one of those is set, or a whole bar from the cache when cachedBar is set. Gains are per output
+	// side, derived from the voice's gain and pan when it starts.
+	struct Voice {
+		const float* samples;
+		const ClickSynth* synth;
+		const AdpcmClip* compressed;
+		AdpcmCursor cursor;
+		const BarCacheVariant* cachedBar;
+		uint32_t length;
+		uint32_t position;
+		float leftGain;
+		float rightGain;
+		uint64_t startOrder;
+	};
+
+	// Fixed-capacity set of voices, preallocated so that starting and stopping them never touches the heap.
+	// When the polyphony limit is reached, the oldest single click is stolen to make room, keeping cached bars
+	// where possible since they carry the beats still to come.
+	// Active voices are always kept in the order they were started, so each output sample sums the same voices
+	// in the same order whatever the block size, and a song rendered in pieces matches one rendered in a go.
+	class VoicePool {
+	public:
+		static const int Capacity = 64;
+
+		VoicePool();
+
+		// Clamped to [1, Capacity]; voices above a lowered limit play out but no new ones start until below it
+		void SetPolyphonyLimit(int limit);
+
+		// Pan runs from -1 (left) to 1 (right) using a balance law, so centred voices play at full gain on both
+		// sides and mono output ignores pan
+		Voice& Start(const float* samples, const BarCacheVariant* cachedBar, uint32_t length, uint32_t position, float gain, float pan);
+
+		// Starts a click from a tone set, whether sampled, synthesised or compressed
+		Voice& Start(const SampleView& click, uint32_t position, float gain, float pan);
+		void Remove(int index);
+		void Clear();
+
+		inline int GetActiveCount() const { return m_activeCount; }
+		inline Voice& Get(int index) { return m_voices[index]; }
+		inline int GetPolyphonyLimit() const { return m_polyphonyLimit; }
+		inline uint64_t GetStolenCount() const { return m_stolenCount; }
+
+	private:
+		Voice m_voices[Capacity];
+		int m_activeCount;
+		int m_polyphonyLimit;
+		uint64_t m_nextStartOrder;
+		uint64_t m_stolenCount;
+	};
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#if !defined(_WIN32)
+#include <time.h>
+#endif
+
+namespace DX
+{
+	// Clock sources used by StepTimer. Each provides the counter frequency in counts per second, and the
+	// current count of a monotonic counter.
+
+#if defined(_WIN32)
+	// Windows performance counter.
+	class QpcClock
+	{
+	public:
+		uint64_t GetFrequency() const
+		{
+			LARGE_INTEGER frequency;
+			if (!QueryPerformanceFrequency(&frequency))
+			{
+				throw winrt::hresult_error();
+			}
+			return static_cast<uint64_t>(frequency.QuadPart);
+		}
+
+		uint64_t GetCounter() const
+		{
+			LARGE_INTEGER counter;
+			if (!QueryPerformanceCounter(&counter))
+			{
+				throw winrt::hresult_error();
+			}
+			return static_cast<uint64_t>(counter.QuadPart);
+		}
+	};
+#else
+	// Linux raw monotonic clock, which is not slewed by NTP adjustments.
+	class MonotonicRawClock
+	{
+	public:
+		uint64_t GetFrequency() const
+		{
+			return 1000000000ULL;
+		}
+
+		uint64_t GetCounter() const
+		{
+			timespec time;
+			if (clock_gettime(CLOCK_MONOTONIC_RAW, &time) != 0)
+			{
+				throw std::runtime_error("clock_gettime failed");
+			}
+			return static_cast<uint64_t>(time.tv_sec) * 1000000000ULL + static_cast<uint64_t>(time.tv_nsec);
+		}
+	};
+#endif
+
+	// Deterministic clock that only moves when told to, for tests and replaying recorded frame timings.
+	class FakeClock
+	{
+	public:
+		explicit FakeClock(uint64_t frequency = 10000000) : m_frequency(frequency), m_counter(0) {}
+
+		uint64_t GetFrequency() const		{ return m_frequency; }
+		uint64_t GetCounter() const			{ return m_counter; }
+
+		void Advance(uint64_t counts)		{ m_counter += counts; }
+		void AdvanceSeconds(double seconds)	{ m_counter += static_cast<uint64_t>(seconds * m_frequency); }
+
+	private:
+		uint64_t m_frequency;
+		uint64_t m_counter;
+	};
+
+#if defined(_WIN32)
+	typedef QpcClock DefaultClock;
+#else
+	typedef MonotonicRawClock DefaultClock;
+#endif
+}
@@ -696,6 +696,14 @@ vbo::BaseVertexBuffer* DX::DeviceResources::GetVertexBuffer(vbo::ClassId vertexB
 	return m_vertexBufferCache.GetVertexBuffer(vertexBufferClass);
 }
 
+geometry::WidgetId DX::DeviceResources::WidgetAt(float xNormalised, float yNormalised, const std::vector<vbo::ClassId>& vertexBufferClasses) {
+	return m_vertexBufferCache.WidgetAt(xNormalised, yNormalised, vertexBufferClasses);
+}
+
+void DX::DeviceResources::RefreshRegionsOfInterest(vbo::ClassId vertexBufferClass) {
+	m_vertexBufferCache.RefreshRegionsOfInterest(vertexBufferClass);
+}
+
 void DX::DeviceResources::ClearVertexBufferCache() {
 	m_vertexBufferCache.Clear();
 }
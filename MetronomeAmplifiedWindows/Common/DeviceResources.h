@@ -77,6 +77,8 @@ namespace DX
 		vbo::BaseVertexBuffer* GetVertexBuffer(vbo::ClassId vertexBufferClass);
 		inline bool AreVertexBuffersFulfilled() { return m_vertexBufferCache.AreVertexBuffersFulfilled(); }
 		inline font::Font* GetOrkneyFont() { return m_vertexBufferCache.GetOrkneyFont(); }
+		geometry::WidgetId WidgetAt(float xNormalised, float yNormalised, const std::vector<vbo::ClassId>& vertexBufferClasses);
+		void RefreshRegionsOfInterest(vbo::ClassId vertexBufferClass);
 		void ClearVertexBufferCache();
 
 		// Manage resources invalidation
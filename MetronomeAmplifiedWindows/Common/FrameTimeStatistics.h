@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+
+namespace DX
+{
+	// Keeps the durations of the most recent frames in a fixed-size ring, and reports percentiles over them.
+	// Recording a frame never allocates; percentiles are computed on request.
+	class FrameTimeStatistics
+	{
+	public:
+		static const size_t WindowSize = 256;
+
+		struct Percentiles
+		{
+			uint64_t p50;
+			uint64_t p95;
+			uint64_t p99;
+		};
+
+		FrameTimeStatistics() : m_frameTicks(), m_next(0), m_count(0) {}
+
+		void Record(uint64_t frameTicks)
+		{
+			m_frameTicks[m_next] = frameTicks;
+			m_next = (m_next + 1) % WindowSize;
+			if (m_count < WindowSize)
+			{
+				m_count++;
+			}
+		}
+
+		void Reset()
+		{
+			m_next = 0;
+			m_count = 0;
+		}
+
+		size_t GetSampleCount() const { return m_count; }
+
+		// Nearest-rank percentiles of the recorded frame times, all zero if nothing has been recorded.
+		Percentiles GetPercentiles() const
+		{
+			Percentiles result = { 0, 0, 0 };
+			if (m_count == 0)
+			{
+				return result;
+			}
+
+			std::array<uint64_t, WindowSize> sorted;
+			std::copy(m_frameTicks.begin(), m_frameTicks.begin() + m_count, sorted.begin());
+			auto end = sorted.begin() + m_count;
+			result.p50 = SelectRank(sorted.begin(), end, 50);
+			result.p95 = SelectRank(sorted.begin(), end, 95);
+			result.p99 = SelectRank(sorted.begin(), end, 99);
+			return result;
+		}
+
+	private:
+		std::array<uint64_t, WindowSize> m_frameTicks;
+		size_t m_next;
+		size_t m_count;
+
+		template<typename TIterator>
+		static uint64_t SelectRank(TIterator begin, TIterator end, size_t percentile)
+		{
+			const size_t count = static_cast<size_t>(end - begin);
+			const size_t rank = (percentile * count + 99) / 100;
+			auto nth = begin + (rank > 0 ? rank - 1 : 0);
+			std::nth_element(begin, nth, end);
+			return *nth;
+		}
+	};
+}
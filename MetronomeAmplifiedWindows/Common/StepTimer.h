@@ -1,12 +1,17 @@
 ﻿#pragma once
 
+#include "ClockSource.h"
+#include "FrameTimeStatistics.h"
+
 namespace DX
 {
-	// Helper class for animation and simulation timing.
-	class StepTimer
+	// Helper class for animation and simulation timing, reading time from the given clock source.
+	template<typename TClock>
+	class BasicStepTimer
 	{
 	public:
-		StepTimer() : 
+		explicit BasicStepTimer(TClock clock = TClock()) :
+			m_clock(clock),
 			m_elapsedTicks(0),
 			m_totalTicks(0),
 			m_leftOverTicks(0),
@@ -17,20 +22,16 @@ namespace DX
 			m_isFixedTimeStep(false),
 			m_targetElapsedTicks(TicksPerSecond / 60)
 		{
-			if (!QueryPerformanceFrequency(&m_qpcFrequency))
-			{
-				throw winrt::hresult_error();
-			}
-
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw winrt::hresult_error();
-			}
+			m_qpcFrequency = m_clock.GetFrequency();
+			m_qpcLastTime = m_clock.GetCounter();
 
 			// Initialize max delta to 1/10 of a second.
-			m_qpcMaxDelta = m_qpcFrequency.QuadPart / 10;
+			m_qpcMaxDelta = m_qpcFrequency / 10;
 		}
 
+		// Access the clock source, e.g. to advance a FakeClock.
+		TClock& GetClock()									{ return m_clock; }
+
 		// Get elapsed time since the previous Update call.
 		uint64_t GetElapsedTicks() const						{ return m_elapsedTicks; }
 		double GetElapsedSeconds() const					{ return TicksToSeconds(m_elapsedTicks); }
@@ -45,6 +46,9 @@ namespace DX
 		// Get the current framerate.
 		uint32_t GetFramesPerSecond() const					{ return m_framesPerSecond; }
 
+		// Get the 50th, 95th and 99th percentile of recent frame times, in ticks.
+		FrameTimeStatistics::Percentiles GetFrameTimePercentiles() const	{ return m_frameTimes.GetPercentiles(); }
+
 		// Set whether to use fixed or variable timestep mode.
 		void SetFixedTimeStep(bool isFixedTimestep)			{ m_isFixedTimeStep = isFixedTimestep; }
 
@@ -64,15 +68,13 @@ namespace DX
 
 		void ResetElapsedTime()
 		{
-			if (!QueryPerformanceCounter(&m_qpcLastTime))
-			{
-				throw winrt::hresult_error();
-			}
+			m_qpcLastTime = m_clock.GetCounter();
 
 			m_leftOverTicks = 0;
 			m_framesPerSecond = 0;
 			m_framesThisSecond = 0;
 			m_qpcSecondCounter = 0;
+			m_frameTimes.Reset();
 		}
 
 		// Update timer state, calling the specified Update function the appropriate number of times.
@@ -80,14 +82,9 @@ namespace DX
 		void Tick(const TUpdate& update)
 		{
 			// Query the current time.
-			LARGE_INTEGER currentTime;
+			uint64_t currentTime = m_clock.GetCounter();
 
-			if (!QueryPerformanceCounter(&currentTime))
-			{
-				throw winrt::hresult_error();
-			}
-
-			uint64_t timeDelta = currentTime.QuadPart - m_qpcLastTime.QuadPart;
+			uint64_t timeDelta = currentTime - m_qpcLastTime;
 
 			m_qpcLastTime = currentTime;
 			m_qpcSecondCounter += timeDelta;
@@ -100,7 +97,9 @@ namespace DX
 
 			// Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
 			timeDelta *= TicksPerSecond;
-			timeDelta /= m_qpcFrequency.QuadPart;
+			timeDelta /= m_qpcFrequency;
+
+			m_frameTimes.Record(timeDelta);
 
 			uint32_t lastFrameCount = m_frameCount;
 
@@ -149,18 +148,19 @@ namespace DX
 				m_framesThisSecond++;
 			}
 
-			if (m_qpcSecondCounter >= static_cast<uint64_t>(m_qpcFrequency.QuadPart))
+			if (m_qpcSecondCounter >= m_qpcFrequency)
 			{
 				m_framesPerSecond = m_framesThisSecond;
 				m_framesThisSecond = 0;
-				m_qpcSecondCounter %= m_qpcFrequency.QuadPart;
+				m_qpcSecondCounter %= m_qpcFrequency;
 			}
 		}
 
 	private:
-		// Source timing data uses QPC units.
-		LARGE_INTEGER m_qpcFrequency;
-		LARGE_INTEGER m_qpcLastTime;
+		// Source timing data uses the clock's own units (QPC units on Windows).
+		TClock m_clock;
+		uint64_t m_qpcFrequency;
+		uint64_t m_qpcLastTime;
 		uint64_t m_qpcMaxDelta;
 
 		// Derived timing data uses a canonical tick format.
@@ -173,9 +173,13 @@ namespace DX
 		uint32_t m_framesPerSecond;
 		uint32_t m_framesThisSecond;
 		uint64_t m_qpcSecondCounter;
+		FrameTimeStatistics m_frameTimes;
 
 		// Members for configuring fixed timestep mode.
 		bool m_isFixedTimeStep;
 		uint64_t m_targetElapsedTicks;
 	};
+
+	// Timer reading the platform's high-resolution clock.
+	typedef BasicStepTimer<DefaultClock> StepTimer;
 }
@@ -5,6 +5,7 @@
 #include "Shaders/AlphaTextureTransformShader.h"
 #include "Shaders/FontShader.h"
 #include "Shaders/FontTransformShader.h"
+#include "Shaders/NotationShader.h"
 #include "../../Common/DirectXHelper.h"
 
 shader::BaseShader::BaseShader(const wchar_t* vertexShaderFile, const wchar_t* pixelShaderFile) :
@@ -155,6 +156,8 @@ shader::BaseShader* shader::BaseShader::NewFromClassId(ClassId id)
 		return new FontShader();
     case ClassId::FONT_TRANSFORM:
         return new FontTransformShader();
+	case ClassId::NOTATION:
+		return new NotationShader();
 	default:
 		throw std::exception("Requested shader class does not exist");
 	}
@@ -8,7 +8,8 @@ namespace shader {
 		ALPHA_TEXTURE,
 		ALPHA_TRANSFORM_TEXTURE,
 		FONT,
-		FONT_TRANSFORM
+		FONT_TRANSFORM,
+		NOTATION
 	};
 
 	class BaseShader {
@@ -2,10 +2,12 @@
 #include "BaseVertexBuffer.h"
 
 #include "Common/DeviceResources.h"
+#include "Geometry.h"
 #include "VertexBuffers/BackgroundVertexBuffer.h"
 #include "VertexBuffers/MainScreenTranslucentOverlayVertexBuffer.h"
 #include "VertexBuffers/MainScreenIconsVertexBuffer.h"
 #include "VertexBuffers/MainScreenIconLabelsVertexBuffer.h"
+#include "VertexBuffers/NotationVertexBuffer.h"
 #include "VertexBuffers/SettingsHubLabelsVertexBuffer.h"
 #include "VertexBuffers/SettingsDetailsTranslucentOverlayVertexBuffer.h"
 #include "VertexBuffers/SettingsDetailsIconsVertexBuffer.h"
@@ -16,54 +18,19 @@ vbo::BaseVertexBuffer::BaseVertexBuffer() : m_subBufferVertexIndices{}, m_isVali
 {
 }
 
-// Puts the vertex data for a square into a float array, assuming each vertex fills 6 floats [x, y, z, s, t, unused]
 void vbo::BaseVertexBuffer::putSquare(structures::VertexTexCoord buffer[], int index, float x1, float y1, float x2, float y2, float s1, float t1, float s2, float t2)
 {
-	using namespace DirectX;
-
-	structures::VertexTexCoord squareVertices[] =
-	{
-		{XMFLOAT3(x1, y1, 0.0f), XMFLOAT3(s1, t1, 0.0f)},
-		{XMFLOAT3(x1, y2, 0.0f), XMFLOAT3(s1, t2, 0.0f)},
-		{XMFLOAT3(x2, y2, 0.0f), XMFLOAT3(s2, t2, 0.0f)},
-		{XMFLOAT3(x2, y2, 0.0f), XMFLOAT3(s2, t2, 0.0f)},
-		{XMFLOAT3(x2, y1, 0.0f), XMFLOAT3(s2, t1, 0.0f)},
-		{XMFLOAT3(x1, y1, 0.0f), XMFLOAT3(s1, t1, 0.0f)}
-	};
-	std::copy(squareVertices, squareVertices + 6, &buffer[index]);
+	geometry::PutSquare(buffer, index, x1, y1, x2, y2, s1, t1, s2, t2);
 }
 
 void vbo::BaseVertexBuffer::putSquareCentredInside(structures::VertexTexCoord buffer[], int index, float x1, float y1, float x2, float y2, float s1, float t1, float s2, float t2, winrt::Windows::Foundation::Size size)
 {
-	// Get units to pixels scaling factor, and use those to determine dimensions of requested rect in pixels
-	const float pixelsPerUnitWidth = size.Width / 2.0f;
-	const float pixelsPerUnitHeight = size.Height / 2.0f;
-	const float rectWidthPixels = abs(x2 - x1) * pixelsPerUnitWidth;
-	const float rectHeightPixels = abs(y2 - y1) * pixelsPerUnitHeight;
-
-	// Figure out where the square lies in this rect (squareness is defined within pixel coordinates)
-	if (rectWidthPixels > rectHeightPixels) {
-		const float direction = x1 > x2 ? -1.0f : 1.0f;
-		const float widthMargin = direction * 0.5f * (rectWidthPixels - rectHeightPixels) / pixelsPerUnitWidth;
-		putSquare(buffer, index, x1 + widthMargin, y1, x2 - widthMargin, y2, s1, t1, s2, t2);
-	} else {
-		const float direction = y1 > y2 ? -1.0f : 1.0f;
-		const float heightMargin = direction * 0.5f * (rectHeightPixels - rectWidthPixels) / pixelsPerUnitHeight;
-		putSquare(buffer, index, x1, y1 + heightMargin, x2, y2 - heightMargin, s1, t1, s2, t2);
-	}
+	geometry::PutSquareCentredInside(buffer, index, x1, y1, x2, y2, s1, t1, s2, t2, size);
 }
 
 int vbo::BaseVertexBuffer::RegionOfInterestAt(float xNormalised, float yNormalised)
 {
-	for (int i = 0; i < m_regionsOfInterest.size(); i++) {
-		auto& region = m_regionsOfInterest[i];
-		if (xNormalised > region.X && xNormalised < region.X + region.Width) {
-			if (yNormalised > region.Y && yNormalised < region.Y + region.Height) {
-				return i;
-			}
-		}
-	}
-	return -1;
+	return geometry::RegionOfInterestAt(m_regionsOfInterest, xNormalised, yNormalised);
 }
 
 vbo::BaseVertexBuffer* vbo::BaseVertexBuffer::NewFromClassId(ClassId id)
@@ -87,6 +54,8 @@ vbo::BaseVertexBuffer* vbo::BaseVertexBuffer::NewFromClassId(ClassId id)
 		return new SettingsNavigatingImagesVertexBuffer();
 	case ClassId::HELP_NAVIGATING_TEXTS:
 		return new SettingsNavigatingTextsVertexBuffer();
+	case ClassId::NOTATION:
+		return new NotationVertexBuffer();
 	default:
 		throw std::exception("Requested VBO class does not exist");
 	}
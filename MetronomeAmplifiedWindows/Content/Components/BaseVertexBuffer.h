@@ -19,7 +19,8 @@ namespace vbo {
 		HELP_DETAILS_OVERLAY,
 		HELP_DETAILS_ICONS,
 		HELP_NAVIGATING_TEXTS,
-		HELP_NAVIGATING_IMAGES
+		HELP_NAVIGATING_IMAGES,
+		NOTATION
 	};
 
 	class BaseVertexBuffer {
@@ -42,6 +43,7 @@ namespace vbo {
 		int RegionOfInterestAt(float xNormalised, float yNormalised);
 
 		inline bool IsValid() { return m_isValid; }
+		inline const std::vector<winrt::Windows::Foundation::Rect>& GetRegionsOfInterest() { return m_regionsOfInterest; }
 		inline unsigned int IndexOfSubBuffer(int index) { return m_subBufferVertexIndices[index]; }
 		inline unsigned int VerticesInSubBuffer(int index) { return m_subBufferVertexIndices[index + 1] - m_subBufferVertexIndices[index]; }
 	};
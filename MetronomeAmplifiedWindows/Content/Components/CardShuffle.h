@@ -0,0 +1,41 @@
+#pragma once
+
+namespace animation {
+
+	// Progress of the settings cards' shuffle, in which the focused card shrinks away to one side as the next
+	// grows in from the other, and the scale each is drawn at. It moves only by the frame times it is given, so
+	// stepping it from a StepTimer on a FakeClock replays the animation exactly.
+	class CardShuffle {
+	public:
+		static constexpr float DurationSeconds = 0.3f;
+
+		CardShuffle() : m_isAnimating(false), m_progress(0.0f) {}
+
+		inline void Start() { m_isAnimating = true; m_progress = 0.0f; }
+
+		// Moves the shuffle on by a frame. Returns false once it has finished, including on the frame it does.
+		bool Advance(double timeDeltaSeconds)
+		{
+			if (!m_isAnimating) {
+				return false;
+			}
+			m_progress += (float)(timeDeltaSeconds / DurationSeconds);
+			if (m_progress >= 1.0f) {
+				m_progress = 1.0f;
+				m_isAnimating = false;
+			}
+			return m_isAnimating;
+		}
+
+		inline bool IsAnimating() const { return m_isAnimating; }
+		inline float GetProgress() const { return m_progress; }
+
+		// The leaving card starts at full size and the arriving one ends at it, both nearer two thirds midway
+		inline float GetScaleOut() const { return 0.66666667f + DurationSeconds / (9.0f * m_progress + 3.0f * DurationSeconds); }
+		inline float GetScaleIn() const { return 0.66666667f + DurationSeconds / (9.0f * (1.0f - m_progress) + 3.0f * DurationSeconds); }
+
+	private:
+		bool m_isAnimating;
+		float m_progress;
+	};
+}
@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "Geometry.h"
+
+// Puts the vertex data for a square into a float array, assuming each vertex fills 6 floats [x, y, z, s, t, unused]
+void geometry::PutSquare(structures::VertexTexCoord buffer[], int index, float x1, float y1, float x2, float y2, float s1, float t1, float s2, float t2)
+{
+	using namespace DirectX;
+
+	structures::VertexTexCoord squareVertices[] =
+	{
+		{XMFLOAT3(x1, y1, 0.0f), XMFLOAT3(s1, t1, 0.0f)},
+		{XMFLOAT3(x1, y2, 0.0f), XMFLOAT3(s1, t2, 0.0f)},
+		{XMFLOAT3(x2, y2, 0.0f), XMFLOAT3(s2, t2, 0.0f)},
+		{XMFLOAT3(x2, y2, 0.0f), XMFLOAT3(s2, t2, 0.0f)},
+		{XMFLOAT3(x2, y1, 0.0f), XMFLOAT3(s2, t1, 0.0f)},
+		{XMFLOAT3(x1, y1, 0.0f), XMFLOAT3(s1, t1, 0.0f)}
+	};
+	std::copy(squareVertices, squareVertices + 6, &buffer[index]);
+}
+
+void geometry::PutSquareCentredInside(structures::VertexTexCoord buffer[], int index, float x1, float y1, float x2, float y2, float s1, float t1, float s2, float t2, winrt::Windows::Foundation::Size size)
+{
+	// Get units to pixels scaling factor, and use those to determine dimensions of requested rect in pixels
+	const float pixelsPerUnitWidth = size.Width / 2.0f;
+	const float pixelsPerUnitHeight = size.Height / 2.0f;
+	const float rectWidthPixels = abs(x2 - x1) * pixelsPerUnitWidth;
+	const float rectHeightPixels = abs(y2 - y1) * pixelsPerUnitHeight;
+
+	// Figure out where the square lies in this rect (squareness is defined within pixel coordinates)
+	if (rectWidthPixels > rectHeightPixels) {
+		const float direction = x1 > x2 ? -1.0f : 1.0f;
+		const float widthMargin = direction * 0.5f * (rectWidthPixels - rectHeightPixels) / pixelsPerUnitWidth;
+		PutSquare(buffer, index, x1 + widthMargin, y1, x2 - widthMargin, y2, s1, t1, s2, t2);
+	} else {
+		const float direction = y1 > y2 ? -1.0f : 1.0f;
+		const float heightMargin = direction * 0.5f * (rectHeightPixels - rectWidthPixels) / pixelsPerUnitHeight;
+		PutSquare(buffer, index, x1, y1 + heightMargin, x2, y2 - heightMargin, s1, t1, s2, t2);
+	}
+}
+
+int geometry::RegionOfInterestAt(const std::vector<winrt::Windows::Foundation::Rect>& regions, float xNormalised, float yNormalised)
+{
+	for (int i = 0; i < regions.size(); i++) {
+		auto& region = regions[i];
+		if (xNormalised > region.X && xNormalised < region.X + region.Width) {
+			if (yNormalised > region.Y && yNormalised < region.Y + region.Height) {
+				return i;
+			}
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../ShaderStructures.h"
+#include <winrt/Windows.Foundation.h>
+
+namespace geometry {
+
+	// Puts the vertex data for a square (two triangles) into the buffer, starting at the given index
+	void PutSquare(structures::VertexTexCoord buffer[], int index, float x1, float y1, float x2, float y2, float s1, float t1, float s2, float t2);
+
+	// Puts a square that is square in pixel space, centred inside the given rect in normalised coordinates
+	void PutSquareCentredInside(structures::VertexTexCoord buffer[], int index, float x1, float y1, float x2, float y2, float s1, float t1, float s2, float t2, winrt::Windows::Foundation::Size size);
+
+	// Returns the index of the first region containing the given point, or -1 if there is none
+	int RegionOfInterestAt(const std::vector<winrt::Windows::Foundation::Rect>& regions, float xNormalised, float yNormalised);
+}
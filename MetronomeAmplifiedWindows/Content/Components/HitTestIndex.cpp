@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "HitTestIndex.h"
+
+geometry::HitTestIndex::HitTestIndex(int columns, int rows) :
+	m_columns(columns), m_rows(rows), m_cells(columns * rows), m_entries(), m_freeEntries(), m_layerEntries()
+{
+}
+
+void geometry::HitTestIndex::CellRange(const winrt::Windows::Foundation::Rect& rect, int& colMin, int& rowMin, int& colMax, int& rowMax) const
+{
+	const float cellsPerUnitX = 0.5f * (float)m_columns;
+	const float cellsPerUnitY = 0.5f * (float)m_rows;
+	colMin = std::clamp((int)floor((rect.X + 1.0f) * cellsPerUnitX), 0, m_columns - 1);
+	colMax = std::clamp((int)floor((rect.X + rect.Width + 1.0f) * cellsPerUnitX), 0, m_columns - 1);
+	rowMin = std::clamp((int)floor((rect.Y + 1.0f) * cellsPerUnitY), 0, m_rows - 1);
+	rowMax = std::clamp((int)floor((rect.Y + rect.Height + 1.0f) * cellsPerUnitY), 0, m_rows - 1);
+}
+
+void geometry::HitTestIndex::InsertIntoCells(uint32_t entryIndex)
+{
+	int colMin, rowMin, colMax, rowMax;
+	CellRange(m_entries[entryIndex].rect, colMin, rowMin, colMax, rowMax);
+	for (int row = rowMin; row <= rowMax; row++) {
+		for (int col = colMin; col <= colMax; col++) {
+			m_cells[row * m_columns + col].push_back(entryIndex);
+		}
+	}
+}
+
+void geometry::HitTestIndex::RemoveFromCells(uint32_t entryIndex)
+{
+	int colMin, rowMin, colMax, rowMax;
+	CellRange(m_entries[entryIndex].rect, colMin, rowMin, colMax, rowMax);
+	for (int row = rowMin; row <= rowMax; row++) {
+		for (int col = colMin; col <= colMax; col++) {
+			std::vector<uint32_t>& cell = m_cells[row * m_columns + col];
+			auto position = std::find(cell.begin(), cell.end(), entryIndex);
+			if (position != cell.end()) {
+				*position = cell.back();
+				cell.pop_back();
+			}
+		}
+	}
+}
+
+uint32_t geometry::HitTestIndex::AllocateEntry(const winrt::Windows::Foundation::Rect& rect, WidgetId id)
+{
+	if (!m_freeEntries.empty()) {
+		uint32_t entryIndex = m_freeEntries.back();
+		m_freeEntries.pop_back();
+		m_entries[entryIndex] = { rect, id };
+		return entryIndex;
+	}
+	m_entries.push_back({ rect, id });
+	return (uint32_t)(m_entries.size() - 1);
+}
+
+/// <summary>
+/// Replace the regions of one layer. Regions that are unchanged since the last call are left in place, so
+/// re-registering a layer after an unrelated layout pass costs one comparison per region. Throws
+/// std::invalid_argument for a layer that has no bit in the mask.
+/// </summary>
+void geometry::HitTestIndex::SetLayer(int layer, const std::vector<winrt::Windows::Foundation::Rect>& regions)
+{
+	if (layer < 0 || layer >= MaxLayers) {
+		throw std::invalid_argument("Hit-test layer " + std::to_string(layer) + " does not fit in the layer mask");
+	}
+	if (layer >= (int)m_layerEntries.size()) {
+		m_layerEntries.resize(layer + 1);
+	}
+	std::vector<uint32_t>& layerEntries = m_layerEntries[layer];
+
+	// Update regions that exist both before and after, moving them between cells only if they changed
+	const size_t keptCount = min(layerEntries.size(), regions.size());
+	for (size_t i = 0; i < keptCount; i++) {
+		Entry& entry = m_entries[layerEntries[i]];
+		const winrt::Windows::Foundation::Rect& rect = regions[i];
+		if (entry.rect.X == rect.X && entry.rect.Y == rect.Y && entry.rect.Width == rect.Width && entry.rect.Height == rect.Height) {
+			continue;
+		}
+		RemoveFromCells(layerEntries[i]);
+		entry.rect = rect;
+		InsertIntoCells(layerEntries[i]);
+	}
+
+	// Drop regions that no longer exist, then add new ones
+	for (size_t i = keptCount; i < layerEntries.size(); i++) {
+		RemoveFromCells(layerEntries[i]);
+		m_freeEntries.push_back(layerEntries[i]);
+	}
+	layerEntries.resize(keptCount);
+	for (size_t i = keptCount; i < regions.size(); i++) {
+		uint32_t entryIndex = AllocateEntry(regions[i], WidgetId(layer, (int)i));
+		InsertIntoCells(entryIndex);
+		layerEntries.push_back(entryIndex);
+	}
+}
+
+void geometry::HitTestIndex::RemoveLayer(int layer)
+{
+	if (layer >= 0 && layer < (int)m_layerEntries.size()) {
+		SetLayer(layer, {});
+	}
+}
+
+void geometry::HitTestIndex::Clear()
+{
+	for (auto& cell : m_cells) {
+		cell.clear();
+	}
+	m_entries.clear();
+	m_freeEntries.clear();
+	m_layerEntries.clear();
+}
+
+geometry::WidgetId geometry::HitTestIndex::WidgetAt(float xNormalised, float yNormalised, uint64_t layerMask) const
+{
+	const int col = std::clamp((int)floor((xNormalised + 1.0f) * 0.5f * (float)m_columns), 0, m_columns - 1);
+	const int row = std::clamp((int)floor((yNormalised + 1.0f) * 0.5f * (float)m_rows), 0, m_rows - 1);
+
+	// Containment uses the same open intervals as BaseVertexBuffer::RegionOfInterestAt
+	WidgetId best;
+	for (uint32_t entryIndex : m_cells[row * m_columns + col]) {
+		const Entry& entry = m_entries[entryIndex];
+		if ((layerMask & LayerBit(entry.id.layer)) == 0) {
+			continue;
+		}
+		const winrt::Windows::Foundation::Rect& rect = entry.rect;
+		if (xNormalised > rect.X && xNormalised < rect.X + rect.Width && yNormalised > rect.Y && yNormalised < rect.Y + rect.Height) {
+			if (!best.IsValid() || entry.id.layer < best.layer || (entry.id.layer == best.layer && entry.id.region < best.region)) {
+				best = entry.id;
+			}
+		}
+	}
+	return best;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <winrt/Windows.Foundation.h>
+
+namespace geometry {
+
+	// Stable identifier of an interactive region: the layer it was registered under (a VBO class, for the
+	// app's own scenes) and its index within that layer. Identifiers survive layout changes.
+	struct WidgetId {
+		int layer;
+		int region;
+
+		WidgetId() : layer(-1), region(-1) {}
+		WidgetId(int layerId, int regionIndex) : layer(layerId), region(regionIndex) {}
+		inline bool IsValid() const { return layer >= 0; }
+		inline bool operator==(const WidgetId& other) const { return layer == other.layer && region == other.region; }
+		inline bool operator!=(const WidgetId& other) const { return !(*this == other); }
+	};
+
+	// Uniform grid over normalised device coordinates (-1 to 1 on both axes) holding the regions of interest of
+	// any number of layers. Each layer can be replaced on its own, and only the grid cells touched by regions
+	// that actually moved are updated. Where regions overlap, the lowest layer and then lowest region wins.
+	class HitTestIndex {
+	private:
+		struct Entry {
+			winrt::Windows::Foundation::Rect rect;
+			WidgetId id;
+		};
+
+		int m_columns;
+		int m_rows;
+		std::vector<std::vector<uint32_t>> m_cells;
+		std::vector<Entry> m_entries;
+		std::vector<uint32_t> m_freeEntries;
+		std::vector<std::vector<uint32_t>> m_layerEntries;
+
+		void CellRange(const winrt::Windows::Foundation::Rect& rect, int& colMin, int& rowMin, int& colMax, int& rowMax) const;
+		void InsertIntoCells(uint32_t entryIndex);
+		void RemoveFromCells(uint32_t entryIndex);
+		uint32_t AllocateEntry(const winrt::Windows::Foundation::Rect& rect, WidgetId id);
+
+	public:
+		// Layers are selected by bits of a 64-bit mask
+		static const int MaxLayers = 64;
+
+		HitTestIndex(int columns = 32, int rows = 32);
+		void SetLayer(int layer, const std::vector<winrt::Windows::Foundation::Rect>& regions);
+		void RemoveLayer(int layer);
+		void Clear();
+		WidgetId WidgetAt(float xNormalised, float yNormalised, uint64_t layerMask = ~0ULL) const;
+		size_t RegionCount() const { return m_entries.size() - m_freeEntries.size(); }
+
+		// No bit for a layer outside the mask, which SetLayer never accepts
+		static inline uint64_t LayerBit(int layer) { return (layer >= 0 && layer < MaxLayers) ? 1ULL << layer : 0; }
+	};
+}
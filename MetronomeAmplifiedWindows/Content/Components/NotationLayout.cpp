@@ -0,0 +1,330 @@
+#include "pch.h"
+#include "NotationLayout.h"
+
+#include "Geometry.h"
+
+namespace {
+
+	// Vertical metrics, as fractions of the box height measured down from its top
+	const float StaffLineDepth = 0.68f;
+	const float HeadHeight = 0.16f;
+	const float GhostHeadScale = 0.65f;
+	const float StemTopDepth = 0.22f;
+	const float BeamThickness = 0.045f;
+	const float BeamSpacing = 0.075f;
+	const float BracketDepth = 0.1f;
+	const float BracketHookDepth = 0.16f;
+	const float NumberHeight = 0.18f;
+	const float AccentTopDepth = 0.8f;
+	const float AccentHeight = 0.16f;
+	const float RestHeight = 0.06f;
+	const float BarLineReach = 0.14f;
+	const float TimeSignatureSplitDepth = 0.66f;
+	const float TimeSignatureNumberHeight = 0.34f;
+
+	// Widths, relative to the box height in pixels so that shapes keep their proportions
+	const float HeadAspect = 1.35f;
+	const float TimeSignatureWidth = 0.45f;
+	const float LineThickness = 0.015f;
+	const float MaxHeadFractionOfSlot = 0.9f;
+	const float BeamStubFractionOfSlot = 0.45f;
+	const float RestFractionOfHead = 0.8f;
+}
+
+notation::NotationLayout::NotationLayout() :
+	m_font(nullptr),
+	m_section(),
+	m_vertices(),
+	m_scratch(),
+	m_stepRegions(),
+	m_size(),
+	m_beamCount(0),
+	m_hasStems(false),
+	m_isHollow(false),
+	m_tupletText(),
+	m_headerVertexCount(0),
+	m_beatVertexCount(0),
+	m_left(0.0f),
+	m_top(0.0f),
+	m_boxWidth(0.0f),
+	m_boxHeight(0.0f),
+	m_barLeft(0.0f),
+	m_slotWidth(0.0f),
+	m_staffY(0.0f),
+	m_headWidth(0.0f),
+	m_headHeight(0.0f),
+	m_stemWidth(0.0f),
+	m_stemTop(0.0f),
+	m_lineHeight(0.0f),
+	m_solid(),
+	m_filledHead(),
+	m_hollowHead(),
+	m_accent()
+{
+}
+
+void notation::NotationLayout::Layout(font::Font* font, const audio::SongSection& section, float left, float top, float boxWidth, float boxHeight, winrt::Windows::Foundation::Size size)
+{
+	const int stepsPerBar = section.GetStepsPerBar();
+	if (section.beatsPerBar <= 0 || section.beatUnit <= 0 || section.stepsPerBeat <= 0 || (int)section.pattern.size() != stepsPerBar) {
+		throw std::invalid_argument("Section pattern must hold exactly one bar");
+	}
+	m_font = font;
+	m_section = section;
+	m_size = size;
+	m_left = left;
+	m_top = top;
+	m_boxWidth = boxWidth;
+	m_boxHeight = boxHeight;
+
+	// A step's note value follows from how many steps make a whole note; any that are not a power of two are
+	// tuplets of the next power of two down
+	const int stepsPerWhole = section.beatUnit * section.stepsPerBeat;
+	int valueOfStep = 1;
+	int beamCount = -2;
+	while (valueOfStep * 2 <= stepsPerWhole) {
+		valueOfStep *= 2;
+		beamCount++;
+	}
+	m_beamCount = std::clamp(beamCount, 0, MaxBeams);
+	m_hasStems = valueOfStep >= 2;
+	m_isHollow = valueOfStep <= 2;
+	m_tupletText = (valueOfStep != stepsPerWhole && section.stepsPerBeat > 1) ? std::to_string(section.stepsPerBeat) : "";
+
+	// Texture coordinates; the middle of the font's capital I is solid
+	m_solid = GlyphBox('I');
+	const float solidS = 0.5f * (m_solid.s1 + m_solid.s2);
+	const float solidT = 0.5f * (m_solid.t1 + m_solid.t2);
+	m_solid = { solidS, solidT, solidS, solidT };
+	m_filledHead = GlyphBox('.');
+	m_hollowHead = GlyphBox('o');
+	m_accent = GlyphBox('>');
+
+	// Metrics
+	const float pixelsPerUnitWidth = size.Width / 2.0f;
+	const float pixelsPerUnitHeight = size.Height / 2.0f;
+	const float boxHeightPixels = boxHeight * pixelsPerUnitHeight;
+	const float lineThicknessPixels = max(1.0f, LineThickness * boxHeightPixels);
+	m_barLeft = left + TimeSignatureWidth * boxHeightPixels / pixelsPerUnitWidth;
+	m_slotWidth = (left + boxWidth - m_barLeft) / (float)stepsPerBar;
+	m_staffY = top - StaffLineDepth * boxHeight;
+	m_headHeight = HeadHeight * boxHeight;
+	m_headWidth = min(HeadAspect * HeadHeight * boxHeightPixels / pixelsPerUnitWidth, MaxHeadFractionOfSlot * m_slotWidth);
+	m_stemWidth = lineThicknessPixels / pixelsPerUnitWidth;
+	m_stemTop = top - StemTopDepth * boxHeight;
+	m_lineHeight = lineThicknessPixels / pixelsPerUnitHeight;
+
+	// Vertex runs: staff line, two bar lines and the time signature, then each beat's steps, beams and bracket
+	const std::string upper = std::to_string(section.beatsPerBar);
+	const std::string lower = std::to_string(section.beatUnit);
+	m_headerVertexCount = 18 + 6 * (int)(upper.length() + lower.length());
+	m_beatVertexCount = section.stepsPerBeat * VerticesPerStep + m_beamCount * 6;
+	if (!m_tupletText.empty()) {
+		m_beatVertexCount += 24 + 6 * (int)m_tupletText.length();
+	}
+
+	m_vertices.resize(m_headerVertexCount + section.beatsPerBar * m_beatVertexCount);
+	m_scratch.resize(m_beatVertexCount);
+	WriteHeader(m_vertices);
+	for (int beat = 0; beat < section.beatsPerBar; beat++) {
+		WriteBeat(m_vertices, m_headerVertexCount + beat * m_beatVertexCount, beat);
+	}
+
+	m_stepRegions.resize(stepsPerBar);
+	for (int step = 0; step < stepsPerBar; step++) {
+		m_stepRegions[step] = { m_barLeft + (float)step * m_slotWidth, top - boxHeight, m_slotWidth, boxHeight };
+	}
+}
+
+/// <summary>
+/// Rebuild the beat holding the step off to one side, then copy over only the vertices that differ. A step's
+/// own vertices always change with it, and the beat's beams only when the first or last note sounding in it
+/// moves, so the range returned is usually a single step's worth.
+/// </summary>
+notation::VertexRange notation::NotationLayout::SetNote(int step, audio::PatternNote note)
+{
+	if (step < 0 || step >= (int)m_section.pattern.size()) {
+		throw std::invalid_argument("Step is outside the laid out bar");
+	}
+	if (m_section.pattern[step] == note) {
+		return { 0, 0 };
+	}
+	m_section.pattern[step] = note;
+
+	const int beat = step / m_section.stepsPerBeat;
+	const int beatIndex = m_headerVertexCount + beat * m_beatVertexCount;
+	WriteBeat(m_scratch, 0, beat);
+	const structures::VertexTexCoord* current = m_vertices.data() + beatIndex;
+	int first = 0;
+	while (first < m_beatVertexCount && memcmp(&current[first], &m_scratch[first], sizeof(structures::VertexTexCoord)) == 0) {
+		first++;
+	}
+	if (first == m_beatVertexCount) {
+		return { 0, 0 };
+	}
+	int last = m_beatVertexCount - 1;
+	while (memcmp(&current[last], &m_scratch[last], sizeof(structures::VertexTexCoord)) == 0) {
+		last--;
+	}
+	std::copy(m_scratch.begin() + first, m_scratch.begin() + last + 1, m_vertices.begin() + beatIndex + first);
+	return { beatIndex + first, last + 1 - first };
+}
+
+bool notation::NotationLayout::IsShowing(const audio::SongSection& section) const
+{
+	return m_font != nullptr && section.beatsPerBar == m_section.beatsPerBar && section.beatUnit == m_section.beatUnit &&
+		section.stepsPerBeat == m_section.stepsPerBeat && section.pattern == m_section.pattern;
+}
+
+notation::VertexRange notation::NotationLayout::GetBeatRange(int beat) const
+{
+	return { m_headerVertexCount + beat * m_beatVertexCount, m_beatVertexCount };
+}
+
+notation::NotationLayout::TextureBox notation::NotationLayout::GlyphBox(char c) const
+{
+	const font::Glyph& glyph = m_font->m_glyphs.at(c);
+	const float s1 = glyph.textureS / FONT_TEXTURE_SIZE;
+	const float t1 = glyph.textureT / FONT_TEXTURE_SIZE;
+	return { s1, t1, s1 + glyph.width / FONT_TEXTURE_SIZE, t1 + glyph.height / FONT_TEXTURE_SIZE };
+}
+
+// Texture rows run downwards, so the bottom edge y1 takes the box's lower texture edge t2
+void notation::NotationLayout::PutQuad(std::vector<structures::VertexTexCoord>& vertices, int index, float x1, float y1, float x2, float y2, const TextureBox& box, float stepTag) const
+{
+	geometry::PutSquare(vertices.data(), index, x1, y1, x2, y2, box.s1, box.t2, box.s2, box.t1);
+	for (int i = index; i < index + 6; i++) {
+		vertices[i].tex.z = stepTag;
+	}
+}
+
+// Zero-area triangles keep a run its fixed size when there is nothing to draw in it
+void notation::NotationLayout::PutNothing(std::vector<structures::VertexTexCoord>& vertices, int index, float stepTag) const
+{
+	for (int i = index; i < index + 6; i++) {
+		vertices[i] = { DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, stepTag) };
+	}
+}
+
+void notation::NotationLayout::PutText(std::vector<structures::VertexTexCoord>& vertices, int index, const std::string& text, float left, float top, float boxWidth, float boxHeight) const
+{
+	std::string textToRender = text;
+	const float maxHeightPixels = boxHeight * m_size.Height / 2.0f;
+	m_font->PrintTextIntoVbo(vertices, index, textToRender, left, top, boxWidth, boxHeight, maxHeightPixels, m_size, font::Gravity::CENTER, font::Gravity::CENTER);
+	for (int i = index; i < index + 6 * (int)text.length(); i++) {
+		vertices[i].tex.z = NoStep;
+	}
+}
+
+void notation::NotationLayout::WriteHeader(std::vector<structures::VertexTexCoord>& vertices) const
+{
+	const float barRight = m_left + m_boxWidth;
+	const float barLineBottom = m_staffY - BarLineReach * m_boxHeight;
+	const float barLineTop = m_staffY + BarLineReach * m_boxHeight;
+	PutQuad(vertices, 0, m_barLeft, m_staffY - 0.5f * m_lineHeight, barRight, m_staffY + 0.5f * m_lineHeight, m_solid, NoStep);
+	PutQuad(vertices, 6, m_barLeft, barLineBottom, m_barLeft + m_stemWidth, barLineTop, m_solid, NoStep);
+	PutQuad(vertices, 12, barRight - m_stemWidth, barLineBottom, barRight, barLineTop, m_solid, NoStep);
+
+	const std::string upper = std::to_string(m_section.beatsPerBar);
+	const std::string lower = std::to_string(m_section.beatUnit);
+	const float splitY = m_top - TimeSignatureSplitDepth * m_boxHeight;
+	const float numberHeight = TimeSignatureNumberHeight * m_boxHeight;
+	PutText(vertices, 18, upper, m_left, splitY + numberHeight, m_barLeft - m_left, numberHeight);
+	PutText(vertices, 18 + 6 * (int)upper.length(), lower, m_left, splitY, m_barLeft - m_left, numberHeight);
+}
+
+float notation::NotationLayout::GetStemLeft(int step) const
+{
+	const float headRight = m_barLeft + ((float)step + 0.5f) * m_slotWidth + 0.5f * m_headWidth;
+	return headRight - m_stemWidth;
+}
+
+void notation::NotationLayout::WriteStep(std::vector<structures::VertexTexCoord>& vertices, int index, int step) const
+{
+	const float stepTag = (float)step;
+	const float centreX = m_barLeft + ((float)step + 0.5f) * m_slotWidth;
+	const audio::PatternNote note = m_section.pattern[step];
+	if (note == audio::PatternNote::REST) {
+		const float halfWidth = 0.5f * RestFractionOfHead * m_headWidth;
+		const float restBottom = m_staffY + 0.5f * m_lineHeight;
+		PutQuad(vertices, index, centreX - halfWidth, restBottom, centreX + halfWidth, restBottom + RestHeight * m_boxHeight, m_solid, stepTag);
+		PutNothing(vertices, index + 6, stepTag);
+		PutNothing(vertices, index + 12, stepTag);
+		return;
+	}
+
+	// Ghost notes get a smaller head, still meeting the stem
+	const float scale = note == audio::PatternNote::GHOST ? GhostHeadScale : 1.0f;
+	const float headRight = centreX + 0.5f * m_headWidth;
+	const float headLeft = headRight - scale * m_headWidth;
+	const float halfHeight = 0.5f * scale * m_headHeight;
+	PutQuad(vertices, index, headLeft, m_staffY - halfHeight, headRight, m_staffY + halfHeight, m_isHollow ? m_hollowHead : m_filledHead, stepTag);
+	if (m_hasStems) {
+		const float stemLeft = GetStemLeft(step);
+		PutQuad(vertices, index + 6, stemLeft, m_staffY, stemLeft + m_stemWidth, m_stemTop, m_solid, stepTag);
+	} else {
+		PutNothing(vertices, index + 6, stepTag);
+	}
+	if (note == audio::PatternNote::ACCENT) {
+		const float accentTop = m_top - AccentTopDepth * m_boxHeight;
+		PutQuad(vertices, index + 12, centreX - 0.5f * m_headWidth, accentTop - AccentHeight * m_boxHeight, centreX + 0.5f * m_headWidth, accentTop, m_accent, stepTag);
+	} else {
+		PutNothing(vertices, index + 12, stepTag);
+	}
+}
+
+/// <summary>
+/// Write the steps of one beat, then its beams and tuplet bracket. Beams join the stems of the first and last
+/// notes sounding in the beat; a lone note gets a short stub in place of a flag.
+/// </summary>
+void notation::NotationLayout::WriteBeat(std::vector<structures::VertexTexCoord>& vertices, int index, int beat) const
+{
+	const int firstStep = beat * m_section.stepsPerBeat;
+	const int endStep = firstStep + m_section.stepsPerBeat;
+	int firstSounding = -1;
+	int lastSounding = -1;
+	for (int step = firstStep; step < endStep; step++) {
+		WriteStep(vertices, index, step);
+		index += VerticesPerStep;
+		if (m_section.pattern[step] != audio::PatternNote::REST) {
+			if (firstSounding < 0) {
+				firstSounding = step;
+			}
+			lastSounding = step;
+		}
+	}
+
+	for (int beam = 0; beam < m_beamCount; beam++) {
+		if (firstSounding < 0) {
+			PutNothing(vertices, index, NoStep);
+		} else {
+			const float beamTop = m_stemTop - (float)beam * BeamSpacing * m_boxHeight;
+			const float beamLeft = GetStemLeft(firstSounding);
+			const float beamRight = firstSounding == lastSounding ?
+				beamLeft + m_stemWidth + BeamStubFractionOfSlot * m_slotWidth :
+				GetStemLeft(lastSounding) + m_stemWidth;
+			PutQuad(vertices, index, beamLeft, beamTop - BeamThickness * m_boxHeight, beamRight, beamTop, m_solid, NoStep);
+		}
+		index += 6;
+	}
+
+	if (m_tupletText.empty()) {
+		return;
+	}
+
+	// Bracket over the whole beat, broken around its number
+	const float beatLeft = m_barLeft + (float)firstStep * m_slotWidth;
+	const float beatWidth = (float)m_section.stepsPerBeat * m_slotWidth;
+	const float bracketLeft = beatLeft + 0.5f * (m_slotWidth - m_headWidth);
+	const float bracketRight = beatLeft + beatWidth - 0.5f * (m_slotWidth - m_headWidth);
+	const float bracketY = m_top - BracketDepth * m_boxHeight;
+	const float hookBottom = m_top - BracketHookDepth * m_boxHeight;
+	const float numberHeight = NumberHeight * m_boxHeight;
+	const float gapHalfWidth = 0.4f * (float)m_tupletText.length() * numberHeight * m_size.Height / m_size.Width;
+	const float centreX = beatLeft + 0.5f * beatWidth;
+	PutQuad(vertices, index, bracketLeft, bracketY - m_lineHeight, max(bracketLeft, centreX - gapHalfWidth), bracketY, m_solid, NoStep);
+	PutQuad(vertices, index + 6, min(bracketRight, centreX + gapHalfWidth), bracketY - m_lineHeight, bracketRight, bracketY, m_solid, NoStep);
+	PutQuad(vertices, index + 12, bracketLeft, hookBottom, bracketLeft + m_stemWidth, bracketY, m_solid, NoStep);
+	PutQuad(vertices, index + 18, bracketRight - m_stemWidth, hookBottom, bracketRight, bracketY, m_solid, NoStep);
+	PutText(vertices, index + 24, m_tupletText, beatLeft, bracketY + 0.5f * numberHeight, beatWidth, numberHeight);
+}
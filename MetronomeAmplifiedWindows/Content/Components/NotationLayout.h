@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../ShaderStructures.h"
+#include "../../Audio/Songs/Song.h"
+#include "../../Common/Font.h"
+#include <winrt/Windows.Foundation.h>
+
+namespace notation {
+
+	// A run of vertices within a layout, and the bytes it occupies in a vertex buffer holding the whole layout
+	struct VertexRange {
+		int firstVertex;
+		int vertexCount;
+
+		inline bool IsEmpty() const { return vertexCount == 0; }
+		inline uint32_t GetByteOffset() const { return (uint32_t)(firstVertex * sizeof(structures::VertexTexCoord)); }
+		inline uint32_t GetByteLength() const { return (uint32_t)(vertexCount * sizeof(structures::VertexTexCoord)); }
+	};
+
+	// Lays out one bar of a section's pattern on a single-line percussion staff: the time signature, then for
+	// each step a note head (or a rest), its stem and any accent mark, and for each beat its beams and any tuplet
+	// bracket. Every step and beat owns a fixed run of vertices whatever notes it holds, so changing one note
+	// rewrites part of its beat and nothing else. Vertices of a step carry the step index in tex.z, and all
+	// others NoStep, so a shader can highlight the step being played. Solid shapes sample one opaque texel of
+	// the font texture, which lets the whole layout draw with the font texture in one call.
+	class NotationLayout {
+	public:
+		static constexpr float NoStep = -1.0f;
+
+		// Head, stem and accent mark
+		static const int VerticesPerStep = 18;
+		static const int MaxBeams = 4;
+
+		NotationLayout();
+
+		// The box is given as for Font::PrintTextIntoVbo. Throws std::invalid_argument if the pattern does not
+		// hold exactly one bar.
+		void Layout(font::Font* font, const audio::SongSection& section, float left, float top, float boxWidth, float boxHeight, winrt::Windows::Foundation::Size size);
+
+		// Changes one step of the laid out pattern, and returns the smallest run of vertices that changed with
+		// it; empty if none did
+		VertexRange SetNote(int step, audio::PatternNote note);
+
+		// True if the same bar is laid out, ignoring name, tempo and bar count
+		bool IsShowing(const audio::SongSection& section) const;
+
+		VertexRange GetBeatRange(int beat) const;
+		inline const audio::SongSection& GetSection() const { return m_section; }
+		inline const std::vector<structures::VertexTexCoord>& GetVertices() const { return m_vertices; }
+		inline const std::vector<winrt::Windows::Foundation::Rect>& GetStepRegions() const { return m_stepRegions; }
+
+	private:
+		struct TextureBox {
+			float s1;
+			float t1;
+			float s2;
+			float t2;
+		};
+
+		font::Font* m_font;
+		audio::SongSection m_section;
+		std::vector<structures::VertexTexCoord> m_vertices;
+		std::vector<structures::VertexTexCoord> m_scratch;
+		std::vector<winrt::Windows::Foundation::Rect> m_stepRegions;
+		winrt::Windows::Foundation::Size m_size;
+
+		// Note values, from the number of steps to a whole note
+		int m_beamCount;
+		bool m_hasStems;
+		bool m_isHollow;
+		std::string m_tupletText;
+
+		// Vertex runs
+		int m_headerVertexCount;
+		int m_beatVertexCount;
+
+		// Metrics, in normalised coordinates
+		float m_left;
+		float m_top;
+		float m_boxWidth;
+		float m_boxHeight;
+		float m_barLeft;
+		float m_slotWidth;
+		float m_staffY;
+		float m_headWidth;
+		float m_headHeight;
+		float m_stemWidth;
+		float m_stemTop;
+		float m_lineHeight;
+
+		TextureBox m_solid;
+		TextureBox m_filledHead;
+		TextureBox m_hollowHead;
+		TextureBox m_accent;
+
+		TextureBox GlyphBox(char c) const;
+		void PutQuad(std::vector<structures::VertexTexCoord>& vertices, int index, float x1, float y1, float x2, float y2, const TextureBox& box, float stepTag) const;
+		void PutNothing(std::vector<structures::VertexTexCoord>& vertices, int index, float stepTag) const;
+		void PutText(std::vector<structures::VertexTexCoord>& vertices, int index, const std::string& text, float left, float top, float boxWidth, float boxHeight) const;
+		void WriteHeader(std::vector<structures::VertexTexCoord>& vertices) const;
+		void WriteStep(std::vector<structures::VertexTexCoord>& vertices, int index, int step) const;
+		void WriteBeat(std::vector<structures::VertexTexCoord>& vertices, int index, int beat) const;
+		float GetStemLeft(int step) const;
+	};
+}
@@ -0,0 +1,51 @@
+#include "pch.h"
+#include "NotationShader.h"
+
+shader::NotationShader::NotationShader() : BaseShader(L"NotationVertexShader.cso", L"NotationPixelShader.cso"), m_constantBufferData()
+{
+	m_constantBufferData.highlightedStep = -1.0f;
+}
+
+std::vector<D3D11_INPUT_ELEMENT_DESC> shader::NotationShader::makeInputDescription()
+{
+	return {
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+}
+
+bool shader::NotationShader::VertexShaderUsesConstantBuffer()
+{
+	return true;
+}
+
+bool shader::NotationShader::PixelShaderUsesConstantBuffer()
+{
+	return false;
+}
+
+UINT shader::NotationShader::GetConstantBufferSize()
+{
+	return sizeof(structures::NotationConstantBuffer);
+}
+
+void* shader::NotationShader::GetConstantBufferData()
+{
+	return &m_constantBufferData;
+}
+
+void shader::NotationShader::SetPaintColor(float r, float g, float b, float a)
+{
+	m_constantBufferData.color = { r, g, b, a };
+}
+
+void shader::NotationShader::SetHighlightColor(float r, float g, float b, float a)
+{
+	m_constantBufferData.highlightColor = { r, g, b, a };
+}
+
+// A negative step highlights nothing
+void shader::NotationShader::SetHighlightedStep(int step)
+{
+	m_constantBufferData.highlightedStep = (float)step;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../BaseShader.h"
+#include "../../ShaderStructures.h"
+
+namespace shader
+{
+	// Draws a NotationLayout with the font texture. The step being played is picked out by constant buffer data
+	// alone, so moving the highlight never touches the vertex buffer.
+	class NotationShader : public BaseShader {
+	public:
+		NotationShader();
+		void SetPaintColor(float r, float g, float b, float a);
+		void SetHighlightColor(float r, float g, float b, float a);
+		void SetHighlightedStep(int step);
+	protected:
+		std::vector<D3D11_INPUT_ELEMENT_DESC> makeInputDescription() override;
+		bool VertexShaderUsesConstantBuffer() override;
+		bool PixelShaderUsesConstantBuffer() override;
+		UINT GetConstantBufferSize() override;
+		void* GetConstantBufferData() override;
+	private:
+		structures::NotationConstantBuffer m_constantBufferData;
+	};
+}
@@ -0,0 +1,58 @@
+#include "pch.h"
+#include "OverlayTexturePixels.h"
+
+void texture::GenerateOverlayTexturePixels(float screenDpi, std::vector<byte>& textureData, int& width, int& height)
+{
+	// Determine sizes and create the data array
+	const float cornerRadiusLogicalInches = 0.25f;
+	const byte alphaLevel = 0x80;
+	const int cornerRadiusPixels = (int)(cornerRadiusLogicalInches * screenDpi);
+	const int rowStrideBytes = 4 * 2 * cornerRadiusPixels;
+	const int sectionOffsetBytes = 4 * cornerRadiusPixels;
+	textureData.resize(rowStrideBytes * cornerRadiusPixels * 2);
+	std::fill(textureData.begin(), textureData.end(), 0xff);
+
+	// Output dimensions
+	width = 2 * cornerRadiusPixels;
+	height = 2 * cornerRadiusPixels;
+
+	// Generate the top-left section (rounded corner)
+	for (int j = 0; j < cornerRadiusPixels; j++) {
+		int index = j * rowStrideBytes;
+		const int transparentPixels = (int)(cornerRadiusPixels - sqrt(max(0.0, 2.0 * j * cornerRadiusPixels - j * j)));
+		for (int i = 0; i < cornerRadiusPixels; i++) {
+			const byte pixelAlpha = i <= transparentPixels ? 0 : alphaLevel;
+			textureData[index + 3] = pixelAlpha;
+			index += 4;
+		}
+	}
+
+	// Generate the top-right section (solid colour)
+	for (int j = 0; j < cornerRadiusPixels; j++) {
+		int index = j * rowStrideBytes + sectionOffsetBytes;
+		for (int i = 0; i < cornerRadiusPixels; i++) {
+			textureData[index + 3] = alphaLevel;
+			index += 4;
+		}
+	}
+
+	// Generate the bottom-left section (inner corner)
+	for (int j = 0; j < cornerRadiusPixels; j++) {
+		int index = (cornerRadiusPixels + j) * rowStrideBytes;
+		const int transparentPixels = (int)sqrt(max(0.0, 2.0 * j * cornerRadiusPixels - j * j));
+		for (int i = 0; i < cornerRadiusPixels; i++) {
+			const int pixelAlpha = i <= transparentPixels ? 0 : alphaLevel;
+			textureData[index + 3] = pixelAlpha;
+			index += 4;
+		}
+	}
+
+	// Generate the right section (fully transparent)
+	for (int j = 0; j < cornerRadiusPixels; j++) {
+		int index = (cornerRadiusPixels + j) * rowStrideBytes + sectionOffsetBytes;
+		for (int i = 0; i < cornerRadiusPixels; i++) {
+			textureData[index + 3] = 0;
+			index += 4;
+		}
+	}
+}
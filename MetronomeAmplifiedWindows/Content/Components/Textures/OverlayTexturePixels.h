@@ -0,0 +1,7 @@
+#pragma once
+
+namespace texture
+{
+	// Generates the RGBA pixels of the translucent rounded-corner overlay texture for the given screen DPI
+	void GenerateOverlayTexturePixels(float screenDpi, std::vector<byte>& textureData, int& width, int& height);
+}
@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "NotationVertexBuffer.h"
+
+#include "../../../Common/DeviceResources.h"
+
+vbo::NotationVertexBuffer::NotationVertexBuffer() :
+	m_left(0.0f),
+	m_top(0.0f),
+	m_boxWidth(0.0f),
+	m_boxHeight(0.0f),
+	m_layout()
+{
+}
+
+bool vbo::NotationVertexBuffer::IsSizeDependent()
+{
+	return true;
+}
+
+// Only finds the notation's box; nothing is drawn until a section is shown
+void vbo::NotationVertexBuffer::Initialise(DX::DeviceResources* resources)
+{
+	// Guidelines from MainScreenTranslucentOverlayVertexBuffer, inside the panel between h4 and h5
+	winrt::Windows::Foundation::Size size = resources->GetOutputSize();
+	const float marginLogicalInches = 0.25f;
+	const float dpi = resources->GetDpi();
+	const float marginUnitsW = 2.0f * (marginLogicalInches * dpi) / size.Width;
+	const float marginUnitsH = 2.0f * (marginLogicalInches * dpi) / size.Height;
+	const float w2 = -1.0f + 2.0f * marginUnitsW;
+	const float w9 = 1.0f - 2.0f * marginUnitsW;
+	const float h4 = -1.0f + (2.0f - marginUnitsH) / 4.0f;
+	const float h5 = -2.0f * marginUnitsH;
+
+	m_left = w2;
+	m_top = h5 - 0.5f * marginUnitsH;
+	m_boxWidth = w9 - w2;
+	m_boxHeight = m_top - h4 - 0.5f * marginUnitsH;
+	m_layout = notation::NotationLayout();
+	m_subBufferVertexIndices = { 0, 0 };
+	m_regionsOfInterest = {};
+	m_vertexBuffer = nullptr;
+	m_isValid = true;
+}
+
+/// <summary>
+/// Lay out a section's bar and replace the whole buffer. The buffer has default usage rather than dynamic,
+/// since edits write small ranges in place with UpdateSubresource1 instead of mapping the whole buffer.
+/// </summary>
+void vbo::NotationVertexBuffer::ShowSection(DX::DeviceResources* resources, const audio::SongSection& section)
+{
+	font::Font* orkney = resources->GetOrkneyFont();
+	if (orkney == nullptr) {
+		return;
+	}
+	m_layout.Layout(orkney, section, m_left, m_top, m_boxWidth, m_boxHeight, resources->GetOutputSize());
+	const std::vector<structures::VertexTexCoord>& vboData = m_layout.GetVertices();
+	m_subBufferVertexIndices = { 0, (unsigned int)vboData.size() };
+	m_regionsOfInterest = m_layout.GetStepRegions();
+
+	D3D11_SUBRESOURCE_DATA vertexBufferData = { 0 };
+	vertexBufferData.pSysMem = vboData.data();
+	vertexBufferData.SysMemPitch = 0;
+	vertexBufferData.SysMemSlicePitch = 0;
+	CD3D11_BUFFER_DESC vertexBufferDesc((UINT)(vboData.size() * sizeof(structures::VertexTexCoord)), D3D11_BIND_VERTEX_BUFFER);
+	m_vertexBuffer = nullptr;
+	winrt::check_hresult(
+		resources->GetD3DDevice()->CreateBuffer(
+			&vertexBufferDesc,
+			&vertexBufferData,
+			m_vertexBuffer.put()
+		)
+	);
+}
+
+void vbo::NotationVertexBuffer::SetNote(ID3D11DeviceContext3* context, int step, audio::PatternNote note)
+{
+	const notation::VertexRange range = m_layout.SetNote(step, note);
+	if (range.IsEmpty() || !m_vertexBuffer) {
+		return;
+	}
+	const D3D11_BOX box = { range.GetByteOffset(), 0, 0, range.GetByteOffset() + range.GetByteLength(), 1, 1 };
+	context->UpdateSubresource1(
+		m_vertexBuffer.get(),
+		0,
+		&box,
+		m_layout.GetVertices().data() + range.firstVertex,
+		0,
+		0,
+		0
+	);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../BaseVertexBuffer.h"
+#include "../NotationLayout.h"
+
+namespace vbo
+{
+	// The current section's bar as notation, in the main screen's section panel. The buffer is rebuilt when a
+	// different bar is shown, and a single edited note only updates the bytes that changed.
+	class NotationVertexBuffer : public BaseVertexBuffer {
+	public:
+		NotationVertexBuffer();
+		virtual bool IsSizeDependent() override;
+		void ShowSection(DX::DeviceResources* resources, const audio::SongSection& section);
+		void SetNote(ID3D11DeviceContext3* context, int step, audio::PatternNote note);
+		inline bool IsShowing(const audio::SongSection& section) const { return m_layout.IsShowing(section); }
+	protected:
+		virtual void Initialise(DX::DeviceResources* resources) override;
+	private:
+		float m_left;
+		float m_top;
+		float m_boxWidth;
+		float m_boxHeight;
+		notation::NotationLayout m_layout;
+	};
+}
@@ -2,6 +2,7 @@
 #include "SettingsNavigatingTextsVertexBuffer.h"
 
 #include "../../../Common/DeviceResources.h"
+#include "../../HelpTexts.h"
 
 vbo::SettingsNavigatingTextsVertexBuffer::SettingsNavigatingTextsVertexBuffer()
 {
@@ -37,17 +38,7 @@ void vbo::SettingsNavigatingTextsVertexBuffer::Initialise(DX::DeviceResources* r
 	const float h3 = h4 - 2.0f * marginUnitsH;
 
 	std::vector<structures::VertexTexCoord> vboData;
-	std::vector<std::string> labels = {
-		"Navigating the App",
-		"The pattern of percussive beats you'll play along with are displayed here. The time signature is shown, along with the timing of each note, in case you're familiar with musical notation. A song consists of one or more of these sections, each with its own note pattern, and therefore can be very simple or very complex.",
-		"Playback is controlled with the buttons at the bottom. Fast-forward and rewind have a use only with songs that have multiple sections. Pausing will halt the current position in the current section, while stopping will reset the playback position to the beginning.",
-		"A section of a song has a default tempo, although the tempo it is being played at can vary. Tapping the beat-per-minute count will reset to the default tempo, while the slider allows free manual adjustments.",
-		"Training modes exist to alter the tempo automatically while you play, or set a limit to how long you'd like to play. Pressing the One-touch Tempo Lift button will begin tempo control, and this feature can be customised through the settings screen.",
-		"The timer will allow you to set a timespan before the metronome stops playing.",
-		"There is more than one set of sounds that the metronome can play - they can be loaded by pressing the Tone button.",
-		"The song and its sections can be fully customised by tapping the Song button.",
-		"Various settings are accessible by tapping the Settings button. These settings control the Tempo Lift behaviour, as well as visual cues to coincide with the sounds you here."
-	};
+	std::vector<std::string> labels = strings::GetNavigatingTheAppTexts();
 	int totalStructCount = 0;
 	for (auto& label : labels) {
 		totalStructCount += 6 * label.length();
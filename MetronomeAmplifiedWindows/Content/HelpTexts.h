@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace strings {
+
+	// Heading followed by the body of each card in the "Navigating the App" help section
+	const std::vector<std::string>& GetNavigatingTheAppTexts();
+}
@@ -3,19 +3,44 @@
 
 #include "../Common/DirectXHelper.h"
 #include "../Components/Shaders/FontShader.h"
+#include "../Components/Shaders/NotationShader.h"
+#include "../Components/VertexBuffers/NotationVertexBuffer.h"
 #include "SettingsHubScene.h"
 
 using namespace MetronomeAmplifiedWindows;
 
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 MainSceneRenderer::MainSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
-	m_deviceResources(deviceResources)
+	m_deviceResources(deviceResources),
+	m_section(),
+	m_playingStep(-1)
 {
+	// Until a song is loaded, show a bar of 4/4 in eighth notes with ghosted offbeats
+	m_section.name = "";
+	m_section.beatsPerBar = 4;
+	m_section.beatUnit = 4;
+	m_section.stepsPerBeat = 2;
+	m_section.barCount = 1;
+	m_section.beatsPerMinute = 120.0;
+	for (int step = 0; step < m_section.GetStepsPerBar(); step++) {
+		m_section.pattern.push_back(step == 0 ? audio::PatternNote::ACCENT : step % 2 == 0 ? audio::PatternNote::NORMAL : audio::PatternNote::GHOST);
+	}
+}
+
+void MainSceneRenderer::ShowSection(const audio::SongSection& section)
+{
+	m_section = section;
+}
+
+// Only moves the highlight in the notation shader's constant buffer
+void MainSceneRenderer::SetPlayingStep(int step)
+{
+	m_playingStep = step;
 }
 
 std::vector<shader::ClassId> MainSceneRenderer::GetRequiredShaders()
 {
-	return { shader::ClassId::ALPHA_TEXTURE, shader::ClassId::FONT };
+	return { shader::ClassId::ALPHA_TEXTURE, shader::ClassId::FONT, shader::ClassId::NOTATION };
 }
 
 std::vector<texture::ClassId> MainSceneRenderer::GetRequiredSizeIndependentTextures()
@@ -35,7 +60,7 @@ std::vector<vbo::ClassId> MainSceneRenderer::GetRequiredSizeIndependentVertexBuf
 
 std::vector<vbo::ClassId> MainSceneRenderer::GetRequiredSizeDependentVertexBuffers()
 {
-	return { vbo::ClassId::BG, vbo::ClassId::MAIN_SCREEN_TRANSLUCENT_OVERLAY, vbo::ClassId::MAIN_SCREEN_ICONS, vbo::ClassId::MAIN_SCREEN_ICON_LABELS };
+	return { vbo::ClassId::BG, vbo::ClassId::MAIN_SCREEN_TRANSLUCENT_OVERLAY, vbo::ClassId::MAIN_SCREEN_ICONS, vbo::ClassId::MAIN_SCREEN_ICON_LABELS, vbo::ClassId::NOTATION };
 }
 
 // Called once per frame, updates the cbuffer struct as needed.
@@ -122,9 +147,30 @@ void MainSceneRenderer::Render()
 		fontVertexBuffer->VerticesInSubBuffer(0),
 		0
 	);
+
+	// Lay out the section's notation again only if another bar is shown, or the buffer was rebuilt
+	vbo::NotationVertexBuffer* notationVertexBuffer = dynamic_cast<vbo::NotationVertexBuffer*>(m_deviceResources->GetVertexBuffer(vbo::ClassId::NOTATION));
+	if (!notationVertexBuffer->IsShowing(m_section)) {
+		notationVertexBuffer->ShowSection(m_deviceResources.get(), m_section);
+		m_deviceResources->RefreshRegionsOfInterest(vbo::ClassId::NOTATION);
+	}
+
+	// Draw notation, using the font texture already set
+	if (notationVertexBuffer->VerticesInSubBuffer(0) > 0) {
+		shader::NotationShader* notationShader = dynamic_cast<shader::NotationShader*>(m_deviceResources->GetShader(shader::ClassId::NOTATION));
+		notationShader->SetPaintColor(0.96f, 0.87f, 0.70f, 1.0f);
+		notationShader->SetHighlightColor(1.0f, 0.62f, 0.24f, 1.0f);
+		notationShader->SetHighlightedStep(m_playingStep);
+		notationShader->Activate(context);
+		notationVertexBuffer->Activate(context);
+		context->Draw(
+			notationVertexBuffer->VerticesInSubBuffer(0),
+			0
+		);
+	}
 }
 
-void MainSceneRenderer::OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY)
+void MainSceneRenderer::OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY, double inputSeconds)
 {
 	// Make sure VBOs are initialised
 	if (!m_deviceResources->AreShadersFulfilled() || !m_deviceResources->AreTexturesFulfilled() || !m_deviceResources->AreVertexBuffersFulfilled())
@@ -132,10 +178,21 @@ void MainSceneRenderer::OnPointerPressed(StackHost* stackHost, float normalisedX
 		return;
 	}
 
-	// Check for region 2 in icons VBO
-	auto iconsVertexBuffer = m_deviceResources->GetVertexBuffer(vbo::ClassId::MAIN_SCREEN_ICONS);
-	int vboRegion = iconsVertexBuffer->RegionOfInterestAt(normalisedX, normalisedY);
-	if (vboRegion == 2) {
+	// Check for the settings icon (region 2 in icons VBO)
+	const geometry::WidgetId settingsIcon((int)vbo::ClassId::MAIN_SCREEN_ICONS, 2);
+	geometry::WidgetId widget = m_deviceResources->WidgetAt(normalisedX, normalisedY, GetRequiredSizeDependentVertexBuffers());
+	if (widget == settingsIcon) {
 		stackHost->pushScene(new SettingsHubScene(m_deviceResources));
+	} else if (widget.layer == (int)vbo::ClassId::NOTATION) {
+		// Tapping a step cycles it from rest through ghost, normal and accent, rewriting only what changed. The
+		// regions may still be those of a section replaced since the last frame.
+		vbo::NotationVertexBuffer* notationVertexBuffer = dynamic_cast<vbo::NotationVertexBuffer*>(m_deviceResources->GetVertexBuffer(vbo::ClassId::NOTATION));
+		if (!notationVertexBuffer->IsShowing(m_section)) {
+			return;
+		}
+		const int step = widget.region;
+		const audio::PatternNote note = (audio::PatternNote)(((int)m_section.pattern[step] + 1) % 4);
+		m_section.pattern[step] = note;
+		notationVertexBuffer->SetNote(m_deviceResources->GetD3DDeviceContext(), step, note);
 	}
 }
@@ -3,6 +3,7 @@
 #include "..\Common\DeviceResources.h"
 #include "..\Common\StepTimer.h"
 #include "..\Traits.h"
+#include "..\..\Audio\Songs\Song.h"
 
 namespace MetronomeAmplifiedWindows
 {
@@ -13,6 +14,10 @@ namespace MetronomeAmplifiedWindows
 		void ReleaseDeviceDependentResources();
 		virtual void Update(double timeDiffSeconds) override;
 
+		// The section whose bar is drawn as notation, and the step being played in it; -1 for none
+		void ShowSection(const audio::SongSection& section);
+		void SetPlayingStep(int step);
+
 		// Renderable
 		virtual void Render() override;
 
@@ -24,11 +29,14 @@ namespace MetronomeAmplifiedWindows
 		virtual std::vector<vbo::ClassId> GetRequiredSizeDependentVertexBuffers() override;
 
 		// Scene
-		virtual void OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY) override;
+		virtual void OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY, double inputSeconds) override;
 
 	private:
 		// Cached pointer to device resources.
 		std::shared_ptr<DX::DeviceResources> m_deviceResources;
+
+		audio::SongSection m_section;
+		int m_playingStep;
 	};
 }
 
@@ -106,7 +106,7 @@ void SettingsHubScene::Render()
 	);
 }
 
-void SettingsHubScene::OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY)
+void SettingsHubScene::OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY, double inputSeconds)
 {
 	// Make sure VBOs are initialised
 	if (!m_deviceResources->AreShadersFulfilled() || !m_deviceResources->AreTexturesFulfilled() || !m_deviceResources->AreVertexBuffersFulfilled())
@@ -114,10 +114,10 @@ void SettingsHubScene::OnPointerPressed(StackHost* stackHost, float normalisedX,
 		return;
 	}
 
-	// Check for region 0 in text labels VBO
-	auto textsVertexBuffer = m_deviceResources->GetVertexBuffer(vbo::ClassId::SETTINGS_HUB_LABELS);
-	int vboRegion = textsVertexBuffer->RegionOfInterestAt(normalisedX, normalisedY);
-	if (vboRegion == 0) {
+	// Check for the first help section label (region 0 in text labels VBO)
+	const geometry::WidgetId navigatingLabel((int)vbo::ClassId::SETTINGS_HUB_LABELS, 0);
+	geometry::WidgetId widget = m_deviceResources->WidgetAt(normalisedX, normalisedY, GetRequiredSizeDependentVertexBuffers());
+	if (widget == navigatingLabel) {
 		stackHost->pushScene(new SettingsNavigationScene(m_deviceResources));
 	}
 }
@@ -24,7 +24,7 @@ namespace MetronomeAmplifiedWindows
 		virtual std::vector<vbo::ClassId> GetRequiredSizeDependentVertexBuffers() override;
 
 		// Scene
-		virtual void OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY) override;
+		virtual void OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY, double inputSeconds) override;
 
 	private:
 		// Cached pointer to device resources.
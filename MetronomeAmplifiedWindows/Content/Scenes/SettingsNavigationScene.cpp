@@ -13,10 +13,9 @@ SettingsNavigationScene::SettingsNavigationScene(const std::shared_ptr<DX::Devic
 	m_identityMatrix{ DirectX::XMMatrixIdentity() },
 	m_transformLeftMatrix{ DirectX::XMMatrixIdentity() },
 	m_transformRightMatrix{ DirectX::XMMatrixIdentity() },
-	m_isAnimating(false),
+	m_shuffle(),
 	m_focusCard(0),
-	m_animateToTheRight(false),
-	m_animationProgress(0.0f)
+	m_animateToTheRight(false)
 {
 }
 
@@ -90,7 +89,7 @@ void SettingsNavigationScene::Render()
 	
 	// Draw the overlay and the sample image, once or twice depending on animation state
 	m_deviceResources->ActivatePointSamplerState();
-	if (!m_isAnimating) {
+	if (!m_shuffle.IsAnimating()) {
 
 		overlayTexture->Activate(context);
 		overlayVertexBuffer->Activate(context);
@@ -170,7 +169,7 @@ void SettingsNavigationScene::Render()
 	fontShader->SetPaintColor(0.0f, 0.0f, 0.0f, 1.0f);
 
 	// Draw one or two contents sections depending on animation state
-	if (!m_isAnimating) {
+	if (!m_shuffle.IsAnimating()) {
 		fontShader->Activate(context);
 		context->Draw(
 			fontVertexBuffer->VerticesInSubBuffer(m_focusCard + 1),
@@ -202,7 +201,7 @@ void SettingsNavigationScene::Render()
 	}
 }
 
-void SettingsNavigationScene::OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY)
+void SettingsNavigationScene::OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY, double inputSeconds)
 {
 	// Make sure VBOs are initialised
 	if (!m_deviceResources->AreShadersFulfilled() || !m_deviceResources->AreTexturesFulfilled() || !m_deviceResources->AreVertexBuffersFulfilled())
@@ -210,66 +209,62 @@ void SettingsNavigationScene::OnPointerPressed(StackHost* stackHost, float norma
 		return;
 	}
 
-	// Check for regions 0 and 1 in icons VBO
-	auto iconsVertexBuffer = m_deviceResources->GetVertexBuffer(vbo::ClassId::HELP_DETAILS_ICONS);
-	int vboRegion = iconsVertexBuffer->RegionOfInterestAt(normalisedX, normalisedY);
-	if (vboRegion == 0) {
+	// Check for the previous and next arrows (regions 0 and 1 in icons VBO)
+	const geometry::WidgetId previousArrow((int)vbo::ClassId::HELP_DETAILS_ICONS, 0);
+	const geometry::WidgetId nextArrow((int)vbo::ClassId::HELP_DETAILS_ICONS, 1);
+	geometry::WidgetId widget = m_deviceResources->WidgetAt(normalisedX, normalisedY, GetRequiredSizeDependentVertexBuffers());
+	if (widget == previousArrow) {
 		MoveToPrevious();
 	}
-	else if (vboRegion == 1) {
+	else if (widget == nextArrow) {
 		MoveToNext();
 	}
 }
 
 void SettingsNavigationScene::MoveToNext()
 {
-	if (m_isAnimating || (m_focusCard >= 7)) {
+	if (m_shuffle.IsAnimating() || (m_focusCard >= 7)) {
 		return;
 	}
 	m_focusCard++;
-	m_isAnimating = true;
+	m_shuffle.Start();
 	m_animateToTheRight = false;
-	m_animationProgress = 0.0f;
 }
 
 void SettingsNavigationScene::MoveToPrevious()
 {
-	if (m_isAnimating || (m_focusCard == 0)) {
+	if (m_shuffle.IsAnimating() || (m_focusCard == 0)) {
 		return;
 	}
 	m_focusCard--;
-	m_isAnimating = true;
+	m_shuffle.Start();
 	m_animateToTheRight = true;
-	m_animationProgress = 0.0f;
 }
 
 void SettingsNavigationScene::UpdateMatrices(double timeDeltaSeconds)
 {
-	const float animationDuration = 0.3f;
-	if (m_isAnimating) {
-		m_animationProgress += (float)(timeDeltaSeconds / animationDuration);
-		if (m_animationProgress >= 1.0f) {
+	if (m_shuffle.IsAnimating()) {
+		if (!m_shuffle.Advance(timeDeltaSeconds)) {
 			m_transformRightMatrix = DirectX::XMMatrixIdentity();
-			m_animationProgress = 1.0f;
-			m_isAnimating = false;
 			return;
 		}
-		const float scaleOut = 0.66666667f + animationDuration / (9.0f * m_animationProgress + 3.0f * animationDuration);
-		const float scaleIn = 0.66666667f + animationDuration / (9.0f * (1.0f - m_animationProgress) + 3.0f * animationDuration);
+		const float progress = m_shuffle.GetProgress();
+		const float scaleOut = m_shuffle.GetScaleOut();
+		const float scaleIn = m_shuffle.GetScaleIn();
 
 		if (m_animateToTheRight) {
 			m_transformLeftMatrix = DirectX::XMMatrixMultiply(
-				DirectX::XMMatrixTranslation(2.0f * (-1.0f + m_animationProgress) / scaleIn, 0.0f, 0.0f),
+				DirectX::XMMatrixTranslation(2.0f * (-1.0f + progress) / scaleIn, 0.0f, 0.0f),
 				DirectX::XMMatrixScaling(scaleIn, scaleIn, 1.0f));
 			m_transformRightMatrix = DirectX::XMMatrixMultiply(
-				DirectX::XMMatrixTranslation(2.0f * m_animationProgress / scaleOut, 0.0f, 0.0f),
+				DirectX::XMMatrixTranslation(2.0f * progress / scaleOut, 0.0f, 0.0f),
 				DirectX::XMMatrixScaling(scaleOut, scaleOut, 1.0f));
 		} else {
 			m_transformLeftMatrix = DirectX::XMMatrixMultiply(
-				DirectX::XMMatrixTranslation(-2.0f * m_animationProgress / scaleOut, 0.0f, 0.0f),
+				DirectX::XMMatrixTranslation(-2.0f * progress / scaleOut, 0.0f, 0.0f),
 				DirectX::XMMatrixScaling(scaleOut, scaleOut, 1.0f));
 			m_transformRightMatrix = DirectX::XMMatrixMultiply(
-				DirectX::XMMatrixTranslation(2.0f * (1.0f - m_animationProgress) / scaleIn, 0.0f, 0.0f),
+				DirectX::XMMatrixTranslation(2.0f * (1.0f - progress) / scaleIn, 0.0f, 0.0f),
 				DirectX::XMMatrixScaling(scaleIn, scaleIn, 1.0f));
 		}
 	} else {
@@ -2,6 +2,7 @@
 
 #include "../Common/DeviceResources.h"
 #include "../Common/StepTimer.h"
+#include "../Components/CardShuffle.h"
 #include "../Traits.h"
 
 namespace MetronomeAmplifiedWindows
@@ -24,7 +25,7 @@ namespace MetronomeAmplifiedWindows
 		virtual std::vector<vbo::ClassId> GetRequiredSizeDependentVertexBuffers() override;
 
 		// Scene
-		virtual void OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY) override;
+		virtual void OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY, double inputSeconds) override;
 
 	private:
 		// Cached pointer to device resources.
@@ -36,10 +37,9 @@ namespace MetronomeAmplifiedWindows
 		DirectX::XMMATRIX m_transformRightMatrix;
 
 		// State for animating
-		bool m_isAnimating;
+		animation::CardShuffle m_shuffle;
 		int m_focusCard;
 		bool m_animateToTheRight;
-		float m_animationProgress;
 
 		void MoveToNext();
 		void MoveToPrevious();
@@ -0,0 +1,19 @@
+// Globals
+Texture2D shaderTexture;
+SamplerState sampleType;
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float2 tex : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+// Font texture alpha, in the colour chosen per vertex
+float4 main(PixelShaderInput input) : SV_TARGET
+{
+	float4 sampleColor;
+	sampleColor = shaderTexture.Sample(sampleType, input.tex);
+
+	return float4(input.color.xyz, sampleColor.w * input.color.w);
+}
@@ -0,0 +1,32 @@
+// Paint colours, and the step to draw in the highlight colour
+cbuffer NotationConstantBuffer : register(b0)
+{
+	float4 paintColor;
+	float4 highlightColor;
+	float highlightedStep;
+};
+
+struct VertexShaderInput
+{
+	float3 pos : POSITION;
+	float3 tex : TEXCOORD0;
+};
+
+struct PixelShaderInput
+{
+	float4 pos : SV_POSITION;
+	float2 tex : TEXCOORD0;
+	float4 color : COLOR0;
+};
+
+// The third texture coordinate holds the step a vertex belongs to, or -1 for shared parts such as beams
+PixelShaderInput main(VertexShaderInput input)
+{
+	PixelShaderInput output;
+
+	output.pos = float4(input.pos, 1.0f);
+	output.tex = input.tex.xy;
+	output.color = (input.tex.z >= 0.0f && abs(input.tex.z - highlightedStep) < 0.5f) ? highlightColor : paintColor;
+
+	return output;
+}
@@ -21,6 +21,15 @@ namespace structures
 		DirectX::XMFLOAT4 color;
 	};
 
+	// Constant buffer for notation: paint colour, highlight colour and the step to highlight, padded to 16 bytes
+	struct NotationConstantBuffer
+	{
+		DirectX::XMFLOAT4 color;
+		DirectX::XMFLOAT4 highlightColor;
+		float highlightedStep;
+		DirectX::XMFLOAT3 padding;
+	};
+
 	// Used to send position and texture coordinate per-vertex data to the vertex shader
 	struct VertexTexCoord
 	{
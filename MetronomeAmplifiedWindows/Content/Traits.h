@@ -23,7 +23,10 @@ public:
 
 class Scene : public Renderable, public UsesCachedResources {
 public:
-	virtual void OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY) = 0;
+	// The input time is when the pointer went down, in seconds since the system started as PointerPoint::Timestamp
+	// gives it, rather than when the event was handled, so that taps can be timed to within the input device's own
+	// resolution.
+	virtual void OnPointerPressed(StackHost* stackHost, float normalisedX, float normalisedY, double inputSeconds) = 0;
 };
 
 class StackHost {
@@ -6,7 +6,8 @@
 cache::VertexBufferCache::VertexBufferCache() : m_vertexBuffers(),
     m_sizeIndependentBuffersAreFulfilled(true),
     m_sizeDependentBuffersAreFulfilled(true),
-    m_orkneyFont(nullptr)
+    m_orkneyFont(nullptr),
+    m_hitTestIndex()
 {
 }
 
@@ -96,6 +97,7 @@ void cache::VertexBufferCache::BuildVertexBuffers(DX::DeviceResources* resources
         vertexBuffer = vbo::BaseVertexBuffer::NewFromClassId(classId);
         vertexBuffer->Initialise(resources);
         m_vertexBuffers[classId] = vertexBuffer;
+        m_hitTestIndex.SetLayer((int)classId, vertexBuffer->GetRegionsOfInterest());
     }
 }
 
@@ -104,12 +106,29 @@ vbo::BaseVertexBuffer* cache::VertexBufferCache::GetVertexBuffer(vbo::ClassId ve
     return m_vertexBuffers[vertexBufferClass];
 }
 
+// Finds the interactive region at a point, considering only the regions of the given vertex buffers
+geometry::WidgetId cache::VertexBufferCache::WidgetAt(float xNormalised, float yNormalised, const std::vector<vbo::ClassId>& vertexBufferClasses)
+{
+    uint64_t layerMask = 0;
+    for (auto classId : vertexBufferClasses) {
+        layerMask |= geometry::HitTestIndex::LayerBit((int)classId);
+    }
+    return m_hitTestIndex.WidgetAt(xNormalised, yNormalised, layerMask);
+}
+
+// For buffers whose regions change after they are built
+void cache::VertexBufferCache::RefreshRegionsOfInterest(vbo::ClassId vertexBufferClass)
+{
+    m_hitTestIndex.SetLayer((int)vertexBufferClass, m_vertexBuffers[vertexBufferClass]->GetRegionsOfInterest());
+}
+
 void cache::VertexBufferCache::Clear()
 {
     for (auto vertexBuffer : m_vertexBuffers) {
         vertexBuffer.second->Reset();
     }
     m_vertexBuffers.clear();
+    m_hitTestIndex.Clear();
     if (m_orkneyFont) {
         delete m_orkneyFont;
     }
@@ -121,6 +140,7 @@ void cache::VertexBufferCache::InvalidateSizeDependentVertexBuffers()
     for (auto vertexBuffer : m_vertexBuffers) {
         if (vertexBuffer.second->IsSizeDependent()) {
             vertexBuffer.second->Reset();
+            m_hitTestIndex.RemoveLayer((int)vertexBuffer.first);
         }
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Components/BaseVertexBuffer.h"
+#include "Components/HitTestIndex.h"
 #include "Common/Font.h"
 
 #include <map>
@@ -13,6 +14,7 @@ namespace cache {
 		bool m_sizeIndependentBuffersAreFulfilled;
 		bool m_sizeDependentBuffersAreFulfilled;
         font::Font* m_orkneyFont;
+		geometry::HitTestIndex m_hitTestIndex;
 
 		void BuildVertexBuffers(DX::DeviceResources* resources, std::vector<vbo::ClassId> vertexBufferClasses);
 
@@ -24,6 +26,8 @@ namespace cache {
 		inline bool AreVertexBuffersFulfilled() { return m_sizeIndependentBuffersAreFulfilled && m_sizeDependentBuffersAreFulfilled; }
 		vbo::BaseVertexBuffer* GetVertexBuffer(vbo::ClassId vertexBufferClass);
 		inline font::Font* GetOrkneyFont() { return m_orkneyFont; }
+		geometry::WidgetId WidgetAt(float xNormalised, float yNormalised, const std::vector<vbo::ClassId>& vertexBufferClasses);
+		void RefreshRegionsOfInterest(vbo::ClassId vertexBufferClass);
 		void Clear();
 		void InvalidateSizeDependentVertexBuffers();
 	};
@@ -69,11 +69,11 @@ bool MetronomeAmplifiedWindowsMain::Render()
 	return true;
 }
 
-void MetronomeAmplifiedWindowsMain::OnPointerPressed(float normalisedX, float normalisedY)
+void MetronomeAmplifiedWindowsMain::OnPointerPressed(float normalisedX, float normalisedY, double inputSeconds)
 {
 	Scene* topScene = GetTopScene();
 	if (topScene != nullptr) {
-		topScene->OnPointerPressed(this, normalisedX, normalisedY);
+		topScene->OnPointerPressed(this, normalisedX, normalisedY, inputSeconds);
 	}
 }
 
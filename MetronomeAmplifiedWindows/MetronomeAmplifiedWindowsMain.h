@@ -16,7 +16,7 @@ namespace MetronomeAmplifiedWindows
 		void CreateWindowSizeDependentResources();
 		void Update();
 		bool Render();
-		void OnPointerPressed(float normalisedX, float normalisedY);
+		void OnPointerPressed(float normalisedX, float normalisedY, double inputSeconds);
 
 		// IDeviceNotify
 		virtual void OnDeviceLost();
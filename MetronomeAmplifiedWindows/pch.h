@@ -1,8 +1,11 @@
 ﻿#pragma once
 
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include <unknwn.h>
 #include <winrt/Windows.ApplicationModel.Core.h>
 #include <winrt/Windows.Devices.Input.h>
+#include <winrt/Windows.Devices.Midi.h>
 #include <winrt/Windows.Foundation.Collections.h>
 #include <winrt/Windows.Gaming.Input.h>
 #include <winrt/Windows.Graphics.Display.h>